@@ -0,0 +1,41 @@
+#version 430 core
+layout (local_size_x = 64) in;
+
+// Matches DrawElementsIndirectCommand in GPUCuller.h
+struct DrawCommand {
+	uint count;
+	uint instanceCount;
+	uint firstIndex;
+	int baseVertex;
+	uint baseInstance;
+};
+
+layout (std430, binding = 0) readonly buffer Bounds { vec4 bounds[]; };	// xyz center, w radius
+layout (std430, binding = 1) readonly buffer Groups { uint groups[]; };
+layout (std430, binding = 2) buffer Commands { DrawCommand commands[]; };
+layout (std430, binding = 3) writeonly buffer Visible { uint visible[]; };
+
+uniform vec4 planes[6];
+uniform uint instanceCount;
+
+void main()
+{
+	uint i = gl_GlobalInvocationID.x;
+	if (i >= instanceCount)
+		return;
+
+	vec4 sphere = bounds[i];
+	bool inside = true;
+	for (int p = 0; p < 6; p++) {
+		// Same operation order as CullSpheres, precise keeps the compiler from fusing it
+		precise float d = (planes[p].x * sphere.x + planes[p].y * sphere.y) + (planes[p].z * sphere.z + planes[p].w);
+		inside = inside && d >= -sphere.w;
+	}
+	if (!inside)
+		return;
+
+	// Append to the group's slice of the visible list
+	uint group = groups[i];
+	uint slot = atomicAdd(commands[group].instanceCount, 1u);
+	visible[commands[group].baseInstance + slot] = i;
+}
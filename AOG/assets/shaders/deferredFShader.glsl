@@ -0,0 +1,176 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+// Same lights as lightingClusteredFShader.glsl, the surface comes from the G-buffer instead
+struct DirLight	{
+	vec3 direction;
+
+	vec3 ambient;
+	vec3 diffuse;
+	vec3 specular;
+};
+
+struct SpotLight {
+	vec3 position;
+	vec3 direction;
+
+	float cutOff;
+	float outerCutOff;
+
+	vec3 ambient;
+	vec3 diffuse;
+	vec3 specular;
+
+	float constant;
+	float linear;
+	float quadratic;
+};
+
+const float POINT_AMBIENT = 0.05;
+const float POINT_DIFFUSE = 0.8;
+const float POINT_SPECULAR = 1.0;
+
+// The half vector lobe is wider, this keeps the highlights the size Phong gave them
+const float BLINN_SHININESS_SCALE = 4.0;
+
+uniform vec3 viewPos;
+uniform DirLight dirLight;
+uniform SpotLight spotLight;
+uniform vec3 pointAttenuation;	// constant, linear, quadratic
+
+// G-buffer
+uniform sampler2D gAlbedoSpecular;
+uniform sampler2D gNormalShininess;
+uniform sampler2D gDepth;
+uniform mat4 inverseViewProjection;
+
+// Clusters, filled by LightClusters every frame
+uniform samplerBuffer clusterLights;
+uniform usamplerBuffer clusterGrid;
+uniform usamplerBuffer clusterIndices;
+uniform vec4 clusterDepth;		// near, far, slice scale, slice bias
+uniform vec4 clusterTile;		// tiles per pixel x / y, tiles x / y
+uniform int clusterSlices;
+
+// Cascaded shadow maps of the directional light, filled by ShadowCascades. cascadeCount 0 = no shadows
+uniform sampler2DArrayShadow shadowMap;
+uniform int cascadeCount;
+uniform mat4 cascadeMatrices[4];	// World to light clip space
+uniform vec4 cascadeSplits;		// Far view depth of each cascade
+uniform vec4 cascadeTexels;		// World size of a shadow map texel in each cascade
+uniform vec4 cascadeDepthPlane;	// View depth = dot(plane, vec4(p, 1))
+
+// 1 lit, 0 in shadow
+float ShadowFactor(vec3 fragPos, vec3 normal)
+{
+	float depth = dot(cascadeDepthPlane, vec4(fragPos, 1.0));
+	int cascade = 0;
+	while (cascade < cascadeCount && depth > cascadeSplits[cascade])
+		cascade++;
+	if (cascade >= cascadeCount)
+		return 1.0;
+
+	// Normal offset against acne, in texels of this cascade
+	vec4 clip = cascadeMatrices[cascade] * vec4(fragPos + normal * 1.5 * cascadeTexels[cascade], 1.0);
+	vec3 coords = clip.xyz * 0.5 + 0.5;
+	if (coords.z >= 1.0)
+		return 1.0;
+
+	// Four bilinear compares half a texel apart, a smooth 3x3 texel footprint
+	vec2 texel = 0.5 / vec2(textureSize(shadowMap, 0).xy);
+	float lit = texture(shadowMap, vec4(coords.xy + vec2(-texel.x, -texel.y), float(cascade), coords.z));
+	lit += texture(shadowMap, vec4(coords.xy + vec2(texel.x, -texel.y), float(cascade), coords.z));
+	lit += texture(shadowMap, vec4(coords.xy + vec2(-texel.x, texel.y), float(cascade), coords.z));
+	lit += texture(shadowMap, vec4(coords.xy + vec2(texel.x, texel.y), float(cascade), coords.z));
+	return lit * 0.25;
+}
+
+vec3 DecodeNormal(vec2 f)
+{
+	f = f * 2.0 - 1.0;
+	vec3 n = vec3(f, 1.0 - abs(f.x) - abs(f.y));
+	float t = clamp(-n.z, 0.0, 1.0);
+	n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+	return normalize(n);
+}
+
+int FindCluster(float windowDepth)
+{
+	float near = clusterDepth.x, far = clusterDepth.y;
+	float ndcZ = windowDepth * 2.0 - 1.0;
+	float depth = 2.0 * near * far / (far + near - ndcZ * (far - near));
+
+	int slice = clamp(int(log(depth) * clusterDepth.z + clusterDepth.w), 0, clusterSlices - 1);
+	ivec2 tiles = ivec2(clusterTile.zw);
+	ivec2 tile = clamp(ivec2(gl_FragCoord.xy * clusterTile.xy), ivec2(0), tiles - 1);
+	return (slice * tiles.y + tile.y) * tiles.x + tile.x;
+}
+
+// Blinn-Phong highlight, none on the side facing away from the light
+float Specular(vec3 lightDir, vec3 normal, vec3 viewDir, float shininess)
+{
+	if (dot(normal, lightDir) <= 0.0)
+		return 0.0;
+	return pow(max(dot(normal, normalize(lightDir + viewDir)), 0.0), shininess * BLINN_SHININESS_SCALE);
+}
+
+void main()
+{
+	ivec2 pixel = ivec2(gl_FragCoord.xy);
+	float windowDepth = texelFetch(gDepth, pixel, 0).r;
+	if (windowDepth == 1.0)
+		discard;	// Nothing drawn here, keep the clear color
+
+	vec4 albedoSpecular = texelFetch(gAlbedoSpecular, pixel, 0);
+	vec4 normalShininess = texelFetch(gNormalShininess, pixel, 0);
+	vec3 albedo = albedoSpecular.rgb;
+	float specularMask = albedoSpecular.a;
+	vec3 norm = DecodeNormal(normalShininess.xy);
+	float shininess = exp2(normalShininess.z * 8.0);
+
+	vec4 world = inverseViewProjection * vec4(TexCoords * 2.0 - 1.0, windowDepth * 2.0 - 1.0, 1.0);
+	vec3 fragPos = world.xyz / world.w;
+	vec3 viewDir = normalize(viewPos - fragPos);
+
+	// Directional light
+	vec3 lightDir = normalize(-dirLight.direction);
+	vec3 result = dirLight.ambient * albedo + ShadowFactor(fragPos, norm) * (dirLight.diffuse * max(dot(norm, lightDir), 0.0) * albedo +
+		dirLight.specular * Specular(lightDir, norm, viewDir, shininess) * specularMask);
+
+	// Point lights of this pixel's cluster
+	uvec2 range = texelFetch(clusterGrid, FindCluster(windowDepth)).xy;
+	for (uint n = range.x; n < range.x + range.y; n++) {
+		int light = int(texelFetch(clusterIndices, int(n)).x);
+		vec4 positionRadius = texelFetch(clusterLights, 2 * light);
+		vec3 color = texelFetch(clusterLights, 2 * light + 1).rgb;
+
+		vec3 toLight = positionRadius.xyz - fragPos;
+		float distance = length(toLight);
+		if (distance >= positionRadius.w)
+			continue;
+
+		lightDir = toLight / distance;
+		float diff = max(dot(lightDir, norm), 0.0);
+		float spec = Specular(lightDir, norm, viewDir, shininess);
+
+		float attenuation = 1.0 / (pointAttenuation.x + pointAttenuation.y * distance + pointAttenuation.z * distance * distance);
+		float ratio2 = distance * distance / (positionRadius.w * positionRadius.w);
+		float fade = 1.0 - ratio2 * ratio2;
+		attenuation *= fade * fade;
+
+		result += attenuation * color * ((POINT_AMBIENT + POINT_DIFFUSE * diff) * albedo + POINT_SPECULAR * spec * specularMask);
+	}
+
+	// Flashlight
+	lightDir = normalize(spotLight.position - fragPos);
+	float distance = length(spotLight.position - fragPos);
+	float attenuation = 1.0 / (spotLight.constant + spotLight.linear * distance + spotLight.quadratic * (distance * distance));
+	float theta = dot(lightDir, normalize(-spotLight.direction));
+	float intensity = clamp((theta - spotLight.outerCutOff) / (spotLight.cutOff - spotLight.outerCutOff), 0.0, 1.0);
+	result += (spotLight.ambient * albedo + spotLight.diffuse * max(dot(norm, lightDir), 0.0) * albedo +
+		spotLight.specular * Specular(lightDir, norm, viewDir, shininess) * specularMask) * attenuation * intensity;
+
+	FragColor = vec4(result, 1.0);
+}
@@ -0,0 +1,10 @@
+#version 330 core
+out vec2 TexCoords;
+
+// Full screen triangle from the vertex index, no vertex buffer needed
+void main()
+{
+	vec2 corner = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+	TexCoords = corner;
+	gl_Position = vec4(corner * 2.0 - 1.0, 0.0, 1.0);
+}
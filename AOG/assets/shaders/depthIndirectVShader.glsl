@@ -0,0 +1,17 @@
+#version 430 core
+layout (location = 0) in vec3 aPos;
+layout (location = 3) in uint aInstance;	// Written by the GPU culling pass
+
+layout (std430, binding = 4) readonly buffer Models { mat4 models[]; };
+
+uniform mat4 view;
+uniform mat4 projection;
+
+// Must match the shading pass bit for bit, it depth tests with GL_EQUAL
+invariant gl_Position;
+
+void main()
+{
+	mat4 model = models[aInstance];
+	gl_Position = projection * view * model * vec4(aPos, 1.0);
+}
@@ -0,0 +1,37 @@
+#version 330 core
+layout (location = 0) out vec4 AlbedoSpecular;
+layout (location = 1) out vec4 NormalShininess;
+
+in vec3 Normal;
+in vec3 FragPos;
+in vec2 TexCoords;
+
+// Same material as the forward shaders
+struct Material {
+	sampler2D diffuse;
+	sampler2D specular;
+	float shininess;
+};
+
+uniform Material material;
+
+// Octahedral mapping: the unit sphere folded onto a square, 2 channels instead of 3
+vec2 OctWrap(vec2 v)
+{
+	return (1.0 - abs(v.yx)) * vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+vec2 EncodeNormal(vec3 n)
+{
+	n /= abs(n.x) + abs(n.y) + abs(n.z);
+	n.xy = n.z >= 0.0 ? n.xy : OctWrap(n.xy);
+	return n.xy * 0.5 + 0.5;
+}
+
+void main()
+{
+	vec3 specularMask = texture(material.specular, TexCoords).rgb;
+
+	AlbedoSpecular = vec4(texture(material.diffuse, TexCoords).rgb, dot(specularMask, vec3(1.0 / 3.0)));
+	NormalShininess = vec4(EncodeNormal(normalize(Normal)), log2(max(material.shininess, 1.0)) / 8.0, 0.0);
+}
@@ -0,0 +1,179 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec3 Normal;
+in vec3 FragPos;
+in vec2 TexCoords;
+
+// Phong model (lighting components)
+struct Material {
+	sampler2D diffuse;
+	sampler2D specular;
+	float shininess;
+};
+
+struct DirLight	{
+	vec3 direction;
+
+	vec3 ambient;
+	vec3 diffuse;
+	vec3 specular;
+};
+
+struct SpotLight {
+	vec3 position;
+	vec3 direction;
+
+	float cutOff;
+	float outerCutOff;
+
+	vec3 ambient;
+	vec3 diffuse;
+	vec3 specular;
+
+	float constant;
+	float linear;
+	float quadratic;
+};
+
+// Point light terms relative to the light's color, same as the fixed 4 light shader
+const float POINT_AMBIENT = 0.05;
+const float POINT_DIFFUSE = 0.8;
+const float POINT_SPECULAR = 1.0;
+
+// The half vector lobe is wider, this keeps the highlights the size Phong gave them
+const float BLINN_SHININESS_SCALE = 4.0;
+
+uniform vec3 viewPos;
+uniform DirLight dirLight;
+uniform SpotLight spotLight;
+uniform Material material;
+uniform vec3 pointAttenuation;	// constant, linear, quadratic
+
+// Clusters, filled by LightClusters every frame
+uniform samplerBuffer clusterLights;	// 2 texels per light: position + radius, color
+uniform usamplerBuffer clusterGrid;		// First index + count per cluster
+uniform usamplerBuffer clusterIndices;
+uniform vec4 clusterDepth;		// near, far, slice scale, slice bias
+uniform vec4 clusterTile;		// tiles per pixel x / y, tiles x / y
+uniform int clusterSlices;
+
+// Cascaded shadow maps of the directional light, filled by ShadowCascades. cascadeCount 0 = no shadows
+uniform sampler2DArrayShadow shadowMap;
+uniform int cascadeCount;
+uniform mat4 cascadeMatrices[4];	// World to light clip space
+uniform vec4 cascadeSplits;		// Far view depth of each cascade
+uniform vec4 cascadeTexels;		// World size of a shadow map texel in each cascade
+uniform vec4 cascadeDepthPlane;	// View depth = dot(plane, vec4(p, 1))
+
+vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir, vec3 albedo, vec3 specularMask, float shadow);
+vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 albedo, vec3 specularMask);
+
+// 1 lit, 0 in shadow
+float ShadowFactor(vec3 fragPos, vec3 normal)
+{
+	float depth = dot(cascadeDepthPlane, vec4(fragPos, 1.0));
+	int cascade = 0;
+	while (cascade < cascadeCount && depth > cascadeSplits[cascade])
+		cascade++;
+	if (cascade >= cascadeCount)
+		return 1.0;
+
+	// Normal offset against acne, in texels of this cascade
+	vec4 clip = cascadeMatrices[cascade] * vec4(fragPos + normal * 1.5 * cascadeTexels[cascade], 1.0);
+	vec3 coords = clip.xyz * 0.5 + 0.5;
+	if (coords.z >= 1.0)
+		return 1.0;
+
+	// Four bilinear compares half a texel apart, a smooth 3x3 texel footprint
+	vec2 texel = 0.5 / vec2(textureSize(shadowMap, 0).xy);
+	float lit = texture(shadowMap, vec4(coords.xy + vec2(-texel.x, -texel.y), float(cascade), coords.z));
+	lit += texture(shadowMap, vec4(coords.xy + vec2(texel.x, -texel.y), float(cascade), coords.z));
+	lit += texture(shadowMap, vec4(coords.xy + vec2(-texel.x, texel.y), float(cascade), coords.z));
+	lit += texture(shadowMap, vec4(coords.xy + vec2(texel.x, texel.y), float(cascade), coords.z));
+	return lit * 0.25;
+}
+
+// Blinn-Phong highlight, none on the side facing away from the light
+float Specular(vec3 lightDir, vec3 normal, vec3 viewDir, float shininess)
+{
+	if (dot(normal, lightDir) <= 0.0)
+		return 0.0;
+	return pow(max(dot(normal, normalize(lightDir + viewDir)), 0.0), shininess * BLINN_SHININESS_SCALE);
+}
+
+int FindCluster()
+{
+	// Linear view depth back from the depth buffer value
+	float near = clusterDepth.x, far = clusterDepth.y;
+	float ndcZ = gl_FragCoord.z * 2.0 - 1.0;
+	float depth = 2.0 * near * far / (far + near - ndcZ * (far - near));
+
+	int slice = clamp(int(log(depth) * clusterDepth.z + clusterDepth.w), 0, clusterSlices - 1);
+	ivec2 tiles = ivec2(clusterTile.zw);
+	ivec2 tile = clamp(ivec2(gl_FragCoord.xy * clusterTile.xy), ivec2(0), tiles - 1);
+	return (slice * tiles.y + tile.y) * tiles.x + tile.x;
+}
+
+void main()
+{
+	vec3 norm = normalize(Normal);
+	vec3 viewDir = normalize(viewPos - FragPos);
+	vec3 albedo = texture(material.diffuse, TexCoords).rgb;
+	vec3 specularMask = texture(material.specular, TexCoords).rgb;
+
+	vec3 result = CalcDirLight(dirLight, norm, viewDir, albedo, specularMask, ShadowFactor(FragPos, norm));
+
+	// Only the lights whose range touches this fragment's cluster
+	uvec2 range = texelFetch(clusterGrid, FindCluster()).xy;
+	for (uint n = range.x; n < range.x + range.y; n++) {
+		int light = int(texelFetch(clusterIndices, int(n)).x);
+		vec4 positionRadius = texelFetch(clusterLights, 2 * light);
+		vec3 color = texelFetch(clusterLights, 2 * light + 1).rgb;
+
+		vec3 toLight = positionRadius.xyz - FragPos;
+		float distance = length(toLight);
+		if (distance >= positionRadius.w)
+			continue;
+
+		vec3 lightDir = toLight / distance;
+		float diff = max(dot(lightDir, norm), 0.0);
+		float spec = Specular(lightDir, norm, viewDir, material.shininess);
+
+		// Usual attenuation, faded to exactly 0 at the light's radius
+		float attenuation = 1.0 / (pointAttenuation.x + pointAttenuation.y * distance + pointAttenuation.z * distance * distance);
+		float ratio2 = distance * distance / (positionRadius.w * positionRadius.w);
+		float fade = 1.0 - ratio2 * ratio2;
+		attenuation *= fade * fade;
+
+		result += attenuation * color * ((POINT_AMBIENT + POINT_DIFFUSE * diff) * albedo + POINT_SPECULAR * spec * specularMask);
+	}
+
+	result += CalcSpotLight(spotLight, norm, FragPos, viewDir, albedo, specularMask);
+
+	FragColor = vec4(result, 1.0);
+}
+
+vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir, vec3 albedo, vec3 specularMask, float shadow)
+{
+	vec3 lightDir = normalize(-light.direction);
+	float diff = max(dot(normal, lightDir), 0.0);
+	float spec = Specular(lightDir, normal, viewDir, material.shininess);
+
+	return light.ambient * albedo + shadow * (light.diffuse * diff * albedo + light.specular * spec * specularMask);
+}
+
+vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 albedo, vec3 specularMask)
+{
+	vec3 lightDir = normalize(light.position - fragPos);
+	float diff = max(dot(normal, lightDir), 0.0);
+	float spec = Specular(lightDir, normal, viewDir, material.shininess);
+
+	float distance = length(light.position - fragPos);
+	float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
+	float theta = dot(lightDir, normalize(-light.direction));
+	float epsilon = light.cutOff - light.outerCutOff;
+	float intensity = clamp((theta - light.outerCutOff) / epsilon, 0.0, 1.0);
+
+	return (light.ambient * albedo + light.diffuse * diff * albedo + light.specular * spec * specularMask) * attenuation * intensity;
+}
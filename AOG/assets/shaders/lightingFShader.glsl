@@ -5,12 +5,9 @@ in vec3 Normal;
 in vec3 FragPos;
 in vec2 TexCoords;
 
-// Phong model (lighting components)
 struct Material {
-	// The color of the surface under diffuse lighting
 	sampler2D diffuse;
 	sampler2D specular;
-	// Shininess component
 	float shininess;
 };
 
@@ -23,18 +20,6 @@ struct DirLight	{
 	vec3 specular;
 };
 
-struct PointLight {
-	vec3 position;
-
-	float constant;
-	float linear;
-	float quadratic;
-
-	vec3 ambient;
-	vec3 diffuse;
-	vec3 specular;
-};
-
 // Material Struct for Light Object
 struct SpotLight {
 	vec3 position;
@@ -52,107 +37,131 @@ struct SpotLight {
 	float quadratic;
 };
 
-#define NR_POINT_LIGHTS 4
+// Point light terms relative to the light's color, same as the clustered shader
+const float POINT_AMBIENT = 0.05;
+const float POINT_DIFFUSE = 0.8;
+const float POINT_SPECULAR = 1.0;
+
+// The half vector lobe is wider, this keeps the highlights the size Phong gave them
+const float BLINN_SHININESS_SCALE = 4.0;
+
+#define MAX_POINT_LIGHTS 16
+
+// Bound of the point light loop, set by the program for its light count (ForwardPointLightSlots). A constant
+// bound lets the loop unroll and the light array be indexed with constants, the uniform count alone doesn't
+#ifndef POINT_LIGHT_SLOTS
+#define POINT_LIGHT_SLOTS MAX_POINT_LIGHTS
+#endif
 
 uniform vec3 viewPos;
 uniform DirLight dirLight;
-uniform PointLight pointLights[NR_POINT_LIGHTS];
 uniform SpotLight spotLight;
 uniform Material material;
 
-// Function prototypes
-vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir);
-vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir);
-vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir);
-
-void main()
+// Packed by SetForwardPointLights: 2 vec4 per light, position + radius, color
+uniform vec4 pointLights[2 * MAX_POINT_LIGHTS];
+uniform int pointLightCount;
+uniform vec3 pointAttenuation;	// constant, linear, quadratic
+
+// Cascaded shadow maps of the directional light, filled by ShadowCascades. cascadeCount 0 = no shadows
+uniform sampler2DArrayShadow shadowMap;
+uniform int cascadeCount;
+uniform mat4 cascadeMatrices[4];	// World to light clip space
+uniform vec4 cascadeSplits;		// Far view depth of each cascade
+uniform vec4 cascadeTexels;		// World size of a shadow map texel in each cascade
+uniform vec4 cascadeDepthPlane;	// View depth = dot(plane, vec4(p, 1))
+
+// 1 lit, 0 in shadow
+float ShadowFactor(vec3 fragPos, vec3 normal)
 {
-	// properties
-	vec3 norm = normalize(Normal);
-	vec3 viewDir = normalize(viewPos - FragPos);
-	
-	// == =====================================================
-    // Our lighting is set up in 3 phases: directional, point lights and an optional flashlight
-    // For each phase, a calculate function is defined that calculates the corresponding color
-    // per lamp. In the main() function we take all the calculated colors and sum them up for
-    // this fragment's final color.
-    // == =====================================================
-	
-	// phase 1 :: directional lighting
-	vec3 result = CalcDirLight(dirLight, norm, viewDir);
-
-	// phase 2 :: point lighting
-	for(int i = 0; i < NR_POINT_LIGHTS; i ++)
-		result += CalcPointLight(pointLights[i], norm, FragPos, viewDir);
-	
-	// phase 3 :: spot lighting
-	result += CalcSpotLight(spotLight, norm, FragPos, viewDir);
-
-	FragColor = vec4(result, 1.0);
+	float depth = dot(cascadeDepthPlane, vec4(fragPos, 1.0));
+	int cascade = 0;
+	while (cascade < cascadeCount && depth > cascadeSplits[cascade])
+		cascade++;
+	if (cascade >= cascadeCount)
+		return 1.0;
+
+	// Normal offset against acne, in texels of this cascade
+	vec4 clip = cascadeMatrices[cascade] * vec4(fragPos + normal * 1.5 * cascadeTexels[cascade], 1.0);
+	vec3 coords = clip.xyz * 0.5 + 0.5;
+	if (coords.z >= 1.0)
+		return 1.0;
+
+	// Four bilinear compares half a texel apart, a smooth 3x3 texel footprint
+	vec2 texel = 0.5 / vec2(textureSize(shadowMap, 0).xy);
+	float lit = texture(shadowMap, vec4(coords.xy + vec2(-texel.x, -texel.y), float(cascade), coords.z));
+	lit += texture(shadowMap, vec4(coords.xy + vec2(texel.x, -texel.y), float(cascade), coords.z));
+	lit += texture(shadowMap, vec4(coords.xy + vec2(-texel.x, texel.y), float(cascade), coords.z));
+	lit += texture(shadowMap, vec4(coords.xy + vec2(texel.x, texel.y), float(cascade), coords.z));
+	return lit * 0.25;
 }
 
-// calculates the color when using a directional light.
-vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir)
+// Blinn-Phong: diffuse factor in x, specular in y. No highlight on the side facing away.
+// The squared cosine to half the exponent is the same highlight without normalizing the half vector
+vec2 BlinnPhong(vec3 normal, vec3 lightDir, vec3 viewDir, float shininess)
 {
-	vec3 lightDir = normalize(-light.direction);
-	// diffuse shading
 	float diff = max(dot(normal, lightDir), 0.0);
-	// specular shading
-	vec3 reflectDir = reflect(-lightDir, normal);
-	float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
-	// combine results
-	vec3 ambient = light.ambient * vec3(texture(material.diffuse, TexCoords));
-	vec3 diffuse = light.diffuse * diff * vec3(texture(material.diffuse, TexCoords));
-	vec3 specular = light.specular * spec * vec3(texture(material.specular, TexCoords));
-
-	return (ambient + diffuse + specular);
+	vec3 halfway = lightDir + viewDir;
+	float cosine = max(dot(normal, halfway), 0.0);
+	float spec = diff > 0.0 ? pow(cosine * cosine / dot(halfway, halfway), shininess * 0.5) : 0.0;
+	return vec2(diff, spec);
 }
 
-vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
-{
-	vec3 lightDir = normalize(light.position - fragPos);
-	// diffuse shading
-	float diff = max(dot(lightDir, normal), 0.0);
-	// specular shading
-	vec3 reflectDir = reflect(-lightDir, normal);
-	float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
-	// attenuation
-	float distance = length(light.position - fragPos);
-	float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance*distance));
-	// combine results
-	vec3 ambient = light.ambient * vec3(texture(material.diffuse, TexCoords));
-	vec3 diffuse = light.diffuse * diff * vec3(texture(material.diffuse, TexCoords));
-	vec3 specular = light.specular * spec * vec3(texture(material.specular, TexCoords));
-
-	ambient *= attenuation;
-	diffuse *= attenuation;
-	specular *= attenuation;
-
-	return (ambient + diffuse + specular);
-}
-
-// calculates the color when using spot light
-vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
+void main()
 {
-	vec3 lightDir = normalize(light.position - fragPos);
-    // diffuse shading
-    float diff = max(dot(normal, lightDir), 0.0);
-    // specular shading
-    vec3 reflectDir = reflect(-lightDir, normal);
-    float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
-    // attenuation
-    float distance = length(light.position - fragPos);
-    float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));    
-    // spotlight intensity
-    float theta = dot(lightDir, normalize(-light.direction)); 
-    float epsilon = light.cutOff - light.outerCutOff;
-    float intensity = clamp((theta - light.outerCutOff) / epsilon, 0.0, 1.0);
-    // combine results
-    vec3 ambient = light.ambient * vec3(texture(material.diffuse, TexCoords));
-    vec3 diffuse = light.diffuse * diff * vec3(texture(material.diffuse, TexCoords));
-    vec3 specular = light.specular * spec * vec3(texture(material.specular, TexCoords));
-    ambient *= attenuation * intensity;
-    diffuse *= attenuation * intensity;
-    specular *= attenuation * intensity;
-    return (ambient + diffuse + specular);
+	vec3 norm = normalize(Normal);
+	vec3 viewDir = normalize(viewPos - FragPos);
+	float shininess = material.shininess * BLINN_SHININESS_SCALE;
+
+	// Lights only add up light here, the material is applied once at the end
+	vec3 diffuse, specular;
+
+	// Directional light, the only one casting shadows
+	vec2 sun = BlinnPhong(norm, normalize(-dirLight.direction), viewDir, shininess);
+	float shadow = ShadowFactor(FragPos, norm);
+	diffuse = dirLight.ambient + shadow * sun.x * dirLight.diffuse;
+	specular = shadow * sun.y * dirLight.specular;
+
+	// Point lights, the ones out of range cost a distance check. An if rather than a continue, software
+	// rasterizers pay for the continue mask on every light
+	for (int i = 0; i < POINT_LIGHT_SLOTS; i++) {
+		if (i >= pointLightCount)
+			break;
+
+		vec4 positionRadius = pointLights[2 * i];
+		vec3 toLight = positionRadius.xyz - FragPos;
+		float distance2 = dot(toLight, toLight);
+		float ratio2 = distance2 / (positionRadius.w * positionRadius.w);
+		if (ratio2 < 1.0) {
+			float invDistance = inversesqrt(distance2);
+			float distance = distance2 * invDistance;
+			vec2 light = BlinnPhong(norm, toLight * invDistance, viewDir, shininess);
+
+			// Usual attenuation, faded to exactly 0 at the light's radius
+			float fade = 1.0 - ratio2 * ratio2;
+			float attenuation = fade * fade / (pointAttenuation.x + pointAttenuation.y * distance + pointAttenuation.z * distance2);
+
+			vec3 color = pointLights[2 * i + 1].rgb * attenuation;
+			diffuse += (POINT_AMBIENT + POINT_DIFFUSE * light.x) * color;
+			specular += (POINT_SPECULAR * light.y) * color;
+		}
+	}
+
+	// Flashlight
+	vec3 toSpot = spotLight.position - FragPos;
+	float spotDistance = length(toSpot);
+	vec3 spotDir = toSpot / spotDistance;
+	float theta = dot(spotDir, normalize(-spotLight.direction));
+	float intensity = clamp((theta - spotLight.outerCutOff) / (spotLight.cutOff - spotLight.outerCutOff), 0.0, 1.0);
+	if (intensity > 0.0) {
+		vec2 spot = BlinnPhong(norm, spotDir, viewDir, shininess);
+		float attenuation = intensity / (spotLight.constant + spotLight.linear * spotDistance + spotLight.quadratic * (spotDistance * spotDistance));
+		diffuse += (spotLight.ambient + spot.x * spotLight.diffuse) * attenuation;
+		specular += spot.y * attenuation * spotLight.specular;
+	}
+
+	// Material textures fetched once for every light
+	vec3 albedo = texture(material.diffuse, TexCoords).rgb;
+	vec3 specularMask = texture(material.specular, TexCoords).rgb;
+	FragColor = vec4(albedo * diffuse + specularMask * specular, 1.0);
 }
\ No newline at end of file
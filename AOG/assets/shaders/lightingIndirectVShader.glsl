@@ -0,0 +1,28 @@
+#version 430 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoords;
+layout (location = 3) in uint aInstance;	// Written by the GPU culling pass
+
+layout (std430, binding = 4) readonly buffer Models { mat4 models[]; };
+
+out vec3 FragPos;
+out vec3 Normal;
+out vec2 TexCoords;
+
+uniform mat4 view;
+uniform mat4 projection;
+
+// Same position as the depth pre-pass, which it depth tests against with GL_EQUAL
+invariant gl_Position;
+
+void main()
+{
+	mat4 model = models[aInstance];
+
+	FragPos = vec3(model * vec4(aPos, 1.0));
+	Normal = mat3(transpose(inverse(model))) * aNormal;
+
+	gl_Position = projection * view * model * vec4(aPos, 1.0);
+	TexCoords = aTexCoords;
+}
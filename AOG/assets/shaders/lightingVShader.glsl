@@ -11,6 +11,9 @@ uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
 
+// Same position as the depth pre-pass, which it depth tests against with GL_EQUAL
+invariant gl_Position;
+
 void main()
 {
 	FragPos = vec3(model * vec4(aPos, 1.0));
@@ -0,0 +1,76 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec3 Normal;
+in vec3 FragPos;
+in vec2 TexCoords;
+in vec2 LightmapCoords;
+
+struct Material {
+	sampler2D diffuse;
+	sampler2D specular;
+	float shininess;
+};
+
+// Camera flashlight, the only light still evaluated per pixel
+struct SpotLight {
+	vec3 position;
+	vec3 direction;
+
+	float cutOff;
+	float outerCutOff;
+
+	vec3 ambient;
+	vec3 diffuse;
+	vec3 specular;
+
+	float constant;
+	float linear;
+	float quadratic;
+};
+
+// The half vector lobe is wider, this keeps the highlights the size Phong gave them
+const float BLINN_SHININESS_SCALE = 4.0;
+
+uniform vec3 viewPos;
+uniform SpotLight spotLight;
+uniform Material material;
+
+// Baked direct + indirect diffuse of the static lights, shadows included
+uniform sampler2D lightmap;
+
+vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 albedo);
+
+void main()
+{
+	vec3 norm = normalize(Normal);
+	vec3 viewDir = normalize(viewPos - FragPos);
+	vec3 albedo = vec3(texture(material.diffuse, TexCoords));
+
+	vec3 result = albedo * texture(lightmap, LightmapCoords).rgb;
+	result += CalcSpotLight(spotLight, norm, FragPos, viewDir, albedo);
+
+	FragColor = vec4(result, 1.0);
+}
+
+// Same as lightingFShader.glsl
+vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir, vec3 albedo)
+{
+	vec3 lightDir = normalize(light.position - fragPos);
+	// diffuse shading
+	float diff = max(dot(normal, lightDir), 0.0);
+	// specular shading, Blinn-Phong
+	float spec = diff > 0.0 ? pow(max(dot(normal, normalize(lightDir + viewDir)), 0.0), material.shininess * BLINN_SHININESS_SCALE) : 0.0;
+	// attenuation
+	float distance = length(light.position - fragPos);
+	float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
+	// spotlight intensity
+	float theta = dot(lightDir, normalize(-light.direction));
+	float epsilon = light.cutOff - light.outerCutOff;
+	float intensity = clamp((theta - light.outerCutOff) / epsilon, 0.0, 1.0);
+	// combine results
+	vec3 ambient = light.ambient * albedo;
+	vec3 diffuse = light.diffuse * diff * albedo;
+	vec3 specular = light.specular * spec * vec3(texture(material.specular, TexCoords));
+	return (ambient + diffuse + specular) * attenuation * intensity;
+}
\ No newline at end of file
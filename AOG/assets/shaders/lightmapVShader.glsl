@@ -0,0 +1,28 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoords;
+layout (location = 4) in vec2 aLightmapCoords;
+
+out vec3 FragPos;
+out vec3 Normal;
+out vec2 TexCoords;
+out vec2 LightmapCoords;
+
+uniform mat4 model;
+uniform mat4 view;
+uniform mat4 projection;
+uniform vec4 lightmapScaleOffset;	// This instance's square in the atlas: uv * xy + zw
+
+// Same position as the depth pre-pass, which it depth tests against with GL_EQUAL
+invariant gl_Position;
+
+void main()
+{
+	FragPos = vec3(model * vec4(aPos, 1.0));
+	Normal = mat3(transpose(inverse(model))) * aNormal;
+
+	gl_Position = projection * view * model * vec4(aPos, 1.0);
+	TexCoords = aTexCoords;
+	LightmapCoords = aLightmapCoords * lightmapScaleOffset.xy + lightmapScaleOffset.zw;
+}
\ No newline at end of file
@@ -0,0 +1,9 @@
+#version 330 core
+out vec4 FragColor;
+
+// Drawn with additive blending: every shaded fragment adds one step, so the
+// brightness of a pixel is how many times it was shaded
+void main()
+{
+	FragColor = vec4(0.1, 0.05, 0.02, 1.0);
+}
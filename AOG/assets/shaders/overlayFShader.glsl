@@ -0,0 +1,13 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+in vec4 Color;
+
+// Glyph coverage in red, panels and graphs sample its solid texel
+uniform sampler2D font;
+
+void main()
+{
+	FragColor = vec4(Color.rgb, Color.a * texture(font, TexCoords).r);
+}
\ No newline at end of file
@@ -0,0 +1,40 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+// Scene rendered into the corner of a larger target
+uniform sampler2D source;
+uniform vec4 sourceRect;	// xy: rendered part in uv, zw: one texel in uv
+uniform float sharpness;	// 0 is plain bilinear
+
+// Bilinear fetch that never blends in texels past the rendered part
+vec3 Fetch(vec2 uv)
+{
+	vec2 halfTexel = 0.5 * sourceRect.zw;
+	return texture(source, clamp(uv, halfTexel, sourceRect.xy - halfTexel)).rgb;
+}
+
+void main()
+{
+	vec2 uv = TexCoords * sourceRect.xy;
+	vec3 center = Fetch(uv);
+	if (sharpness <= 0.0) {
+		FragColor = vec4(center, 1.0);
+		return;
+	}
+
+	// Unsharp mask with the 4 neighbours one source texel away
+	vec3 north = Fetch(uv + vec2(0.0, sourceRect.w));
+	vec3 south = Fetch(uv - vec2(0.0, sourceRect.w));
+	vec3 east = Fetch(uv + vec2(sourceRect.z, 0.0));
+	vec3 west = Fetch(uv - vec2(sourceRect.z, 0.0));
+
+	vec3 blur = 0.25 * (north + south + east + west);
+	vec3 sharpened = center + sharpness * (center - blur);
+
+	// Kept within the neighbourhood so edges don't get a halo
+	vec3 lowest = min(center, min(min(north, south), min(east, west)));
+	vec3 highest = max(center, max(max(north, south), max(east, west)));
+	FragColor = vec4(clamp(sharpened, lowest, highest), 1.0);
+}
@@ -0,0 +1,338 @@
+#include "BVH.h"
+
+#include <algorithm>
+#include <numeric>
+
+static const uint32_t MAX_LEAF_SIZE = 4;
+static const int SAH_BINS = 12;
+static const int MAX_DEPTH = 60;		// Keeps every traversal inside the fixed size stacks below
+static const int STACK_SIZE = 64;
+
+enum class Containment {
+	OUTSIDE,
+	INTERSECTING,
+	INSIDE
+};
+
+static Containment classifyBox(const Frustum& frustum, const glm::vec3& min, const glm::vec3& max)
+{
+	glm::vec3 center = (min + max) * 0.5f;
+	glm::vec3 extents = (max - min) * 0.5f;
+	Containment result = Containment::INSIDE;
+
+	for (int p = 0; p < 6; p++) {
+		const glm::vec4& plane = frustum.planes[p];
+		float d = glm::dot(glm::vec3(plane), center) + plane.w;
+		float r = glm::dot(glm::abs(glm::vec3(plane)), extents);
+
+		if (d + r < 0.0f)
+			return Containment::OUTSIDE;
+		if (d - r < 0.0f)
+			result = Containment::INTERSECTING;
+	}
+	return result;
+}
+
+// Slab test, returns the entry distance in tNear
+static inline bool intersectRay(const glm::vec3& origin, const glm::vec3& invDir,
+	const glm::vec3& min, const glm::vec3& max, float maxDistance, float& tNear)
+{
+	glm::vec3 t0 = (min - origin) * invDir;
+	glm::vec3 t1 = (max - origin) * invDir;
+	glm::vec3 tMin = glm::min(t0, t1);
+	glm::vec3 tMax = glm::max(t0, t1);
+
+	float enter = glm::max(glm::max(tMin.x, tMin.y), glm::max(tMin.z, 0.0f));
+	float exit = glm::min(glm::min(tMax.x, tMax.y), glm::min(tMax.z, maxDistance));
+
+	tNear = enter;
+	return enter <= exit;
+}
+
+static inline bool overlapsSphere(const glm::vec3& min, const glm::vec3& max, const glm::vec3& center, float radius2)
+{
+	glm::vec3 closest = glm::clamp(center, min, max);
+	glm::vec3 d = closest - center;
+	return glm::dot(d, d) <= radius2;
+}
+
+void BVH::Build(const AABB* bounds, size_t count)
+{
+	m_Nodes.clear();
+	m_LeafBounds.clear();
+	m_Indices.resize(count);
+	std::iota(m_Indices.begin(), m_Indices.end(), 0);
+
+	if (count == 0)
+		return;
+
+	std::vector<glm::vec3> centers(count);
+	for (size_t i = 0; i < count; i++)
+		centers[i] = bounds[i].Center();
+
+	// A binary tree with at least one primitive per leaf never needs more than 2n - 1 nodes
+	m_Nodes.reserve(2 * count);
+	m_Nodes.push_back(Node());
+	buildRecursive(0, 0, (uint32_t)count, bounds, centers, 0);
+
+	m_LeafBounds.resize(count);
+	for (size_t k = 0; k < count; k++)
+		m_LeafBounds[k] = bounds[m_Indices[k]];
+}
+
+void BVH::buildRecursive(uint32_t nodeIndex, uint32_t begin, uint32_t end, const AABB* bounds,
+	std::vector<glm::vec3>& centers, int depth)
+{
+	AABB nodeBounds, centroidBounds;
+	for (uint32_t i = begin; i < end; i++) {
+		nodeBounds.Grow(bounds[m_Indices[i]]);
+		centroidBounds.Grow(centers[m_Indices[i]]);
+	}
+
+	uint32_t count = end - begin;
+	m_Nodes[nodeIndex].min = nodeBounds.min;
+	m_Nodes[nodeIndex].max = nodeBounds.max;
+
+	if (count <= MAX_LEAF_SIZE || depth >= MAX_DEPTH) {
+		m_Nodes[nodeIndex].rightOrFirst = begin;
+		m_Nodes[nodeIndex].count = count;
+		return;
+	}
+
+	// Binned SAH: bucket centroids along each axis and pick the cheapest bucket boundary
+	glm::vec3 extent = centroidBounds.max - centroidBounds.min;
+	int bestAxis = -1;
+	int bestSplit = 0;
+	float bestCost = FLT_MAX;
+
+	for (int axis = 0; axis < 3; axis++) {
+		if (extent[axis] <= 1e-6f)
+			continue;
+
+		float scale = SAH_BINS / extent[axis];
+		AABB binBounds[SAH_BINS];
+		uint32_t binCount[SAH_BINS] = { 0 };
+
+		for (uint32_t i = begin; i < end; i++) {
+			uint32_t idx = m_Indices[i];
+			int bin = std::min(SAH_BINS - 1, (int)((centers[idx][axis] - centroidBounds.min[axis]) * scale));
+			binCount[bin]++;
+			binBounds[bin].Grow(bounds[idx]);
+		}
+
+		// Sweep from the left, then from the right evaluating each boundary
+		float leftArea[SAH_BINS - 1];
+		uint32_t leftCount[SAH_BINS - 1];
+		AABB accum;
+		uint32_t n = 0;
+		for (int b = 0; b < SAH_BINS - 1; b++) {
+			accum.Grow(binBounds[b]);
+			n += binCount[b];
+			leftCount[b] = n;
+			leftArea[b] = n ? accum.SurfaceArea() : 0.0f;
+		}
+
+		accum = AABB();
+		n = 0;
+		for (int b = SAH_BINS - 1; b > 0; b--) {
+			accum.Grow(binBounds[b]);
+			n += binCount[b];
+			if (n == 0 || leftCount[b - 1] == 0)
+				continue;
+
+			float cost = leftCount[b - 1] * leftArea[b - 1] + n * accum.SurfaceArea();
+			if (cost < bestCost) {
+				bestCost = cost;
+				bestAxis = axis;
+				bestSplit = b;
+			}
+		}
+	}
+
+	uint32_t mid = begin;
+	if (bestAxis >= 0) {
+		float scale = SAH_BINS / extent[bestAxis];
+		float axisMin = centroidBounds.min[bestAxis];
+		uint32_t* split = std::partition(m_Indices.data() + begin, m_Indices.data() + end, [&](uint32_t idx) {
+			int bin = std::min(SAH_BINS - 1, (int)((centers[idx][bestAxis] - axisMin) * scale));
+			return bin < bestSplit;
+		});
+		mid = (uint32_t)(split - m_Indices.data());
+	}
+
+	// Every centroid in the same spot, any split is as good as another
+	if (mid == begin || mid == end)
+		mid = begin + count / 2;
+
+	uint32_t left = (uint32_t)m_Nodes.size();
+	m_Nodes.push_back(Node());
+	buildRecursive(left, begin, mid, bounds, centers, depth + 1);
+
+	uint32_t right = (uint32_t)m_Nodes.size();
+	m_Nodes.push_back(Node());
+	m_Nodes[nodeIndex].rightOrFirst = right;
+	m_Nodes[nodeIndex].count = 0;
+	buildRecursive(right, mid, end, bounds, centers, depth + 1);
+}
+
+void BVH::Refit(const AABB* bounds)
+{
+	for (size_t k = 0; k < m_Indices.size(); k++)
+		m_LeafBounds[k] = bounds[m_Indices[k]];
+
+	// Children always come after their parent, so walking backwards is a bottom-up pass
+	for (size_t i = m_Nodes.size(); i-- > 0;) {
+		Node& node = m_Nodes[i];
+
+		if (node.count) {
+			AABB b;
+			for (uint32_t k = node.rightOrFirst; k < node.rightOrFirst + node.count; k++)
+				b.Grow(m_LeafBounds[k]);
+			node.min = b.min;
+			node.max = b.max;
+		}
+		else {
+			const Node& left = m_Nodes[i + 1];
+			const Node& right = m_Nodes[node.rightOrFirst];
+			node.min = glm::min(left.min, right.min);
+			node.max = glm::max(left.max, right.max);
+		}
+	}
+}
+
+size_t BVH::CullFrustum(const Frustum& frustum, std::vector<uint32_t>& visible) const
+{
+	if (m_Nodes.empty())
+		return 0;
+
+	// Once a node is fully inside, nothing below it needs testing
+	struct Entry {
+		uint32_t node;
+		bool inside;
+	};
+
+	Entry stack[STACK_SIZE];
+	int sp = 0;
+	size_t found = 0;
+	stack[sp++] = { 0, false };
+
+	while (sp > 0) {
+		Entry entry = stack[--sp];
+		const Node& node = m_Nodes[entry.node];
+		bool inside = entry.inside;
+
+		if (!inside) {
+			Containment c = classifyBox(frustum, node.min, node.max);
+			if (c == Containment::OUTSIDE)
+				continue;
+			inside = (c == Containment::INSIDE);
+		}
+
+		if (node.count) {
+			for (uint32_t k = node.rightOrFirst; k < node.rightOrFirst + node.count; k++) {
+				if (inside || classifyBox(frustum, m_LeafBounds[k].min, m_LeafBounds[k].max) != Containment::OUTSIDE) {
+					visible.push_back(m_Indices[k]);
+					found++;
+				}
+			}
+		}
+		else {
+			stack[sp++] = { node.rightOrFirst, inside };
+			stack[sp++] = { entry.node + 1, inside };
+		}
+	}
+
+	return found;
+}
+
+bool BVH::Raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, RayHit& hit) const
+{
+	if (m_Nodes.empty())
+		return false;
+
+	glm::vec3 invDir = 1.0f / direction;
+	float closest = maxDistance;
+	bool found = false;
+	float tNear;
+
+	if (!intersectRay(origin, invDir, m_Nodes[0].min, m_Nodes[0].max, closest, tNear))
+		return false;
+
+	uint32_t stack[STACK_SIZE];
+	int sp = 0;
+	stack[sp++] = 0;
+
+	while (sp > 0) {
+		const Node& node = m_Nodes[stack[--sp]];
+
+		if (node.count) {
+			for (uint32_t k = node.rightOrFirst; k < node.rightOrFirst + node.count; k++) {
+				if (intersectRay(origin, invDir, m_LeafBounds[k].min, m_LeafBounds[k].max, closest, tNear)) {
+					closest = tNear;
+					hit.index = m_Indices[k];
+					hit.t = tNear;
+					found = true;
+				}
+			}
+			continue;
+		}
+
+		// Visit the nearer child first so the far one is usually rejected by the closest hit
+		uint32_t leftIndex = (uint32_t)(&node - m_Nodes.data()) + 1;
+		uint32_t rightIndex = node.rightOrFirst;
+		float tLeft, tRight;
+		bool hitLeft = intersectRay(origin, invDir, m_Nodes[leftIndex].min, m_Nodes[leftIndex].max, closest, tLeft);
+		bool hitRight = intersectRay(origin, invDir, m_Nodes[rightIndex].min, m_Nodes[rightIndex].max, closest, tRight);
+
+		if (hitLeft && hitRight) {
+			if (tLeft > tRight) {
+				std::swap(leftIndex, rightIndex);
+			}
+			stack[sp++] = rightIndex;
+			stack[sp++] = leftIndex;
+		}
+		else if (hitLeft) {
+			stack[sp++] = leftIndex;
+		}
+		else if (hitRight) {
+			stack[sp++] = rightIndex;
+		}
+	}
+
+	return found;
+}
+
+size_t BVH::QuerySphere(const glm::vec3& center, float radius, std::vector<uint32_t>& results) const
+{
+	if (m_Nodes.empty())
+		return 0;
+
+	float radius2 = radius * radius;
+	uint32_t stack[STACK_SIZE];
+	int sp = 0;
+	size_t found = 0;
+	stack[sp++] = 0;
+
+	while (sp > 0) {
+		uint32_t index = stack[--sp];
+		const Node& node = m_Nodes[index];
+
+		if (!overlapsSphere(node.min, node.max, center, radius2))
+			continue;
+
+		if (node.count) {
+			for (uint32_t k = node.rightOrFirst; k < node.rightOrFirst + node.count; k++) {
+				if (overlapsSphere(m_LeafBounds[k].min, m_LeafBounds[k].max, center, radius2)) {
+					results.push_back(m_Indices[k]);
+					found++;
+				}
+			}
+		}
+		else {
+			stack[sp++] = node.rightOrFirst;
+			stack[sp++] = index + 1;
+		}
+	}
+
+	return found;
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "Frustum.h"
+
+#include <glm/glm.hpp>
+
+// System library
+#include <vector>
+#include <cstdint>
+#include <cfloat>
+
+struct AABB
+{
+	glm::vec3 min;
+	glm::vec3 max;
+
+	AABB() : min(FLT_MAX), max(-FLT_MAX) {}
+	AABB(const glm::vec3& min, const glm::vec3& max) : min(min), max(max) {}
+
+	void Grow(const glm::vec3& p) { min = glm::min(min, p); max = glm::max(max, p); }
+	void Grow(const AABB& b) { min = glm::min(min, b.min); max = glm::max(max, b.max); }
+
+	glm::vec3 Center() const { return (min + max) * 0.5f; }
+	glm::vec3 Extents() const { return (max - min) * 0.5f; }
+
+	float SurfaceArea() const {
+		glm::vec3 d = max - min;
+		return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+	}
+};
+
+// Bounds of a local box after an affine transform (Arvo's method)
+inline AABB TransformAABB(const AABB& box, const glm::mat4& m)
+{
+	glm::vec3 center = glm::vec3(m * glm::vec4(box.Center(), 1.0f));
+	glm::vec3 e = box.Extents();
+	glm::vec3 extents = glm::abs(glm::vec3(m[0])) * e.x + glm::abs(glm::vec3(m[1])) * e.y + glm::abs(glm::vec3(m[2])) * e.z;
+
+	return AABB(center - extents, center + extents);
+}
+
+struct RayHit
+{
+	uint32_t index;		// Primitive index as passed to Build()
+	float t;			// Distance along the (normalised) ray direction
+};
+
+/*
+	Bounding volume hierarchy over primitive AABBs.
+
+	Build() does a binned SAH split and stores the tree depth first in one flat
+	array: the left child always directly follows its parent, so only the right
+	child index needs storing and every node fits in 32 bytes. Static geometry
+	is built once; dynamic objects keep the topology and call Refit() each frame.
+*/
+class BVH
+{
+public:
+	struct Node {
+		glm::vec3 min;
+		uint32_t rightOrFirst;	// Internal: right child index. Leaf: first slot in m_Indices
+		glm::vec3 max;
+		uint32_t count;			// Number of primitives, 0 for internal nodes
+	};
+
+private:
+	std::vector<Node> m_Nodes;
+	std::vector<uint32_t> m_Indices;	// Primitive indices, each leaf owns a contiguous range
+	std::vector<AABB> m_LeafBounds;		// Primitive bounds stored in leaf order for cache-friendly tests
+
+public:
+	BVH() {}
+
+	void Build(const AABB* bounds, size_t count);
+
+	// Update bounds after primitives moved; topology stays the same so quality degrades
+	// with large motion, rebuild when that happens
+	void Refit(const AABB* bounds);
+
+	// Hierarchical frustum culling, appends visible primitive indices
+	size_t CullFrustum(const Frustum& frustum, std::vector<uint32_t>& visible) const;
+
+	// Closest primitive box hit along the ray
+	bool Raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, RayHit& hit) const;
+
+	// Every primitive whose box overlaps the sphere (e.g. objects touched by a point light)
+	size_t QuerySphere(const glm::vec3& center, float radius, std::vector<uint32_t>& results) const;
+
+	// Getters
+	size_t GetNodeCount() const { return m_Nodes.size(); }
+	size_t GetPrimitiveCount() const { return m_Indices.size(); }
+	const Node* GetNodes() const { return m_Nodes.data(); }
+	const uint32_t* GetIndices() const { return m_Indices.data(); }	// Primitive of every leaf slot
+
+private:
+	void buildRecursive(uint32_t nodeIndex, uint32_t begin, uint32_t end, const AABB* bounds,
+		std::vector<glm::vec3>& centers, int depth);
+};
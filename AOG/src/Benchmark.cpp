@@ -0,0 +1,735 @@
+#include "Benchmark.h"
+#include "Scene.h"
+#include "Camera.h"
+#include "Culling.h"
+#include "BVH.h"
+#include "OcclusionCuller.h"
+#include "ThreadPool.h"
+#include "Mesh.h"
+#include "SceneFile.h"
+#include "LightmapBaker.h"
+
+#include <iostream>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include <cstring>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+
+#if !defined(_WIN32)
+#include <sys/resource.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// Entities per hierarchy; each group is a root with a 4-ary tree of descendants below it
+static const size_t GROUP_SIZE = 100;
+
+static double elapsedMs(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void reportUpdate(const char* label, int iterations, double totalMs, size_t updated)
+{
+	double avgMs = totalMs / iterations;
+	std::cout << "  " << label << ": " << avgMs << " ms/update, "
+		<< updated << " matrices";
+	if (updated > 0)
+		std::cout << ", " << (avgMs * 1.0e6) / updated << " ns/matrix";
+	std::cout << std::endl;
+}
+
+void RunSceneBenchmark(size_t entityCount)
+{
+	const int iterations = 10;
+	Scene scene;
+
+	std::cout << "Scene benchmark: " << entityCount << " entities, groups of " << GROUP_SIZE << std::endl;
+
+	// Build
+	auto start = std::chrono::steady_clock::now();
+	scene.Reserve(entityCount);
+	for (size_t i = 0; i < entityCount; i++) {
+		size_t local = i % GROUP_SIZE;
+		size_t root = i - local;
+		Entity parent = (local == 0) ? NULL_ENTITY : (Entity)(root + (local - 1) / 4);
+
+		glm::vec3 position((float)(i % 1000), (float)((i / 1000) % 1000), (float)(i / 1000000));
+		glm::quat rotation = glm::angleAxis(glm::radians((float)(i % 360)), glm::normalize(glm::vec3(1.0f, 0.3f, 0.5f)));
+		scene.CreateEntity(position, rotation, glm::vec3(1.0f), parent);
+	}
+	std::cout << "  create: " << elapsedMs(start) << " ms" << std::endl;
+
+	// Everything is dirty after creation
+	start = std::chrono::steady_clock::now();
+	scene.UpdateWorldMatrices();
+	reportUpdate("initial (100% dirty)", 1, elapsedMs(start), scene.GetLastUpdateCount());
+
+	// Nothing changed, should early out
+	double total = 0.0;
+	for (int it = 0; it < iterations; it++) {
+		start = std::chrono::steady_clock::now();
+		scene.UpdateWorldMatrices();
+		total += elapsedMs(start);
+	}
+	reportUpdate("clean (0% dirty)", iterations, total, scene.GetLastUpdateCount());
+
+	// Move a percentage of roots, which drags their whole subtree along
+	const size_t percents[] = { 1, 10, 100 };
+	for (size_t percent : percents) {
+		size_t stride = 100 / percent;
+		size_t updated = 0;
+		total = 0.0;
+
+		for (int it = 0; it < iterations; it++) {
+			for (size_t root = 0; root < entityCount; root += GROUP_SIZE * stride)
+				scene.SetRotation((Entity)root, glm::angleAxis(glm::radians((float)it), glm::vec3(0.0f, 1.0f, 0.0f)));
+
+			start = std::chrono::steady_clock::now();
+			scene.UpdateWorldMatrices();
+			total += elapsedMs(start);
+			updated = scene.GetLastUpdateCount();
+		}
+
+		std::string label = "roots moved (" + std::to_string(percent) + "% subtrees)";
+		reportUpdate(label.c_str(), iterations, total, updated);
+	}
+
+	// Scattered leaf changes only touch the leaves themselves
+	total = 0.0;
+	size_t updated = 0;
+	for (int it = 0; it < iterations; it++) {
+		for (size_t i = GROUP_SIZE - 1; i < entityCount; i += GROUP_SIZE * 10)
+			scene.SetPosition((Entity)i, glm::vec3((float)it));
+
+		start = std::chrono::steady_clock::now();
+		scene.UpdateWorldMatrices();
+		total += elapsedMs(start);
+		updated = scene.GetLastUpdateCount();
+	}
+	reportUpdate("scattered leaves", iterations, total, updated);
+}
+
+void RunCullingBenchmark(size_t objectCount)
+{
+	const int frames = 36;
+	const float worldSize = 1000.0f;
+
+	std::cout << "Culling benchmark: " << objectCount << " objects, " << frames << " frames, "
+		<< CullingSimdName() << " vs scalar" << std::endl;
+
+	// Deterministic synthetic scene scattered around the camera
+	std::mt19937 rng(1234);
+	std::uniform_real_distribution<float> position(-worldSize * 0.5f, worldSize * 0.5f);
+	std::uniform_real_distribution<float> size(0.5f, 2.0f);
+
+	BoundingSpheres spheres;
+	std::vector<float> ex(objectCount), ey(objectCount), ez(objectCount);
+	spheres.x.resize(objectCount);
+	spheres.y.resize(objectCount);
+	spheres.z.resize(objectCount);
+	spheres.radius.resize(objectCount);
+	for (size_t i = 0; i < objectCount; i++) {
+		spheres.x[i] = position(rng);
+		spheres.y[i] = position(rng);
+		spheres.z[i] = position(rng);
+		ex[i] = size(rng);
+		ey[i] = size(rng);
+		ez[i] = size(rng);
+		spheres.radius[i] = glm::length(glm::vec3(ex[i], ey[i], ez[i]));
+	}
+
+	Camera camera;
+	camera.SetPerspective(800.0f / 600.0f, 0.1f, worldSize);
+
+	std::vector<uint8_t> visibleScalar(objectCount), visibleSimd(objectCount);
+	CullingStats sphereScalar, sphereSimd, boxScalar, boxSimd;
+	size_t mismatches = 0;
+
+	for (int frame = 0; frame < frames; frame++) {
+		// Spin around so every frame sees a different slice of the scene
+		camera.ProcessMouseMovement(10.0f / SENSITIVITY, 0.0f);
+		const Frustum& frustum = camera.GetFrustum();
+
+		auto start = std::chrono::steady_clock::now();
+		sphereScalar.visible += CullSpheresScalar(frustum, spheres.x.data(), spheres.y.data(), spheres.z.data(),
+			spheres.radius.data(), objectCount, visibleScalar.data());
+		sphereScalar.timeMs += elapsedMs(start);
+
+		start = std::chrono::steady_clock::now();
+		sphereSimd.visible += CullSpheres(frustum, spheres.x.data(), spheres.y.data(), spheres.z.data(),
+			spheres.radius.data(), objectCount, visibleSimd.data());
+		sphereSimd.timeMs += elapsedMs(start);
+
+		mismatches += (visibleScalar != visibleSimd) ? 1 : 0;
+
+		start = std::chrono::steady_clock::now();
+		boxScalar.visible += CullAABBsScalar(frustum, spheres.x.data(), spheres.y.data(), spheres.z.data(),
+			ex.data(), ey.data(), ez.data(), objectCount, visibleScalar.data());
+		boxScalar.timeMs += elapsedMs(start);
+
+		start = std::chrono::steady_clock::now();
+		boxSimd.visible += CullAABBs(frustum, spheres.x.data(), spheres.y.data(), spheres.z.data(),
+			ex.data(), ey.data(), ez.data(), objectCount, visibleSimd.data());
+		boxSimd.timeMs += elapsedMs(start);
+
+		mismatches += (visibleScalar != visibleSimd) ? 1 : 0;
+	}
+
+	const char* labels[] = { "spheres scalar", "spheres simd", "aabbs scalar", "aabbs simd" };
+	CullingStats* stats[] = { &sphereScalar, &sphereSimd, &boxScalar, &boxSimd };
+	for (int i = 0; i < 4; i++) {
+		stats[i]->tested = objectCount * frames;
+		std::cout << "  " << labels[i] << ": " << stats[i]->timeMs / frames << " ms/frame, "
+			<< stats[i]->visible / frames << " visible, " << stats[i]->Culled() / frames << " culled per frame" << std::endl;
+	}
+	std::cout << "  frames where simd and scalar disagree: " << mismatches << std::endl;
+}
+
+void RunBVHBenchmark(size_t objectCount)
+{
+	const int frames = 36;
+	const int queries = 1000;
+	const float worldSize = 1000.0f;
+
+	std::cout << "BVH benchmark: " << objectCount << " objects" << std::endl;
+
+	std::mt19937 rng(1234);
+	std::uniform_real_distribution<float> position(-worldSize * 0.5f, worldSize * 0.5f);
+	std::uniform_real_distribution<float> size(0.5f, 2.0f);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+	std::vector<AABB> boxes(objectCount);
+	std::vector<float> cx(objectCount), cy(objectCount), cz(objectCount);
+	std::vector<float> ex(objectCount), ey(objectCount), ez(objectCount);
+	for (size_t i = 0; i < objectCount; i++) {
+		glm::vec3 c(position(rng), position(rng), position(rng));
+		glm::vec3 e(size(rng), size(rng), size(rng));
+		boxes[i] = AABB(c - e, c + e);
+		cx[i] = c.x; cy[i] = c.y; cz[i] = c.z;
+		ex[i] = e.x; ey[i] = e.y; ez[i] = e.z;
+	}
+
+	// Build
+	BVH bvh;
+	auto start = std::chrono::steady_clock::now();
+	bvh.Build(boxes.data(), boxes.size());
+	std::cout << "  build (SAH): " << elapsedMs(start) << " ms, " << bvh.GetNodeCount() << " nodes" << std::endl;
+
+	// Frustum culling
+	Camera camera;
+	camera.SetPerspective(800.0f / 600.0f, 0.1f, worldSize);
+	std::vector<uint8_t> visibleMask(objectCount);
+	std::vector<uint32_t> visibleList;
+	visibleList.reserve(objectCount);
+	double bruteMs = 0.0, bvhMs = 0.0;
+	size_t bruteVisible = 0, bvhVisible = 0;
+
+	for (int frame = 0; frame < frames; frame++) {
+		camera.ProcessMouseMovement(10.0f / SENSITIVITY, 0.0f);
+		const Frustum& frustum = camera.GetFrustum();
+
+		start = std::chrono::steady_clock::now();
+		bruteVisible += CullAABBs(frustum, cx.data(), cy.data(), cz.data(), ex.data(), ey.data(), ez.data(), objectCount, visibleMask.data());
+		bruteMs += elapsedMs(start);
+
+		visibleList.clear();
+		start = std::chrono::steady_clock::now();
+		bvhVisible += bvh.CullFrustum(frustum, visibleList);
+		bvhMs += elapsedMs(start);
+	}
+	std::cout << "  frustum: brute force (" << CullingSimdName() << ") " << bruteMs / frames << " ms, bvh " << bvhMs / frames
+		<< " ms, visible " << bruteVisible / frames << " / " << bvhVisible / frames << std::endl;
+
+	// Ray picking from the camera position
+	std::vector<glm::vec3> directions(queries);
+	for (glm::vec3& d : directions)
+		d = glm::normalize(glm::vec3(unit(rng), unit(rng), unit(rng)) + glm::vec3(0.0f, 0.0f, -0.001f));
+
+	glm::vec3 origin(0.0f);
+	size_t bruteHits = 0, bvhHits = 0, disagreements = 0;
+	bruteMs = 0.0;
+	bvhMs = 0.0;
+	for (const glm::vec3& dir : directions) {
+		glm::vec3 invDir = 1.0f / dir;
+
+		start = std::chrono::steady_clock::now();
+		float closest = worldSize;
+		int64_t bruteIndex = -1;
+		for (size_t i = 0; i < objectCount; i++) {
+			glm::vec3 t0 = (boxes[i].min - origin) * invDir;
+			glm::vec3 t1 = (boxes[i].max - origin) * invDir;
+			glm::vec3 tMin = glm::min(t0, t1), tMax = glm::max(t0, t1);
+			float enter = glm::max(glm::max(tMin.x, tMin.y), glm::max(tMin.z, 0.0f));
+			float exit = glm::min(glm::min(tMax.x, tMax.y), glm::min(tMax.z, closest));
+			if (enter <= exit) {
+				closest = enter;
+				bruteIndex = (int64_t)i;
+			}
+		}
+		bruteMs += elapsedMs(start);
+		bruteHits += bruteIndex >= 0 ? 1 : 0;
+
+		RayHit hit;
+		start = std::chrono::steady_clock::now();
+		bool found = bvh.Raycast(origin, dir, worldSize, hit);
+		bvhMs += elapsedMs(start);
+		bvhHits += found ? 1 : 0;
+
+		if (found != (bruteIndex >= 0) || (found && glm::abs(hit.t - closest) > 1e-3f))
+			disagreements++;
+	}
+	std::cout << "  raycast: brute force " << bruteMs * 1000.0 / queries << " us, bvh " << bvhMs * 1000.0 / queries
+		<< " us, hits " << bruteHits << " / " << bvhHits << ", disagreements " << disagreements << std::endl;
+
+	// Range queries, e.g. objects inside a point light's radius
+	const float radius = 25.0f;
+	std::vector<uint32_t> results;
+	size_t bruteFound = 0, bvhFound = 0;
+	bruteMs = 0.0;
+	bvhMs = 0.0;
+	for (int q = 0; q < queries; q++) {
+		glm::vec3 center(position(rng), position(rng), position(rng));
+
+		start = std::chrono::steady_clock::now();
+		for (size_t i = 0; i < objectCount; i++) {
+			glm::vec3 d = glm::clamp(center, boxes[i].min, boxes[i].max) - center;
+			bruteFound += glm::dot(d, d) <= radius * radius ? 1 : 0;
+		}
+		bruteMs += elapsedMs(start);
+
+		results.clear();
+		start = std::chrono::steady_clock::now();
+		bvhFound += bvh.QuerySphere(center, radius, results);
+		bvhMs += elapsedMs(start);
+	}
+	std::cout << "  sphere r=" << radius << ": brute force " << bruteMs * 1000.0 / queries << " us, bvh " << bvhMs * 1000.0 / queries
+		<< " us, found " << bruteFound << " / " << bvhFound << std::endl;
+
+	// Dynamic objects: refit after everything moved a little, compared to a full rebuild
+	for (AABB& box : boxes) {
+		glm::vec3 offset(unit(rng), unit(rng), unit(rng));
+		box.min += offset;
+		box.max += offset;
+	}
+
+	start = std::chrono::steady_clock::now();
+	bvh.Refit(boxes.data());
+	double refitMs = elapsedMs(start);
+
+	BVH rebuilt;
+	start = std::chrono::steady_clock::now();
+	rebuilt.Build(boxes.data(), boxes.size());
+	std::cout << "  refit: " << refitMs << " ms, rebuild: " << elapsedMs(start) << " ms" << std::endl;
+}
+
+void RunOcclusionBenchmark(size_t objectCount)
+{
+	const int frames = 20;
+	const size_t maxOccluders = 1024;
+	const float spacing = 2.0f;
+
+	// Square grid of unit cubes on the ground with the camera walking in from one edge
+	size_t side = (size_t)ceil(sqrt((double)objectCount));
+	std::vector<glm::mat4> models(objectCount);
+	std::vector<AABB> boxes(objectCount);
+	BoundingSpheres spheres;
+	spheres.x.resize(objectCount);
+	spheres.y.resize(objectCount);
+	spheres.z.resize(objectCount);
+	spheres.radius.assign(objectCount, 0.8660254f);
+
+	for (size_t i = 0; i < objectCount; i++) {
+		glm::vec3 position((float)(i % side) * spacing, 0.0f, -(float)(i / side) * spacing);
+		models[i] = glm::translate(glm::mat4(1.0f), position);
+		boxes[i] = AABB(position - glm::vec3(0.5f), position + glm::vec3(0.5f));
+		spheres.x[i] = position.x;
+		spheres.y[i] = position.y;
+		spheres.z[i] = position.z;
+	}
+
+	ThreadPool pool;
+	ThreadPool serial(0);
+	OcclusionCuller culler(pool);
+	OcclusionCuller reference(serial);
+
+	std::cout << "Occlusion benchmark: " << objectCount << " cubes, " << culler.GetWidth() << "x" << culler.GetHeight()
+		<< " depth buffer, " << pool.GetThreadCount() << " threads" << std::endl;
+
+	Camera camera(glm::vec3(side * spacing * 0.5f + 1.0f, 0.0f, 2.0f));
+	camera.SetPerspective(800.0f / 600.0f, 0.1f, side * spacing * 2.0f);
+
+	std::vector<uint8_t> visible(objectCount), visibleReference(objectCount);
+	std::vector<uint32_t> candidates;
+	OcclusionStats total;
+	size_t frustumVisible = 0, mismatches = 0;
+	double cullMs = 0.0;
+
+	for (int frame = 0; frame < frames; frame++) {
+		camera.ProcessKeyboard(CameraMovement::FORWARD, 0.2f);
+		camera.ProcessMouseMovement(1.0f / SENSITIVITY, 0.0f);
+		const Frustum& frustum = camera.GetFrustum();
+
+		frustumVisible += CullSpheres(frustum, spheres.x.data(), spheres.y.data(), spheres.z.data(), spheres.radius.data(),
+			objectCount, visible.data());
+
+		// Nearest visible cubes make the best occluders
+		auto start = std::chrono::steady_clock::now();
+		candidates.clear();
+		for (size_t i = 0; i < objectCount; i++) {
+			if (visible[i])
+				candidates.push_back((uint32_t)i);
+		}
+		glm::vec3 eye = camera.GetPosition();
+		auto distance2 = [&](uint32_t i) {
+			glm::vec3 d = glm::vec3(spheres.x[i], spheres.y[i], spheres.z[i]) - eye;
+			return glm::dot(d, d);
+		};
+		size_t occluderCount = std::min(maxOccluders, candidates.size());
+		std::partial_sort(candidates.begin(), candidates.begin() + occluderCount, candidates.end(),
+			[&](uint32_t a, uint32_t b) { return distance2(a) < distance2(b); });
+
+		memcpy(visibleReference.data(), visible.data(), objectCount);
+		culler.BeginFrame(camera.GetViewProjectionMatrix());
+		reference.BeginFrame(camera.GetViewProjectionMatrix());
+		for (size_t k = 0; k < occluderCount; k++) {
+			culler.AddBoxOccluder(models[candidates[k]]);
+			reference.AddBoxOccluder(models[candidates[k]]);
+		}
+		culler.RasterizeOccluders();
+		culler.TestBoxes(boxes.data(), objectCount, visible.data());
+		cullMs += elapsedMs(start);
+
+		// Same frame on one thread must give the same depth and the same answers
+		reference.RasterizeOccluders();
+		reference.TestBoxes(boxes.data(), objectCount, visibleReference.data());
+		bool same = memcmp(culler.GetDepthBuffer(), reference.GetDepthBuffer(),
+			sizeof(float) * culler.GetWidth() * culler.GetHeight()) == 0 && visible == visibleReference;
+		mismatches += same ? 0 : 1;
+
+		const OcclusionStats& stats = culler.GetStats();
+		total.occluders += stats.occluders;
+		total.occluderTriangles += stats.occluderTriangles;
+		total.tested += stats.tested;
+		total.occluded += stats.occluded;
+		total.rasterMs += stats.rasterMs;
+		total.testMs += stats.testMs;
+	}
+
+	std::cout << "  per frame: " << frustumVisible / frames << " in frustum, " << total.occluded / frames << " occluded, "
+		<< (frustumVisible - total.occluded) / frames << " drawn" << std::endl;
+	std::cout << "  occluders: " << total.occluders / frames << " boxes, " << total.occluderTriangles / frames << " triangles" << std::endl;
+	std::cout << "  raster " << total.rasterMs / frames << " ms, test " << total.testMs / frames << " ms, total incl. occluder selection "
+		<< cullMs / frames << " ms" << std::endl;
+	std::cout << "  frames differing from the single threaded result: " << mismatches << std::endl;
+}
+
+// Bumpy UV sphere, detailed enough that simplification has something to do
+static void buildDetailedSphere(int rings, int segments, std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+	const float PI = 3.14159265f;
+
+	for (int r = 0; r <= rings; r++) {
+		float theta = PI * r / rings;
+		for (int s = 0; s <= segments; s++) {
+			float phi = 2.0f * PI * s / segments;
+			glm::vec3 direction(sin(theta) * cos(phi), cos(theta), sin(theta) * sin(phi));
+			float bump = 1.0f + 0.05f * sin(7.0f * phi) * sin(5.0f * theta);
+
+			Vertex v;
+			v.position = direction * bump;
+			v.normal = direction;
+			v.texCoords = glm::vec2((float)s / segments, (float)r / rings);
+			vertices.push_back(v);
+		}
+	}
+
+	for (int r = 0; r < rings; r++) {
+		for (int s = 0; s < segments; s++) {
+			uint32_t i0 = r * (segments + 1) + s;
+			uint32_t i1 = i0 + segments + 1;
+			indices.insert(indices.end(), { i0, i0 + 1, i1, i0 + 1, i1 + 1, i1 });
+		}
+	}
+}
+
+void RunLODBenchmark(size_t objectCount)
+{
+	const float pixelError = 1.0f;
+	const float viewportHeight = 1080.0f;
+	const int frames = 200;
+
+	std::cout << "LOD benchmark: " << objectCount << " meshes" << std::endl;
+
+	std::vector<Vertex> vertices;
+	std::vector<uint32_t> indices;
+	buildDetailedSphere(128, 256, vertices, indices);
+
+	Mesh mesh(vertices, indices);
+	auto start = std::chrono::steady_clock::now();
+	mesh.GenerateLODs(6, 0.5f);
+	std::cout << "  simplification: " << elapsedMs(start) << " ms for " << mesh.GetLODCount() - 1 << " levels" << std::endl;
+	for (int lod = 0; lod < mesh.GetLODCount(); lod++)
+		std::cout << "    LOD " << lod << ": " << mesh.GetTriangleCount(lod) << " triangles, error " << mesh.lods[lod].error << std::endl;
+
+	// Meshes scattered between 5 and 500 units from the path the camera flies along
+	std::mt19937 rng(7);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	std::uniform_real_distribution<float> distance(5.0f, 500.0f);
+	std::vector<glm::vec3> positions(objectCount);
+	for (glm::vec3& p : positions)
+		p = glm::normalize(glm::vec3(unit(rng), unit(rng) * 0.2f, unit(rng)) + glm::vec3(0.0f, 0.0f, 1e-3f)) * distance(rng);
+
+	Camera camera(glm::vec3(0.0f));
+	float projectionScale = camera.GetProjectionScale(viewportHeight);
+
+	std::vector<int> lodsHysteresis(objectCount, 0), lodsPlain(objectCount, 0);
+	size_t fullTriangles = 0, lodTriangles = 0, switchesHysteresis = 0, switchesPlain = 0;
+	double selectMs = 0.0;
+
+	for (int frame = 0; frame < frames; frame++) {
+		// Camera swaying back and forth, the worst case for popping between two levels
+		glm::vec3 eye(0.0f, 0.0f, 2.0f * sin(frame * 0.2f));
+
+		start = std::chrono::steady_clock::now();
+		for (size_t i = 0; i < objectCount; i++) {
+			float d = glm::length(positions[i] - eye);
+			int lod = mesh.SelectLOD(d, projectionScale, pixelError, lodsHysteresis[i]);
+			switchesHysteresis += frame > 0 && lod != lodsHysteresis[i] ? 1 : 0;
+			lodsHysteresis[i] = lod;
+			lodTriangles += mesh.GetTriangleCount(lod);
+		}
+		selectMs += elapsedMs(start);
+
+		for (size_t i = 0; i < objectCount; i++) {
+			float d = glm::length(positions[i] - eye);
+			int lod = mesh.SelectLOD(d, projectionScale, pixelError, lodsPlain[i], 0.0f);
+			switchesPlain += frame > 0 && lod != lodsPlain[i] ? 1 : 0;
+			lodsPlain[i] = lod;
+		}
+		fullTriangles += objectCount * mesh.GetTriangleCount(0);
+	}
+
+	std::cout << "  triangles per frame: " << fullTriangles / frames << " full detail, " << lodTriangles / frames << " with LOD ("
+		<< 100.0 * lodTriangles / fullTriangles << "%)" << std::endl;
+	std::cout << "  LOD switches per frame: " << (double)switchesHysteresis / frames << " with hysteresis, "
+		<< (double)switchesPlain / frames << " without" << std::endl;
+	std::cout << "  selection: " << selectMs / frames << " ms/frame" << std::endl;
+}
+
+// Minor + major page faults of the process so far, -1 where we can't tell
+static long pageFaults()
+{
+#if !defined(_WIN32)
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return usage.ru_minflt + usage.ru_majflt;
+#else
+	return -1;
+#endif
+}
+
+// Push the file out of the OS cache so the next load really comes from disk
+static bool dropFileCache(const char* path)
+{
+#if defined(__linux__)
+	int fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return false;
+	fdatasync(fd);
+	bool dropped = posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED) == 0;
+	close(fd);
+	return dropped;
+#else
+	(void)path;
+	return false;
+#endif
+}
+
+void RunSceneLoadBenchmark(size_t entityCount)
+{
+	const char* textPath = "./bench_scene.txt";
+	const char* binaryPath = "./bench_scene.aogs";
+	const float radius = 0.8660254f;
+
+	std::cout << "Scene load benchmark: " << entityCount << " entities" << std::endl;
+
+	// Same hierarchy as the scene benchmark, spread over a few materials
+	{
+		std::ofstream text(textPath);
+		text << std::setprecision(9);
+		text << "material container diffuse=./assets/textures/container_steel.png specular=./assets/textures/container_mask.png shininess=32\n";
+		text << "material steel diffuse=./assets/textures/container_steel.png shininess=64\n";
+		text << "material lamp diffuse=./assets/textures/glowstone.png shininess=0\n";
+		text << "mesh cube builtin:cube\n";
+
+		const char* materials[] = { "container", "steel", "lamp" };
+		for (size_t i = 0; i < entityCount; i++) {
+			size_t local = i % GROUP_SIZE;
+			size_t root = i - local;
+			long parent = (local == 0) ? -1 : (long)(root + (local - 1) / 4);
+
+			text << "entity mesh=cube material=" << materials[i % 3]
+				<< " position=" << (float)(i % 1000) << "," << (float)((i / 1000) % 1000) << "," << (float)(i / 1000000)
+				<< " rotation=" << (float)(i % 360) << ",1,0.3,0.5 radius=" << radius << " parent=" << parent << "\n";
+		}
+	}
+
+	// The way a text based loader goes: parse, then one entity at a time
+	Scene textScene;
+	auto start = std::chrono::steady_clock::now();
+	SceneDescription description;
+	if (!ParseSceneText(textPath, description))
+		return;
+	textScene.Reserve(description.Size());
+	for (size_t i = 0; i < description.Size(); i++) {
+		Entity e = textScene.CreateEntity(description.positions[i], description.rotations[i], description.scales[i], description.parents[i]);
+		textScene.SetBoundingRadius(e, description.radii[i]);
+	}
+	double textMs = elapsedMs(start);
+	std::cout << "  text parse + create: " << textMs << " ms" << std::endl;
+
+	start = std::chrono::steady_clock::now();
+	if (!WriteSceneFile(binaryPath, description))
+		return;
+	std::cout << "  export to binary: " << elapsedMs(start) << " ms" << std::endl;
+
+	// Cold (file dropped from the OS cache if possible) and warm loads
+	Scene binaryScene;
+	SceneFile file;
+	for (int pass = 0; pass < 2; pass++) {
+		bool cold = pass == 0 && dropFileCache(binaryPath);
+		if (pass == 0 && !cold)
+			continue;
+
+		binaryScene.Clear();
+		file.Close();
+		long faults = pageFaults();
+		start = std::chrono::steady_clock::now();
+		if (!file.Load(binaryPath))
+			return;
+		double mapMs = elapsedMs(start);
+		file.AssignTo(binaryScene);
+		double totalMs = elapsedMs(start);
+		faults = pageFaults() - faults;
+
+		std::cout << "  binary load (" << (cold ? "cold" : "warm") << "): " << totalMs << " ms (map " << mapMs << " ms, assign "
+			<< totalMs - mapMs << " ms), " << textMs / totalMs << "x faster";
+		if (faults >= 0)
+			std::cout << ", " << faults << " page faults";
+		std::cout << std::endl;
+	}
+	std::ifstream binary(binaryPath, std::ios::binary | std::ios::ate);
+	std::ifstream text(textPath, std::ios::binary | std::ios::ate);
+	std::cout << "  file size: " << (double)binary.tellg() / (1024 * 1024) << " MB binary, "
+		<< (double)text.tellg() / (1024 * 1024) << " MB text" << std::endl;
+	binary.close();
+	text.close();
+
+	// Both paths must end up with the same world
+	start = std::chrono::steady_clock::now();
+	binaryScene.UpdateWorldMatrices();
+	std::cout << "  first world update: " << elapsedMs(start) << " ms" << std::endl;
+	textScene.UpdateWorldMatrices();
+
+	size_t mismatches = binaryScene.Size() == textScene.Size() ? 0 : 1;
+	for (size_t i = 0; i < binaryScene.Size() && mismatches == 0; i++)
+		if (memcmp(&binaryScene.GetWorldMatrix((Entity)i), &textScene.GetWorldMatrix((Entity)i), sizeof(glm::mat4)) != 0 ||
+			binaryScene.GetWorldBounds().radius[i] != textScene.GetWorldBounds().radius[i])
+			mismatches++;
+	std::cout << "  text and binary scenes " << (mismatches == 0 ? "match" : "DIFFER") << std::endl;
+
+	file.Close();
+	std::remove(textPath);
+	std::remove(binaryPath);
+}
+
+// Unit cube with a vertex per face corner, like the sandbox cube
+static void buildBox(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+	for (int axis = 0; axis < 3; axis++) {
+		for (int side = -1; side <= 1; side += 2) {
+			glm::vec3 n(0.0f), u(0.0f), v(0.0f);
+			n[axis] = (float)side;
+			u[(axis + 1) % 3] = 1.0f;
+			v = glm::cross(n, u);
+
+			uint32_t first = (uint32_t)vertices.size();
+			for (int corner = 0; corner < 4; corner++) {
+				float a = corner == 1 || corner == 2 ? 0.5f : -0.5f, b = corner >= 2 ? 0.5f : -0.5f;
+				vertices.push_back({ n * 0.5f + u * a + v * b, n, glm::vec2(a + 0.5f, b + 0.5f) });
+			}
+			uint32_t quad[6] = { 0, 1, 2, 2, 3, 0 };
+			for (uint32_t q : quad)
+				indices.push_back(first + q);
+		}
+	}
+}
+
+void RunLightmapBenchmark(size_t instanceCount)
+{
+	const int samples = 64;
+	const int resolution = 32;
+
+	std::vector<Vertex> vertices;
+	std::vector<uint32_t> indices;
+	buildBox(vertices, indices);
+	std::vector<glm::vec2> uvs = UnwrapLightmapUVs(vertices, indices, resolution);
+
+	// Boxes scattered over a ground slab, lit by a sun and 4 point lights
+	std::mt19937 rng(7);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	float extent = 2.0f * sqrtf((float)instanceCount);
+	std::vector<glm::mat4> models;
+	models.push_back(glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, -0.5f, 0.0f)), glm::vec3(2.0f * extent, 1.0f, 2.0f * extent)));
+	for (size_t i = 1; i < instanceCount; i++) {
+		glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(unit(rng) * extent, 0.5f + (unit(rng) + 1.0f) * 1.5f, unit(rng) * extent));
+		model = glm::rotate(model, unit(rng) * 3.14159f, glm::normalize(glm::vec3(unit(rng), 1.0f, unit(rng))));
+		models.push_back(glm::scale(model, glm::vec3(0.5f + (unit(rng) + 1.0f) * 0.5f)));
+	}
+
+	BakedDirLight sun = { glm::vec3(-0.2f, -1.0f, -0.3f), glm::vec3(0.05f), glm::vec3(0.4f) };
+	std::vector<BakedPointLight> lamps;
+	for (int i = 0; i < 4; i++)
+		lamps.push_back({ glm::vec3(unit(rng) * extent, 3.0f, unit(rng) * extent), glm::vec3(0.05f), glm::vec3(0.8f), 1.0f, 0.09f, 0.032f });
+
+	unsigned int cores = std::max(std::thread::hardware_concurrency(), 1u);
+	std::cout << "Lightmap benchmark: " << models.size() << " instances, " << resolution << "x" << resolution << " texels each, "
+		<< samples << " samples, " << cores << " hardware threads" << std::endl;
+
+	// Every thread count must give the same lightmap, the random numbers only depend on the texel
+	double baseRate = 0.0;
+	std::vector<glm::vec3> reference;
+	for (unsigned int threads = 1; ; threads = std::min(threads * 2, cores)) {
+		ThreadPool pool((int)threads - 1);
+		LightmapSettings settings;
+		settings.instanceResolution = resolution;
+		settings.samples = samples;
+		LightmapBaker baker(pool, settings);
+		for (const glm::mat4& model : models)
+			baker.AddInstance(vertices, indices, uvs, model);
+		baker.SetLights(sun, lamps.data(), lamps.size());
+		baker.Bake();
+
+		const LightmapStats& stats = baker.GetStats();
+		if (threads == 1) {
+			baseRate = stats.RaysPerSecond();
+			reference = baker.GetTexels();
+			std::cout << "  " << baker.GetAtlas().width << "x" << baker.GetAtlas().height << " atlas, " << stats.texels << " texels, "
+				<< stats.rays << " rays" << std::endl;
+		}
+
+		bool identical = baker.GetTexels() == reference;
+		std::cout << "  " << std::setw(2) << threads << " threads: " << std::setw(8) << stats.traceMs << " ms, "
+			<< stats.RaysPerSecond() / 1e6 << " Mrays/s, " << stats.RaysPerSecond() / baseRate << "x"
+			<< " (ideal " << threads << "x), denoise " << stats.denoiseMs << " ms" << (identical ? "" : ", DIFFERENT RESULT") << std::endl;
+
+		if (threads == cores)
+			break;
+	}
+}
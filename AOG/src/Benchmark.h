@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+
+/*
+	Headless CPU benchmarks. These don't need a window or a GL context and are
+	selected from the command line in main(), e.g. "AOG.exe --bench-scene 1000000"
+*/
+
+// World matrix update pass of the SoA scene
+void RunSceneBenchmark(size_t entityCount);
+
+// Frustum culling of a synthetic scene, SIMD against scalar
+void RunCullingBenchmark(size_t objectCount);
+
+// BVH build, refit and queries (frustum, ray, sphere) against brute force
+void RunBVHBenchmark(size_t objectCount);
+
+// Software occlusion culling of a dense city-like grid of cubes
+void RunOcclusionBenchmark(size_t objectCount);
+
+// Mesh simplification and screen space LOD selection over many detailed meshes
+void RunLODBenchmark(size_t objectCount);
+
+// Mapping a binary scene file against parsing the same scene from text
+void RunSceneLoadBenchmark(size_t entityCount);
+
+// Lightmap baking of a scene of boxes at 1, 2, 4 ... threads: rays per second and scaling
+void RunLightmapBenchmark(size_t instanceCount);
@@ -0,0 +1,218 @@
+#include "CPUProfiler.h"
+
+#if AOG_PROFILING
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <cstdio>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define PROFILER_RDTSC
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define PROFILER_RDTSC
+#endif
+
+static const size_t CHUNK_EVENTS = 4096;
+static const size_t DETAIL_LENGTH = 40;
+
+struct CPUEvent
+{
+	const char* name;
+	uint64_t start, end;
+	char detail[DETAIL_LENGTH];	// Empty when there is none
+};
+
+struct EventChunk
+{
+	CPUEvent events[CHUNK_EVENTS];
+	std::atomic<uint32_t> count;	// Written by the owning thread only, released after each event
+};
+
+// One per thread that ever recorded, kept until exit so finished threads still show up
+struct ThreadBuffer
+{
+	uint32_t id;
+	std::string name;
+	uint32_t generation;		// Capture the chunks belong to
+	size_t current;				// Chunk being filled
+
+	std::mutex mutex;			// Only around changes to the chunk list and the name
+	std::vector<std::unique_ptr<EventChunk>> chunks;
+};
+
+static std::atomic<bool> s_Recording(false);
+static std::atomic<uint32_t> s_Generation(0);
+
+// Capture start and end in both clocks, for the tick rate
+static uint64_t s_StartTicks = 0, s_StopTicks = 0;
+static std::chrono::steady_clock::time_point s_StartTime, s_StopTime;
+
+static std::mutex s_RegistryMutex;
+static std::vector<std::unique_ptr<ThreadBuffer>> s_Buffers;
+static thread_local ThreadBuffer* t_Buffer = nullptr;
+
+static ThreadBuffer& threadBuffer()
+{
+	if (!t_Buffer) {
+		std::lock_guard<std::mutex> lock(s_RegistryMutex);
+		s_Buffers.emplace_back(new ThreadBuffer());
+		t_Buffer = s_Buffers.back().get();
+		t_Buffer->id = (uint32_t)s_Buffers.size();
+		t_Buffer->name = "thread " + std::to_string(t_Buffer->id);
+		t_Buffer->generation = ~0u;
+		t_Buffer->current = 0;
+	}
+	return *t_Buffer;
+}
+
+// Trace strings are JSON, paths come with backslashes on Windows
+static void writeEscaped(std::ofstream& file, const char* text)
+{
+	for (const char* c = text; *c; c++) {
+		if (*c == '"' || *c == '\\')
+			file << '\\' << *c;
+		else if ((unsigned char)*c < 0x20)
+			file << ' ';
+		else
+			file << *c;
+	}
+}
+
+void StartCPUProfile()
+{
+	// Threads notice the new generation on their next event and start their buffers over
+	s_Generation++;
+	s_StartTime = std::chrono::steady_clock::now();
+	s_StartTicks = CPUProfileNow();
+	s_Recording.store(true, std::memory_order_release);
+}
+
+void StopCPUProfile()
+{
+	if (!s_Recording.load(std::memory_order_relaxed))
+		return;
+
+	s_Recording.store(false, std::memory_order_release);
+	s_StopTime = std::chrono::steady_clock::now();
+	s_StopTicks = CPUProfileNow();
+}
+
+bool IsCPUProfileRecording()
+{
+	return s_Recording.load(std::memory_order_relaxed);
+}
+
+uint64_t CPUProfileNow()
+{
+#if defined(PROFILER_RDTSC)
+	return __rdtsc();
+#else
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+void SetProfilerThreadName(const char* name)
+{
+	ThreadBuffer& buffer = threadBuffer();
+	std::lock_guard<std::mutex> lock(buffer.mutex);
+	buffer.name = name;
+}
+
+void RecordCPUEvent(const char* name, const char* detail, uint64_t start, uint64_t end)
+{
+	ThreadBuffer& buffer = threadBuffer();
+
+	uint32_t generation = s_Generation.load(std::memory_order_relaxed);
+	if (buffer.generation != generation) {
+		std::lock_guard<std::mutex> lock(buffer.mutex);
+		for (std::unique_ptr<EventChunk>& chunk : buffer.chunks)
+			chunk->count.store(0, std::memory_order_relaxed);
+		buffer.current = 0;
+		buffer.generation = generation;
+	}
+
+	// Needs a new chunk every CHUNK_EVENTS events, the only time this thread takes a lock
+	if (buffer.current < buffer.chunks.size() && buffer.chunks[buffer.current]->count.load(std::memory_order_relaxed) == CHUNK_EVENTS)
+		buffer.current++;
+	if (buffer.current == buffer.chunks.size()) {
+		std::lock_guard<std::mutex> lock(buffer.mutex);
+		buffer.chunks.emplace_back(new EventChunk());
+		buffer.chunks.back()->count.store(0, std::memory_order_relaxed);
+	}
+
+	EventChunk& chunk = *buffer.chunks[buffer.current];
+	uint32_t index = chunk.count.load(std::memory_order_relaxed);
+	CPUEvent& event = chunk.events[index];
+	event.name = name;
+	event.start = start;
+	event.end = end;
+	size_t length = 0;
+	for (; detail && detail[length] && length < DETAIL_LENGTH - 1; length++)
+		event.detail[length] = detail[length];
+	event.detail[length] = '\0';
+	chunk.count.store(index + 1, std::memory_order_release);
+}
+
+bool WriteCPUTrace(const std::string& path)
+{
+	std::ofstream file(path);
+	if (!file) {
+		std::cout << "ERROR::CPU_PROFILER::CANNOT_WRITE " << path << std::endl;
+		return false;
+	}
+
+	// Ticks per microsecond over the capture, still running captures measure up to now
+	bool recording = IsCPUProfileRecording();
+	uint64_t stopTicks = recording ? CPUProfileNow() : s_StopTicks;
+	std::chrono::steady_clock::time_point stopTime = recording ? std::chrono::steady_clock::now() : s_StopTime;
+	double us = std::chrono::duration<double, std::micro>(stopTime - s_StartTime).count();
+	double ticksPerUs = us > 0.0 && stopTicks > s_StartTicks ? (stopTicks - s_StartTicks) / us : 1000.0;
+
+	uint32_t generation = s_Generation.load(std::memory_order_relaxed);
+	size_t written = 0;
+	char number[64];
+
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	std::lock_guard<std::mutex> registryLock(s_RegistryMutex);
+	for (const std::unique_ptr<ThreadBuffer>& buffer : s_Buffers) {
+		std::lock_guard<std::mutex> lock(buffer->mutex);
+		file << (written++ ? ",\n" : "") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->id << ",\"args\":{\"name\":\"";
+		writeEscaped(file, buffer->name.c_str());
+		file << "\"}}";
+
+		// Left over from an earlier capture
+		if (buffer->generation != generation)
+			continue;
+
+		for (const std::unique_ptr<EventChunk>& chunk : buffer->chunks) {
+			uint32_t count = chunk->count.load(std::memory_order_acquire);
+			for (uint32_t i = 0; i < count; i++) {
+				const CPUEvent& event = chunk->events[i];
+				double ts = ((double)event.start - (double)s_StartTicks) / ticksPerUs;
+				double dur = ((double)event.end - (double)event.start) / ticksPerUs;
+
+				file << ",\n{\"name\":\"";
+				writeEscaped(file, event.name);
+				snprintf(number, sizeof(number), "\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f", ts, dur);
+				file << number << ",\"pid\":1,\"tid\":" << buffer->id;
+				if (event.detail[0]) {
+					file << ",\"args\":{\"detail\":\"";
+					writeEscaped(file, event.detail);
+					file << "\"}";
+				}
+				file << "}";
+			}
+		}
+	}
+	file << "\n]}\n";
+	return true;
+}
+
+#endif
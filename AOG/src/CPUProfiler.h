@@ -0,0 +1,99 @@
+#pragma once
+
+// System library
+#include <cstdint>
+#include <string>
+
+/*
+	Compile time switch: on unless NDEBUG, so release builds carry none of it.
+	Define AOG_PROFILING to 1 or 0 to force it either way.
+*/
+#ifndef AOG_PROFILING
+#if defined(NDEBUG)
+#define AOG_PROFILING 0
+#else
+#define AOG_PROFILING 1
+#endif
+#endif
+
+#if AOG_PROFILING
+
+/*
+	Scoped CPU profiler writing Chrome trace_event JSON (chrome://tracing, Perfetto).
+
+	Every thread appends to its own buffer of fixed size chunks: no lock and no
+	allocation per event, only a new chunk every CHUNK_EVENTS events. A chunk publishes
+	its event count with a release store, so WriteCPUTrace can read the buffers while the
+	threads are still running. Timestamps are rdtsc ticks where there is one, converted
+	with the rate measured against steady_clock over the capture, otherwise steady_clock.
+
+	Scopes only record between start and stop, outside they cost one flag check.
+	Use the macros, they compile to nothing when AOG_PROFILING is 0.
+*/
+
+// Drops what was recorded before and starts recording
+void StartCPUProfile();
+void StopCPUProfile();
+bool IsCPUProfileRecording();
+
+// Every event recorded since the start as complete ("X") events, one track per thread
+bool WriteCPUTrace(const std::string& path);
+
+// Track name of the calling thread in the trace
+void SetProfilerThreadName(const char* name);
+
+uint64_t CPUProfileNow();
+
+// name must outlive the capture (a literal), detail is copied and cut to fit
+void RecordCPUEvent(const char* name, const char* detail, uint64_t start, uint64_t end);
+
+class CPUScope
+{
+private:
+	const char* m_Name;
+	const char* m_Detail;
+	uint64_t m_Start;
+
+public:
+	CPUScope(const char* name, const char* detail = nullptr)
+		: m_Name(name), m_Detail(detail), m_Start(IsCPUProfileRecording() ? CPUProfileNow() : 0) {}
+	~CPUScope() { End(); }
+
+	// Ends the scope before the block does
+	void End()
+	{
+		if (m_Start)
+			RecordCPUEvent(m_Name, m_Detail, m_Start, CPUProfileNow());
+		m_Start = 0;
+	}
+
+	CPUScope(const CPUScope&) = delete;
+	CPUScope& operator=(const CPUScope&) = delete;
+};
+
+#define CPU_SCOPE_JOIN(a, b) a##b
+#define CPU_SCOPE_NAME(a, b) CPU_SCOPE_JOIN(a, b)
+#define CPU_SCOPE(name) CPUScope CPU_SCOPE_NAME(cpuScope, __LINE__)(name)
+#define CPU_SCOPE_DETAIL(name, detail) CPUScope CPU_SCOPE_NAME(cpuScope, __LINE__)(name, detail)
+// For phases that aren't a block of their own, id only has to be unique in the function
+#define CPU_SCOPE_BEGIN(id, name) CPUScope CPU_SCOPE_NAME(cpuScope_, id)(name)
+#define CPU_SCOPE_END(id) CPU_SCOPE_NAME(cpuScope_, id).End()
+#define CPU_PROFILE_START() StartCPUProfile()
+#define CPU_PROFILE_STOP() StopCPUProfile()
+#define CPU_PROFILE_RECORDING() IsCPUProfileRecording()
+#define CPU_PROFILE_WRITE(path) WriteCPUTrace(path)
+#define CPU_PROFILE_THREAD(name) SetProfilerThreadName(name)
+
+#else
+
+#define CPU_SCOPE(name) ((void)0)
+#define CPU_SCOPE_DETAIL(name, detail) ((void)0)
+#define CPU_SCOPE_BEGIN(id, name) ((void)0)
+#define CPU_SCOPE_END(id) ((void)0)
+#define CPU_PROFILE_START() ((void)0)
+#define CPU_PROFILE_STOP() ((void)0)
+#define CPU_PROFILE_RECORDING() false
+#define CPU_PROFILE_WRITE(path) false
+#define CPU_PROFILE_THREAD(name) ((void)0)
+
+#endif
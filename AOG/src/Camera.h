@@ -4,12 +4,17 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <memory>
 
+#include "Frustum.h"
+
 // Const variables
 const float YAW			= -90.0f;
 const float PITCH		= 0.0f;
 const float SPEED		= 2.5f;
 const float SENSITIVITY	= 0.1f;
 const float ZOOM		= 45.0f;
+const float ASPECT		= 800.0f / 600.0f;
+const float NEAR_PLANE	= 0.1f;
+const float FAR_PLANE	= 100.0f;
 
 enum class CameraMovement {
 	FORWARD,
@@ -37,10 +42,22 @@ private:
 	float m_MouseSensitivity;
 	float m_Zoom;
 
+	float m_Aspect;				// Projection Options
+	float m_Near;
+	float m_Far;
+
+	// Cached matrices, only rebuilt after the position, orientation or projection changed
+	mutable bool m_MatricesDirty;
+	mutable glm::mat4 m_View;
+	mutable glm::mat4 m_Projection;
+	mutable glm::mat4 m_ViewProjection;
+	mutable Frustum m_Frustum;
+
 public:
 	// Constructor with vectors
 	Camera(glm::vec3 position = glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3 worldUp = glm::vec3(0.0f, 1.0f, 0.0f))
-		: m_Front(glm::vec3(0.0f, 0.0f, -1.0f)), m_Pitch(PITCH), m_Yaw(YAW), m_MovementSpeed(SPEED), m_MouseSensitivity(SENSITIVITY), m_Zoom(ZOOM) 
+		: m_Front(glm::vec3(0.0f, 0.0f, -1.0f)), m_Pitch(PITCH), m_Yaw(YAW), m_MovementSpeed(SPEED), m_MouseSensitivity(SENSITIVITY), m_Zoom(ZOOM),
+		  m_Aspect(ASPECT), m_Near(NEAR_PLANE), m_Far(FAR_PLANE), m_MatricesDirty(true)
 	{
 		m_Position = position;
 		m_WorldUp = worldUp;
@@ -49,8 +66,53 @@ public:
 	}
 
 	/* The target here is m_Front which is the Z axis */
-	glm::mat4 GetViewMatrix() {
-		return glm::lookAt(m_Position, m_Position + m_Front, m_Up); 
+	const glm::mat4& GetViewMatrix() const {
+		updateMatrices();
+		return m_View;
+	}
+
+	const glm::mat4& GetProjectionMatrix() const {
+		updateMatrices();
+		return m_Projection;
+	}
+
+	const glm::mat4& GetViewProjectionMatrix() const {
+		updateMatrices();
+		return m_ViewProjection;
+	}
+
+	// World space frustum planes extracted from the view projection matrix
+	const Frustum& GetFrustum() const {
+		updateMatrices();
+		return m_Frustum;
+	}
+
+	// Pixels covered by one world unit at distance 1, for screen space error estimates
+	float GetProjectionScale(float viewportHeight) const {
+		return viewportHeight / (2.0f * tan(glm::radians(m_Zoom) * 0.5f));
+	}
+
+	void SetPerspective(float aspect, float zNear, float zFar) {
+		m_Aspect = aspect;
+		m_Near = zNear;
+		m_Far = zFar;
+		m_MatricesDirty = true;
+	}
+
+	void SetAspectRatio(float aspect) {
+		m_Aspect = aspect;
+		m_MatricesDirty = true;
+	}
+
+	// Place the camera and turn it towards target, for scripted camera paths
+	void LookAt(const glm::vec3& position, const glm::vec3& target) {
+		glm::vec3 direction = glm::normalize(target - position);
+
+		m_Position = position;
+		m_Pitch = glm::degrees(asin(glm::clamp(direction.y, -1.0f, 1.0f)));
+		m_Yaw = glm::degrees(atan2(direction.z, direction.x));
+
+		updateCameraVectors();
 	}
 
 	void ProcessKeyboard(CameraMovement mov, float deltaTime){
@@ -75,6 +137,7 @@ public:
 				m_Position -= m_Up * velocity;
 				break;
 		}
+		m_MatricesDirty = true;
 	}
 
 	void ProcessMouseMovement(float xoffset, float yoffset)
@@ -105,12 +168,16 @@ public:
 		if (m_Zoom > 45.0f) {
 			m_Zoom = 45.0f;
 		}
+		m_MatricesDirty = true;
 	}
 
 	// Getters and Setters
 	const float GetZoom() const { return m_Zoom; }
 	const glm::vec3& GetPosition() const { return m_Position; }
 	const glm::vec3& GetFront() const { return m_Front; }
+	float GetAspectRatio() const { return m_Aspect; }
+	float GetNearPlane() const { return m_Near; }
+	float GetFarPlane() const { return m_Far; }
 
 private:
 	void updateCameraVectors() {
@@ -125,5 +192,19 @@ private:
 		// Re-calculate the right and up vectors
 		m_Right = glm::normalize(glm::cross(m_Front, m_WorldUp));
 		m_Up = glm::normalize(glm::cross(m_Right, m_Front));
+
+		m_MatricesDirty = true;
+	}
+
+	void updateMatrices() const {
+		if (!m_MatricesDirty)
+			return;
+
+		m_View = glm::lookAt(m_Position, m_Position + m_Front, m_Up);
+		m_Projection = glm::perspective(glm::radians(m_Zoom), m_Aspect, m_Near, m_Far);
+		m_ViewProjection = m_Projection * m_View;
+		m_Frustum = Frustum::FromMatrix(m_ViewProjection);
+
+		m_MatricesDirty = false;
 	}
 };
\ No newline at end of file
@@ -0,0 +1,272 @@
+#include "Culling.h"
+
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+#if defined(__AVX__)
+	#include <immintrin.h>
+	#define CULLING_AVX
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#include <emmintrin.h>
+	#define CULLING_SSE
+#endif
+
+// Scalar helpers working on [begin, end) so the SIMD paths can reuse them for the tail
+static size_t cullSpheresRange(const Frustum& frustum,
+	const float* x, const float* y, const float* z, const float* radius,
+	size_t begin, size_t end, uint8_t* visible)
+{
+	size_t count = 0;
+	for (size_t i = begin; i < end; i++) {
+		bool inside = true;
+		for (int p = 0; p < 6; p++) {
+			const glm::vec4& plane = frustum.planes[p];
+			// same operation order as the SIMD path so both agree bit for bit
+			float d = (plane.x * x[i] + plane.y * y[i]) + (plane.z * z[i] + plane.w);
+			inside &= (d >= -radius[i]);
+		}
+		visible[i] = inside ? 1 : 0;
+		count += inside ? 1 : 0;
+	}
+	return count;
+}
+
+static size_t cullAABBsRange(const Frustum& frustum,
+	const float* cx, const float* cy, const float* cz,
+	const float* ex, const float* ey, const float* ez,
+	size_t begin, size_t end, uint8_t* visible)
+{
+	size_t count = 0;
+	for (size_t i = begin; i < end; i++) {
+		bool inside = true;
+		for (int p = 0; p < 6; p++) {
+			const glm::vec4& plane = frustum.planes[p];
+			float d = (plane.x * cx[i] + plane.y * cy[i]) + (plane.z * cz[i] + plane.w);
+			// projected radius of the box onto the plane normal
+			float r = (fabsf(plane.x) * ex[i] + fabsf(plane.y) * ey[i]) + fabsf(plane.z) * ez[i];
+			inside &= (d + r >= 0.0f);
+		}
+		visible[i] = inside ? 1 : 0;
+		count += inside ? 1 : 0;
+	}
+	return count;
+}
+
+// Expand a lane mask into one byte per object
+static inline size_t storeMask(int mask, int lanes, uint8_t* visible)
+{
+	size_t count = 0;
+	for (int lane = 0; lane < lanes; lane++) {
+		uint8_t bit = (uint8_t)((mask >> lane) & 1);
+		visible[lane] = bit;
+		count += bit;
+	}
+	return count;
+}
+
+size_t CullSpheresScalar(const Frustum& frustum,
+	const float* x, const float* y, const float* z, const float* radius,
+	size_t count, uint8_t* visible)
+{
+	return cullSpheresRange(frustum, x, y, z, radius, 0, count, visible);
+}
+
+size_t CullAABBsScalar(const Frustum& frustum,
+	const float* cx, const float* cy, const float* cz,
+	const float* ex, const float* ey, const float* ez,
+	size_t count, uint8_t* visible)
+{
+	return cullAABBsRange(frustum, cx, cy, cz, ex, ey, ez, 0, count, visible);
+}
+
+#if defined(CULLING_AVX)
+
+const char* CullingSimdName() { return "AVX"; }
+
+size_t CullSpheres(const Frustum& frustum,
+	const float* x, const float* y, const float* z, const float* radius,
+	size_t count, uint8_t* visible)
+{
+	__m256 px[6], py[6], pz[6], pw[6];
+	for (int p = 0; p < 6; p++) {
+		px[p] = _mm256_set1_ps(frustum.planes[p].x);
+		py[p] = _mm256_set1_ps(frustum.planes[p].y);
+		pz[p] = _mm256_set1_ps(frustum.planes[p].z);
+		pw[p] = _mm256_set1_ps(frustum.planes[p].w);
+	}
+
+	size_t visibleCount = 0;
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m256 vx = _mm256_loadu_ps(x + i);
+		__m256 vy = _mm256_loadu_ps(y + i);
+		__m256 vz = _mm256_loadu_ps(z + i);
+		__m256 vr = _mm256_loadu_ps(radius + i);
+		__m256 negR = _mm256_sub_ps(_mm256_setzero_ps(), vr);
+
+		__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+		for (int p = 0; p < 6; p++) {
+			__m256 d = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(px[p], vx), _mm256_mul_ps(py[p], vy)),
+				_mm256_add_ps(_mm256_mul_ps(pz[p], vz), pw[p]));
+			inside = _mm256_and_ps(inside, _mm256_cmp_ps(d, negR, _CMP_GE_OQ));
+		}
+		visibleCount += storeMask(_mm256_movemask_ps(inside), 8, visible + i);
+	}
+
+	return visibleCount + cullSpheresRange(frustum, x, y, z, radius, i, count, visible);
+}
+
+size_t CullAABBs(const Frustum& frustum,
+	const float* cx, const float* cy, const float* cz,
+	const float* ex, const float* ey, const float* ez,
+	size_t count, uint8_t* visible)
+{
+	__m256 px[6], py[6], pz[6], pw[6], ax[6], ay[6], az[6];
+	for (int p = 0; p < 6; p++) {
+		px[p] = _mm256_set1_ps(frustum.planes[p].x);
+		py[p] = _mm256_set1_ps(frustum.planes[p].y);
+		pz[p] = _mm256_set1_ps(frustum.planes[p].z);
+		pw[p] = _mm256_set1_ps(frustum.planes[p].w);
+		ax[p] = _mm256_set1_ps(fabsf(frustum.planes[p].x));
+		ay[p] = _mm256_set1_ps(fabsf(frustum.planes[p].y));
+		az[p] = _mm256_set1_ps(fabsf(frustum.planes[p].z));
+	}
+
+	size_t visibleCount = 0;
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m256 vx = _mm256_loadu_ps(cx + i);
+		__m256 vy = _mm256_loadu_ps(cy + i);
+		__m256 vz = _mm256_loadu_ps(cz + i);
+		__m256 wx = _mm256_loadu_ps(ex + i);
+		__m256 wy = _mm256_loadu_ps(ey + i);
+		__m256 wz = _mm256_loadu_ps(ez + i);
+
+		__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+		for (int p = 0; p < 6; p++) {
+			__m256 d = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(px[p], vx), _mm256_mul_ps(py[p], vy)),
+				_mm256_add_ps(_mm256_mul_ps(pz[p], vz), pw[p]));
+			__m256 r = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ax[p], wx), _mm256_mul_ps(ay[p], wy)),
+				_mm256_mul_ps(az[p], wz));
+			inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(d, r), _mm256_setzero_ps(), _CMP_GE_OQ));
+		}
+		visibleCount += storeMask(_mm256_movemask_ps(inside), 8, visible + i);
+	}
+
+	return visibleCount + cullAABBsRange(frustum, cx, cy, cz, ex, ey, ez, i, count, visible);
+}
+
+#elif defined(CULLING_SSE)
+
+const char* CullingSimdName() { return "SSE2"; }
+
+size_t CullSpheres(const Frustum& frustum,
+	const float* x, const float* y, const float* z, const float* radius,
+	size_t count, uint8_t* visible)
+{
+	__m128 px[6], py[6], pz[6], pw[6];
+	for (int p = 0; p < 6; p++) {
+		px[p] = _mm_set1_ps(frustum.planes[p].x);
+		py[p] = _mm_set1_ps(frustum.planes[p].y);
+		pz[p] = _mm_set1_ps(frustum.planes[p].z);
+		pw[p] = _mm_set1_ps(frustum.planes[p].w);
+	}
+
+	size_t visibleCount = 0;
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		__m128 vx = _mm_loadu_ps(x + i);
+		__m128 vy = _mm_loadu_ps(y + i);
+		__m128 vz = _mm_loadu_ps(z + i);
+		__m128 vr = _mm_loadu_ps(radius + i);
+		__m128 negR = _mm_sub_ps(_mm_setzero_ps(), vr);
+
+		__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+		for (int p = 0; p < 6; p++) {
+			__m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(px[p], vx), _mm_mul_ps(py[p], vy)),
+				_mm_add_ps(_mm_mul_ps(pz[p], vz), pw[p]));
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(d, negR));
+		}
+		visibleCount += storeMask(_mm_movemask_ps(inside), 4, visible + i);
+	}
+
+	return visibleCount + cullSpheresRange(frustum, x, y, z, radius, i, count, visible);
+}
+
+size_t CullAABBs(const Frustum& frustum,
+	const float* cx, const float* cy, const float* cz,
+	const float* ex, const float* ey, const float* ez,
+	size_t count, uint8_t* visible)
+{
+	__m128 px[6], py[6], pz[6], pw[6], ax[6], ay[6], az[6];
+	for (int p = 0; p < 6; p++) {
+		px[p] = _mm_set1_ps(frustum.planes[p].x);
+		py[p] = _mm_set1_ps(frustum.planes[p].y);
+		pz[p] = _mm_set1_ps(frustum.planes[p].z);
+		pw[p] = _mm_set1_ps(frustum.planes[p].w);
+		ax[p] = _mm_set1_ps(fabsf(frustum.planes[p].x));
+		ay[p] = _mm_set1_ps(fabsf(frustum.planes[p].y));
+		az[p] = _mm_set1_ps(fabsf(frustum.planes[p].z));
+	}
+
+	size_t visibleCount = 0;
+	size_t i = 0;
+	for (; i + 4 <= count; i += 4) {
+		__m128 vx = _mm_loadu_ps(cx + i);
+		__m128 vy = _mm_loadu_ps(cy + i);
+		__m128 vz = _mm_loadu_ps(cz + i);
+		__m128 wx = _mm_loadu_ps(ex + i);
+		__m128 wy = _mm_loadu_ps(ey + i);
+		__m128 wz = _mm_loadu_ps(ez + i);
+
+		__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+		for (int p = 0; p < 6; p++) {
+			__m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(px[p], vx), _mm_mul_ps(py[p], vy)),
+				_mm_add_ps(_mm_mul_ps(pz[p], vz), pw[p]));
+			__m128 r = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax[p], wx), _mm_mul_ps(ay[p], wy)),
+				_mm_mul_ps(az[p], wz));
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(d, r), _mm_setzero_ps()));
+		}
+		visibleCount += storeMask(_mm_movemask_ps(inside), 4, visible + i);
+	}
+
+	return visibleCount + cullAABBsRange(frustum, cx, cy, cz, ex, ey, ez, i, count, visible);
+}
+
+#else
+
+const char* CullingSimdName() { return "scalar"; }
+
+size_t CullSpheres(const Frustum& frustum,
+	const float* x, const float* y, const float* z, const float* radius,
+	size_t count, uint8_t* visible)
+{
+	return cullSpheresRange(frustum, x, y, z, radius, 0, count, visible);
+}
+
+size_t CullAABBs(const Frustum& frustum,
+	const float* cx, const float* cy, const float* cz,
+	const float* ex, const float* ey, const float* ez,
+	size_t count, uint8_t* visible)
+{
+	return cullAABBsRange(frustum, cx, cy, cz, ex, ey, ez, 0, count, visible);
+}
+
+#endif
+
+void SortFrontToBack(uint32_t* indices, size_t count,
+	const float* x, const float* y, const float* z, const glm::vec3& eye)
+{
+	// Sort (distance, index) pairs rather than indices so the comparisons stay in cache
+	std::vector<std::pair<float, uint32_t>> keys(count);
+	for (size_t i = 0; i < count; i++) {
+		uint32_t e = indices[i];
+		float dx = x[e] - eye.x, dy = y[e] - eye.y, dz = z[e] - eye.z;
+		keys[i] = std::make_pair(dx * dx + dy * dy + dz * dz, e);
+	}
+
+	std::sort(keys.begin(), keys.end());
+	for (size_t i = 0; i < count; i++)
+		indices[i] = keys[i].second;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "Frustum.h"
+
+// System library
+#include <cstddef>
+#include <cstdint>
+
+/*
+	Frustum culling over structure-of-arrays bounds. The SIMD path tests 8 objects
+	at a time with AVX (when compiled with /arch:AVX), 4 at a time with SSE otherwise.
+	Each function writes 1/0 into visible[i] and returns the number of visible objects.
+*/
+
+struct CullingStats
+{
+	size_t tested = 0;
+	size_t visible = 0;
+	double timeMs = 0.0;
+
+	size_t Culled() const { return tested - visible; }
+};
+
+size_t CullSpheres(const Frustum& frustum,
+	const float* x, const float* y, const float* z, const float* radius,
+	size_t count, uint8_t* visible);
+
+// Boxes given as centre and half extents
+size_t CullAABBs(const Frustum& frustum,
+	const float* cx, const float* cy, const float* cz,
+	const float* ex, const float* ey, const float* ez,
+	size_t count, uint8_t* visible);
+
+// Plain C++ reference versions, used for validation and as the benchmark baseline
+size_t CullSpheresScalar(const Frustum& frustum,
+	const float* x, const float* y, const float* z, const float* radius,
+	size_t count, uint8_t* visible);
+
+size_t CullAABBsScalar(const Frustum& frustum,
+	const float* cx, const float* cy, const float* cz,
+	const float* ex, const float* ey, const float* ez,
+	size_t count, uint8_t* visible);
+
+// Reorder indices nearest first (by centre distance to eye) so early depth rejects
+// as much of the expensive shading as possible
+void SortFrontToBack(uint32_t* indices, size_t count,
+	const float* x, const float* y, const float* z, const glm::vec3& eye);
+
+// Name of the instruction set the SIMD path was compiled for
+const char* CullingSimdName();
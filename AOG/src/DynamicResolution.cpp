@@ -0,0 +1,193 @@
+#include "DynamicResolution.h"
+
+#include <algorithm>
+#include <cmath>
+
+DynamicResolution::DynamicResolution(int outputWidth, int outputHeight, const DynamicResolutionSettings& settings)
+	: m_Settings(settings),
+	m_Target(std::max((int)std::ceil(outputWidth * settings.maxScale), 1), std::max((int)std::ceil(outputHeight * settings.maxScale), 1)),
+	m_UpscaleShader("./assets/shaders/deferredVShader.glsl", "./assets/shaders/upscaleFShader.glsl"),
+	m_EmptyVAO(0), m_Frame(0), m_OutputWidth(outputWidth), m_OutputHeight(outputHeight),
+	m_Scale(settings.maxScale), m_OverBudget(0), m_UnderBudget(0), m_Timing(false),
+	m_LastFrame(), m_HasLastFrame(false), m_HistoryNext(0)
+{
+	glGenVertexArrays(1, &m_EmptyVAO);
+	for (PendingQuery& query : m_Queries) {
+		glGenQueries(1, &query.id);
+		query.pending = false;
+	}
+
+	m_UpscaleShader.use();
+	m_UpscaleShader.setInt("source", 0);
+}
+
+DynamicResolution::~DynamicResolution()
+{
+	for (PendingQuery& query : m_Queries)
+		glDeleteQueries(1, &query.id);
+	glDeleteVertexArrays(1, &m_EmptyVAO);
+}
+
+void DynamicResolution::BeginFrame()
+{
+	// Oldest first, so the results come back in frame order
+	for (int i = 0; i < QUERY_COUNT; i++) {
+		PendingQuery& query = m_Queries[(m_Frame + i) % QUERY_COUNT];
+		if (!query.pending)
+			continue;
+
+		GLint available = 0;
+		glGetQueryObjectiv(query.id, GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available)
+			break;
+		collect(query);
+	}
+
+	// Every query is in flight, this frame's slot has to finish first
+	PendingQuery& query = m_Queries[m_Frame % QUERY_COUNT];
+	if (query.pending)
+		collect(query);
+
+	query.frame.frame = m_Frame;
+	query.frame.scale = m_Scale;
+	query.frame.width = GetRenderWidth();
+	query.frame.height = GetRenderHeight();
+	query.frame.gpuMs = 0.0;
+	glBeginQuery(GL_TIME_ELAPSED, query.id);
+	m_Timing = true;
+}
+
+void DynamicResolution::Bind() const
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, m_Target.id);
+	glViewport(0, 0, GetRenderWidth(), GetRenderHeight());
+}
+
+void DynamicResolution::EndFrame(unsigned int framebuffer, int width, int height)
+{
+	const PendingQuery& query = m_Queries[m_Frame % QUERY_COUNT];
+	const float renderWidth = (float)query.frame.width, renderHeight = (float)query.frame.height;
+
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glViewport(0, 0, width, height);
+
+	GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+	glDisable(GL_DEPTH_TEST);
+
+	// Sharpen more the further the scale is from full resolution
+	float range = std::max(m_Settings.maxScale - m_Settings.minScale, 1e-3f);
+	float sharpness = m_Settings.sharpness * std::min(std::max((m_Settings.maxScale - query.frame.scale) / range, 0.0f), 1.0f);
+
+	m_UpscaleShader.use();
+	m_UpscaleShader.setVec4f("sourceRect", glm::vec4(renderWidth / m_Target.GetWidth(), renderHeight / m_Target.GetHeight(),
+		1.0f / m_Target.GetWidth(), 1.0f / m_Target.GetHeight()));
+	m_UpscaleShader.setFloat("sharpness", sharpness);
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, m_Target.colorTexture);
+	glBindVertexArray(m_EmptyVAO);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+	glBindVertexArray(0);
+
+	if (depthTest)
+		glEnable(GL_DEPTH_TEST);
+
+	if (m_Timing) {
+		glEndQuery(GL_TIME_ELAPSED);
+		m_Queries[m_Frame % QUERY_COUNT].pending = true;
+		m_Timing = false;
+	}
+	m_Frame++;
+}
+
+void DynamicResolution::Flush()
+{
+	for (int i = 0; i < QUERY_COUNT; i++) {
+		PendingQuery& query = m_Queries[(m_Frame + i) % QUERY_COUNT];
+		if (query.pending)
+			collect(query);
+	}
+}
+
+void DynamicResolution::SetOutputSize(int width, int height)
+{
+	if (width <= 0 || height <= 0)
+		return;	// Minimised
+
+	m_OutputWidth = width;
+	m_OutputHeight = height;
+	m_Target.Resize(std::max((int)std::ceil(width * m_Settings.maxScale), 1), std::max((int)std::ceil(height * m_Settings.maxScale), 1));
+}
+
+int DynamicResolution::GetRenderWidth() const
+{
+	return std::min(std::max((int)(m_OutputWidth * m_Scale + 0.5f), 1), m_Target.GetWidth());
+}
+
+int DynamicResolution::GetRenderHeight() const
+{
+	return std::min(std::max((int)(m_OutputHeight * m_Scale + 0.5f), 1), m_Target.GetHeight());
+}
+
+std::vector<DynamicResolutionFrame> DynamicResolution::GetHistory() const
+{
+	std::vector<DynamicResolutionFrame> frames;
+	frames.reserve(m_History.size());
+	for (size_t i = 0; i < m_History.size(); i++)
+		frames.push_back(m_History[(m_HistoryNext + i) % m_History.size()]);
+	return frames;
+}
+
+void DynamicResolution::collect(PendingQuery& query)
+{
+	GLuint64 elapsedNs = 0;
+	glGetQueryObjectui64v(query.id, GL_QUERY_RESULT, &elapsedNs);
+	query.pending = false;
+	query.frame.gpuMs = elapsedNs / 1.0e6;
+
+	m_LastFrame = query.frame;
+	m_HasLastFrame = true;
+	if (m_Settings.historyFrames > 0) {
+		if (m_History.size() < (size_t)m_Settings.historyFrames)
+			m_History.push_back(query.frame);
+		else
+			m_History[m_HistoryNext] = query.frame;
+		m_HistoryNext = (m_HistoryNext + 1) % m_Settings.historyFrames;
+	}
+	adjust(query.frame);
+}
+
+void DynamicResolution::adjust(const DynamicResolutionFrame& frame)
+{
+	// Rendered before the last change, says nothing about the current scale
+	if (frame.scale != m_Scale)
+		return;
+
+	const double target = m_Settings.targetMs;
+	float scale = m_Scale;
+	if (frame.gpuMs > target) {
+		m_UnderBudget = 0;
+		if (++m_OverBudget < m_Settings.shrinkFrames)
+			return;
+
+		// Pixels scale with the square, aim for the middle of the band so the next frames don't grow right back
+		double aim = target * (1.0 - 0.5 * m_Settings.headroom);
+		scale = m_Scale * (float)std::sqrt(aim / frame.gpuMs);
+		scale = std::min(std::floor(scale / m_Settings.step + 1e-3f) * m_Settings.step, m_Scale - m_Settings.step);
+	}
+	else if (frame.gpuMs < target * (1.0 - m_Settings.headroom)) {
+		m_OverBudget = 0;
+		if (++m_UnderBudget < m_Settings.growFrames)
+			return;
+
+		scale = m_Scale + m_Settings.step;
+	}
+	else {
+		m_OverBudget = m_UnderBudget = 0;
+		return;
+	}
+
+	// Pinned at a limit the counting just starts again
+	m_Scale = std::min(std::max(scale, m_Settings.minScale), m_Settings.maxScale);
+	m_OverBudget = m_UnderBudget = 0;
+}
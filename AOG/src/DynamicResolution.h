@@ -0,0 +1,118 @@
+#pragma once
+
+#include "Framebuffer.h"
+#include "Shader.h"
+
+// Third Party library
+#include <glad/glad.h>
+
+// System library
+#include <vector>
+
+struct DynamicResolutionSettings
+{
+	float targetMs = 16.0f;		// GPU time of a frame to hold, upscale included
+	float minScale = 0.5f;		// Per axis, of the output size
+	float maxScale = 1.0f;
+	float step = 0.05f;			// The scale moves in these increments so the size doesn't jitter
+	float headroom = 0.15f;		// Only grows while the frames stay this far under the target
+	int shrinkFrames = 2;		// Over budget frames in a row before shrinking, one spike isn't enough
+	int growFrames = 30;		// Frames under the headroom in a row before growing one step
+	float sharpness = 0.5f;		// Of the upscale at the smallest scale, none at full resolution
+	int historyFrames = 0;		// Timed frames GetHistory keeps, the newest ones. 0 keeps only the last
+};
+
+// One timed frame, in the order the timer queries came back
+struct DynamicResolutionFrame
+{
+	int frame;
+	float scale;
+	int width, height;		// Rendered size
+	double gpuMs;
+};
+
+/*
+	Renders the scene into an offscreen target at a fraction of the output size and
+	upscales it, picking the fraction that keeps the GPU frame time on target.
+
+	Each frame is timed with a GL_TIME_ELAPSED query, read back a few frames later
+	when it is available so the CPU never waits on it. The cost of a frame is about
+	proportional to its pixels, so an over budget frame shrinks the scale at once by
+	sqrt(target / time); growing waits until a run of frames stayed under the target
+	minus the headroom, and then goes one step at a time. Results of frames rendered
+	at an older scale are not used to decide.
+
+	The target is allocated at the largest scale and rendered into its corner, so
+	changing the scale only changes the viewport. The upscale is one full screen pass:
+	bilinear, then an unsharp mask clamped to the neighbourhood so edges don't ring.
+*/
+class DynamicResolution
+{
+private:
+	static const int QUERY_COUNT = 4;	// Frames a query can stay in flight before BeginFrame waits for it
+
+	struct PendingQuery
+	{
+		unsigned int id;
+		bool pending;
+		DynamicResolutionFrame frame;
+	};
+
+	DynamicResolutionSettings m_Settings;
+	Framebuffer m_Target;
+	Shader m_UpscaleShader;
+	unsigned int m_EmptyVAO;
+
+	PendingQuery m_Queries[QUERY_COUNT];
+	int m_Frame;
+	int m_OutputWidth, m_OutputHeight;
+	float m_Scale;
+	int m_OverBudget, m_UnderBudget;	// Frames in a row at the current scale
+	bool m_Timing;
+
+	DynamicResolutionFrame m_LastFrame;
+	bool m_HasLastFrame;
+	std::vector<DynamicResolutionFrame> m_History;	// Ring, m_HistoryNext is the oldest once full
+	size_t m_HistoryNext;
+
+public:
+	DynamicResolution(int outputWidth, int outputHeight, const DynamicResolutionSettings& settings = DynamicResolutionSettings());
+	~DynamicResolution();
+
+	DynamicResolution(const DynamicResolution&) = delete;
+	DynamicResolution& operator=(const DynamicResolution&) = delete;
+
+	// Collects the finished timer queries, which may change the scale, and starts timing this frame
+	void BeginFrame();
+
+	// Binds the offscreen target with the viewport at the render size
+	void Bind() const;
+
+	// Stops timing and upscales into framebuffer, whose viewport covers width x height
+	void EndFrame(unsigned int framebuffer, int width, int height);
+
+	// Waits for the queries still in flight, so GetHistory has every frame
+	void Flush();
+
+	// The window was resized, keeps the scale
+	void SetOutputSize(int width, int height);
+
+	void SetTargetMs(float targetMs) { m_Settings.targetMs = targetMs; }
+
+	// Getters
+	unsigned int GetFramebuffer() const { return m_Target.id; }
+	float GetScale() const { return m_Scale; }
+	int GetRenderWidth() const;
+	int GetRenderHeight() const;
+	const DynamicResolutionSettings& GetSettings() const { return m_Settings; }
+
+	// The most recent result, nullptr until the first query came back
+	const DynamicResolutionFrame* GetLastFrame() const { return m_HasLastFrame ? &m_LastFrame : nullptr; }
+
+	// The last historyFrames timed frames, oldest first
+	std::vector<DynamicResolutionFrame> GetHistory() const;
+
+private:
+	void collect(PendingQuery& query);
+	void adjust(const DynamicResolutionFrame& frame);
+};
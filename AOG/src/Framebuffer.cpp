@@ -0,0 +1,84 @@
+#include "Framebuffer.h"
+#include "MemoryTracker.h"
+
+#include <iostream>
+
+Framebuffer::Framebuffer(int width, int height)
+	: id(0), colorTexture(0), depthRenderbuffer(0), m_Width(width), m_Height(height)
+{
+	create();
+}
+
+Framebuffer::~Framebuffer()
+{
+	destroy();
+}
+
+void Framebuffer::Bind() const
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, id);
+	glViewport(0, 0, m_Width, m_Height);
+}
+
+void Framebuffer::Resize(int width, int height)
+{
+	if (width == m_Width && height == m_Height)
+		return;
+
+	destroy();
+	m_Width = width;
+	m_Height = height;
+	create();
+}
+
+void Framebuffer::BlitToScreen(int screenWidth, int screenHeight) const
+{
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, id);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+	glBlitFramebuffer(0, 0, m_Width, m_Height, 0, 0, screenWidth, screenHeight, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void Framebuffer::ReadPixels(std::vector<uint8_t>& pixels) const
+{
+	pixels.resize((size_t)m_Width * m_Height * 4);
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, id);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, m_Width, m_Height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+}
+
+void Framebuffer::create()
+{
+	glGenFramebuffers(1, &id);
+	glBindFramebuffer(GL_FRAMEBUFFER, id);
+
+	glGenTextures(1, &colorTexture);
+	glBindTexture(GL_TEXTURE_2D, colorTexture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, m_Width, m_Height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	TrackGPUMemory(GPUResource::Texture, colorTexture, TextureBytes(GL_RGBA8, m_Width, m_Height), "render target", "color");
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, colorTexture, 0);
+
+	glGenRenderbuffers(1, &depthRenderbuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, depthRenderbuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, m_Width, m_Height);
+	TrackGPUMemory(GPUResource::Renderbuffer, depthRenderbuffer, TextureBytes(GL_DEPTH24_STENCIL8, m_Width, m_Height), "render target", "depth");
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthRenderbuffer);
+
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		std::cout << "ERROR::FRAMEBUFFER::INCOMPLETE" << std::endl;
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void Framebuffer::destroy()
+{
+	UntrackGPUMemory(GPUResource::Texture, colorTexture);
+	UntrackGPUMemory(GPUResource::Renderbuffer, depthRenderbuffer);
+	glDeleteFramebuffers(1, &id);
+	glDeleteTextures(1, &colorTexture);
+	glDeleteRenderbuffers(1, &depthRenderbuffer);
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+// Third Party library
+#include <glad/glad.h>
+
+// System library
+#include <vector>
+#include <cstdint>
+
+/*
+	Render target with an RGBA8 color texture and a depth/stencil renderbuffer.
+	Used when there is no window to draw to (headless runs) or when the frame has
+	to be read back.
+*/
+class Framebuffer
+{
+public:
+	unsigned int id;
+	unsigned int colorTexture;
+	unsigned int depthRenderbuffer;
+
+	Framebuffer(int width, int height);
+	~Framebuffer();
+
+	Framebuffer(const Framebuffer&) = delete;
+	Framebuffer& operator=(const Framebuffer&) = delete;
+
+	// Binds for drawing and sets the viewport to cover it
+	void Bind() const;
+	void Resize(int width, int height);
+
+	// Copy the color buffer into the window's default framebuffer, stretched to fit
+	void BlitToScreen(int screenWidth, int screenHeight) const;
+
+	// Tightly packed RGBA rows, bottom row first
+	void ReadPixels(std::vector<uint8_t>& pixels) const;
+
+	// Getters
+	int GetWidth() const { return m_Width; }
+	int GetHeight() const { return m_Height; }
+
+private:
+	int m_Width, m_Height;
+
+	void create();
+	void destroy();
+};
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+/*
+	Six planes stored as (normal, distance) with the normal pointing inside,
+	so a point p is inside a plane when dot(normal, p) + distance >= 0
+*/
+struct Frustum
+{
+	// Plane order: left, right, bottom, top, near, far
+	glm::vec4 planes[6];
+
+	// Gribb/Hartmann extraction from a (projection * view) matrix
+	static Frustum FromMatrix(const glm::mat4& m)
+	{
+		// glm is column major, so row i of the matrix is (m[0][i], m[1][i], m[2][i], m[3][i])
+		glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+		glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+		glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+		glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+		Frustum frustum;
+		frustum.planes[0] = row3 + row0;
+		frustum.planes[1] = row3 - row0;
+		frustum.planes[2] = row3 + row1;
+		frustum.planes[3] = row3 - row1;
+		frustum.planes[4] = row3 + row2;
+		frustum.planes[5] = row3 - row2;
+
+		// Normalise so the plane distance is in world units (needed for sphere radii)
+		for (int i = 0; i < 6; i++) {
+			float length = glm::length(glm::vec3(frustum.planes[i]));
+			frustum.planes[i] /= length;
+		}
+
+		return frustum;
+	}
+};
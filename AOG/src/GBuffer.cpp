@@ -0,0 +1,99 @@
+#include "GBuffer.h"
+#include "MemoryTracker.h"
+
+#include <iostream>
+
+GBuffer::GBuffer(int width, int height)
+	: id(0), albedoTexture(0), normalTexture(0), depthTexture(0), m_EmptyVAO(0), m_Width(width), m_Height(height)
+{
+	glGenVertexArrays(1, &m_EmptyVAO);
+	create();
+}
+
+GBuffer::~GBuffer()
+{
+	destroy();
+	glDeleteVertexArrays(1, &m_EmptyVAO);
+}
+
+void GBuffer::Bind() const
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, id);
+	glViewport(0, 0, m_Width, m_Height);
+}
+
+void GBuffer::Resize(int width, int height)
+{
+	if (width == m_Width && height == m_Height)
+		return;
+
+	destroy();
+	m_Width = width;
+	m_Height = height;
+	create();
+}
+
+void GBuffer::BindTextures(int firstUnit) const
+{
+	const unsigned int textures[3] = { albedoTexture, normalTexture, depthTexture };
+	for (int i = 0; i < 3; i++) {
+		glActiveTexture(GL_TEXTURE0 + firstUnit + i);
+		glBindTexture(GL_TEXTURE_2D, textures[i]);
+	}
+}
+
+void GBuffer::BlitDepth(unsigned int targetFramebuffer) const
+{
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, id);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, targetFramebuffer);
+	glBlitFramebuffer(0, 0, m_Width, m_Height, 0, 0, m_Width, m_Height, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+	glBindFramebuffer(GL_FRAMEBUFFER, targetFramebuffer);
+}
+
+void GBuffer::DrawFullscreen() const
+{
+	glBindVertexArray(m_EmptyVAO);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+	glBindVertexArray(0);
+}
+
+void GBuffer::create()
+{
+	glGenFramebuffers(1, &id);
+	glBindFramebuffer(GL_FRAMEBUFFER, id);
+
+	// Every pixel maps to exactly one texel, no filtering
+	auto createTarget = [this](unsigned int& texture, GLenum internalFormat, GLenum format, GLenum type, GLenum attachment) {
+		glGenTextures(1, &texture);
+		glBindTexture(GL_TEXTURE_2D, texture);
+		glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, m_Width, m_Height, 0, format, type, nullptr);
+		TrackGPUMemory(GPUResource::Texture, texture, TextureBytes(internalFormat, m_Width, m_Height), "gbuffer");
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, texture, 0);
+	};
+
+	createTarget(albedoTexture, GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, GL_COLOR_ATTACHMENT0);
+	createTarget(normalTexture, GL_RGB10_A2, GL_RGBA, GL_UNSIGNED_INT_2_10_10_10_REV, GL_COLOR_ATTACHMENT1);
+	createTarget(depthTexture, GL_DEPTH24_STENCIL8, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, GL_DEPTH_STENCIL_ATTACHMENT);
+
+	const GLenum drawBuffers[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+	glDrawBuffers(2, drawBuffers);
+
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		std::cout << "ERROR::GBUFFER::INCOMPLETE" << std::endl;
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void GBuffer::destroy()
+{
+	glDeleteFramebuffers(1, &id);
+	unsigned int textures[3] = { albedoTexture, normalTexture, depthTexture };
+	for (unsigned int texture : textures)
+		UntrackGPUMemory(GPUResource::Texture, texture);
+	glDeleteTextures(3, textures);
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+// Third Party library
+#include <glad/glad.h>
+
+/*
+	Geometry buffer for deferred shading, 8 bytes per pixel plus depth:
+
+		0  RGBA8     albedo, specular mask (one channel)
+		1  RGB10_A2  octahedral normal (2 x 10 bits), log2(shininess) / 8
+		   DEPTH24_STENCIL8 texture, world positions are rebuilt from it
+
+	Written by gbufferFShader.glsl, read back by deferredFShader.glsl in one full
+	screen pass.
+*/
+class GBuffer
+{
+public:
+	static const int BYTES_PER_PIXEL = 8;	// Color targets only
+
+	unsigned int id;
+	unsigned int albedoTexture;
+	unsigned int normalTexture;
+	unsigned int depthTexture;
+
+private:
+	unsigned int m_EmptyVAO;	// Core profile needs one bound even without vertex attributes
+	int m_Width, m_Height;
+
+public:
+	GBuffer(int width, int height);
+	~GBuffer();
+
+	GBuffer(const GBuffer&) = delete;
+	GBuffer& operator=(const GBuffer&) = delete;
+
+	// Binds for drawing and sets the viewport to cover it
+	void Bind() const;
+	void Resize(int width, int height);
+
+	// Albedo, normal and depth on firstUnit .. firstUnit + 2
+	void BindTextures(int firstUnit) const;
+
+	// Copies the depth into another framebuffer of the same size, so forward passes can test against it
+	void BlitDepth(unsigned int targetFramebuffer) const;
+
+	// One triangle covering the viewport, for the lighting pass
+	void DrawFullscreen() const;
+
+	int GetWidth() const { return m_Width; }
+	int GetHeight() const { return m_Height; }
+
+private:
+	void create();
+	void destroy();
+};
@@ -0,0 +1,29 @@
+#include "GL43.h"
+
+PFNGLDISPATCHCOMPUTEPROC_AOG glDispatchCompute = nullptr;
+PFNGLMEMORYBARRIERPROC_AOG glMemoryBarrier = nullptr;
+PFNGLMULTIDRAWELEMENTSINDIRECTPROC_AOG glMultiDrawElementsIndirect = nullptr;
+
+static bool s_Loaded = false;
+
+bool LoadGL43(GLADloadproc load)
+{
+	// Core profile contexts report their real version even when 3.3 was requested
+	GLint major = 0, minor = 0;
+	glGetIntegerv(GL_MAJOR_VERSION, &major);
+	glGetIntegerv(GL_MINOR_VERSION, &minor);
+	if (major < 4 || (major == 4 && minor < 3))
+		return false;
+
+	glDispatchCompute = (PFNGLDISPATCHCOMPUTEPROC_AOG)load("glDispatchCompute");
+	glMemoryBarrier = (PFNGLMEMORYBARRIERPROC_AOG)load("glMemoryBarrier");
+	glMultiDrawElementsIndirect = (PFNGLMULTIDRAWELEMENTSINDIRECTPROC_AOG)load("glMultiDrawElementsIndirect");
+
+	s_Loaded = glDispatchCompute && glMemoryBarrier && glMultiDrawElementsIndirect;
+	return s_Loaded;
+}
+
+bool HasGL43()
+{
+	return s_Loaded;
+}
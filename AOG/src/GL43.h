@@ -0,0 +1,46 @@
+#pragma once
+
+// Third Party library
+#include <glad/glad.h>
+
+/*
+	The bundled glad loader only covers GL 3.3 core. The few GL 4.3 entry points the
+	GPU driven paths need (compute shaders, storage buffers, multi draw indirect) are
+	loaded here by hand, with the same proc address function that loaded glad.
+
+	Everything stays optional: check LoadGL43() and keep the 3.3 path otherwise.
+*/
+
+#ifndef GL_COMPUTE_SHADER
+#define GL_COMPUTE_SHADER 0x91B9
+#endif
+#ifndef GL_SHADER_STORAGE_BUFFER
+#define GL_SHADER_STORAGE_BUFFER 0x90D2
+#endif
+#ifndef GL_DRAW_INDIRECT_BUFFER
+#define GL_DRAW_INDIRECT_BUFFER 0x8F3F
+#endif
+#ifndef GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT
+#define GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT 0x00000001
+#endif
+#ifndef GL_COMMAND_BARRIER_BIT
+#define GL_COMMAND_BARRIER_BIT 0x00000040
+#endif
+#ifndef GL_BUFFER_UPDATE_BARRIER_BIT
+#define GL_BUFFER_UPDATE_BARRIER_BIT 0x00000200
+#endif
+#ifndef GL_SHADER_STORAGE_BARRIER_BIT
+#define GL_SHADER_STORAGE_BARRIER_BIT 0x00002000
+#endif
+
+typedef void (APIENTRYP PFNGLDISPATCHCOMPUTEPROC_AOG)(GLuint numGroupsX, GLuint numGroupsY, GLuint numGroupsZ);
+typedef void (APIENTRYP PFNGLMEMORYBARRIERPROC_AOG)(GLbitfield barriers);
+typedef void (APIENTRYP PFNGLMULTIDRAWELEMENTSINDIRECTPROC_AOG)(GLenum mode, GLenum type, const void* indirect, GLsizei drawcount, GLsizei stride);
+
+extern PFNGLDISPATCHCOMPUTEPROC_AOG glDispatchCompute;
+extern PFNGLMEMORYBARRIERPROC_AOG glMemoryBarrier;
+extern PFNGLMULTIDRAWELEMENTSINDIRECTPROC_AOG glMultiDrawElementsIndirect;
+
+// Needs a current context already loaded by glad. False when the context is older than 4.3
+bool LoadGL43(GLADloadproc load);
+bool HasGL43();
@@ -0,0 +1,1125 @@
+#include "GLCapture.h"
+#include "GL43.h"
+#include "GLEntryPoints.h"
+#include "OffscreenContext.h"
+#include "MappedFile.h"
+
+#include <glad/glad.h>
+
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <tuple>
+#include <utility>
+#include <cstring>
+#include <cstdint>
+
+static const char CAPTURE_MAGIC[8] = { 'A', 'O', 'G', 'G', 'L', 'C', 'A', 'P' };
+static const uint32_t CAPTURE_VERSION = 1;
+static const uint16_t FRAME_MARK = 0xFFFF;	// In place of an entry point, ends a frame
+static const uint16_t END_MARK = 0xFFFE;
+static const size_t WRITE_CHUNK = 1 << 20;		// Written to the file in pieces this big
+static const size_t SCRATCH_BYTES = 64 << 20;	// Where replayed queries and readbacks write
+
+/*
+	What the integer (and pointer) arguments of an entry point are, one character each:
+	. as is, b buffer, t texture, v vertex array, f framebuffer, r renderbuffer,
+	p program or shader (one name space), P program made current, q query,
+	l uniform location in the current program, e draw or read buffer, o offset
+	into the bound buffer, # bytes written to the output pointer after it.
+	Missing characters are '.', entry points without a line are all '.'.
+*/
+struct GLArgKinds
+{
+	const char* name;
+	const char* args;
+	char result;		// Kind of the name returned, 0 for none
+};
+
+static const GLArgKinds s_ArgKinds[] = {
+	{ "glBindBuffer", ".b", 0 }, { "glBindBufferBase", "..b", 0 }, { "glBindBufferRange", "..b", 0 },
+	{ "glBindTexture", ".t", 0 }, { "glBindVertexArray", "v", 0 }, { "glBindFramebuffer", ".f", 0 },
+	{ "glBindRenderbuffer", ".r", 0 }, { "glTexBuffer", "..b", 0 },
+	{ "glFramebufferTexture", "..t", 0 }, { "glFramebufferTexture1D", "...t", 0 }, { "glFramebufferTexture2D", "...t", 0 },
+	{ "glFramebufferTexture3D", "...t", 0 }, { "glFramebufferTextureLayer", "..t", 0 }, { "glFramebufferRenderbuffer", "...r", 0 },
+	{ "glUseProgram", "P", 0 }, { "glCreateShader", "", 'p' }, { "glCreateProgram", "", 'p' },
+	{ "glAttachShader", "pp", 0 }, { "glDetachShader", "pp", 0 }, { "glCompileShader", "p", 0 },
+	{ "glLinkProgram", "p", 0 }, { "glValidateProgram", "p", 0 }, { "glDeleteShader", "p", 0 },
+	{ "glDeleteProgram", "p", 0 }, { "glGetShaderiv", "p", 0 }, { "glGetProgramiv", "p", 0 },
+	{ "glGetShaderInfoLog", "p", 0 }, { "glGetProgramInfoLog", "p", 0 }, { "glUniformBlockBinding", "p", 0 },
+	{ "glBeginQuery", ".q", 0 }, { "glQueryCounter", "q", 0 }, { "glGetQueryObjectiv", "q", 0 },
+	{ "glGetQueryObjectuiv", "q", 0 }, { "glGetQueryObjecti64v", "q", 0 }, { "glGetQueryObjectui64v", "q", 0 },
+	{ "glUniform1f", "l", 0 }, { "glUniform2f", "l", 0 }, { "glUniform3f", "l", 0 }, { "glUniform4f", "l", 0 },
+	{ "glUniform1i", "l", 0 }, { "glUniform2i", "l", 0 }, { "glUniform3i", "l", 0 }, { "glUniform4i", "l", 0 },
+	{ "glUniform1ui", "l", 0 }, { "glUniform2ui", "l", 0 }, { "glUniform3ui", "l", 0 }, { "glUniform4ui", "l", 0 },
+	{ "glDrawBuffer", "e", 0 }, { "glReadBuffer", "e", 0 },
+	{ "glVertexAttribPointer", ".....o", 0 }, { "glVertexAttribIPointer", "....o", 0 },
+	{ "glDrawElements", "...o", 0 }, { "glDrawElementsInstanced", "...o", 0 }, { "glDrawRangeElements", ".....o", 0 },
+	{ "glDrawElementsBaseVertex", "...o", 0 }, { "glDrawElementsInstancedBaseVertex", "...o", 0 },
+	{ "glDrawRangeElementsBaseVertex", ".....o", 0 }, { "glMultiDrawElementsIndirect", "..o", 0 },
+	{ "glGetBufferSubData", "..#", 0 },
+};
+
+static void describe(const char* name, const char*& args, char& result)
+{
+	args = "";
+	result = 0;
+	for (const GLArgKinds& kinds : s_ArgKinds) {
+		if (strcmp(kinds.name, name) == 0) {
+			args = kinds.args;
+			result = kinds.result;
+			return;
+		}
+	}
+}
+
+static char kindAt(const char* args, size_t index)
+{
+	for (size_t i = 0; args[i]; i++) {
+		if (i == index)
+			return args[i];
+	}
+	return '.';
+}
+
+/*
+	Reading the file back, everything unaligned so copied out
+*/
+static std::vector<uint64_t> s_Staging;
+
+struct Reader
+{
+	const uint8_t* at;
+	const uint8_t* end;
+	bool failed;
+
+	template <typename T>
+	T get()
+	{
+		T value = T();
+		if ((size_t)(end - at) < sizeof(T))
+			failed = true;
+		else {
+			memcpy(&value, at, sizeof(T));
+			at += sizeof(T);
+		}
+		return value;
+	}
+
+	// Straight from the file, for bytes and chars
+	const uint8_t* bytes(size_t size)
+	{
+		if ((size_t)(end - at) < size) {
+			failed = true;
+			return nullptr;
+		}
+		const uint8_t* data = at;
+		at += size;
+		return data;
+	}
+
+	// Aligned for any type, valid until the next call
+	const void* data(size_t size)
+	{
+		const uint8_t* data = bytes(size);
+		if (!data || (uintptr_t)data % sizeof(uint64_t) == 0)
+			return data;
+		s_Staging.resize(size / sizeof(uint64_t) + 1);
+		memcpy(s_Staging.data(), data, size);
+		return s_Staging.data();
+	}
+};
+
+typedef void (*ReplayFn)(Reader&);
+
+/*
+	One slot per function pointer, like in GLInterceptor.cpp: F is its type, Slot the
+	pointer glad calls through
+*/
+template <typename F, F* Slot>
+struct GLCaptureSlot
+{
+	static F original;		// What was in the slot before, usually the driver's
+	static F placed;		// nullptr while not hooked
+	static int entry;
+	static const char* args;
+	static char result;
+	static bool dropped;	// Reads client data nothing here knows the size of
+};
+
+template <typename F, F* Slot> F GLCaptureSlot<F, Slot>::original = nullptr;
+template <typename F, F* Slot> F GLCaptureSlot<F, Slot>::placed = nullptr;
+template <typename F, F* Slot> int GLCaptureSlot<F, Slot>::entry = -1;
+template <typename F, F* Slot> const char* GLCaptureSlot<F, Slot>::args = "";
+template <typename F, F* Slot> char GLCaptureSlot<F, Slot>::result = 0;
+template <typename F, F* Slot> bool GLCaptureSlot<F, Slot>::dropped = false;
+
+#define GL_TYPE_SLOT(name) decltype(glad_gl##name), &glad_gl##name
+#define GL_SLOT(name) GLCaptureSlot<GL_TYPE_SLOT(name)>
+
+/*
+	Capture
+*/
+static bool s_Capturing = false;
+static std::string s_Path;
+static std::ofstream s_File;
+static std::vector<char> s_Buffer;
+static int s_Frame = 0, s_FirstFrame = 0, s_FrameCount = 0;
+static uint64_t s_Calls = 0, s_Written = 0;
+static std::vector<const char*> s_EntryNames;	// Index is the id in the file
+static std::vector<uint64_t> s_DroppedCalls;
+
+static void flushCapture()
+{
+	s_File.write(s_Buffer.data(), s_Buffer.size());
+	s_Written += s_Buffer.size();
+	s_Buffer.clear();
+}
+
+static void putBytes(const void* data, size_t size)
+{
+	const char* bytes = (const char*)data;
+	s_Buffer.insert(s_Buffer.end(), bytes, bytes + size);
+	if (s_Buffer.size() >= WRITE_CHUNK)
+		flushCapture();
+}
+
+template <typename T>
+static void put(T value)
+{
+	putBytes(&value, sizeof(T));
+}
+
+static void beginCall(int entry)
+{
+	put((uint16_t)entry);
+	s_Calls++;
+}
+
+static void putString(const char* text)
+{
+	uint32_t length = (uint32_t)strlen(text);
+	put(length);
+	putBytes(text, length);
+}
+
+template <typename T>
+static void writeArg(T value)
+{
+	put(value);
+}
+
+// Outputs, the replay gives them scratch memory
+template <typename T>
+static void writeArg(T*) {}
+
+// Only offsets get here, what points at client data is written by its own wrapper
+template <typename T>
+static void writeArg(const T* value)
+{
+	put((uint64_t)(uintptr_t)value);
+}
+
+template <typename R>
+struct CapturedResult
+{
+	template <typename F, typename... A>
+	static R call(F function, A... args)
+	{
+		R result = function(args...);
+		put(result);
+		return result;
+	}
+};
+
+template <>
+struct CapturedResult<void>
+{
+	template <typename F, typename... A>
+	static void call(F function, A... args) { function(args...); }
+};
+
+template <typename F, F* Slot, typename R, typename... A>
+static R APIENTRY capturedCall(A... args)
+{
+	typedef GLCaptureSlot<F, Slot> S;
+	if (S::dropped) {
+		s_DroppedCalls[S::entry]++;
+		return S::original(args...);
+	}
+
+	beginCall(S::entry);
+	int written[] = { 0, (writeArg(args), 0)... };
+	(void)written;
+	return CapturedResult<R>::call(S::original, args...);
+}
+
+template <typename F, F* Slot, typename R, typename... A>
+static F capturedCallOf(R (APIENTRY*)(A...))
+{
+	return &capturedCall<F, Slot, R, A...>;
+}
+
+template <typename T> struct IsDataPointer { static const bool value = false; };
+template <typename T> struct IsDataPointer<const T*> { static const bool value = true; };
+
+template <typename R, typename... A>
+static bool readsClientData(R (APIENTRY*)(A...), const char* args)
+{
+	const bool data[] = { false, IsDataPointer<A>::value... };
+	for (size_t i = 0; i < sizeof...(A); i++) {
+		if (data[i + 1] && kindAt(args, i) != 'o')
+			return true;
+	}
+	return false;
+}
+
+template <typename F, F* Slot>
+static void hook(const char* name, F special = nullptr)
+{
+	typedef GLCaptureSlot<F, Slot> S;
+	if (!*Slot || *Slot == S::placed)
+		return;		// Not loaded, or hooked already
+
+	if (S::entry < 0) {
+		S::entry = (int)s_EntryNames.size();
+		s_EntryNames.push_back(name);
+		s_DroppedCalls.push_back(0);
+	}
+	describe(name, S::args, S::result);
+	S::original = *Slot;
+	S::placed = special ? special : capturedCallOf<F, Slot>(*Slot);
+	S::dropped = !special && readsClientData(*Slot, S::args);
+	*Slot = S::placed;
+}
+
+template <typename F, F* Slot>
+static void unhook()
+{
+	typedef GLCaptureSlot<F, Slot> S;
+	if (S::placed && *Slot == S::placed)
+		*Slot = S::original;
+	S::placed = nullptr;
+}
+
+// State the call depends on, asked without going through the capture
+static GLint currentInteger(GLenum name)
+{
+	GLint value = 0;
+	PFNGLGETINTEGERVPROC get = GL_SLOT(GetIntegerv)::placed ? GL_SLOT(GetIntegerv)::original : glad_glGetIntegerv;
+	get(name, &value);
+	return value;
+}
+
+/*
+	Replay
+*/
+static std::unordered_map<uint64_t, GLuint> s_Names;	// Replayed name by kind and captured name
+static std::unordered_map<uint64_t, GLint> s_Locations;	// Replayed location by captured program and location
+static GLuint s_CurrentProgram = 0;		// Captured name
+static GLuint s_DefaultFramebuffer = 0;
+static std::vector<char> s_Scratch;
+static std::unordered_map<std::string, ReplayFn>* s_Registry = nullptr;	// Filled instead of hooking while set
+
+static uint64_t nameKey(char kind, GLuint name)
+{
+	return ((uint64_t)(unsigned char)kind << 32) | name;
+}
+
+static void mapName(char kind, GLuint captured, GLuint replayed)
+{
+	s_Names[nameKey(kind, captured)] = replayed;
+}
+
+static GLuint remapArg(GLuint value, char kind)
+{
+	switch (kind) {
+	case '.':
+		return value;
+	case '#':
+		if (s_Scratch.size() < value)
+			s_Scratch.resize(value);
+		return value;
+	case 'e':
+		// There is no window, the default framebuffer's color is attachment 0
+		return value == GL_BACK || value == GL_FRONT || value == GL_BACK_LEFT || value == GL_FRONT_LEFT ? GL_COLOR_ATTACHMENT0 : value;
+	case 'P':
+		s_CurrentProgram = value;
+		kind = 'p';
+		break;
+	}
+
+	if (value == 0)
+		return kind == 'f' ? s_DefaultFramebuffer : 0;
+	auto found = s_Names.find(nameKey(kind, value));
+	return found != s_Names.end() ? found->second : value;
+}
+
+static GLint remapLocation(GLint location)
+{
+	if (location < 0)
+		return location;
+	auto found = s_Locations.find(((uint64_t)s_CurrentProgram << 32) | (uint32_t)location);
+	return found != s_Locations.end() ? found->second : location;
+}
+
+static GLint remapArg(GLint value, char kind)
+{
+	return kind == 'l' ? remapLocation(value) : value;
+}
+
+template <typename T>
+static T remapArg(T value, char kind)
+{
+	if (kind == '#' && s_Scratch.size() < (size_t)value)
+		s_Scratch.resize((size_t)value);
+	return value;
+}
+
+template <typename T>
+struct ReplayArg
+{
+	static T read(Reader& r, char kind) { return remapArg(r.get<T>(), kind); }
+};
+
+template <typename T>
+struct ReplayArg<T*>
+{
+	static T* read(Reader&, char) { return (T*)s_Scratch.data(); }
+};
+
+template <typename T>
+struct ReplayArg<const T*>
+{
+	static const T* read(Reader& r, char) { return (const T*)(uintptr_t)r.get<uint64_t>(); }
+};
+
+static void mapResult(char kind, GLuint captured, GLuint replayed)
+{
+	if (kind)
+		mapName(kind, captured, replayed);
+}
+
+template <typename T>
+static void mapResult(char, T, T) {}
+
+template <typename R>
+struct ReplayResult
+{
+	template <typename Call>
+	static void run(Reader& r, Call call, char kind)
+	{
+		R replayed = call();
+		R captured = r.get<R>();
+		mapResult(kind, captured, replayed);
+	}
+};
+
+template <>
+struct ReplayResult<void>
+{
+	template <typename Call>
+	static void run(Reader&, Call call, char) { call(); }
+};
+
+template <typename F, F* Slot, typename R, typename... A>
+struct GLReplay
+{
+	template <size_t... I>
+	static R invoke(Reader& r, std::index_sequence<I...>)
+	{
+		typedef GLCaptureSlot<F, Slot> S;
+
+		// Read in order, a braced list of ints guarantees it
+		std::tuple<A...> args;
+		int read[] = { 0, (std::get<I>(args) = ReplayArg<A>::read(r, kindAt(S::args, I)), 0)... };
+		(void)read;
+		return (*Slot)(std::get<I>(args)...);
+	}
+
+	static void call(Reader& r)
+	{
+		ReplayResult<R>::run(r, [&r]() { return invoke(r, std::index_sequence_for<A...>()); }, GLCaptureSlot<F, Slot>::result);
+	}
+};
+
+template <typename F, F* Slot, typename R, typename... A>
+static ReplayFn replayerOf(R (APIENTRY*)(A...))
+{
+	return &GLReplay<F, Slot, R, A...>::call;
+}
+
+template <typename F, F* Slot>
+static void registerReplay(const char* name, ReplayFn special = nullptr)
+{
+	typedef GLCaptureSlot<F, Slot> S;
+	describe(name, S::args, S::result);
+
+	// nullptr when this context doesn't have it, an error once a call needs it
+	s_Registry->emplace(name, *Slot ? (special ? special : replayerOf<F, Slot>((F)nullptr)) : nullptr);
+}
+
+/*
+	Entry points reading client data, each with its own wrapper and replay
+*/
+template <typename F, F* Slot>
+static void special(const char* name, F capture, ReplayFn replay)
+{
+	if (s_Registry)
+		registerReplay<F, Slot>(name, replay);
+	else
+		hook<F, Slot>(name, capture);
+}
+
+// glGen*: the names the driver gave, the replay maps its own onto them
+template <typename F, F* Slot, char Kind>
+static void APIENTRY captureGen(GLsizei n, GLuint* names)
+{
+	typedef GLCaptureSlot<F, Slot> S;
+	S::original(n, names);
+	beginCall(S::entry);
+	put(n);
+	putBytes(names, n * sizeof(GLuint));
+}
+
+template <typename F, F* Slot, char Kind>
+static void replayGen(Reader& r)
+{
+	GLsizei n = r.get<GLsizei>();
+	const GLuint* captured = (const GLuint*)r.data(n * sizeof(GLuint));
+	if (!captured)
+		return;
+
+	std::vector<GLuint> names(n);
+	(*Slot)(n, names.data());
+	for (GLsizei i = 0; i < n; i++)
+		mapName(Kind, captured[i], names[i]);
+}
+
+template <typename F, F* Slot, char Kind>
+static void APIENTRY captureDelete(GLsizei n, const GLuint* names)
+{
+	typedef GLCaptureSlot<F, Slot> S;
+	beginCall(S::entry);
+	put(n);
+	putBytes(names, n * sizeof(GLuint));
+	S::original(n, names);
+}
+
+template <typename F, F* Slot, char Kind>
+static void replayDelete(Reader& r)
+{
+	GLsizei n = r.get<GLsizei>();
+	const GLuint* captured = (const GLuint*)r.data(n * sizeof(GLuint));
+	if (!captured)
+		return;
+
+	std::vector<GLuint> names(n);
+	for (GLsizei i = 0; i < n; i++) {
+		names[i] = remapArg(captured[i], Kind);
+		s_Names.erase(nameKey(Kind, captured[i]));
+	}
+	(*Slot)(n, names.data());
+}
+
+template <typename F, F* Slot, typename T, int Elements>
+static void APIENTRY captureUniformArray(GLint location, GLsizei count, const T* value)
+{
+	typedef GLCaptureSlot<F, Slot> S;
+	beginCall(S::entry);
+	put(location);
+	put(count);
+	putBytes(value, count * Elements * sizeof(T));
+	S::original(location, count, value);
+}
+
+template <typename F, F* Slot, typename T, int Elements>
+static void replayUniformArray(Reader& r)
+{
+	GLint location = r.get<GLint>();
+	GLsizei count = r.get<GLsizei>();
+	const T* value = (const T*)r.data(count * Elements * sizeof(T));
+	if (value)
+		(*Slot)(remapLocation(location), count, value);
+}
+
+template <typename F, F* Slot, int Elements>
+static void APIENTRY captureUniformMatrix(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value)
+{
+	typedef GLCaptureSlot<F, Slot> S;
+	beginCall(S::entry);
+	put(location);
+	put(count);
+	put(transpose);
+	putBytes(value, count * Elements * sizeof(GLfloat));
+	S::original(location, count, transpose, value);
+}
+
+template <typename F, F* Slot, int Elements>
+static void replayUniformMatrix(Reader& r)
+{
+	GLint location = r.get<GLint>();
+	GLsizei count = r.get<GLsizei>();
+	GLboolean transpose = r.get<GLboolean>();
+	const GLfloat* value = (const GLfloat*)r.data(count * Elements * sizeof(GLfloat));
+	if (value)
+		(*Slot)(remapLocation(location), count, transpose, value);
+}
+
+static void APIENTRY captureShaderSource(GLuint shader, GLsizei count, const GLchar* const* string, const GLint* length)
+{
+	beginCall(GL_SLOT(ShaderSource)::entry);
+	put(shader);
+	put(count);
+	for (GLsizei i = 0; i < count; i++) {
+		GLint size = length && length[i] >= 0 ? length[i] : (GLint)strlen(string[i]);
+		put(size);
+		putBytes(string[i], size);
+	}
+	GL_SLOT(ShaderSource)::original(shader, count, string, length);
+}
+
+static void replayShaderSource(Reader& r)
+{
+	GLuint shader = r.get<GLuint>();
+	GLsizei count = r.get<GLsizei>();
+	std::vector<const GLchar*> strings(std::max(count, 0));
+	std::vector<GLint> lengths(std::max(count, 0));
+	for (GLsizei i = 0; i < count; i++) {
+		lengths[i] = r.get<GLint>();
+		strings[i] = (const GLchar*)r.bytes(lengths[i]);
+	}
+	if (!r.failed)
+		glad_glShaderSource(remapArg(shader, 'p'), count, strings.data(), lengths.data());
+}
+
+static GLint APIENTRY captureGetUniformLocation(GLuint program, const GLchar* name)
+{
+	GLint location = GL_SLOT(GetUniformLocation)::original(program, name);
+	beginCall(GL_SLOT(GetUniformLocation)::entry);
+	put(program);
+	putString(name);
+	put(location);
+	return location;
+}
+
+static void replayGetUniformLocation(Reader& r)
+{
+	GLuint program = r.get<GLuint>();
+	uint32_t length = r.get<uint32_t>();
+	const uint8_t* chars = r.bytes(length);
+	GLint captured = r.get<GLint>();
+	if (r.failed)
+		return;
+
+	std::string name((const char*)chars, length);
+	GLint location = glad_glGetUniformLocation(remapArg(program, 'p'), name.c_str());
+	if (captured >= 0)
+		s_Locations[((uint64_t)program << 32) | (uint32_t)captured] = location;
+}
+
+static void APIENTRY captureDrawBuffers(GLsizei n, const GLenum* bufs)
+{
+	beginCall(GL_SLOT(DrawBuffers)::entry);
+	put(n);
+	putBytes(bufs, n * sizeof(GLenum));
+	GL_SLOT(DrawBuffers)::original(n, bufs);
+}
+
+static void replayDrawBuffers(Reader& r)
+{
+	GLsizei n = r.get<GLsizei>();
+	const GLenum* captured = (const GLenum*)r.data(n * sizeof(GLenum));
+	if (!captured)
+		return;
+
+	std::vector<GLenum> bufs(n);
+	for (GLsizei i = 0; i < n; i++)
+		bufs[i] = remapArg(captured[i], 'e');
+	glad_glDrawBuffers(n, bufs.data());
+}
+
+static void APIENTRY captureBufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage)
+{
+	beginCall(GL_SLOT(BufferData)::entry);
+	put(target);
+	put(size);
+	put((uint8_t)(data != nullptr));
+	if (data)
+		putBytes(data, size);
+	put(usage);
+	GL_SLOT(BufferData)::original(target, size, data, usage);
+}
+
+static void replayBufferData(Reader& r)
+{
+	GLenum target = r.get<GLenum>();
+	GLsizeiptr size = r.get<GLsizeiptr>();
+	const void* data = r.get<uint8_t>() ? r.data(size) : nullptr;
+	GLenum usage = r.get<GLenum>();
+	if (!r.failed)
+		glad_glBufferData(target, size, data, usage);
+}
+
+static void APIENTRY captureBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data)
+{
+	beginCall(GL_SLOT(BufferSubData)::entry);
+	put(target);
+	put(offset);
+	put(size);
+	putBytes(data, size);
+	GL_SLOT(BufferSubData)::original(target, offset, size, data);
+}
+
+static void replayBufferSubData(Reader& r)
+{
+	GLenum target = r.get<GLenum>();
+	GLintptr offset = r.get<GLintptr>();
+	GLsizeiptr size = r.get<GLsizeiptr>();
+	const void* data = r.data(size);
+	if (!r.failed)
+		glad_glBufferSubData(target, offset, size, data);
+}
+
+// Bytes per pixel in client memory
+static size_t pixelBytes(GLenum format, GLenum type)
+{
+	switch (type) {
+	case GL_UNSIGNED_BYTE_3_3_2: case GL_UNSIGNED_BYTE_2_3_3_REV:
+		return 1;
+	case GL_UNSIGNED_SHORT_5_6_5: case GL_UNSIGNED_SHORT_5_6_5_REV: case GL_UNSIGNED_SHORT_4_4_4_4:
+	case GL_UNSIGNED_SHORT_4_4_4_4_REV: case GL_UNSIGNED_SHORT_5_5_5_1: case GL_UNSIGNED_SHORT_1_5_5_5_REV:
+		return 2;
+	case GL_UNSIGNED_INT_8_8_8_8: case GL_UNSIGNED_INT_8_8_8_8_REV: case GL_UNSIGNED_INT_10_10_10_2:
+	case GL_UNSIGNED_INT_2_10_10_10_REV: case GL_UNSIGNED_INT_24_8: case GL_UNSIGNED_INT_10F_11F_11F_REV:
+	case GL_UNSIGNED_INT_5_9_9_9_REV:
+		return 4;
+	case GL_FLOAT_32_UNSIGNED_INT_24_8_REV:
+		return 8;
+	}
+
+	size_t components = 1;
+	switch (format) {
+	case GL_RG: case GL_RG_INTEGER:
+		components = 2;
+		break;
+	case GL_RGB: case GL_BGR: case GL_RGB_INTEGER: case GL_BGR_INTEGER:
+		components = 3;
+		break;
+	case GL_RGBA: case GL_BGRA: case GL_RGBA_INTEGER: case GL_BGRA_INTEGER:
+		components = 4;
+		break;
+	}
+
+	switch (type) {
+	case GL_BYTE: case GL_UNSIGNED_BYTE:
+		return components;
+	case GL_SHORT: case GL_UNSIGNED_SHORT: case GL_HALF_FLOAT:
+		return components * 2;
+	default:
+		return components * 4;
+	}
+}
+
+// Texture uploads: from a pixel unpack buffer, from nothing or from client memory
+static void putPixels(GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, const void* pixels)
+{
+	if (currentInteger(GL_PIXEL_UNPACK_BUFFER_BINDING)) {
+		put((uint8_t)1);
+		put((uint64_t)(uintptr_t)pixels);
+		return;
+	}
+	if (!pixels) {
+		put((uint8_t)0);
+		return;
+	}
+
+	size_t alignment = std::max(currentInteger(GL_UNPACK_ALIGNMENT), 1);
+	size_t rowLength = currentInteger(GL_UNPACK_ROW_LENGTH);
+	size_t pixel = pixelBytes(format, type);
+	size_t stride = ((rowLength ? rowLength : width) * pixel + alignment - 1) / alignment * alignment;
+	size_t rows = (size_t)height * depth;
+	uint64_t size = rows ? stride * (rows - 1) + width * pixel : 0;
+	put((uint8_t)2);
+	put(size);
+	putBytes(pixels, (size_t)size);
+}
+
+static const void* readPixels(Reader& r)
+{
+	switch (r.get<uint8_t>()) {
+	case 1:
+		return (const void*)(uintptr_t)r.get<uint64_t>();
+	case 2:
+		return r.data((size_t)r.get<uint64_t>());
+	default:
+		return nullptr;
+	}
+}
+
+static void APIENTRY captureTexImage2D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height,
+	GLint border, GLenum format, GLenum type, const void* pixels)
+{
+	beginCall(GL_SLOT(TexImage2D)::entry);
+	put(target); put(level); put(internalformat); put(width); put(height); put(border); put(format); put(type);
+	putPixels(width, height, 1, format, type, pixels);
+	GL_SLOT(TexImage2D)::original(target, level, internalformat, width, height, border, format, type, pixels);
+}
+
+static void replayTexImage2D(Reader& r)
+{
+	GLenum target = r.get<GLenum>();
+	GLint level = r.get<GLint>();
+	GLint internalformat = r.get<GLint>();
+	GLsizei width = r.get<GLsizei>();
+	GLsizei height = r.get<GLsizei>();
+	GLint border = r.get<GLint>();
+	GLenum format = r.get<GLenum>();
+	GLenum type = r.get<GLenum>();
+	const void* pixels = readPixels(r);
+	if (!r.failed)
+		glad_glTexImage2D(target, level, internalformat, width, height, border, format, type, pixels);
+}
+
+static void APIENTRY captureTexImage3D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height,
+	GLsizei depth, GLint border, GLenum format, GLenum type, const void* pixels)
+{
+	beginCall(GL_SLOT(TexImage3D)::entry);
+	put(target); put(level); put(internalformat); put(width); put(height); put(depth); put(border); put(format); put(type);
+	putPixels(width, height, depth, format, type, pixels);
+	GL_SLOT(TexImage3D)::original(target, level, internalformat, width, height, depth, border, format, type, pixels);
+}
+
+static void replayTexImage3D(Reader& r)
+{
+	GLenum target = r.get<GLenum>();
+	GLint level = r.get<GLint>();
+	GLint internalformat = r.get<GLint>();
+	GLsizei width = r.get<GLsizei>();
+	GLsizei height = r.get<GLsizei>();
+	GLsizei depth = r.get<GLsizei>();
+	GLint border = r.get<GLint>();
+	GLenum format = r.get<GLenum>();
+	GLenum type = r.get<GLenum>();
+	const void* pixels = readPixels(r);
+	if (!r.failed)
+		glad_glTexImage3D(target, level, internalformat, width, height, depth, border, format, type, pixels);
+}
+
+static void APIENTRY captureTexSubImage2D(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height,
+	GLenum format, GLenum type, const void* pixels)
+{
+	beginCall(GL_SLOT(TexSubImage2D)::entry);
+	put(target); put(level); put(xoffset); put(yoffset); put(width); put(height); put(format); put(type);
+	putPixels(width, height, 1, format, type, pixels);
+	GL_SLOT(TexSubImage2D)::original(target, level, xoffset, yoffset, width, height, format, type, pixels);
+}
+
+static void replayTexSubImage2D(Reader& r)
+{
+	GLenum target = r.get<GLenum>();
+	GLint level = r.get<GLint>();
+	GLint xoffset = r.get<GLint>();
+	GLint yoffset = r.get<GLint>();
+	GLsizei width = r.get<GLsizei>();
+	GLsizei height = r.get<GLsizei>();
+	GLenum format = r.get<GLenum>();
+	GLenum type = r.get<GLenum>();
+	const void* pixels = readPixels(r);
+	if (!r.failed)
+		glad_glTexSubImage2D(target, level, xoffset, yoffset, width, height, format, type, pixels);
+}
+
+#define GL_SPECIAL(name) special<GL_TYPE_SLOT(name)>("gl" #name, &capture##name, &replay##name)
+#define GL_GEN(name, kind) special<GL_TYPE_SLOT(name)>("gl" #name, &captureGen<GL_TYPE_SLOT(name), kind>, &replayGen<GL_TYPE_SLOT(name), kind>)
+#define GL_DELETE(name, kind) \
+	special<GL_TYPE_SLOT(name)>("gl" #name, &captureDelete<GL_TYPE_SLOT(name), kind>, &replayDelete<GL_TYPE_SLOT(name), kind>)
+#define GL_UNIFORM_ARRAY(name, type, elements) special<GL_TYPE_SLOT(name)>("gl" #name, \
+	&captureUniformArray<GL_TYPE_SLOT(name), type, elements>, &replayUniformArray<GL_TYPE_SLOT(name), type, elements>)
+#define GL_UNIFORM_MATRIX(name, elements) special<GL_TYPE_SLOT(name)>("gl" #name, \
+	&captureUniformMatrix<GL_TYPE_SLOT(name), elements>, &replayUniformMatrix<GL_TYPE_SLOT(name), elements>)
+
+// Hooks them, or registers their replays while s_Registry is set
+static void specials()
+{
+	GL_GEN(GenBuffers, 'b'); GL_GEN(GenTextures, 't'); GL_GEN(GenVertexArrays, 'v');
+	GL_GEN(GenFramebuffers, 'f'); GL_GEN(GenRenderbuffers, 'r'); GL_GEN(GenQueries, 'q');
+	GL_DELETE(DeleteBuffers, 'b'); GL_DELETE(DeleteTextures, 't'); GL_DELETE(DeleteVertexArrays, 'v');
+	GL_DELETE(DeleteFramebuffers, 'f'); GL_DELETE(DeleteRenderbuffers, 'r'); GL_DELETE(DeleteQueries, 'q');
+
+	GL_UNIFORM_ARRAY(Uniform1fv, GLfloat, 1); GL_UNIFORM_ARRAY(Uniform2fv, GLfloat, 2);
+	GL_UNIFORM_ARRAY(Uniform3fv, GLfloat, 3); GL_UNIFORM_ARRAY(Uniform4fv, GLfloat, 4);
+	GL_UNIFORM_ARRAY(Uniform1iv, GLint, 1); GL_UNIFORM_ARRAY(Uniform2iv, GLint, 2);
+	GL_UNIFORM_ARRAY(Uniform3iv, GLint, 3); GL_UNIFORM_ARRAY(Uniform4iv, GLint, 4);
+	GL_UNIFORM_ARRAY(Uniform1uiv, GLuint, 1); GL_UNIFORM_ARRAY(Uniform2uiv, GLuint, 2);
+	GL_UNIFORM_ARRAY(Uniform3uiv, GLuint, 3); GL_UNIFORM_ARRAY(Uniform4uiv, GLuint, 4);
+	GL_UNIFORM_MATRIX(UniformMatrix2fv, 4); GL_UNIFORM_MATRIX(UniformMatrix3fv, 9); GL_UNIFORM_MATRIX(UniformMatrix4fv, 16);
+
+	GL_SPECIAL(ShaderSource);
+	GL_SPECIAL(GetUniformLocation);
+	GL_SPECIAL(DrawBuffers);
+	GL_SPECIAL(BufferData);
+	GL_SPECIAL(BufferSubData);
+	GL_SPECIAL(TexImage2D);
+	GL_SPECIAL(TexImage3D);
+	GL_SPECIAL(TexSubImage2D);
+}
+
+bool StartGLCapture(const std::string& path, int firstFrame, int frameCount)
+{
+	if (s_Capturing) {
+		std::cout << "ERROR::GL_CAPTURE::ALREADY_CAPTURING " << s_Path << std::endl;
+		return false;
+	}
+	if (!glad_glGetString) {
+		std::cout << "ERROR::GL_CAPTURE::GLAD_NOT_LOADED" << std::endl;
+		return false;
+	}
+
+	s_File.open(path, std::ios::binary);
+	if (!s_File) {
+		std::cout << "ERROR::GL_CAPTURE::CANNOT_WRITE " << path << std::endl;
+		return false;
+	}
+
+	// Size of the default framebuffer, headless contexts have none
+	GLint viewport[4] = {};
+	glad_glGetIntegerv(GL_VIEWPORT, viewport);
+
+	// Specials first, the rest then sees them hooked and skips them
+	specials();
+#define GL_CAPTURE_HOOK(name) hook<GL_TYPE_SLOT(name)>("gl" #name);
+	GL_ENTRY_POINTS(GL_CAPTURE_HOOK)
+	hook<PFNGLDISPATCHCOMPUTEPROC_AOG, &glDispatchCompute>("glDispatchCompute");
+	hook<PFNGLMEMORYBARRIERPROC_AOG, &glMemoryBarrier>("glMemoryBarrier");
+	hook<PFNGLMULTIDRAWELEMENTSINDIRECTPROC_AOG, &glMultiDrawElementsIndirect>("glMultiDrawElementsIndirect");
+
+	s_Path = path;
+	s_Frame = 0;
+	s_FirstFrame = std::max(firstFrame, 0);
+	s_FrameCount = std::max(frameCount, 1);
+	s_Calls = s_Written = 0;
+	std::fill(s_DroppedCalls.begin(), s_DroppedCalls.end(), 0);
+	s_Capturing = true;
+
+	putBytes(CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC));
+	put(CAPTURE_VERSION);
+	put((uint32_t)sizeof(void*));
+	put((uint32_t)std::max(viewport[2], 1));
+	put((uint32_t)std::max(viewport[3], 1));
+	put((int32_t)s_FirstFrame);
+	put((int32_t)s_FrameCount);
+	put((uint32_t)s_EntryNames.size());
+	for (const char* name : s_EntryNames)
+		putString(name);
+	return true;
+}
+
+void StopGLCapture()
+{
+	if (!s_Capturing)
+		return;
+
+#define GL_CAPTURE_UNHOOK(name) unhook<GL_TYPE_SLOT(name)>();
+	GL_ENTRY_POINTS(GL_CAPTURE_UNHOOK)
+	unhook<PFNGLDISPATCHCOMPUTEPROC_AOG, &glDispatchCompute>();
+	unhook<PFNGLMEMORYBARRIERPROC_AOG, &glMemoryBarrier>();
+	unhook<PFNGLMULTIDRAWELEMENTSINDIRECTPROC_AOG, &glMultiDrawElementsIndirect>();
+	s_Capturing = false;
+
+	put(END_MARK);
+	flushCapture();
+	s_File.close();
+	if (!s_File) {
+		std::cout << "ERROR::GL_CAPTURE::CANNOT_WRITE " << s_Path << std::endl;
+		return;
+	}
+
+	std::cout << "GL capture: " << s_Calls << " calls over " << s_Frame << " frames (" << std::max(s_Frame - s_FirstFrame, 0)
+		<< " timed), " << s_Written / (1024.0 * 1024.0) << " MB written to " << s_Path << std::endl;
+	if (s_Frame <= s_FirstFrame)
+		std::cout << "ERROR::GL_CAPTURE::STOPPED_BEFORE_FRAME " << s_FirstFrame << " nothing to time" << std::endl;
+	for (size_t i = 0; i < s_EntryNames.size(); i++) {
+		if (s_DroppedCalls[i])
+			std::cout << "ERROR::GL_CAPTURE::NOT_CAPTURED " << s_EntryNames[i] << " (" << s_DroppedCalls[i] << " calls)" << std::endl;
+	}
+}
+
+bool IsGLCapturing()
+{
+	return s_Capturing;
+}
+
+void EndGLCaptureFrame()
+{
+	if (!s_Capturing)
+		return;
+
+	put(FRAME_MARK);
+	if (++s_Frame >= s_FirstFrame + s_FrameCount)
+		StopGLCapture();
+}
+
+static double percentile(std::vector<double> values, double p)
+{
+	if (values.empty())
+		return 0.0;
+	std::sort(values.begin(), values.end());
+	return values[(size_t)(p / 100.0 * (values.size() - 1) + 0.5)];
+}
+
+int ReplayGLCapture(const char* path, int repeat)
+{
+	if (s_Capturing) {
+		std::cout << "ERROR::GL_REPLAY::CAPTURING" << std::endl;
+		return -1;
+	}
+
+	MappedFile file;
+	if (!file.Open(path)) {
+		std::cout << "ERROR::GL_REPLAY::CANNOT_OPEN " << path << std::endl;
+		return -1;
+	}
+
+	Reader r = { file.GetData(), file.GetData() + file.GetSize(), false };
+	const uint8_t* magic = r.bytes(sizeof(CAPTURE_MAGIC));
+	uint32_t version = r.get<uint32_t>();
+	uint32_t pointerSize = r.get<uint32_t>();
+	if (!magic || memcmp(magic, CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC)) != 0 || version != CAPTURE_VERSION) {
+		std::cout << "ERROR::GL_REPLAY::NOT_A_CAPTURE " << path << std::endl;
+		return -1;
+	}
+	if (pointerSize != sizeof(void*)) {
+		std::cout << "ERROR::GL_REPLAY::CAPTURED_WITH_" << pointerSize * 8 << "_BIT_POINTERS" << std::endl;
+		return -1;
+	}
+
+	GLsizei width = (GLsizei)r.get<uint32_t>();
+	GLsizei height = (GLsizei)r.get<uint32_t>();
+	int firstFrame = r.get<int32_t>();
+	r.get<int32_t>();
+	std::vector<std::string> names(r.get<uint32_t>());
+	for (std::string& name : names) {
+		uint32_t length = r.get<uint32_t>();
+		const uint8_t* chars = r.bytes(length);
+		if (chars)
+			name.assign((const char*)chars, length);
+	}
+	if (r.failed) {
+		std::cout << "ERROR::GL_REPLAY::TRUNCATED " << path << std::endl;
+		return -1;
+	}
+
+	OffscreenContext context;
+	if (!context.Create())
+		return -1;
+	LoadGL43(context.GetLoader());	// Only needed when the capture calls them
+
+	// Replay of every entry point in the file, by its id
+	std::unordered_map<std::string, ReplayFn> registry;
+	s_Registry = &registry;
+	specials();
+#define GL_REPLAY_REGISTER(name) registerReplay<GL_TYPE_SLOT(name)>("gl" #name);
+	GL_ENTRY_POINTS(GL_REPLAY_REGISTER)
+	registerReplay<PFNGLDISPATCHCOMPUTEPROC_AOG, &glDispatchCompute>("glDispatchCompute");
+	registerReplay<PFNGLMEMORYBARRIERPROC_AOG, &glMemoryBarrier>("glMemoryBarrier");
+	registerReplay<PFNGLMULTIDRAWELEMENTSINDIRECTPROC_AOG, &glMultiDrawElementsIndirect>("glMultiDrawElementsIndirect");
+	s_Registry = nullptr;
+
+	std::vector<ReplayFn> replays(names.size(), nullptr);
+	for (size_t i = 0; i < names.size(); i++) {
+		auto found = registry.find(names[i]);
+		if (found != registry.end())
+			replays[i] = found->second;
+	}
+
+	s_Names.clear();
+	s_Locations.clear();
+	s_CurrentProgram = 0;
+	s_Scratch.assign(SCRATCH_BYTES, 0);
+
+	// Stands in for the window
+	GLuint renderbuffers[2];
+	glGenRenderbuffers(2, renderbuffers);
+	glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[0]);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[1]);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+	glGenFramebuffers(1, &s_DefaultFramebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, s_DefaultFramebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderbuffers[0]);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, renderbuffers[1]);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	// Up to the end of the frame, false at the end of the capture or on an error
+	uint64_t calls = 0;
+	bool broken = false;
+	auto replayFrame = [&]() {
+		for (;;) {
+			uint16_t id = r.get<uint16_t>();
+			if (r.failed) {
+				std::cout << "ERROR::GL_REPLAY::TRUNCATED " << path << std::endl;
+				broken = true;
+				return false;
+			}
+			if (id == FRAME_MARK)
+				return true;
+			if (id == END_MARK)
+				return false;
+			if (id >= replays.size() || !replays[id]) {
+				std::cout << "ERROR::GL_REPLAY::NOT_AVAILABLE " << (id < names.size() ? names[id] : std::to_string(id)) << std::endl;
+				broken = true;
+				return false;
+			}
+			replays[id](r);
+			calls++;
+		}
+	};
+
+	typedef std::chrono::steady_clock Clock;
+	Clock::time_point setupStart = Clock::now();
+	int setupFrames = 0;
+	bool more = true;
+	while (setupFrames < firstFrame && (more = replayFrame()))
+		setupFrames++;
+	glFinish();
+	double setupMs = std::chrono::duration<double, std::milli>(Clock::now() - setupStart).count();
+	uint64_t setupCalls = calls;
+
+	// A frame cut short by the end of the capture isn't timed
+	std::vector<double> submitMs, frameMs;
+	const uint8_t* framesStart = r.at;
+	size_t framesBytes = 0;
+	for (int pass = 0; more && !broken && pass < std::max(repeat, 1); pass++) {
+		r.at = framesStart;
+		for (;;) {
+			Clock::time_point start = Clock::now();
+			if (!replayFrame())
+				break;
+			submitMs.push_back(std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+			glFinish();
+			frameMs.push_back(std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+		}
+		framesBytes = r.at - framesStart;
+	}
+
+	glDeleteFramebuffers(1, &s_DefaultFramebuffer);
+	glDeleteRenderbuffers(2, renderbuffers);
+	s_DefaultFramebuffer = 0;
+	s_Scratch = std::vector<char>();
+
+	double frames = (double)std::max(frameMs.size(), (size_t)1);
+	std::cout << "GL replay of " << path << " (" << width << "x" << height << ", " << context.GetBackendName() << ")" << std::endl;
+	std::cout << "  setup: " << setupFrames << " frames, " << setupCalls << " calls, " << setupMs << " ms" << std::endl;
+	std::cout << "  " << frameMs.size() << " frames replayed (" << std::max(repeat, 1) << " times), " << (calls - setupCalls) / frames
+		<< " calls and " << framesBytes * std::max(repeat, 1) / frames / (1024.0 * 1024.0) << " MB per frame" << std::endl;
+	std::cout << "  submit ms: p50 " << percentile(submitMs, 50.0) << ", p95 " << percentile(submitMs, 95.0) << ", max "
+		<< percentile(submitMs, 100.0) << std::endl;
+	std::cout << "  frame ms (to glFinish): p50 " << percentile(frameMs, 50.0) << ", p95 " << percentile(frameMs, 95.0) << ", max "
+		<< percentile(frameMs, 100.0) << ", " << 1000.0 / std::max(percentile(frameMs, 50.0), 1.0e-6) << " fps at p50" << std::endl;
+	return broken ? 1 : 0;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+// System library
+#include <string>
+
+/*
+	GL command stream capture: every glad entry point (and the GL 4.3 ones of GL43.h)
+	is swapped for a wrapper that appends the call and the data it reads to a binary
+	file (buffer and texture uploads, shader sources, uniform arrays), then calls the
+	driver. Object names and uniform locations are written as the driver returned
+	them; the replay maps its own onto them.
+
+	Objects are only known from their creation, so a capture starts right after the
+	GL functions are loaded and keeps every call from there: the frames before
+	firstFrame are replayed once to rebuild the state, the frameCount after it are the
+	ones timed. Recording stops on its own at the end of the last one.
+
+	Client memory for vertex, index and indirect data isn't followed (pointers are
+	written as buffer offsets), and the few entry points reading other client data
+	that nothing here calls are left out of the file and listed when it is written.
+
+	GL calls from the rendering thread only.
+*/
+bool StartGLCapture(const std::string& path, int firstFrame, int frameCount);
+void StopGLCapture();
+bool IsGLCapturing();
+
+// Marks the end of a frame, call once per frame before swapping
+void EndGLCaptureFrame();
+
+/*
+	Plays a capture back on an offscreen context as fast as it goes: the setup frames
+	once, then the captured frames repeat times, each one timed up to the end of its
+	submission and after a glFinish. The default framebuffer becomes a framebuffer
+	object of the captured size.
+
+	Selected from the command line: "AOG.exe --replay frames.glcap [repeat]"
+*/
+int ReplayGLCapture(const char* path, int repeat);
@@ -0,0 +1,524 @@
+#include "GLInterceptor.h"
+
+#if AOG_GL_INTERCEPT
+
+#include "GL43.h"
+#include "GLEntryPoints.h"
+
+#include <glad/glad.h>
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <cstring>
+
+static const size_t HISTORY_FRAMES = 600;	// Frames kept for the averages and the CSV
+
+struct GLEntry
+{
+	const char* name;
+	bool draw;
+	uint64_t calls, redundant;	// In the current frame
+	double ns;
+};
+
+struct GLFrameEntry
+{
+	int entry;
+	uint32_t calls, redundant;
+	double ns;
+};
+
+struct GLFrameRecord
+{
+	GLCallFrameTotals totals;
+	std::vector<GLFrameEntry> entries;	// Only the ones called
+};
+
+typedef std::chrono::steady_clock Clock;
+
+static std::vector<GLEntry> s_Entries;
+static bool s_Installed = false;
+static double s_TimerNs = 0.0;		// What reading the clock twice costs, taken off every call
+static int s_Frame = 0;
+static std::vector<GLFrameRecord> s_History;	// Ring, s_HistoryNext is the oldest once full
+static size_t s_HistoryNext = 0;
+
+static int entryIndex(const char* name)
+{
+	for (size_t i = 0; i < s_Entries.size(); i++) {
+		if (strcmp(s_Entries[i].name, name) == 0)
+			return (int)i;
+	}
+
+	GLEntry entry = {};
+	entry.name = name;
+	entry.draw = strncmp(name, "glDraw", 6) == 0 || strncmp(name, "glMultiDraw", 11) == 0;
+	s_Entries.push_back(entry);
+	return (int)s_Entries.size() - 1;
+}
+
+// Counts and times one call until the end of the scope
+class GLCallTimer
+{
+private:
+	GLEntry& m_Entry;
+	Clock::time_point m_Start;
+
+public:
+	explicit GLCallTimer(int entry) : m_Entry(s_Entries[entry]), m_Start(Clock::now()) {}
+	~GLCallTimer()
+	{
+		m_Entry.calls++;
+		m_Entry.ns += std::chrono::duration<double, std::nano>(Clock::now() - m_Start).count();
+	}
+};
+
+/*
+	One slot per function pointer: F is its type, Slot the pointer glad calls through.
+	countedCall has the exact signature of F, so it can take the pointer's place.
+*/
+template <typename F, F* Slot>
+struct GLHookSlot
+{
+	static F original;		// The driver's
+	static F placed;		// What was put in the slot, nullptr while not hooked
+	static int entry;
+};
+
+template <typename F, F* Slot> F GLHookSlot<F, Slot>::original = nullptr;
+template <typename F, F* Slot> F GLHookSlot<F, Slot>::placed = nullptr;
+template <typename F, F* Slot> int GLHookSlot<F, Slot>::entry = -1;
+
+template <typename F, F* Slot, typename R, typename... A>
+static R APIENTRY countedCall(A... args)
+{
+	GLCallTimer timer(GLHookSlot<F, Slot>::entry);
+	return GLHookSlot<F, Slot>::original(args...);
+}
+
+template <typename F, F* Slot, typename R, typename... A>
+static F countedCallOf(R (APIENTRY*)(A...))
+{
+	return &countedCall<F, Slot, R, A...>;
+}
+
+// checked runs the redundancy check first and then calls through countedCall itself
+template <typename F, F* Slot>
+static void hook(const char* name, F checked = nullptr)
+{
+	typedef GLHookSlot<F, Slot> S;
+	if (!*Slot || *Slot == S::placed)
+		return;		// Not loaded, or hooked already
+
+	if (S::entry < 0)
+		S::entry = entryIndex(name);
+	S::original = *Slot;
+	S::placed = checked ? checked : countedCallOf<F, Slot>(*Slot);
+	*Slot = S::placed;
+}
+
+template <typename F, F* Slot>
+static void unhook()
+{
+	typedef GLHookSlot<F, Slot> S;
+	if (S::placed && *Slot == S::placed)
+		*Slot = S::original;	// Left alone when glad was reloaded since
+	S::placed = nullptr;
+}
+
+#define GL_HOOK(name) hook<decltype(glad_gl##name), &glad_gl##name>("gl" #name)
+#define GL_HOOK_CHECKED(name) hook<decltype(glad_gl##name), &glad_gl##name>("gl" #name, &checked##name)
+#define GL_UNHOOK(name) unhook<decltype(glad_gl##name), &glad_gl##name>()
+#define GL_ENTRY(name) GLHookSlot<decltype(glad_gl##name), &glad_gl##name>::entry
+#define GL_COUNTED(name) countedCallOf<decltype(glad_gl##name), &glad_gl##name>(glad_gl##name)
+
+/*
+	State as last set through the wrappers, UNKNOWN until then
+*/
+static const GLuint UNKNOWN = ~0u;
+static GLuint s_Program, s_VertexArray, s_DrawFramebuffer, s_ReadFramebuffer, s_ActiveTexture, s_DepthFunc, s_DepthMask;
+static std::unordered_map<uint64_t, GLuint> s_Bindings;		// Buffers by target, textures by unit and target
+static std::unordered_map<GLenum, GLuint> s_Capabilities;
+static std::unordered_map<uint64_t, std::string> s_Uniforms;	// Bytes by program and location
+
+static void forgetState()
+{
+	s_Program = s_VertexArray = s_DrawFramebuffer = s_ReadFramebuffer = s_ActiveTexture = s_DepthFunc = s_DepthMask = UNKNOWN;
+	s_Bindings.clear();
+	s_Capabilities.clear();
+	s_Uniforms.clear();
+}
+
+static void forgetUniforms(GLuint program)
+{
+	for (auto it = s_Uniforms.begin(); it != s_Uniforms.end();) {
+		if ((it->first >> 32) == program)
+			it = s_Uniforms.erase(it);
+		else
+			++it;
+	}
+}
+
+// True when value was set already
+static bool setState(GLuint& state, GLuint value)
+{
+	bool same = state == value;
+	state = value;
+	return same;
+}
+
+static bool setBinding(uint64_t key, GLuint value)
+{
+	auto found = s_Bindings.find(key);
+	bool same = found != s_Bindings.end() && found->second == value;
+	s_Bindings[key] = value;
+	return same;
+}
+
+static void flag(int entry, bool redundant)
+{
+	if (redundant)
+		s_Entries[entry].redundant++;
+}
+
+static void checkUniform(int entry, GLint location, const void* data, size_t size)
+{
+	// Goes nowhere, usually a name the shader doesn't have (or optimized away)
+	if (location < 0) {
+		flag(entry, true);
+		return;
+	}
+	if (s_Program == UNKNOWN)
+		return;
+
+	std::string& cached = s_Uniforms[((uint64_t)s_Program << 32) | (uint32_t)location];
+	bool same = cached.size() == size && memcmp(cached.data(), data, size) == 0;
+	flag(entry, same);
+	if (!same)
+		cached.assign((const char*)data, size);
+}
+
+static void APIENTRY checkedUseProgram(GLuint program)
+{
+	flag(GL_ENTRY(UseProgram), setState(s_Program, program));
+	GL_COUNTED(UseProgram)(program);
+}
+
+static void APIENTRY checkedLinkProgram(GLuint program)
+{
+	forgetUniforms(program);	// Linking resets them
+	GL_COUNTED(LinkProgram)(program);
+}
+
+static void APIENTRY checkedDeleteProgram(GLuint program)
+{
+	forgetUniforms(program);
+	GL_COUNTED(DeleteProgram)(program);
+}
+
+static void APIENTRY checkedBindVertexArray(GLuint array)
+{
+	flag(GL_ENTRY(BindVertexArray), setState(s_VertexArray, array));
+	GL_COUNTED(BindVertexArray)(array);
+}
+
+static void APIENTRY checkedBindFramebuffer(GLenum target, GLuint framebuffer)
+{
+	bool same;
+	if (target == GL_DRAW_FRAMEBUFFER)
+		same = setState(s_DrawFramebuffer, framebuffer);
+	else if (target == GL_READ_FRAMEBUFFER)
+		same = setState(s_ReadFramebuffer, framebuffer);
+	else
+		same = setState(s_DrawFramebuffer, framebuffer) & setState(s_ReadFramebuffer, framebuffer);
+	flag(GL_ENTRY(BindFramebuffer), same);
+	GL_COUNTED(BindFramebuffer)(target, framebuffer);
+}
+
+static void APIENTRY checkedBindBuffer(GLenum target, GLuint buffer)
+{
+	// The element buffer belongs to the bound vertex array, not worth following
+	if (target != GL_ELEMENT_ARRAY_BUFFER)
+		flag(GL_ENTRY(BindBuffer), setBinding(target, buffer));
+	GL_COUNTED(BindBuffer)(target, buffer);
+}
+
+// Binding to an index binds the target's generic point too, only that one is followed
+static void APIENTRY checkedBindBufferBase(GLenum target, GLuint index, GLuint buffer)
+{
+	s_Bindings[target] = buffer;
+	GL_COUNTED(BindBufferBase)(target, index, buffer);
+}
+
+static void APIENTRY checkedBindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size)
+{
+	s_Bindings[target] = buffer;
+	GL_COUNTED(BindBufferRange)(target, index, buffer, offset, size);
+}
+
+static void APIENTRY checkedActiveTexture(GLenum texture)
+{
+	flag(GL_ENTRY(ActiveTexture), setState(s_ActiveTexture, texture));
+	GL_COUNTED(ActiveTexture)(texture);
+}
+
+static void APIENTRY checkedBindTexture(GLenum target, GLuint texture)
+{
+	if (s_ActiveTexture != UNKNOWN)
+		flag(GL_ENTRY(BindTexture), setBinding(((uint64_t)s_ActiveTexture << 32) | target, texture));
+	GL_COUNTED(BindTexture)(target, texture);
+}
+
+// Deleting bound objects unbinds them, simplest to start over
+static void APIENTRY checkedDeleteTextures(GLsizei n, const GLuint* textures)
+{
+	s_Bindings.clear();
+	GL_COUNTED(DeleteTextures)(n, textures);
+}
+
+static void APIENTRY checkedDeleteBuffers(GLsizei n, const GLuint* buffers)
+{
+	s_Bindings.clear();
+	GL_COUNTED(DeleteBuffers)(n, buffers);
+}
+
+static void APIENTRY checkedDeleteVertexArrays(GLsizei n, const GLuint* arrays)
+{
+	s_VertexArray = UNKNOWN;
+	GL_COUNTED(DeleteVertexArrays)(n, arrays);
+}
+
+static void APIENTRY checkedDeleteFramebuffers(GLsizei n, const GLuint* framebuffers)
+{
+	s_DrawFramebuffer = s_ReadFramebuffer = UNKNOWN;
+	GL_COUNTED(DeleteFramebuffers)(n, framebuffers);
+}
+
+static void APIENTRY checkedEnable(GLenum cap)
+{
+	auto found = s_Capabilities.find(cap);
+	flag(GL_ENTRY(Enable), found != s_Capabilities.end() && found->second == GL_TRUE);
+	s_Capabilities[cap] = GL_TRUE;
+	GL_COUNTED(Enable)(cap);
+}
+
+static void APIENTRY checkedDisable(GLenum cap)
+{
+	auto found = s_Capabilities.find(cap);
+	flag(GL_ENTRY(Disable), found != s_Capabilities.end() && found->second == GL_FALSE);
+	s_Capabilities[cap] = GL_FALSE;
+	GL_COUNTED(Disable)(cap);
+}
+
+static void APIENTRY checkedDepthFunc(GLenum func)
+{
+	flag(GL_ENTRY(DepthFunc), setState(s_DepthFunc, func));
+	GL_COUNTED(DepthFunc)(func);
+}
+
+static void APIENTRY checkedDepthMask(GLboolean flagValue)
+{
+	flag(GL_ENTRY(DepthMask), setState(s_DepthMask, flagValue));
+	GL_COUNTED(DepthMask)(flagValue);
+}
+
+static void APIENTRY checkedUniform1i(GLint location, GLint v0)
+{
+	checkUniform(GL_ENTRY(Uniform1i), location, &v0, sizeof(v0));
+	GL_COUNTED(Uniform1i)(location, v0);
+}
+
+static void APIENTRY checkedUniform1ui(GLint location, GLuint v0)
+{
+	checkUniform(GL_ENTRY(Uniform1ui), location, &v0, sizeof(v0));
+	GL_COUNTED(Uniform1ui)(location, v0);
+}
+
+static void APIENTRY checkedUniform1f(GLint location, GLfloat v0)
+{
+	checkUniform(GL_ENTRY(Uniform1f), location, &v0, sizeof(v0));
+	GL_COUNTED(Uniform1f)(location, v0);
+}
+
+static void APIENTRY checkedUniform3f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2)
+{
+	const GLfloat values[] = { v0, v1, v2 };
+	checkUniform(GL_ENTRY(Uniform3f), location, values, sizeof(values));
+	GL_COUNTED(Uniform3f)(location, v0, v1, v2);
+}
+
+static void APIENTRY checkedUniform4f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2, GLfloat v3)
+{
+	const GLfloat values[] = { v0, v1, v2, v3 };
+	checkUniform(GL_ENTRY(Uniform4f), location, values, sizeof(values));
+	GL_COUNTED(Uniform4f)(location, v0, v1, v2, v3);
+}
+
+static void APIENTRY checkedUniform4fv(GLint location, GLsizei count, const GLfloat* value)
+{
+	checkUniform(GL_ENTRY(Uniform4fv), location, value, (size_t)std::max(count, 0) * 4 * sizeof(GLfloat));
+	GL_COUNTED(Uniform4fv)(location, count, value);
+}
+
+static void APIENTRY checkedUniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value)
+{
+	// Transposed or not doesn't matter much, nothing here sets the same matrix both ways
+	checkUniform(GL_ENTRY(UniformMatrix4fv), location, value, (size_t)std::max(count, 0) * 16 * sizeof(GLfloat));
+	GL_COUNTED(UniformMatrix4fv)(location, count, transpose, value);
+}
+
+#define GL_CHECKED_ENTRY_POINTS(X) \
+	X(UseProgram) X(LinkProgram) X(DeleteProgram) X(BindVertexArray) X(BindFramebuffer) X(BindBuffer) X(BindBufferBase) \
+	X(BindBufferRange) X(ActiveTexture) X(BindTexture) X(DeleteTextures) X(DeleteBuffers) X(DeleteVertexArrays) \
+	X(DeleteFramebuffers) X(Enable) X(Disable) X(DepthFunc) X(DepthMask) X(Uniform1i) X(Uniform1ui) X(Uniform1f) X(Uniform3f) X(Uniform4f) X(Uniform4fv) X(UniformMatrix4fv)
+
+bool InstallGLInterceptor()
+{
+	if (!glad_glGetString) {
+		std::cout << "ERROR::GL_INTERCEPTOR::GLAD_NOT_LOADED" << std::endl;
+		return false;
+	}
+
+	// The clock is read twice per call, its cost doesn't belong to the driver
+	double best = 1.0e9;
+	for (int i = 0; i < 1000; i++) {
+		Clock::time_point start = Clock::now();
+		best = std::min(best, std::chrono::duration<double, std::nano>(Clock::now() - start).count());
+	}
+	s_TimerNs = best;
+	forgetState();
+
+	// The checked ones first, the rest then sees them hooked and skips them
+#define GL_HOOK_CHECKED_ENTRY(name) GL_HOOK_CHECKED(name);
+	GL_CHECKED_ENTRY_POINTS(GL_HOOK_CHECKED_ENTRY)
+#define GL_HOOK_ENTRY(name) GL_HOOK(name);
+	GL_ENTRY_POINTS(GL_HOOK_ENTRY)
+
+	hook<PFNGLDISPATCHCOMPUTEPROC_AOG, &glDispatchCompute>("glDispatchCompute");
+	hook<PFNGLMEMORYBARRIERPROC_AOG, &glMemoryBarrier>("glMemoryBarrier");
+	hook<PFNGLMULTIDRAWELEMENTSINDIRECTPROC_AOG, &glMultiDrawElementsIndirect>("glMultiDrawElementsIndirect");
+
+	s_Installed = true;
+	return true;
+}
+
+void RemoveGLInterceptor()
+{
+#define GL_UNHOOK_ENTRY(name) GL_UNHOOK(name);
+	GL_ENTRY_POINTS(GL_UNHOOK_ENTRY)
+
+	unhook<PFNGLDISPATCHCOMPUTEPROC_AOG, &glDispatchCompute>();
+	unhook<PFNGLMEMORYBARRIERPROC_AOG, &glMemoryBarrier>();
+	unhook<PFNGLMULTIDRAWELEMENTSINDIRECTPROC_AOG, &glMultiDrawElementsIndirect>();
+
+	s_Installed = false;
+}
+
+bool IsGLInterceptorInstalled()
+{
+	return s_Installed;
+}
+
+void EndGLCallFrame()
+{
+	GLFrameRecord record;
+	record.totals = GLCallFrameTotals();
+	record.totals.frame = s_Frame++;
+
+	for (size_t i = 0; i < s_Entries.size(); i++) {
+		GLEntry& e = s_Entries[i];
+		if (e.calls == 0)
+			continue;
+
+		GLFrameEntry called;
+		called.entry = (int)i;
+		called.calls = (uint32_t)e.calls;
+		called.redundant = (uint32_t)e.redundant;
+		called.ns = std::max(e.ns - e.calls * s_TimerNs, 0.0);
+		record.entries.push_back(called);
+
+		record.totals.calls += e.calls;
+		record.totals.redundant += e.redundant;
+		record.totals.drawCalls += e.draw ? e.calls : 0;
+		record.totals.driverMs += called.ns / 1.0e6;
+		e.calls = e.redundant = 0;
+		e.ns = 0.0;
+	}
+
+	if (s_History.size() < HISTORY_FRAMES)
+		s_History.push_back(record);
+	else
+		s_History[s_HistoryNext] = record;
+	s_HistoryNext = (s_HistoryNext + 1) % HISTORY_FRAMES;
+}
+
+static const GLFrameRecord* lastFrame()
+{
+	return s_History.empty() ? nullptr : &s_History[(s_HistoryNext + s_History.size() - 1) % s_History.size()];
+}
+
+GLCallFrameTotals GetLastGLCallFrame()
+{
+	const GLFrameRecord* last = lastFrame();
+	return last ? last->totals : GLCallFrameTotals();
+}
+
+void PrintGLCallReport()
+{
+	const GLFrameRecord* last = lastFrame();
+	if (!last) {
+		std::cout << "GL calls: no frame recorded" << std::endl;
+		return;
+	}
+
+	GLCallFrameTotals average = GLCallFrameTotals();
+	for (const GLFrameRecord& record : s_History) {
+		average.calls += record.totals.calls;
+		average.redundant += record.totals.redundant;
+		average.drawCalls += record.totals.drawCalls;
+		average.driverMs += record.totals.driverMs;
+	}
+	double frames = (double)s_History.size();
+
+	const GLCallFrameTotals& t = last->totals;
+	std::cout << "GL calls of frame " << t.frame << ": " << t.calls << " calls, " << t.redundant << " redundant, " << t.drawCalls
+		<< " draws, " << t.driverMs << " ms in the driver" << std::endl;
+	std::cout << "  average over " << s_History.size() << " frames: " << average.calls / frames << " calls, " << average.redundant / frames
+		<< " redundant, " << average.drawCalls / frames << " draws, " << average.driverMs / frames << " ms in the driver" << std::endl;
+
+	std::vector<GLFrameEntry> entries = last->entries;
+	std::sort(entries.begin(), entries.end(), [](const GLFrameEntry& a, const GLFrameEntry& b) { return a.ns > b.ns; });
+	std::cout << "  " << std::left << std::setw(30) << "entry point" << std::right << std::setw(8) << "calls" << std::setw(11) << "redundant"
+		<< std::setw(12) << "driver us" << std::setw(10) << "us/call" << std::endl;
+	std::cout << std::fixed << std::setprecision(2);
+	for (const GLFrameEntry& e : entries) {
+		std::cout << "  " << std::left << std::setw(30) << s_Entries[e.entry].name << std::right << std::setw(8) << e.calls
+			<< std::setw(11) << e.redundant << std::setw(12) << e.ns / 1000.0 << std::setw(10) << e.ns / 1000.0 / e.calls << std::endl;
+	}
+	std::cout << std::defaultfloat << std::setprecision(6);
+}
+
+bool WriteGLCallCSV(const std::string& path)
+{
+	std::ofstream file(path);
+	if (!file) {
+		std::cout << "ERROR::GL_INTERCEPTOR::CANNOT_WRITE " << path << std::endl;
+		return false;
+	}
+
+	file << "frame,entry,calls,redundant,driver_us\n";
+	for (size_t i = 0; i < s_History.size(); i++) {
+		const GLFrameRecord& record = s_History[(s_HistoryNext + i) % s_History.size()];
+		for (const GLFrameEntry& e : record.entries)
+			file << record.totals.frame << "," << s_Entries[e.entry].name << "," << e.calls << "," << e.redundant << "," << e.ns / 1000.0 << "\n";
+	}
+	return true;
+}
+
+#endif
@@ -0,0 +1,68 @@
+#pragma once
+
+// System library
+#include <cstdint>
+#include <string>
+
+/*
+	Compile time switch, on unless NDEBUG like the CPU profiler.
+	Define AOG_GL_INTERCEPT to 1 or 0 to force it either way.
+*/
+#ifndef AOG_GL_INTERCEPT
+#if defined(NDEBUG)
+#define AOG_GL_INTERCEPT 0
+#else
+#define AOG_GL_INTERCEPT 1
+#endif
+#endif
+
+struct GLCallFrameTotals
+{
+	int frame;
+	uint64_t calls;
+	uint64_t redundant;		// Binds, state and uniform sets that changed nothing
+	uint64_t drawCalls;		// glDraw* and glMultiDraw*
+	double driverMs;		// Time inside the GL calls, the timer's own cost taken off
+};
+
+#if AOG_GL_INTERCEPT
+
+/*
+	GL call accounting without regenerating glad in debug mode: every glad entry point
+	(and the GL 4.3 ones of GL43.h) is a function pointer, so installing swaps each one
+	for a wrapper that counts the call, times it and forwards to the driver.
+
+	Binds (program, vertex array, framebuffer, buffer, texture unit, texture), enable /
+	disable, depth state and uniform sets are also checked against the state they
+	last set and counted as redundant when they changed nothing. Uniform sets to
+	location -1 count as redundant too. State set before installing is unknown, so
+	nothing is flagged until it was set once through the wrappers.
+
+	GL calls from the rendering thread only. Nothing costs anything until installed;
+	call it after gladLoadGLLoader (and LoadGL43), again after reloading them.
+*/
+bool InstallGLInterceptor();
+void RemoveGLInterceptor();
+bool IsGLInterceptorInstalled();
+
+// Closes the frame's counts, call once per frame before swapping
+void EndGLCallFrame();
+GLCallFrameTotals GetLastGLCallFrame();
+
+// Last frame per entry point by time in the driver, with the averages over the frames kept
+void PrintGLCallReport();
+
+// One row per frame and entry point called in it: frame,entry,calls,redundant,driver_us
+bool WriteGLCallCSV(const std::string& path);
+
+#else
+
+inline bool InstallGLInterceptor() { return false; }
+inline void RemoveGLInterceptor() {}
+inline bool IsGLInterceptorInstalled() { return false; }
+inline void EndGLCallFrame() {}
+inline GLCallFrameTotals GetLastGLCallFrame() { return GLCallFrameTotals(); }
+inline void PrintGLCallReport() {}
+inline bool WriteGLCallCSV(const std::string&) { return false; }
+
+#endif
@@ -0,0 +1,175 @@
+#include "GPUCuller.h"
+#include "MemoryTracker.h"
+
+static const unsigned int WORKGROUP_SIZE = 64;	// local_size_x in cullCShader.glsl
+
+GPUCuller::GPUCuller(size_t capacity)
+	: m_CullShader("./assets/shaders/cullCShader.glsl"), m_Capacity(capacity), m_InstanceCount(0),
+	  m_Frame(0), m_DelayedVisible(0)
+{
+	unsigned int* buffers[] = { &m_BoundsBuffer, &m_GroupBuffer, &m_CommandBuffer, &m_VisibleBuffer, &m_MatrixBuffer };
+	const size_t sizes[] = {
+		capacity * sizeof(glm::vec4), capacity * sizeof(uint32_t), 0, capacity * sizeof(uint32_t), capacity * sizeof(glm::mat4)
+	};
+
+	for (int i = 0; i < 5; i++) {
+		glGenBuffers(1, buffers[i]);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, *buffers[i]);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, sizes[i], nullptr, GL_DYNAMIC_DRAW);
+		TrackGPUMemory(GPUResource::Buffer, *buffers[i], sizes[i], "gpu culling");
+	}
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	glGenBuffers(READBACK_LATENCY, m_ReadbackBuffers);
+}
+
+GPUCuller::~GPUCuller()
+{
+	unsigned int buffers[] = { m_BoundsBuffer, m_GroupBuffer, m_CommandBuffer, m_VisibleBuffer, m_MatrixBuffer };
+	for (unsigned int buffer : buffers)
+		UntrackGPUMemory(GPUResource::Buffer, buffer);
+	for (unsigned int buffer : m_ReadbackBuffers)
+		UntrackGPUMemory(GPUResource::Buffer, buffer);
+	glDeleteBuffers(5, buffers);
+	glDeleteBuffers(READBACK_LATENCY, m_ReadbackBuffers);
+}
+
+int GPUCuller::AddGroup(uint32_t indexCount, uint32_t firstIndex, int32_t baseVertex)
+{
+	m_Commands.push_back({ indexCount, 0, firstIndex, baseVertex, 0 });
+
+	size_t bytes = m_Commands.size() * sizeof(DrawElementsIndirectCommand);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_CommandBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, bytes, m_Commands.data(), GL_DYNAMIC_DRAW);
+	TrackGPUMemory(GPUResource::Buffer, m_CommandBuffer, bytes, "gpu culling", "commands");
+	for (int i = 0; i < READBACK_LATENCY; i++) {
+		glBindBuffer(GL_COPY_WRITE_BUFFER, m_ReadbackBuffers[i]);
+		glBufferData(GL_COPY_WRITE_BUFFER, bytes, nullptr, GL_STREAM_READ);
+		TrackGPUMemory(GPUResource::Buffer, m_ReadbackBuffers[i], bytes, "gpu culling", "readback");
+	}
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	return (int)m_Commands.size() - 1;
+}
+
+void GPUCuller::SetInstanceGroups(const uint32_t* groups, size_t count)
+{
+	m_InstanceCount = count < m_Capacity ? count : m_Capacity;
+
+	// Every group gets a slice big enough for all of its instances
+	std::vector<uint32_t> sizes(m_Commands.size(), 0);
+	for (size_t i = 0; i < m_InstanceCount; i++)
+		sizes[groups[i]]++;
+
+	uint32_t offset = 0;
+	for (size_t g = 0; g < m_Commands.size(); g++) {
+		m_Commands[g].baseInstance = offset;
+		offset += sizes[g];
+	}
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_GroupBuffer);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, m_InstanceCount * sizeof(uint32_t), groups);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void GPUCuller::UpdateInstances(const glm::mat4* matrices, const BoundingSpheres& bounds, size_t first, size_t count)
+{
+	if (first >= m_Capacity)
+		return;
+	if (first + count > m_Capacity)
+		count = m_Capacity - first;
+
+	m_Staging.resize(count);
+	for (size_t i = 0; i < count; i++) {
+		size_t e = first + i;
+		m_Staging[i] = glm::vec4(bounds.x[e], bounds.y[e], bounds.z[e], bounds.radius[e]);
+	}
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_BoundsBuffer);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, first * sizeof(glm::vec4), count * sizeof(glm::vec4), m_Staging.data());
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_MatrixBuffer);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, first * sizeof(glm::mat4), count * sizeof(glm::mat4), matrices + first);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void GPUCuller::Cull(const Frustum& frustum)
+{
+	size_t bytes = m_Commands.size() * sizeof(DrawElementsIndirectCommand);
+	int slot = m_Frame % READBACK_LATENCY;
+
+	// Counts from a few frames back have long landed, so this read does not wait on the GPU
+	if (m_Frame >= READBACK_LATENCY) {
+		std::vector<DrawElementsIndirectCommand> previous(m_Commands.size());
+		glBindBuffer(GL_COPY_READ_BUFFER, m_ReadbackBuffers[slot]);
+		glGetBufferSubData(GL_COPY_READ_BUFFER, 0, bytes, previous.data());
+
+		m_DelayedVisible = 0;
+		for (const DrawElementsIndirectCommand& command : previous)
+			m_DelayedVisible += command.instanceCount;
+	}
+
+	// Reset the instance counts
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_CommandBuffer);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, bytes, m_Commands.data());
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	m_CullShader.use();
+	for (int p = 0; p < 6; p++)
+		m_CullShader.setVec4f("planes[" + std::to_string(p) + "]", frustum.planes[p]);
+	m_CullShader.setUint("instanceCount", (unsigned int)m_InstanceCount);
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_BoundsBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, m_GroupBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, m_CommandBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, m_VisibleBuffer);
+
+	glDispatchCompute((unsigned int)((m_InstanceCount + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE), 1, 1);
+
+	// The draw reads the commands and the visible list as vertex data; the copy reads the counts
+	glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+
+	glBindBuffer(GL_COPY_READ_BUFFER, m_CommandBuffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, m_ReadbackBuffers[slot]);
+	glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, bytes);
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	m_Frame++;
+}
+
+void GPUCuller::BindInstanceAttribute(unsigned int vao, unsigned int location) const
+{
+	glBindVertexArray(vao);
+	glBindBuffer(GL_ARRAY_BUFFER, m_VisibleBuffer);
+	glVertexAttribIPointer(location, 1, GL_UNSIGNED_INT, sizeof(uint32_t), (void*)0);
+	glEnableVertexAttribArray(location);
+	glVertexAttribDivisor(location, 1);
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void GPUCuller::Draw(int firstGroup, int groupCount) const
+{
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, m_MatrixBuffer);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_CommandBuffer);
+	glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (void*)(firstGroup * sizeof(DrawElementsIndirectCommand)),
+		groupCount, 0);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+void GPUCuller::ReadVisible(std::vector<uint32_t>& instances) const
+{
+	std::vector<DrawElementsIndirectCommand> commands(m_Commands.size());
+	glBindBuffer(GL_COPY_READ_BUFFER, m_CommandBuffer);
+	glGetBufferSubData(GL_COPY_READ_BUFFER, 0, commands.size() * sizeof(DrawElementsIndirectCommand), commands.data());
+
+	std::vector<uint32_t> slices(m_InstanceCount);
+	glBindBuffer(GL_COPY_READ_BUFFER, m_VisibleBuffer);
+	glGetBufferSubData(GL_COPY_READ_BUFFER, 0, slices.size() * sizeof(uint32_t), slices.data());
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+
+	instances.clear();
+	for (const DrawElementsIndirectCommand& command : commands)
+		instances.insert(instances.end(), slices.begin() + command.baseInstance,
+			slices.begin() + command.baseInstance + command.instanceCount);
+}
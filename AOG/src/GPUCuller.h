@@ -0,0 +1,91 @@
+#pragma once
+
+#include "GL43.h"
+#include "Shader.h"
+#include "Scene.h"
+#include "Frustum.h"
+
+#include <glm/glm.hpp>
+
+// System library
+#include <vector>
+#include <cstdint>
+
+// Layout fixed by glMultiDrawElementsIndirect
+struct DrawElementsIndirectCommand
+{
+	uint32_t count;
+	uint32_t instanceCount;
+	uint32_t firstIndex;
+	int32_t baseVertex;
+	uint32_t baseInstance;
+};
+
+/*
+	Frustum culling and draw building on the GPU (GL 4.3).
+
+	Instance bounds and world matrices live in storage buffers. A compute pass tests
+	every sphere against the frustum and appends survivors to their group's slice of
+	the visible list, bumping that group's instanceCount in place. The same buffer
+	is then consumed by glMultiDrawElementsIndirect, so the CPU never sees the
+	visible set. A group is one indirect command: an index range (mesh or LOD) plus
+	the instances drawn with it.
+
+	The vertex shader gets the instance's index as a per instance attribute (see
+	BindInstanceAttribute) and fetches its model matrix from binding 4.
+*/
+class GPUCuller
+{
+public:
+	static const int READBACK_LATENCY = 4;	// Frames before the visible count is read back
+
+private:
+	Shader m_CullShader;
+
+	unsigned int m_BoundsBuffer;	// vec4 center + radius
+	unsigned int m_GroupBuffer;		// Group index per instance
+	unsigned int m_CommandBuffer;
+	unsigned int m_VisibleBuffer;	// Compacted instance indices, one slice per group
+	unsigned int m_MatrixBuffer;
+	unsigned int m_ReadbackBuffers[READBACK_LATENCY];
+
+	size_t m_Capacity;
+	size_t m_InstanceCount;
+	std::vector<DrawElementsIndirectCommand> m_Commands;	// instanceCount kept at 0, uploaded to reset
+	std::vector<glm::vec4> m_Staging;
+
+	int m_Frame;
+	size_t m_DelayedVisible;
+
+public:
+	explicit GPUCuller(size_t capacity);
+	~GPUCuller();
+
+	GPUCuller(const GPUCuller&) = delete;
+	GPUCuller& operator=(const GPUCuller&) = delete;
+
+	// Returns the group index; add all groups before SetInstanceGroups
+	int AddGroup(uint32_t indexCount, uint32_t firstIndex = 0, int32_t baseVertex = 0);
+
+	// Group of every instance; sizes each group's slice of the visible list
+	void SetInstanceGroups(const uint32_t* groups, size_t count);
+
+	// Upload matrices and bounds of instances [first, first + count)
+	void UpdateInstances(const glm::mat4* matrices, const BoundingSpheres& bounds, size_t first, size_t count);
+
+	void Cull(const Frustum& frustum);
+
+	// Feeds the visible list into the VAO as an instanced uint attribute
+	void BindInstanceAttribute(unsigned int vao, unsigned int location = 3) const;
+
+	// Caller binds the VAO and the shader; one multi draw over the given groups
+	void Draw(int firstGroup, int groupCount) const;
+
+	// Blocking read of the visible instances, for validation only
+	void ReadVisible(std::vector<uint32_t>& instances) const;
+
+	// Getters
+	size_t GetInstanceCount() const { return m_InstanceCount; }
+	int GetGroupCount() const { return (int)m_Commands.size(); }
+	size_t GetDelayedVisibleCount() const { return m_DelayedVisible; }	// From READBACK_LATENCY frames ago, no stall
+};
@@ -0,0 +1,249 @@
+#include "GPUProfiler.h"
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <algorithm>
+#include <cmath>
+
+GPUProfiler* GPUProfiler::s_Active = nullptr;
+
+GPUProfiler::GPUProfiler(int historyFrames)
+	: m_Frame(0), m_InFrame(false), m_HistoryFrames((size_t)std::max(historyFrames, 1)), m_HistoryNext(0)
+{
+	for (Slot& slot : m_Slots) {
+		slot.frame = -1;
+		slot.used = 0;
+	}
+
+	m_Names.push_back("frame");
+	m_Depths.push_back(0);
+	m_Scopes["frame"] = 0;
+}
+
+GPUProfiler::~GPUProfiler()
+{
+	if (s_Active == this)
+		s_Active = nullptr;
+
+	for (Slot& slot : m_Slots) {
+		if (!slot.queries.empty())
+			glDeleteQueries((GLsizei)slot.queries.size(), slot.queries.data());
+	}
+}
+
+void GPUProfiler::BeginFrame()
+{
+	if (m_InFrame)
+		EndFrame();
+
+	// FRAME_LATENCY frames old, done by now on anything but a very busy GPU
+	Slot& slot = m_Slots[m_Frame % FRAME_LATENCY];
+	if (slot.frame >= 0)
+		collect(slot);
+
+	slot.frame = m_Frame;
+	slot.used = 0;
+	slot.records.clear();
+	m_Open.clear();
+	m_InFrame = true;
+	BeginScope("frame");
+}
+
+void GPUProfiler::EndFrame()
+{
+	if (!m_InFrame)
+		return;
+
+	// Scopes left open end with the frame
+	while (!m_Open.empty())
+		EndScope(m_Open.back());
+
+	m_InFrame = false;
+	m_Frame++;
+}
+
+int GPUProfiler::BeginScope(const char* name)
+{
+	if (!m_InFrame)
+		return -1;
+
+	auto found = m_Scopes.find(name);
+	int scope;
+	if (found == m_Scopes.end()) {
+		scope = (int)m_Names.size();
+		m_Names.push_back(name);
+		m_Depths.push_back((int)m_Open.size());
+		m_Scopes[name] = scope;
+	}
+	else
+		scope = found->second;
+
+	Slot& slot = m_Slots[m_Frame % FRAME_LATENCY];
+	Record record;
+	record.scope = scope;
+	record.begin = slot.used;
+	record.end = slot.used;
+	glQueryCounter(nextQuery(slot), GL_TIMESTAMP);
+
+	slot.records.push_back(record);
+	m_Open.push_back((int)slot.records.size() - 1);
+	return m_Open.back();
+}
+
+void GPUProfiler::EndScope(int record)
+{
+	if (!m_InFrame || std::find(m_Open.begin(), m_Open.end(), record) == m_Open.end())
+		return;
+
+	// Ends the scopes nested inside it too, they would otherwise outlive their parent
+	while (!m_Open.empty()) {
+		int open = m_Open.back();
+		m_Open.pop_back();
+
+		Slot& slot = m_Slots[m_Frame % FRAME_LATENCY];
+		slot.records[open].end = slot.used;
+		glQueryCounter(nextQuery(slot), GL_TIMESTAMP);
+
+		if (open == record)
+			break;
+	}
+}
+
+void GPUProfiler::Flush()
+{
+	EndFrame();
+
+	// Oldest first so the history stays in frame order
+	for (int i = 0; i < FRAME_LATENCY; i++) {
+		Slot& slot = m_Slots[(m_Frame + i) % FRAME_LATENCY];
+		if (slot.frame >= 0)
+			collect(slot);
+	}
+}
+
+std::vector<GPUScopeStats> GPUProfiler::GetStats() const
+{
+	std::vector<GPUScopeStats> stats;
+	std::vector<double> times;
+
+	// The newest frame sits just before m_HistoryNext
+	const FrameResult* newest = m_History.empty() ? nullptr :
+		&m_History[(m_HistoryNext + m_History.size() - 1) % m_History.size()];
+
+	for (size_t scope = 0; scope < m_Names.size(); scope++) {
+		times.clear();
+		for (const FrameResult& result : m_History) {
+			if (scope < result.ms.size() && result.ms[scope] >= 0.0)
+				times.push_back(result.ms[scope]);
+		}
+
+		GPUScopeStats s;
+		s.name = m_Names[scope];
+		s.depth = m_Depths[scope];
+		s.samples = times.size();
+		s.lastMs = newest && scope < newest->ms.size() ? std::max(newest->ms[scope], 0.0) : 0.0;
+		s.minMs = s.avgMs = s.p99Ms = 0.0;
+		if (!times.empty()) {
+			std::sort(times.begin(), times.end());
+			s.minMs = times.front();
+			for (double t : times)
+				s.avgMs += t;
+			s.avgMs /= times.size();
+
+			// Nearest rank
+			size_t rank = (size_t)std::ceil(0.99 * times.size());
+			s.p99Ms = times[rank > 0 ? rank - 1 : 0];
+		}
+		stats.push_back(s);
+	}
+	return stats;
+}
+
+bool GPUProfiler::GetLastFrame(int& frame, double& ms) const
+{
+	if (m_History.empty())
+		return false;
+
+	const FrameResult& newest = m_History[(m_HistoryNext + m_History.size() - 1) % m_History.size()];
+	frame = newest.frame;
+	ms = std::max(newest.ms[0], 0.0);
+	return true;
+}
+
+void GPUProfiler::PrintReport() const
+{
+	std::vector<GPUScopeStats> stats = GetStats();
+	std::cout << "GPU scopes over the last " << m_History.size() << " frames (ms): min / avg / p99" << std::endl;
+	std::cout << std::fixed << std::setprecision(3);
+	for (const GPUScopeStats& s : stats) {
+		std::string label = std::string(2 + 2 * s.depth, ' ') + s.name;
+		std::cout << std::left << std::setw(28) << label << std::right << std::setw(10) << s.minMs << std::setw(10) << s.avgMs
+			<< std::setw(10) << s.p99Ms << "  (" << s.samples << " frames)" << std::endl;
+	}
+	std::cout << std::defaultfloat << std::setprecision(6);
+}
+
+bool GPUProfiler::WriteCSV(const std::string& path) const
+{
+	std::ofstream file(path);
+	if (!file) {
+		std::cout << "ERROR::GPU_PROFILER::CANNOT_WRITE " << path << std::endl;
+		return false;
+	}
+
+	file << "frame_number";
+	for (const std::string& name : m_Names)
+		file << "," << name;
+	file << "\n";
+
+	for (size_t i = 0; i < m_History.size(); i++) {
+		const FrameResult& result = m_History[(m_HistoryNext + i) % m_History.size()];
+		file << result.frame;
+		for (size_t scope = 0; scope < m_Names.size(); scope++) {
+			file << ",";
+			if (scope < result.ms.size() && result.ms[scope] >= 0.0)
+				file << result.ms[scope];
+		}
+		file << "\n";
+	}
+	return true;
+}
+
+unsigned int GPUProfiler::nextQuery(Slot& slot)
+{
+	if (slot.used == slot.queries.size()) {
+		unsigned int query = 0;
+		glGenQueries(1, &query);
+		slot.queries.push_back(query);
+	}
+	return slot.queries[slot.used++];
+}
+
+void GPUProfiler::collect(Slot& slot)
+{
+	FrameResult result;
+	result.frame = slot.frame;
+	result.ms.assign(m_Names.size(), -1.0);
+
+	for (const Record& record : slot.records) {
+		if (record.end == record.begin)
+			continue;	// Never ended
+
+		GLuint64 begin = 0, end = 0;
+		glGetQueryObjectui64v(slot.queries[record.begin], GL_QUERY_RESULT, &begin);
+		glGetQueryObjectui64v(slot.queries[record.end], GL_QUERY_RESULT, &end);
+
+		double ms = end > begin ? (end - begin) / 1.0e6 : 0.0;
+		double& total = result.ms[record.scope];
+		total = total < 0.0 ? ms : total + ms;
+	}
+	slot.frame = -1;
+	slot.records.clear();
+
+	if (m_History.size() < m_HistoryFrames)
+		m_History.push_back(result);
+	else
+		m_History[m_HistoryNext] = result;
+	m_HistoryNext = (m_HistoryNext + 1) % m_HistoryFrames;
+}
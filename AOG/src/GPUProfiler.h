@@ -0,0 +1,135 @@
+#pragma once
+
+// Third Party library
+#include <glad/glad.h>
+
+// System library
+#include <vector>
+#include <string>
+#include <unordered_map>
+
+struct GPUScopeStats
+{
+	std::string name;
+	int depth;			// Nesting level it was first seen at, 0 for the frame
+	size_t samples;		// Frames of the history it ran in
+	double lastMs;		// Summed over the frame when it ran more than once
+	double minMs, avgMs, p99Ms;
+};
+
+/*
+	Where the GPU time of a frame goes, per named scope.
+
+	Scopes put a GL_TIMESTAMP query at their start and end, so they nest and don't
+	get in the way of a GL_TIME_ELAPSED query around the whole frame. Each frame
+	writes its queries into one slot of a ring of FRAME_LATENCY slots and the slot is
+	only read back when it comes round again, long after the GPU finished it, so
+	reading never stalls. The last historyFrames frames give every scope its rolling
+	min / avg / p99; scopes running several times in a frame are summed.
+
+	The frame itself is the first scope. Use it through GPU_SCOPE("name") once a
+	profiler is active, scopes outside BeginFrame / EndFrame are ignored.
+*/
+class GPUProfiler
+{
+public:
+	static const int FRAME_LATENCY = 4;
+
+private:
+	struct Record
+	{
+		int scope;
+		size_t begin, end;		// Into the slot's queries
+	};
+
+	struct Slot
+	{
+		int frame;			// -1 while empty
+		std::vector<unsigned int> queries;	// Grows to the most a frame used
+		size_t used;
+		std::vector<Record> records;
+	};
+
+	struct FrameResult
+	{
+		int frame;
+		std::vector<double> ms;		// Per scope, negative when it didn't run
+	};
+
+	Slot m_Slots[FRAME_LATENCY];
+	int m_Frame;
+	bool m_InFrame;
+	std::vector<int> m_Open;		// Records begun but not ended
+
+	std::vector<std::string> m_Names;
+	std::vector<int> m_Depths;
+	std::unordered_map<std::string, int> m_Scopes;
+
+	size_t m_HistoryFrames;
+	std::vector<FrameResult> m_History;	// Ring, m_HistoryNext is the oldest once full
+	size_t m_HistoryNext;
+
+	static GPUProfiler* s_Active;
+
+public:
+	explicit GPUProfiler(int historyFrames = 240);
+	~GPUProfiler();
+
+	GPUProfiler(const GPUProfiler&) = delete;
+	GPUProfiler& operator=(const GPUProfiler&) = delete;
+
+	// Reads back the frame that last used this slot and starts timing a new one
+	void BeginFrame();
+	void EndFrame();
+
+	// Returns the record to end, -1 outside a frame
+	int BeginScope(const char* name);
+	void EndScope(int record);
+
+	// Waits for the frames still in flight, for a final report
+	void Flush();
+
+	// Every scope in the order they were first seen
+	std::vector<GPUScopeStats> GetStats() const;
+
+	// Number and GPU time of the newest frame read back, false before the first. Cheap enough for every frame
+	bool GetLastFrame(int& frame, double& ms) const;
+
+	// Table of GetStats, indented by depth
+	void PrintReport() const;
+
+	// One row per frame of the history, one column of ms per scope (empty when it didn't run)
+	bool WriteCSV(const std::string& path) const;
+
+	// The profiler GPU_SCOPE records into, nullptr turns the scopes off
+	static void SetActive(GPUProfiler* profiler) { s_Active = profiler; }
+	static GPUProfiler* GetActive() { return s_Active; }
+
+private:
+	unsigned int nextQuery(Slot& slot);
+	void collect(Slot& slot);
+};
+
+// Times the rest of the enclosing block on the active profiler
+class GPUScope
+{
+private:
+	GPUProfiler* m_Profiler;
+	int m_Record;
+
+public:
+	explicit GPUScope(const char* name)
+		: m_Profiler(GPUProfiler::GetActive()), m_Record(m_Profiler ? m_Profiler->BeginScope(name) : -1) {}
+	~GPUScope()
+	{
+		if (m_Record >= 0)
+			m_Profiler->EndScope(m_Record);
+	}
+
+	GPUScope(const GPUScope&) = delete;
+	GPUScope& operator=(const GPUScope&) = delete;
+};
+
+#define GPU_SCOPE_JOIN(a, b) a##b
+#define GPU_SCOPE_NAME(a, b) GPU_SCOPE_JOIN(a, b)
+#define GPU_SCOPE(name) GPUScope GPU_SCOPE_NAME(gpuScope, __LINE__)(name)
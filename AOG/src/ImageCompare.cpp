@@ -0,0 +1,98 @@
+#include "ImageCompare.h"
+
+#include <stb_image.h>
+
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+static const double MAX_YIQ_DELTA = 35215.0;	// Black against white
+
+bool WriteImagePPM(const std::string& path, const Image& image)
+{
+	std::ofstream file(path, std::ios::binary);
+	if (!file) {
+		std::cout << "ERROR::IMAGE::CANNOT_WRITE " << path << std::endl;
+		return false;
+	}
+
+	file << "P6\n" << image.width << " " << image.height << "\n255\n";
+	std::vector<uint8_t> row(image.width * 3);
+	for (int y = image.height - 1; y >= 0; y--) {
+		const uint8_t* rgba = &image.pixels[(size_t)y * image.width * 4];
+		for (int x = 0; x < image.width; x++)
+			memcpy(&row[x * 3], &rgba[x * 4], 3);
+		file.write((const char*)row.data(), row.size());
+	}
+	return (bool)file;
+}
+
+bool ReadImage(const std::string& path, Image& image)
+{
+	int channels;
+	stbi_set_flip_vertically_on_load_thread(true);	// Bottom row first like glReadPixels
+	uint8_t* data = stbi_load(path.c_str(), &image.width, &image.height, &channels, 4);
+	if (!data)
+		return false;
+
+	image.pixels.assign(data, data + (size_t)image.width * image.height * 4);
+	stbi_image_free(data);
+	return true;
+}
+
+static double yiqDelta(const uint8_t* a, const uint8_t* b)
+{
+	double r = (double)a[0] - b[0], g = (double)a[1] - b[1], bl = (double)a[2] - b[2];
+	double y = r * 0.29889531 + g * 0.58662247 + bl * 0.11448223;
+	double i = r * 0.59597799 - g * 0.27417610 - bl * 0.32180189;
+	double q = r * 0.21147017 - g * 0.52261711 + bl * 0.31114694;
+	return 0.5053 * y * y + 0.299 * i * i + 0.1957 * q * q;
+}
+
+ImageDifference CompareImages(const Image& reference, const Image& image, float threshold, Image* diff)
+{
+	ImageDifference result;
+	if (reference.width != image.width || reference.height != image.height || reference.pixels.size() != image.pixels.size())
+		return result;
+
+	result.sameSize = true;
+	if (diff) {
+		diff->width = reference.width;
+		diff->height = reference.height;
+		diff->pixels.resize(reference.pixels.size());
+	}
+
+	size_t pixelCount = (size_t)reference.width * reference.height;
+	size_t differing = 0;
+	double maxDelta = 0.0, totalDelta = 0.0;
+	for (size_t p = 0; p < pixelCount; p++) {
+		const uint8_t* a = &reference.pixels[p * 4];
+		const uint8_t* b = &image.pixels[p * 4];
+		double delta = sqrt(yiqDelta(a, b) / MAX_YIQ_DELTA);
+		bool differs = delta > threshold;
+		differing += differs ? 1 : 0;
+		maxDelta = std::max(maxDelta, delta);
+		totalDelta += delta;
+
+		if (diff) {
+			uint8_t* out = &diff->pixels[p * 4];
+			if (differs) {
+				out[0] = 255;
+				out[1] = out[2] = 0;
+			}
+			else {
+				// Faded so the red stands out
+				uint8_t grey = (uint8_t)(255 - (255 - (a[0] * 0.299 + a[1] * 0.587 + a[2] * 0.114)) * 0.25);
+				out[0] = out[1] = out[2] = grey;
+			}
+			out[3] = 255;
+		}
+	}
+
+	result.differingFraction = (double)differing / std::max(pixelCount, (size_t)1);
+	result.maxDelta = maxDelta;
+	result.meanDelta = totalDelta / std::max(pixelCount, (size_t)1);
+	return result;
+}
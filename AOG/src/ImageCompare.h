@@ -0,0 +1,38 @@
+#pragma once
+
+// System library
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Tightly packed RGBA rows, bottom row first like Framebuffer::ReadPixels
+struct Image
+{
+	int width = 0;
+	int height = 0;
+	std::vector<uint8_t> pixels;
+};
+
+// Binary PPM (the alpha channel is dropped), readable by any image viewer
+bool WriteImagePPM(const std::string& path, const Image& image);
+
+// PPM, PNG, JPG... through stb_image
+bool ReadImage(const std::string& path, Image& image);
+
+struct ImageDifference
+{
+	double differingFraction = 1.0;		// Pixels over the threshold
+	double maxDelta = 1.0;				// 0 same color, 1 black against white
+	double meanDelta = 1.0;
+	bool sameSize = false;
+};
+
+/*
+	Perceptual difference, the YIQ metric pixelmatch uses: brightness counts about
+	twice as much as hue, so dithering and small shading changes stay under the
+	threshold where a missing object or a wrong texture doesn't. threshold is a
+	fraction of the largest difference, 0.1 lets through what the eye hardly sees.
+
+	diff, if given, gets the reference in faded grey with the differing pixels red.
+*/
+ImageDifference CompareImages(const Image& reference, const Image& image, float threshold, Image* diff = nullptr);
@@ -0,0 +1,246 @@
+#include "LightClusters.h"
+#include "MemoryTracker.h"
+
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+#include <iostream>
+
+enum { LIGHT_BUFFER, GRID_BUFFER, INDEX_BUFFER };
+
+float PointLightRange(float constant, float linear, float quadratic, float cutoff)
+{
+	// quadratic d^2 + linear d + constant - 1 / cutoff = 0
+	float c = constant - 1.0f / cutoff;
+	if (quadratic <= 0.0f)
+		return linear > 0.0f ? -c / linear : 0.0f;
+	return (-linear + sqrtf(linear * linear - 4.0f * quadratic * c)) / (2.0f * quadratic);
+}
+
+void SetForwardPointLights(const Shader& shader, const PointLight* lights, size_t count)
+{
+	// Same layout as the clusters' light buffer: position + radius, color
+	glm::vec4 packed[2 * MAX_FORWARD_POINT_LIGHTS];
+	int packedCount = (int)std::min(count, (size_t)MAX_FORWARD_POINT_LIGHTS);
+	for (int i = 0; i < packedCount; i++) {
+		packed[2 * i] = glm::vec4(lights[i].position, lights[i].radius);
+		packed[2 * i + 1] = glm::vec4(lights[i].color, 0.0f);
+	}
+
+	if (packedCount > 0)
+		shader.setVec4fv("pointLights", packed, 2 * packedCount);
+	shader.setInt("pointLightCount", packedCount);
+}
+
+int ForwardPointLightSlots(size_t count)
+{
+	if (count == 0)
+		return 0;
+	int slots = 4;
+	while (slots < MAX_FORWARD_POINT_LIGHTS && (size_t)slots < count)
+		slots *= 2;
+	return slots;
+}
+
+LightClusters::LightClusters(ThreadPool& pool, int tilesX, int tilesY, int slices)
+	: m_Pool(pool), m_TilesX(std::max(tilesX, 1)), m_TilesY(std::max(tilesY, 1)), m_Slices(std::max(slices, 1)),
+	  m_Near(0.0f), m_Far(0.0f), m_TanHalfFovY(0.0f), m_Aspect(0.0f)
+{
+	GLint maxTexels = 0;
+	glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxTexels);
+	m_MaxTexels = (size_t)maxTexels;
+
+	m_Grid.resize(GetClusterCount());
+	m_SliceIndices.resize(m_Slices);
+	m_SliceCandidates.resize(m_Slices);
+
+	const GLenum formats[3] = { GL_RGBA32F, GL_RG32UI, GL_R32UI };
+	glGenBuffers(3, m_Buffers);
+	glGenTextures(3, m_Textures);
+	for (int i = 0; i < 3; i++) {
+		glBindBuffer(GL_TEXTURE_BUFFER, m_Buffers[i]);
+		glBufferData(GL_TEXTURE_BUFFER, 16, nullptr, GL_STREAM_DRAW);
+		TrackGPUMemory(GPUResource::Buffer, m_Buffers[i], 16, "light clusters");
+		glBindTexture(GL_TEXTURE_BUFFER, m_Textures[i]);
+		glTexBuffer(GL_TEXTURE_BUFFER, formats[i], m_Buffers[i]);
+	}
+	glBindTexture(GL_TEXTURE_BUFFER, 0);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+LightClusters::~LightClusters()
+{
+	for (unsigned int buffer : m_Buffers)
+		UntrackGPUMemory(GPUResource::Buffer, buffer);
+	glDeleteTextures(3, m_Textures);
+	glDeleteBuffers(3, m_Buffers);
+}
+
+void LightClusters::buildClusters(const Camera& camera)
+{
+	m_Near = camera.GetNearPlane();
+	m_Far = camera.GetFarPlane();
+	m_TanHalfFovY = tan(glm::radians(camera.GetZoom()) * 0.5f);
+	m_Aspect = camera.GetAspectRatio();
+
+	// Exponential slices: each one is the same factor deeper than the previous
+	m_SliceDepth.resize(m_Slices + 1);
+	for (int s = 0; s <= m_Slices; s++)
+		m_SliceDepth[s] = m_Near * powf(m_Far / m_Near, (float)s / m_Slices);
+
+	const float kx = m_TanHalfFovY * m_Aspect, ky = m_TanHalfFovY;
+	m_ClusterMin.resize(GetClusterCount());
+	m_ClusterMax.resize(GetClusterCount());
+	for (int s = 0; s < m_Slices; s++) {
+		float dn = m_SliceDepth[s], df = m_SliceDepth[s + 1];
+		for (int ty = 0; ty < m_TilesY; ty++) {
+			float y0 = (-1.0f + 2.0f * ty / m_TilesY) * ky, y1 = (-1.0f + 2.0f * (ty + 1) / m_TilesY) * ky;
+			for (int tx = 0; tx < m_TilesX; tx++) {
+				float x0 = (-1.0f + 2.0f * tx / m_TilesX) * kx, x1 = (-1.0f + 2.0f * (tx + 1) / m_TilesX) * kx;
+
+				// The tile's side planes fan out, so the box spans both ends of the slice
+				int c = (s * m_TilesY + ty) * m_TilesX + tx;
+				m_ClusterMin[c] = glm::vec3(std::min(x0 * dn, x0 * df), std::min(y0 * dn, y0 * df), dn);
+				m_ClusterMax[c] = glm::vec3(std::max(x1 * dn, x1 * df), std::max(y1 * dn, y1 * df), df);
+			}
+		}
+	}
+}
+
+void LightClusters::Update(const Camera& camera, const PointLight* lights, size_t count)
+{
+	auto start = std::chrono::steady_clock::now();
+
+	if (camera.GetNearPlane() != m_Near || camera.GetFarPlane() != m_Far || camera.GetAspectRatio() != m_Aspect ||
+		tan(glm::radians(camera.GetZoom()) * 0.5f) != m_TanHalfFovY)
+		buildClusters(camera);
+
+	if (2 * count > m_MaxTexels)
+		count = m_MaxTexels / 2;
+
+	// View space, with z flipped to a positive depth like the cluster boxes
+	const glm::mat4& view = camera.GetViewMatrix();
+	m_ViewLights.resize(count);
+	m_LightTexels.resize(2 * count);
+	for (size_t i = 0; i < count; i++) {
+		glm::vec3 p = glm::vec3(view * glm::vec4(lights[i].position, 1.0f));
+		m_ViewLights[i] = glm::vec4(p.x, p.y, -p.z, lights[i].radius);
+		m_LightTexels[2 * i] = glm::vec4(lights[i].position, lights[i].radius);
+		m_LightTexels[2 * i + 1] = glm::vec4(lights[i].color, 0.0f);
+	}
+
+	// Every slice writes its own clusters and index list, no locking needed
+	m_Pool.ParallelFor((uint32_t)m_Slices, [this](uint32_t slice) { assignSlice((int)slice); });
+
+	// Stitch the per slice lists together
+	m_Indices.clear();
+	const int clustersPerSlice = m_TilesX * m_TilesY;
+	for (int s = 0; s < m_Slices; s++) {
+		uint32_t base = (uint32_t)m_Indices.size();
+		for (int c = s * clustersPerSlice; c < (s + 1) * clustersPerSlice; c++)
+			m_Grid[c].x += base;
+		m_Indices.insert(m_Indices.end(), m_SliceIndices[s].begin(), m_SliceIndices[s].end());
+	}
+
+	m_Stats = LightClusterStats();
+	m_Stats.lights = count;
+	m_Stats.references = m_Indices.size();
+	for (const glm::uvec2& cluster : m_Grid) {
+		m_Stats.maxPerCluster = std::max(m_Stats.maxPerCluster, (size_t)cluster.y);
+		m_Stats.nonEmptyClusters += cluster.y > 0 ? 1 : 0;
+	}
+
+	// Past the texture buffer limit the farthest clusters lose their lights
+	if (m_Indices.size() > m_MaxTexels) {
+		std::cout << "ERROR::LIGHT_CLUSTERS::TOO_MANY_REFERENCES " << m_Indices.size() << std::endl;
+		for (glm::uvec2& cluster : m_Grid)
+			cluster.y = cluster.x >= m_MaxTexels ? 0 : std::min(cluster.y, (uint32_t)(m_MaxTexels - cluster.x));
+		m_Indices.resize(m_MaxTexels);
+	}
+	m_Stats.assignMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	// Orphan and refill, the previous frame may still be reading the old storage
+	const void* data[3] = { m_LightTexels.data(), m_Grid.data(), m_Indices.data() };
+	const size_t sizes[3] = { m_LightTexels.size() * sizeof(glm::vec4), m_Grid.size() * sizeof(glm::uvec2), m_Indices.size() * sizeof(uint32_t) };
+	for (int i = 0; i < 3; i++) {
+		glBindBuffer(GL_TEXTURE_BUFFER, m_Buffers[i]);
+		glBufferData(GL_TEXTURE_BUFFER, std::max(sizes[i], (size_t)16), nullptr, GL_STREAM_DRAW);
+		TrackGPUMemory(GPUResource::Buffer, m_Buffers[i], std::max(sizes[i], (size_t)16), "light clusters");
+		if (sizes[i] > 0)
+			glBufferSubData(GL_TEXTURE_BUFFER, 0, sizes[i], data[i]);
+	}
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void LightClusters::assignSlice(int slice)
+{
+	const float dn = m_SliceDepth[slice], df = m_SliceDepth[slice + 1];
+	const float kx = m_TanHalfFovY * m_Aspect, ky = m_TanHalfFovY;
+
+	// 1) Lights touching the slice, with the range of tiles their bounding box covers
+	std::vector<uint32_t>& candidates = m_SliceCandidates[slice];
+	candidates.clear();
+	for (size_t i = 0; i < m_ViewLights.size(); i++) {
+		const glm::vec4& l = m_ViewLights[i];
+		if (l.z + l.w < dn || l.z - l.w > df)
+			continue;
+
+		// x / depth is monotonic in both, so the extremes are at the box corners
+		float da = std::max(l.z - l.w, dn), db = std::min(l.z + l.w, df);
+		float minX = std::min((l.x - l.w) / da, (l.x - l.w) / db) / kx;
+		float maxX = std::max((l.x + l.w) / da, (l.x + l.w) / db) / kx;
+		float minY = std::min((l.y - l.w) / da, (l.y - l.w) / db) / ky;
+		float maxY = std::max((l.y + l.w) / da, (l.y + l.w) / db) / ky;
+		if (maxX < -1.0f || minX > 1.0f || maxY < -1.0f || minY > 1.0f)
+			continue;
+
+		candidates.push_back((uint32_t)i);
+		candidates.push_back((uint32_t)glm::clamp((int)floorf((minX + 1.0f) * 0.5f * m_TilesX), 0, m_TilesX - 1));
+		candidates.push_back((uint32_t)glm::clamp((int)floorf((maxX + 1.0f) * 0.5f * m_TilesX), 0, m_TilesX - 1));
+		candidates.push_back((uint32_t)glm::clamp((int)floorf((minY + 1.0f) * 0.5f * m_TilesY), 0, m_TilesY - 1));
+		candidates.push_back((uint32_t)glm::clamp((int)floorf((maxY + 1.0f) * 0.5f * m_TilesY), 0, m_TilesY - 1));
+	}
+
+	// 2) Exact sphere against box test for every cluster the candidate may touch
+	std::vector<uint32_t>& indices = m_SliceIndices[slice];
+	indices.clear();
+	for (int ty = 0; ty < m_TilesY; ty++) {
+		for (int tx = 0; tx < m_TilesX; tx++) {
+			int c = (slice * m_TilesY + ty) * m_TilesX + tx;
+			const glm::vec3& boxMin = m_ClusterMin[c];
+			const glm::vec3& boxMax = m_ClusterMax[c];
+			uint32_t first = (uint32_t)indices.size();
+
+			for (size_t n = 0; n < candidates.size(); n += 5) {
+				if ((uint32_t)tx < candidates[n + 1] || (uint32_t)tx > candidates[n + 2] ||
+					(uint32_t)ty < candidates[n + 3] || (uint32_t)ty > candidates[n + 4])
+					continue;
+
+				const glm::vec4& l = m_ViewLights[candidates[n]];
+				glm::vec3 center(l);
+				glm::vec3 d = glm::clamp(center, boxMin, boxMax) - center;
+				if (glm::dot(d, d) <= l.w * l.w)
+					indices.push_back(candidates[n]);
+			}
+
+			m_Grid[c] = glm::uvec2(first, (uint32_t)indices.size() - first);
+		}
+	}
+}
+
+void LightClusters::Bind(const Shader& shader, int viewportWidth, int viewportHeight, int firstUnit) const
+{
+	const char* samplers[3] = { "clusterLights", "clusterGrid", "clusterIndices" };
+	for (int i = 0; i < 3; i++) {
+		glActiveTexture(GL_TEXTURE0 + firstUnit + i);
+		glBindTexture(GL_TEXTURE_BUFFER, m_Textures[i]);
+		shader.setInt(samplers[i], firstUnit + i);
+	}
+
+	// slice = log(depth) * scale + bias, the inverse of the exponential spacing
+	float sliceScale = m_Slices / logf(m_Far / m_Near);
+	shader.setVec4f("clusterDepth", glm::vec4(m_Near, m_Far, sliceScale, -logf(m_Near) * sliceScale));
+	shader.setVec4f("clusterTile", glm::vec4((float)m_TilesX / viewportWidth, (float)m_TilesY / viewportHeight,
+		(float)m_TilesX, (float)m_TilesY));
+	shader.setInt("clusterSlices", m_Slices);
+}
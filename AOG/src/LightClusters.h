@@ -0,0 +1,105 @@
+#pragma once
+
+#include "Camera.h"
+#include "Shader.h"
+#include "ThreadPool.h"
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+// System library
+#include <vector>
+#include <cstdint>
+
+struct PointLight
+{
+	glm::vec3 position;
+	float radius;		// Light is cut off (smoothly) at this distance
+	glm::vec3 color;	// Scales the ambient, diffuse and specular terms
+};
+
+// Distance at which 1 / (constant + linear d + quadratic d^2) falls below cutoff
+float PointLightRange(float constant, float linear, float quadratic, float cutoff = 1.0f / 256.0f);
+
+// MAX_POINT_LIGHTS of the forward shader (lightingFShader.glsl)
+const int MAX_FORWARD_POINT_LIGHTS = 16;
+
+// Packs the first MAX_FORWARD_POINT_LIGHTS lights into the forward shader's "pointLights" array, 2 vec4 each
+void SetForwardPointLights(const Shader& shader, const PointLight* lights, size_t count);
+
+// POINT_LIGHT_SLOTS to build the forward shader with for count lights: the smallest of 0, 4, 8 and 16 that
+// holds them, so the loop unrolls without running many empty slots
+int ForwardPointLightSlots(size_t count);
+
+struct LightClusterStats
+{
+	size_t lights = 0;
+	size_t references = 0;		// Light indices over all clusters
+	size_t maxPerCluster = 0;
+	size_t nonEmptyClusters = 0;
+	double assignMs = 0.0;		// CPU time of the assignment, upload not included
+};
+
+/*
+	Clustered forward lighting.
+
+	The view frustum is cut into tilesX * tilesY screen tiles and slices depth
+	slices, spaced exponentially between the near and far plane so clusters stay
+	roughly cube shaped. Every frame the lights are tested against the clusters'
+	view space boxes on the thread pool, one depth slice per job, and the result
+	goes to the GPU as three texture buffers (GL 3.1, no SSBOs needed):
+
+		lights		RGBA32F, 2 texels per light: position + radius, color
+		grid		RG32UI per cluster: first index, light count
+		indices		R32UI light indices, one run per cluster
+
+	lightingClusteredFShader.glsl finds its cluster from gl_FragCoord and only
+	loops over that cluster's lights. A 1x1x1 grid degenerates to a plain forward
+	loop over every light, handy as a reference.
+*/
+class LightClusters
+{
+private:
+	ThreadPool& m_Pool;
+
+	int m_TilesX, m_TilesY, m_Slices;
+	size_t m_MaxTexels;				// GL_MAX_TEXTURE_BUFFER_SIZE
+
+	// Projection the cluster boxes were built for
+	float m_Near, m_Far, m_TanHalfFovY, m_Aspect;
+	std::vector<float> m_SliceDepth;			// Slices + 1 boundaries, positive view depth
+	std::vector<glm::vec3> m_ClusterMin, m_ClusterMax;	// View space (z = depth), per cluster
+
+	// Per frame data
+	std::vector<glm::vec4> m_ViewLights;		// View space position (z = depth) + radius
+	std::vector<glm::vec4> m_LightTexels;
+	std::vector<glm::uvec2> m_Grid;
+	std::vector<std::vector<uint32_t>> m_SliceIndices;
+	std::vector<std::vector<uint32_t>> m_SliceCandidates;
+	std::vector<uint32_t> m_Indices;
+	LightClusterStats m_Stats;
+
+	unsigned int m_Buffers[3];
+	unsigned int m_Textures[3];
+
+public:
+	LightClusters(ThreadPool& pool, int tilesX = 16, int tilesY = 9, int slices = 24);
+	~LightClusters();
+
+	LightClusters(const LightClusters&) = delete;
+	LightClusters& operator=(const LightClusters&) = delete;
+
+	// Assigns the lights to clusters and uploads the buffers
+	void Update(const Camera& camera, const PointLight* lights, size_t count);
+
+	// Binds the buffers to firstUnit .. firstUnit + 2 and sets the cluster uniforms of a program using them
+	void Bind(const Shader& shader, int viewportWidth, int viewportHeight, int firstUnit = 3) const;
+
+	// Getters
+	int GetClusterCount() const { return m_TilesX * m_TilesY * m_Slices; }
+	const LightClusterStats& GetStats() const { return m_Stats; }
+
+private:
+	void buildClusters(const Camera& camera);
+	void assignSlice(int slice);
+};
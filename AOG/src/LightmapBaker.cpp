@@ -0,0 +1,831 @@
+#include "LightmapBaker.h"
+#include "MemoryTracker.h"
+
+#include <glad/glad.h>
+#include <stb_image.h>
+
+#include <chrono>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <algorithm>
+#include <unordered_map>
+#include <iostream>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#include <emmintrin.h>
+	#define LIGHTMAP_SSE
+#endif
+
+static const float RAY_BIAS = 1e-3f;		// Ray origins are pushed this far off the surface
+static const float RAY_FAR = 1e4f;
+static const float LIGHT_CUTOFF = 1.0f / 512.0f;	// Point lights dimmer than this skip their shadow ray
+static const int DILATE_PASSES = 3;
+static const int STACK_SIZE = 64;
+
+// Four rays traced together, SoA so the box and triangle tests run across the lanes
+struct RayPacket
+{
+	float ox[4], oy[4], oz[4];
+	float dx[4], dy[4], dz[4];
+	float tMax[4];		// Shortened to the closest hit
+	uint32_t hit[4];	// Triangle (leaf order) or ~0u
+	int active;			// Lane bits, inactive lanes never hit
+};
+
+// One float per lane, SSE or plain C++ with the same results
+#if defined(LIGHTMAP_SSE)
+
+struct Float4
+{
+	__m128 v;
+
+	Float4() {}
+	Float4(__m128 v) : v(v) {}
+	explicit Float4(float s) : v(_mm_set1_ps(s)) {}
+
+	static Float4 Load(const float* p) { return _mm_loadu_ps(p); }
+	static Float4 Mask(int bits) {
+		return _mm_castsi128_ps(_mm_set_epi32(bits & 8 ? -1 : 0, bits & 4 ? -1 : 0, bits & 2 ? -1 : 0, bits & 1 ? -1 : 0));
+	}
+	void Store(float* p) const { _mm_storeu_ps(p, v); }
+};
+
+static inline Float4 operator+(Float4 a, Float4 b) { return _mm_add_ps(a.v, b.v); }
+static inline Float4 operator-(Float4 a, Float4 b) { return _mm_sub_ps(a.v, b.v); }
+static inline Float4 operator*(Float4 a, Float4 b) { return _mm_mul_ps(a.v, b.v); }
+static inline Float4 operator/(Float4 a, Float4 b) { return _mm_div_ps(a.v, b.v); }
+static inline Float4 operator<=(Float4 a, Float4 b) { return _mm_cmple_ps(a.v, b.v); }
+static inline Float4 operator<(Float4 a, Float4 b) { return _mm_cmplt_ps(a.v, b.v); }
+static inline Float4 operator>=(Float4 a, Float4 b) { return _mm_cmpge_ps(a.v, b.v); }
+static inline Float4 operator>(Float4 a, Float4 b) { return _mm_cmpgt_ps(a.v, b.v); }
+static inline Float4 operator&(Float4 a, Float4 b) { return _mm_and_ps(a.v, b.v); }
+static inline Float4 min4(Float4 a, Float4 b) { return _mm_min_ps(a.v, b.v); }
+static inline Float4 max4(Float4 a, Float4 b) { return _mm_max_ps(a.v, b.v); }
+static inline Float4 abs4(Float4 a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a.v); }
+static inline Float4 select4(Float4 mask, Float4 a, Float4 b) { return _mm_or_ps(_mm_and_ps(mask.v, a.v), _mm_andnot_ps(mask.v, b.v)); }
+static inline int bits4(Float4 mask) { return _mm_movemask_ps(mask.v); }
+
+#else
+
+struct Float4
+{
+	float v[4];
+
+	Float4() {}
+	explicit Float4(float s) { v[0] = v[1] = v[2] = v[3] = s; }
+
+	static Float4 Load(const float* p) { Float4 r; memcpy(r.v, p, sizeof(r.v)); return r; }
+	static Float4 Mask(int bits);
+	void Store(float* p) const { memcpy(p, v, sizeof(v)); }
+};
+
+static inline float laneMask(bool set)
+{
+	uint32_t bits = set ? 0xFFFFFFFFu : 0u;
+	float f;
+	memcpy(&f, &bits, sizeof(f));
+	return f;
+}
+
+static inline bool laneSet(float f)
+{
+	uint32_t bits;
+	memcpy(&bits, &f, sizeof(bits));
+	return bits != 0;
+}
+
+Float4 Float4::Mask(int bits)
+{
+	Float4 r;
+	for (int i = 0; i < 4; i++)
+		r.v[i] = laneMask((bits >> i) & 1);
+	return r;
+}
+
+#define LANE_OP(op) static inline Float4 operator op(Float4 a, Float4 b) { Float4 r; for (int i = 0; i < 4; i++) r.v[i] = a.v[i] op b.v[i]; return r; }
+#define LANE_CMP(op) static inline Float4 operator op(Float4 a, Float4 b) { Float4 r; for (int i = 0; i < 4; i++) r.v[i] = laneMask(a.v[i] op b.v[i]); return r; }
+LANE_OP(+) LANE_OP(-) LANE_OP(*) LANE_OP(/)
+LANE_CMP(<=) LANE_CMP(<) LANE_CMP(>=) LANE_CMP(>)
+#undef LANE_OP
+#undef LANE_CMP
+
+static inline Float4 operator&(Float4 a, Float4 b) { Float4 r; for (int i = 0; i < 4; i++) r.v[i] = laneMask(laneSet(a.v[i]) && laneSet(b.v[i])); return r; }
+// SSE min / max return the second operand when either is NaN, so do the same
+static inline Float4 min4(Float4 a, Float4 b) { Float4 r; for (int i = 0; i < 4; i++) r.v[i] = a.v[i] < b.v[i] ? a.v[i] : b.v[i]; return r; }
+static inline Float4 max4(Float4 a, Float4 b) { Float4 r; for (int i = 0; i < 4; i++) r.v[i] = a.v[i] > b.v[i] ? a.v[i] : b.v[i]; return r; }
+static inline Float4 abs4(Float4 a) { Float4 r; for (int i = 0; i < 4; i++) r.v[i] = fabsf(a.v[i]); return r; }
+static inline Float4 select4(Float4 mask, Float4 a, Float4 b) { Float4 r; for (int i = 0; i < 4; i++) r.v[i] = laneSet(mask.v[i]) ? a.v[i] : b.v[i]; return r; }
+static inline int bits4(Float4 mask) { int bits = 0; for (int i = 0; i < 4; i++) bits |= laneSet(mask.v[i]) ? 1 << i : 0; return bits; }
+
+#endif
+
+struct Vec3x4
+{
+	Float4 x, y, z;
+
+	Vec3x4() {}
+	Vec3x4(Float4 x, Float4 y, Float4 z) : x(x), y(y), z(z) {}
+	explicit Vec3x4(const glm::vec3& v) : x(v.x), y(v.y), z(v.z) {}
+};
+
+static inline Vec3x4 operator-(const Vec3x4& a, const Vec3x4& b) { return Vec3x4(a.x - b.x, a.y - b.y, a.z - b.z); }
+static inline Float4 dot4(const Vec3x4& a, const Vec3x4& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+static inline Vec3x4 cross4(const Vec3x4& a, const Vec3x4& b)
+{
+	return Vec3x4(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+}
+
+// Per texel / per sample random numbers, no state shared between threads
+static inline uint32_t nextRandom(uint32_t& state)
+{
+	state = state * 747796405u + 2891336453u;
+	uint32_t word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+	return (word >> 22u) ^ word;
+}
+
+static inline float randomFloat(uint32_t& state)
+{
+	return (nextRandom(state) >> 8) * (1.0f / 16777216.0f);
+}
+
+// Cosine weighted around n (Duff et al. orthonormal basis)
+static glm::vec3 cosineSample(const glm::vec3& n, uint32_t& rng)
+{
+	float r = sqrtf(randomFloat(rng));
+	float phi = 6.2831853f * randomFloat(rng);
+	float x = r * cosf(phi), y = r * sinf(phi), z = sqrtf(std::max(0.0f, 1.0f - r * r));
+
+	float sign = copysignf(1.0f, n.z);
+	float a = -1.0f / (sign + n.z);
+	float b = n.x * n.y * a;
+	glm::vec3 t(1.0f + sign * n.x * n.x * a, sign * b, -sign * n.x);
+	glm::vec3 bt(b, sign + n.y * n.y * a, -n.y);
+	return glm::normalize(t * x + bt * y + n * z);
+}
+
+static inline void setLane(RayPacket& packet, int lane, const glm::vec3& origin, const glm::vec3& direction, float tMax)
+{
+	packet.ox[lane] = origin.x; packet.oy[lane] = origin.y; packet.oz[lane] = origin.z;
+	packet.dx[lane] = direction.x; packet.dy[lane] = direction.y; packet.dz[lane] = direction.z;
+	packet.tMax[lane] = tMax;
+	packet.hit[lane] = ~0u;
+}
+
+static inline int laneCount(int bits)
+{
+	return (bits & 1) + ((bits >> 1) & 1) + ((bits >> 2) & 1) + ((bits >> 3) & 1);
+}
+
+std::vector<glm::vec2> UnwrapLightmapUVs(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, int resolution, int padding)
+{
+	const size_t triangleCount = indices.size() / 3;
+
+	std::vector<glm::vec3> faceNormals(triangleCount);
+	std::unordered_map<uint64_t, std::vector<uint32_t>> edgeTriangles;
+	for (size_t t = 0; t < triangleCount; t++) {
+		const uint32_t* tri = &indices[t * 3];
+		glm::vec3 n = glm::cross(vertices[tri[1]].position - vertices[tri[0]].position, vertices[tri[2]].position - vertices[tri[0]].position);
+		faceNormals[t] = glm::length(n) > 0.0f ? glm::normalize(n) : glm::vec3(0.0f, 0.0f, 1.0f);
+
+		for (int e = 0; e < 3; e++) {
+			uint32_t a = tri[e], b = tri[(e + 1) % 3];
+			edgeTriangles[(uint64_t)std::min(a, b) << 32 | std::max(a, b)].push_back((uint32_t)t);
+		}
+	}
+
+	// Flood fill over shared edges while the triangles stay in the seed's plane
+	std::vector<int> triangleChart(triangleCount, -1);
+	std::vector<glm::vec3> chartNormals, chartPoints;
+	for (size_t seed = 0; seed < triangleCount; seed++) {
+		if (triangleChart[seed] >= 0)
+			continue;
+
+		int chart = (int)chartNormals.size();
+		glm::vec3 n = faceNormals[seed];
+		glm::vec3 p = vertices[indices[seed * 3]].position;
+		chartNormals.push_back(n);
+		chartPoints.push_back(p);
+
+		std::vector<uint32_t> open(1, (uint32_t)seed);
+		triangleChart[seed] = chart;
+		while (!open.empty()) {
+			uint32_t t = open.back();
+			open.pop_back();
+			for (int e = 0; e < 3; e++) {
+				uint32_t a = indices[t * 3 + e], b = indices[t * 3 + (e + 1) % 3];
+				for (uint32_t other : edgeTriangles[(uint64_t)std::min(a, b) << 32 | std::max(a, b)]) {
+					if (triangleChart[other] >= 0 || glm::dot(faceNormals[other], n) < 0.999f)
+						continue;
+					glm::vec3 q = vertices[indices[other * 3]].position;
+					if (fabsf(glm::dot(q - p, n)) > 1e-4f)
+						continue;
+					triangleChart[other] = chart;
+					open.push_back(other);
+				}
+			}
+		}
+	}
+
+	// A vertex belongs to one chart, the ones on a seam get a copy per chart
+	std::vector<int> vertexChart(vertices.size(), -1);
+	std::unordered_map<uint64_t, uint32_t> copies;
+	for (size_t i = 0; i < indices.size(); i++) {
+		uint32_t v = indices[i];
+		int chart = triangleChart[i / 3];
+		if (vertexChart[v] < 0)
+			vertexChart[v] = chart;
+		if (vertexChart[v] == chart)
+			continue;
+
+		uint64_t key = (uint64_t)v << 32 | (uint32_t)chart;
+		auto it = copies.find(key);
+		if (it == copies.end()) {
+			it = copies.emplace(key, (uint32_t)vertices.size()).first;
+			vertices.push_back(vertices[v]);
+			vertexChart.push_back(chart);
+		}
+		indices[i] = it->second;
+	}
+
+	// Project every chart on its plane
+	const size_t chartCount = chartNormals.size();
+	std::vector<glm::vec3> tangents(chartCount), bitangents(chartCount);
+	std::vector<glm::vec2> chartMin(chartCount, glm::vec2(FLT_MAX)), chartMax(chartCount, glm::vec2(-FLT_MAX));
+	std::vector<glm::vec2> planar(vertices.size());
+	for (size_t c = 0; c < chartCount; c++) {
+		glm::vec3 n = chartNormals[c];
+		glm::vec3 axis = fabsf(n.x) < 0.9f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+		tangents[c] = glm::normalize(glm::cross(axis, n));
+		bitangents[c] = glm::cross(n, tangents[c]);
+	}
+	for (size_t v = 0; v < vertices.size(); v++) {
+		int c = vertexChart[v];
+		if (c < 0)
+			continue;
+		planar[v] = glm::vec2(glm::dot(vertices[v].position, tangents[c]), glm::dot(vertices[v].position, bitangents[c]));
+		chartMin[c] = glm::min(chartMin[c], planar[v]);
+		chartMax[c] = glm::max(chartMax[c], planar[v]);
+	}
+
+	// Shelf packing, tallest first, shrinking the texel density until everything fits.
+	// Half the padding on each side, so neighbouring charts are padding texels apart
+	std::vector<uint32_t> order(chartCount);
+	float area = 0.0f;
+	for (size_t c = 0; c < chartCount; c++) {
+		order[c] = (uint32_t)c;
+		glm::vec2 size = chartMax[c] - chartMin[c];
+		area += std::max(size.x, 1e-6f) * std::max(size.y, 1e-6f);
+	}
+	std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+		return chartMax[a].y - chartMin[a].y > chartMax[b].y - chartMin[b].y;
+	});
+
+	std::vector<glm::ivec2> placement(chartCount);
+	float density = resolution / sqrtf(std::max(area, 1e-12f));
+	for (int attempt = 0; attempt < 100; attempt++, density *= 0.95f) {
+		int x = 0, y = 0, shelfHeight = 0;
+		bool fits = true;
+		for (uint32_t c : order) {
+			glm::vec2 size = (chartMax[c] - chartMin[c]) * density;
+			int w = (int)ceilf(size.x) + padding, h = (int)ceilf(size.y) + padding;
+			if (x + w > resolution) {
+				x = 0;
+				y += shelfHeight;
+				shelfHeight = 0;
+			}
+			if (x + w > resolution || y + h > resolution) {
+				fits = false;
+				break;
+			}
+			placement[c] = glm::ivec2(x, y);
+			x += w;
+			shelfHeight = std::max(shelfHeight, h);
+		}
+		if (fits)
+			break;
+	}
+
+	std::vector<glm::vec2> uvs(vertices.size(), glm::vec2(0.0f));
+	for (size_t v = 0; v < vertices.size(); v++) {
+		int c = vertexChart[v];
+		if (c < 0)
+			continue;
+		glm::vec2 texel = glm::vec2(placement[c]) + padding * 0.5f + (planar[v] - chartMin[c]) * density;
+		uvs[v] = texel / (float)resolution;
+	}
+	return uvs;
+}
+
+LightmapAtlas::LightmapAtlas(size_t instances, int instanceResolution)
+	: instanceResolution(instanceResolution)
+{
+	columns = std::max((int)ceil(sqrt((double)instances)), 1);
+	int rows = std::max((int)((instances + columns - 1) / columns), 1);
+	width = columns * instanceResolution;
+	height = rows * instanceResolution;
+}
+
+glm::vec4 LightmapAtlas::GetScaleOffset(size_t instance) const
+{
+	int column = (int)(instance % columns), row = (int)(instance / columns);
+	return glm::vec4((float)instanceResolution / width, (float)instanceResolution / height,
+		(float)(column * instanceResolution) / width, (float)(row * instanceResolution) / height);
+}
+
+LightmapBaker::LightmapBaker(ThreadPool& pool, const LightmapSettings& settings)
+	: m_Pool(pool), m_Settings(settings)
+{
+	m_Settings.samples = (std::max(m_Settings.samples, 0) + 3) / 4 * 4;
+	m_DirLight = { glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f), glm::vec3(0.0f) };
+}
+
+void LightmapBaker::AddInstance(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices,
+	const std::vector<glm::vec2>& lightmapUVs, const glm::mat4& model)
+{
+	Instance instance;
+	glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(model)));
+	for (const Vertex& v : vertices) {
+		instance.positions.push_back(glm::vec3(model * glm::vec4(v.position, 1.0f)));
+		instance.normals.push_back(glm::normalize(normalMatrix * v.normal));
+	}
+	instance.uvs = lightmapUVs;
+	instance.indices = indices;
+	m_Instances.push_back(instance);
+}
+
+void LightmapBaker::SetLights(const BakedDirLight& dirLight, const BakedPointLight* pointLights, size_t count)
+{
+	m_DirLight = dirLight;
+	m_DirLight.direction = glm::normalize(dirLight.direction);
+	m_PointLights.assign(pointLights, pointLights + count);
+}
+
+void LightmapBaker::buildScene()
+{
+	std::vector<AABB> bounds;
+	std::vector<glm::vec3> corners;
+	for (const Instance& instance : m_Instances) {
+		for (uint32_t index : instance.indices)
+			corners.push_back(instance.positions[index]);
+	}
+
+	const size_t triangleCount = corners.size() / 3;
+	for (size_t t = 0; t < triangleCount; t++) {
+		AABB box;
+		box.Grow(corners[t * 3]);
+		box.Grow(corners[t * 3 + 1]);
+		box.Grow(corners[t * 3 + 2]);
+		bounds.push_back(box);
+	}
+	m_BVH.Build(bounds.data(), bounds.size());
+
+	// Leaf order, so a leaf's triangles sit next to each other
+	const uint32_t* slots = m_BVH.GetIndices();
+	m_TriangleV0.resize(triangleCount);
+	m_TriangleE1.resize(triangleCount);
+	m_TriangleE2.resize(triangleCount);
+	m_TriangleNormals.resize(triangleCount);
+	for (size_t k = 0; k < triangleCount; k++) {
+		const glm::vec3* tri = &corners[slots[k] * 3];
+		m_TriangleV0[k] = tri[0];
+		m_TriangleE1[k] = tri[1] - tri[0];
+		m_TriangleE2[k] = tri[2] - tri[0];
+		glm::vec3 n = glm::cross(m_TriangleE1[k], m_TriangleE2[k]);
+		m_TriangleNormals[k] = glm::length(n) > 0.0f ? glm::normalize(n) : glm::vec3(0.0f, 1.0f, 0.0f);
+	}
+}
+
+void LightmapBaker::rasterizeTexels()
+{
+	const int width = m_Atlas.width, height = m_Atlas.height;
+	m_Texels.assign((size_t)width * height, { glm::vec3(0.0f), glm::vec3(0.0f), ~0u });
+
+	for (size_t i = 0; i < m_Instances.size(); i++) {
+		const Instance& instance = m_Instances[i];
+		glm::vec4 scaleOffset = m_Atlas.GetScaleOffset(i);
+
+		for (size_t t = 0; t + 2 < instance.indices.size(); t += 3) {
+			uint32_t v[3] = { instance.indices[t], instance.indices[t + 1], instance.indices[t + 2] };
+			glm::vec2 p[3];
+			for (int k = 0; k < 3; k++)
+				p[k] = (instance.uvs[v[k]] * glm::vec2(scaleOffset) + glm::vec2(scaleOffset.z, scaleOffset.w)) * glm::vec2(width, height);
+
+			float area = (p[1].x - p[0].x) * (p[2].y - p[0].y) - (p[2].x - p[0].x) * (p[1].y - p[0].y);
+			if (fabsf(area) < 1e-12f)
+				continue;
+
+			int x0 = std::max((int)floorf(std::min(p[0].x, std::min(p[1].x, p[2].x))), 0);
+			int x1 = std::min((int)ceilf(std::max(p[0].x, std::max(p[1].x, p[2].x))), width - 1);
+			int y0 = std::max((int)floorf(std::min(p[0].y, std::min(p[1].y, p[2].y))), 0);
+			int y1 = std::min((int)ceilf(std::max(p[0].y, std::max(p[1].y, p[2].y))), height - 1);
+
+			// Texel centres inside the triangle, barycentrics from the edge functions
+			for (int y = y0; y <= y1; y++) {
+				for (int x = x0; x <= x1; x++) {
+					glm::vec2 c(x + 0.5f, y + 0.5f);
+					float w0 = ((p[1].x - c.x) * (p[2].y - c.y) - (p[2].x - c.x) * (p[1].y - c.y)) / area;
+					float w1 = ((p[2].x - c.x) * (p[0].y - c.y) - (p[0].x - c.x) * (p[2].y - c.y)) / area;
+					float w2 = 1.0f - w0 - w1;
+					if (w0 < -1e-5f || w1 < -1e-5f || w2 < -1e-5f)
+						continue;
+
+					Texel& texel = m_Texels[(size_t)y * width + x];
+					texel.position = w0 * instance.positions[v[0]] + w1 * instance.positions[v[1]] + w2 * instance.positions[v[2]];
+					texel.normal = glm::normalize(w0 * instance.normals[v[0]] + w1 * instance.normals[v[1]] + w2 * instance.normals[v[2]]);
+					texel.instance = (uint32_t)i;
+				}
+			}
+		}
+	}
+}
+
+void LightmapBaker::trace(RayPacket& packet, bool anyHit) const
+{
+	if (m_BVH.GetNodeCount() == 0 || packet.active == 0)
+		return;
+
+	const BVH::Node* nodes = m_BVH.GetNodes();
+	Vec3x4 origin(Float4::Load(packet.ox), Float4::Load(packet.oy), Float4::Load(packet.oz));
+	Vec3x4 direction(Float4::Load(packet.dx), Float4::Load(packet.dy), Float4::Load(packet.dz));
+	Vec3x4 invDir(Float4(1.0f) / direction.x, Float4(1.0f) / direction.y, Float4(1.0f) / direction.z);
+	Float4 tMax = Float4::Load(packet.tMax);
+	Float4 active = Float4::Mask(packet.active);
+	const Float4 zero(0.0f), one(1.0f);
+
+	// Summed direction, picks which child to visit first
+	glm::vec3 packetDir(0.0f);
+	for (int lane = 0; lane < 4; lane++) {
+		if (packet.active & (1 << lane))
+			packetDir += glm::vec3(packet.dx[lane], packet.dy[lane], packet.dz[lane]);
+	}
+
+	uint32_t stack[STACK_SIZE];
+	int sp = 0;
+	stack[sp++] = 0;
+
+	while (sp > 0) {
+		uint32_t nodeIndex = stack[--sp];
+		const BVH::Node& node = nodes[nodeIndex];
+
+		// Slab test of all 4 rays against the box
+		Float4 t0x = (Float4(node.min.x) - origin.x) * invDir.x, t1x = (Float4(node.max.x) - origin.x) * invDir.x;
+		Float4 t0y = (Float4(node.min.y) - origin.y) * invDir.y, t1y = (Float4(node.max.y) - origin.y) * invDir.y;
+		Float4 t0z = (Float4(node.min.z) - origin.z) * invDir.z, t1z = (Float4(node.max.z) - origin.z) * invDir.z;
+		Float4 enter = max4(max4(min4(t0x, t1x), min4(t0y, t1y)), max4(min4(t0z, t1z), zero));
+		Float4 exit = min4(min4(max4(t0x, t1x), max4(t0y, t1y)), min4(max4(t0z, t1z), tMax));
+		if (bits4((enter <= exit) & active) == 0)
+			continue;
+
+		if (node.count) {
+			for (uint32_t k = node.rightOrFirst; k < node.rightOrFirst + node.count; k++) {
+				// Moller-Trumbore, one triangle against the 4 rays
+				Vec3x4 e1(m_TriangleE1[k]), e2(m_TriangleE2[k]);
+				Vec3x4 p = cross4(direction, e2);
+				Float4 det = dot4(e1, p);
+				Float4 invDet = one / det;
+				Vec3x4 s = origin - Vec3x4(m_TriangleV0[k]);
+				Float4 u = dot4(s, p) * invDet;
+				Vec3x4 q = cross4(s, e1);
+				Float4 v = dot4(direction, q) * invDet;
+				Float4 t = dot4(e2, q) * invDet;
+
+				Float4 hit = (abs4(det) > Float4(1e-12f)) & (u >= zero) & (v >= zero) & (u + v <= one) &
+					(t > zero) & (t < tMax) & active;
+				int hitBits = bits4(hit);
+				if (hitBits == 0)
+					continue;
+
+				tMax = select4(hit, t, tMax);
+				for (int lane = 0; lane < 4; lane++) {
+					if (hitBits & (1 << lane))
+						packet.hit[lane] = k;
+				}
+
+				// Shadow rays only need to know something is in the way
+				if (anyHit) {
+					packet.active &= ~hitBits;
+					active = Float4::Mask(packet.active);
+					if (packet.active == 0) {
+						tMax.Store(packet.tMax);
+						return;
+					}
+				}
+			}
+			continue;
+		}
+
+		// Children, nearer one along the packet's direction on top of the stack
+		uint32_t left = nodeIndex + 1, right = node.rightOrFirst;
+		glm::vec3 separation = (nodes[right].min + nodes[right].max) - (nodes[left].min + nodes[left].max);
+		if (glm::dot(separation, packetDir) < 0.0f)
+			std::swap(left, right);
+		if (sp + 2 <= STACK_SIZE) {
+			stack[sp++] = right;
+			stack[sp++] = left;
+		}
+	}
+
+	tMax.Store(packet.tMax);
+}
+
+glm::vec3 LightmapBaker::directLight(const glm::vec3& position, const glm::vec3& normal, uint64_t& rays) const
+{
+	glm::vec3 result = m_DirLight.ambient;
+	glm::vec3 origin = position + normal * RAY_BIAS;
+
+	// Shadow rays of up to 4 lights at a time; lane light -1 is the directional light
+	RayPacket packet;
+	glm::vec3 contribution[4];
+	int lanes = 0;
+	auto flush = [&]() {
+		packet.active = (1 << lanes) - 1;
+		trace(packet, true);
+		rays += lanes;
+		for (int lane = 0; lane < lanes; lane++) {
+			if (packet.active & (1 << lane))
+				result += contribution[lane];
+		}
+		lanes = 0;
+	};
+
+	float nDotL = glm::dot(normal, -m_DirLight.direction);
+	if (nDotL > 0.0f) {
+		setLane(packet, lanes, origin, -m_DirLight.direction, RAY_FAR);
+		contribution[lanes++] = m_DirLight.diffuse * nDotL;
+	}
+
+	for (const BakedPointLight& light : m_PointLights) {
+		glm::vec3 toLight = light.position - position;
+		float distance = glm::length(toLight);
+		float attenuation = 1.0f / (light.constant + light.linear * distance + light.quadratic * distance * distance);
+		result += light.ambient * attenuation;
+
+		glm::vec3 lightDir = toLight / std::max(distance, 1e-6f);
+		nDotL = glm::dot(normal, lightDir);
+		glm::vec3 diffuse = light.diffuse * (nDotL * attenuation);
+		if (nDotL <= 0.0f || std::max(diffuse.x, std::max(diffuse.y, diffuse.z)) < LIGHT_CUTOFF)
+			continue;
+
+		setLane(packet, lanes, origin, lightDir, distance - RAY_BIAS);
+		contribution[lanes++] = diffuse;
+		if (lanes == 4)
+			flush();
+	}
+	if (lanes > 0)
+		flush();
+
+	return result;
+}
+
+void LightmapBaker::bakeRow(int row, uint64_t& rays)
+{
+	const int width = m_Atlas.width;
+	const int bounces = std::max(m_Settings.bounces, 0);
+
+	for (int x = 0; x < width; x++) {
+		size_t index = (size_t)row * width + x;
+		const Texel& texel = m_Texels[index];
+		if (texel.instance == ~0u)
+			continue;
+
+		m_Direct[index] = directLight(texel.position, texel.normal, rays);
+		if (bounces == 0 || m_Settings.samples == 0)
+			continue;
+
+		// Indirect: 4 paths per packet leaving the texel, every hit lit by the direct lighting
+		uint32_t rng = (uint32_t)index * 0x9E3779B9u ^ m_Settings.seed;
+		glm::vec3 indirect(0.0f);
+		for (int sample = 0; sample < m_Settings.samples; sample += 4) {
+			RayPacket packet;
+			glm::vec3 throughput[4];
+			for (int lane = 0; lane < 4; lane++) {
+				setLane(packet, lane, texel.position + texel.normal * RAY_BIAS, cosineSample(texel.normal, rng), RAY_FAR);
+				throughput[lane] = glm::vec3(1.0f);
+			}
+			packet.active = 0xF;
+
+			for (int bounce = 0; bounce < bounces && packet.active; bounce++) {
+				rays += laneCount(packet.active);
+				trace(packet, false);
+
+				for (int lane = 0; lane < 4; lane++) {
+					if (!(packet.active & (1 << lane)))
+						continue;
+					if (packet.hit[lane] == ~0u) {
+						packet.active &= ~(1 << lane);	// Nothing out there, no sky light
+						continue;
+					}
+
+					glm::vec3 direction(packet.dx[lane], packet.dy[lane], packet.dz[lane]);
+					glm::vec3 hitPosition = glm::vec3(packet.ox[lane], packet.oy[lane], packet.oz[lane]) + direction * packet.tMax[lane];
+					glm::vec3 hitNormal = m_TriangleNormals[packet.hit[lane]];
+					if (glm::dot(hitNormal, direction) > 0.0f)
+						hitNormal = -hitNormal;
+
+					throughput[lane] *= m_Settings.albedo;
+					indirect += throughput[lane] * directLight(hitPosition, hitNormal, rays);
+					setLane(packet, lane, hitPosition + hitNormal * RAY_BIAS, cosineSample(hitNormal, rng), RAY_FAR);
+				}
+			}
+		}
+
+		// Cosine weighted: the mean of the incoming light is already the irradiance / pi
+		m_Indirect[index] = indirect / (float)m_Settings.samples;
+	}
+}
+
+void LightmapBaker::denoise()
+{
+	const int radius = m_Settings.denoiseRadius;
+	if (radius <= 0)
+		return;
+
+	const int width = m_Atlas.width, height = m_Atlas.height;
+	const float spatial = 1.0f / (0.5f * radius * radius);
+	std::vector<glm::vec3> filtered(m_Indirect.size(), glm::vec3(0.0f));
+
+	// Joint bilateral: neighbours count less the further away, the more they turn and the further off the plane
+	m_Pool.ParallelFor((uint32_t)height, [&](uint32_t row) {
+		int y = (int)row;
+		for (int x = 0; x < width; x++) {
+			size_t index = (size_t)y * width + x;
+			const Texel& texel = m_Texels[index];
+			if (texel.instance == ~0u)
+				continue;
+
+			glm::vec3 sum(0.0f);
+			float weights = 0.0f;
+			for (int dy = -radius; dy <= radius; dy++) {
+				for (int dx = -radius; dx <= radius; dx++) {
+					int nx = x + dx, ny = y + dy;
+					if (nx < 0 || ny < 0 || nx >= width || ny >= height)
+						continue;
+
+					size_t other = (size_t)ny * width + nx;
+					const Texel& neighbour = m_Texels[other];
+					if (neighbour.instance != texel.instance)
+						continue;
+
+					float facing = std::max(glm::dot(texel.normal, neighbour.normal), 0.0f);
+					facing *= facing;
+					facing *= facing;
+					float offPlane = glm::dot(texel.normal, neighbour.position - texel.position);
+					float weight = expf(-(dx * dx + dy * dy) * spatial - offPlane * offPlane * 400.0f) * facing * facing;
+					sum += m_Indirect[other] * weight;
+					weights += weight;
+				}
+			}
+			filtered[index] = weights > 0.0f ? sum / weights : m_Indirect[index];
+		}
+	});
+
+	m_Indirect.swap(filtered);
+}
+
+void LightmapBaker::dilate(int passes)
+{
+	const int width = m_Atlas.width, height = m_Atlas.height;
+	std::vector<uint8_t> covered(m_Texels.size());
+	for (size_t i = 0; i < m_Texels.size(); i++)
+		covered[i] = m_Texels[i].instance != ~0u ? 1 : 0;
+
+	// Each pass grows the charts by one texel into the gutter
+	for (int pass = 0; pass < passes; pass++) {
+		std::vector<uint8_t> next = covered;
+		for (int y = 0; y < height; y++) {
+			for (int x = 0; x < width; x++) {
+				size_t index = (size_t)y * width + x;
+				if (covered[index])
+					continue;
+
+				glm::vec3 sum(0.0f);
+				int count = 0;
+				for (int dy = -1; dy <= 1; dy++) {
+					for (int dx = -1; dx <= 1; dx++) {
+						int nx = x + dx, ny = y + dy;
+						if (nx < 0 || ny < 0 || nx >= width || ny >= height || !covered[(size_t)ny * width + nx])
+							continue;
+						sum += m_Result[(size_t)ny * width + nx];
+						count++;
+					}
+				}
+				if (count > 0) {
+					m_Result[index] = sum / (float)count;
+					next[index] = 1;
+				}
+			}
+		}
+		covered.swap(next);
+	}
+}
+
+void LightmapBaker::Bake()
+{
+	m_Stats = LightmapStats();
+	m_Stats.threads = m_Pool.GetThreadCount();
+	m_Atlas = LightmapAtlas(m_Instances.size(), m_Settings.instanceResolution);
+
+	buildScene();
+	rasterizeTexels();
+	for (const Texel& texel : m_Texels)
+		m_Stats.texels += texel.instance != ~0u ? 1 : 0;
+
+	m_Direct.assign(m_Texels.size(), glm::vec3(0.0f));
+	m_Indirect.assign(m_Texels.size(), glm::vec3(0.0f));
+
+	// One atlas row per job, plenty of them to balance the threads
+	auto start = std::chrono::steady_clock::now();
+	std::atomic<uint64_t> rays(0);
+	m_Pool.ParallelFor((uint32_t)m_Atlas.height, [&](uint32_t row) {
+		uint64_t rowRays = 0;
+		bakeRow((int)row, rowRays);
+		rays += rowRays;
+	});
+	m_Stats.rays = rays;
+	m_Stats.traceMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	start = std::chrono::steady_clock::now();
+	denoise();
+	m_Stats.denoiseMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	m_Result.resize(m_Texels.size());
+	for (size_t i = 0; i < m_Result.size(); i++)
+		m_Result[i] = m_Direct[i] + m_Indirect[i];
+	dilate(DILATE_PASSES);
+}
+
+bool LightmapBaker::Write(const std::string& path) const
+{
+	std::ofstream file(path, std::ios::binary);
+	if (!file) {
+		std::cout << "ERROR::LIGHTMAP::FAILED_TO_WRITE " << path << std::endl;
+		return false;
+	}
+
+	// Flat (not run length encoded) RGBE scanlines, top row first
+	file << "#?RADIANCE\nFORMAT=32-bit_rle_rgbe\n\n-Y " << m_Atlas.height << " +X " << m_Atlas.width << "\n";
+	std::vector<uint8_t> scanline((size_t)m_Atlas.width * 4);
+	for (int y = m_Atlas.height - 1; y >= 0; y--) {
+		for (int x = 0; x < m_Atlas.width; x++) {
+			const glm::vec3& c = m_Result[(size_t)y * m_Atlas.width + x];
+			float largest = std::max(c.r, std::max(c.g, c.b));
+			uint8_t* rgbe = &scanline[(size_t)x * 4];
+			if (largest < 1e-32f) {
+				rgbe[0] = rgbe[1] = rgbe[2] = rgbe[3] = 0;
+				continue;
+			}
+
+			int exponent;
+			float scale = frexpf(largest, &exponent) * 256.0f / largest;
+			rgbe[0] = (uint8_t)(std::max(c.r, 0.0f) * scale);
+			rgbe[1] = (uint8_t)(std::max(c.g, 0.0f) * scale);
+			rgbe[2] = (uint8_t)(std::max(c.b, 0.0f) * scale);
+			rgbe[3] = (uint8_t)(exponent + 128);
+		}
+		file.write((const char*)scanline.data(), scanline.size());
+	}
+	return (bool)file;
+}
+
+LightmapImage DecodeLightmapImage(const std::string& path)
+{
+	LightmapImage image;
+	image.path = path;
+
+	int channels;
+	stbi_set_flip_vertically_on_load_thread(true);		// Row 0 at v = 0 like the atlas
+	float* data = stbi_loadf(path.c_str(), &image.width, &image.height, &channels, 3);
+	if (!data) {
+		std::cout << "ERROR::LIGHTMAP::FAILED_TO_LOAD " << path << std::endl;
+		return image;
+	}
+
+	image.texels.assign(data, data + (size_t)image.width * image.height * 3);
+	stbi_image_free(data);
+	return image;
+}
+
+unsigned int CreateLightmapTexture(const LightmapImage& image)
+{
+	if (image.texels.empty())
+		return 0;
+
+	unsigned int texture;
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16F, image.width, image.height, 0, GL_RGB, GL_FLOAT, image.texels.data());
+	TrackGPUMemory(GPUResource::Texture, texture, TextureBytes(GL_RGB16F, image.width, image.height), "lightmap", image.path);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	return texture;
+}
+
+unsigned int LoadLightmapTexture(const std::string& path)
+{
+	return CreateLightmapTexture(DecodeLightmapImage(path));
+}
@@ -0,0 +1,169 @@
+#pragma once
+
+#include "MeshSimplifier.h"
+#include "BVH.h"
+#include "ThreadPool.h"
+
+#include <glm/glm.hpp>
+
+// System library
+#include <vector>
+#include <string>
+#include <cstdint>
+
+struct RayPacket;
+
+// Static lights, same terms as lightingFShader.glsl minus the view dependent specular
+struct BakedDirLight
+{
+	glm::vec3 direction;	// From the light into the scene
+	glm::vec3 ambient;
+	glm::vec3 diffuse;
+};
+
+struct BakedPointLight
+{
+	glm::vec3 position;
+	glm::vec3 ambient;
+	glm::vec3 diffuse;
+	float constant, linear, quadratic;
+};
+
+struct LightmapSettings
+{
+	int instanceResolution = 64;	// Texels along each side of an instance's square in the atlas
+	int samples = 64;				// Indirect paths per texel, rounded up to a multiple of 4
+	int bounces = 2;
+	float albedo = 0.5f;			// Of every bounce surface, the textures are not read
+	int denoiseRadius = 3;			// Texels, 0 keeps the raw indirect light
+	uint32_t seed = 1;
+};
+
+struct LightmapStats
+{
+	size_t texels = 0;			// Covered by a surface, gutters not included
+	uint64_t rays = 0;			// Closest hit and shadow rays
+	double traceMs = 0.0;
+	double denoiseMs = 0.0;
+	unsigned int threads = 0;
+
+	double RaysPerSecond() const { return traceMs > 0.0 ? rays * 1000.0 / traceMs : 0.0; }
+};
+
+/*
+	Lightmap uvs for a mesh, in [0, 1] for one instance's square of resolution texels.
+	Edge connected triangles facing the same way become a flat chart, projected on its
+	plane and shelf packed at one texel density with padding texels between charts.
+	Vertices shared between charts are duplicated, so call it before GenerateLODs
+*/
+std::vector<glm::vec2> UnwrapLightmapUVs(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, int resolution, int padding = 2);
+
+// Every instance gets a square, rows of ceil(sqrt(instances)) squares
+struct LightmapAtlas
+{
+	int instanceResolution = 0;
+	int columns = 0;
+	int width = 0, height = 0;
+
+	LightmapAtlas() {}
+	LightmapAtlas(size_t instances, int instanceResolution);
+
+	// Atlas uv = lightmap uv * xy + zw
+	glm::vec4 GetScaleOffset(size_t instance) const;
+};
+
+/*
+	CPU path tracer for the lighting of static geometry.
+
+	Every texel of every instance's square is rasterised from the lightmap uvs to a
+	world position and normal. Rays go out in packets of 4 (SSE when available):
+	the shadow rays of one point to 4 lights at a time, and 4 cosine weighted
+	indirect paths of one texel, each bounce lit by next event estimation. The
+	scene is a BVH over the world space triangles, rows of the atlas are spread
+	over the thread pool.
+
+	The direct light is kept sharp, the noisy indirect light goes through a joint
+	bilateral filter guided by position and normal. Finally the gutters are
+	dilated so bilinear filtering never reads an empty texel.
+*/
+class LightmapBaker
+{
+private:
+	struct Instance
+	{
+		std::vector<glm::vec3> positions;	// World space, per vertex
+		std::vector<glm::vec3> normals;
+		std::vector<glm::vec2> uvs;			// Lightmap uvs of the mesh
+		std::vector<uint32_t> indices;
+	};
+
+	struct Texel
+	{
+		glm::vec3 position;
+		glm::vec3 normal;
+		uint32_t instance;		// ~0u for gutter texels
+	};
+
+	ThreadPool& m_Pool;
+	LightmapSettings m_Settings;
+	LightmapAtlas m_Atlas;
+
+	std::vector<Instance> m_Instances;
+	BakedDirLight m_DirLight;
+	std::vector<BakedPointLight> m_PointLights;
+
+	// Scene triangles in BVH leaf order: v0, edge 1, edge 2
+	BVH m_BVH;
+	std::vector<glm::vec3> m_TriangleV0, m_TriangleE1, m_TriangleE2;
+	std::vector<glm::vec3> m_TriangleNormals;
+
+	std::vector<Texel> m_Texels;
+	std::vector<glm::vec3> m_Direct, m_Indirect, m_Result;
+	LightmapStats m_Stats;
+
+public:
+	LightmapBaker(ThreadPool& pool, const LightmapSettings& settings = LightmapSettings());
+
+	// Triangles of indices (one LOD) with the uvs from UnwrapLightmapUVs, placed by model
+	void AddInstance(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices,
+		const std::vector<glm::vec2>& lightmapUVs, const glm::mat4& model);
+
+	void SetLights(const BakedDirLight& dirLight, const BakedPointLight* pointLights, size_t count);
+
+	// Runs every stage, the instances get their squares in the order they were added
+	void Bake();
+
+	// Radiance .hdr, the first row written is the top of the atlas (v = 1)
+	bool Write(const std::string& path) const;
+
+	// Getters
+	const LightmapAtlas& GetAtlas() const { return m_Atlas; }
+	const LightmapStats& GetStats() const { return m_Stats; }
+	const std::vector<glm::vec3>& GetTexels() const { return m_Result; }
+
+private:
+	void buildScene();
+	void rasterizeTexels();
+	void trace(RayPacket& packet, bool anyHit) const;
+	void bakeRow(int row, uint64_t& rays);
+	glm::vec3 directLight(const glm::vec3& position, const glm::vec3& normal, uint64_t& rays) const;
+	void denoise();
+	void dilate(int passes);
+};
+
+// Decoded .hdr, RGB rows with row 0 at v = 0
+struct LightmapImage
+{
+	std::string path;
+	int width = 0, height = 0;
+	std::vector<float> texels;
+};
+
+// File read and decode only, no GL: safe on any thread. Empty texels on failure
+LightmapImage DecodeLightmapImage(const std::string& path);
+
+// RGB16F texture with bilinear filtering, 0 when the image is empty
+unsigned int CreateLightmapTexture(const LightmapImage& image);
+
+// Both of the above
+unsigned int LoadLightmapTexture(const std::string& path);
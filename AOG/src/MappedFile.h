@@ -0,0 +1,34 @@
+#pragma once
+
+// System library
+#include <cstddef>
+#include <cstdint>
+
+/*
+	Read-only memory mapping of a whole file. Nothing is read up front, pages come
+	in from the OS file cache the first time they are touched.
+*/
+class MappedFile
+{
+private:
+	const uint8_t* m_Data;
+	size_t m_Size;
+#if defined(_WIN32)
+	void* m_File;
+	void* m_Mapping;
+#endif
+
+public:
+	MappedFile();
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool Open(const char* path);
+	void Close();
+
+	const uint8_t* GetData() const { return m_Data; }
+	size_t GetSize() const { return m_Size; }
+	bool IsOpen() const { return m_Data != nullptr; }
+};
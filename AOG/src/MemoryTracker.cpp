@@ -0,0 +1,286 @@
+#include "MemoryTracker.h"
+
+#include <glad/glad.h>
+
+#include <iostream>
+#include <iomanip>
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+
+#if defined(__APPLE__)
+#include <malloc/malloc.h>
+#define HEAP_BLOCK_SIZE(memory) malloc_size(memory)
+#elif defined(_WIN32)
+#include <malloc.h>
+#define HEAP_BLOCK_SIZE(memory) _msize(memory)
+#else
+#include <malloc.h>
+#define HEAP_BLOCK_SIZE(memory) malloc_usable_size(memory)
+#endif
+
+static const size_t LARGEST_LISTED = 8;		// Resources listed under the categories
+
+/*
+	Replaces the global operator new. Costs a thread local increment and two relaxed
+	atomic adds per allocation, the block size comes from the allocator.
+*/
+static thread_local size_t t_Allocations = 0;
+static std::atomic<size_t> s_HeapBytes(0), s_HeapPeak(0), s_HeapLive(0), s_HeapTotal(0);
+
+void* operator new(size_t size)
+{
+	void* memory = malloc(size ? size : 1);
+	if (!memory)
+		throw std::bad_alloc();
+
+	t_Allocations++;
+	s_HeapLive.fetch_add(1, std::memory_order_relaxed);
+	s_HeapTotal.fetch_add(1, std::memory_order_relaxed);
+	size_t block = HEAP_BLOCK_SIZE(memory);
+	size_t bytes = s_HeapBytes.fetch_add(block, std::memory_order_relaxed) + block;
+	size_t peak = s_HeapPeak.load(std::memory_order_relaxed);
+	while (bytes > peak && !s_HeapPeak.compare_exchange_weak(peak, bytes, std::memory_order_relaxed)) {}
+	return memory;
+}
+
+void* operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void operator delete(void* memory) noexcept
+{
+	if (!memory)
+		return;
+
+	s_HeapLive.fetch_sub(1, std::memory_order_relaxed);
+	s_HeapBytes.fetch_sub(HEAP_BLOCK_SIZE(memory), std::memory_order_relaxed);
+	free(memory);
+}
+
+void operator delete[](void* memory) noexcept
+{
+	operator delete(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept
+{
+	operator delete(memory);
+}
+
+void operator delete[](void* memory, size_t) noexcept
+{
+	operator delete(memory);
+}
+
+size_t GetThreadAllocationCount()
+{
+	return t_Allocations;
+}
+
+/*
+	GPU resources
+*/
+struct GPUAllocation
+{
+	GPUResource type;
+	unsigned int name;
+	size_t bytes;
+	const char* category;
+	std::string owner;
+};
+
+struct CategoryTotals
+{
+	size_t bytes, count, peakBytes;
+};
+
+static std::mutex s_GPUMutex;
+static std::unordered_map<uint64_t, GPUAllocation> s_GPU;	// By type and name
+static std::unordered_map<std::string, CategoryTotals> s_Categories;
+static size_t s_GPUBytes = 0, s_GPUPeak = 0;
+
+static uint64_t resourceKey(GPUResource type, unsigned int name)
+{
+	return ((uint64_t)type << 32) | name;
+}
+
+static const char* typeName(GPUResource type)
+{
+	switch (type) {
+	case GPUResource::Buffer: return "buffer";
+	case GPUResource::Texture: return "texture";
+	case GPUResource::Renderbuffer: return "renderbuffer";
+	default: return "program";
+	}
+}
+
+static void untrack(uint64_t key)
+{
+	auto found = s_GPU.find(key);
+	if (found == s_GPU.end())
+		return;
+
+	CategoryTotals& totals = s_Categories[found->second.category];
+	totals.bytes -= found->second.bytes;
+	totals.count--;
+	s_GPUBytes -= found->second.bytes;
+	s_GPU.erase(found);
+}
+
+void TrackGPUMemory(GPUResource type, unsigned int name, size_t bytes, const char* category, const std::string& owner)
+{
+	if (!name)
+		return;
+
+	std::lock_guard<std::mutex> lock(s_GPUMutex);
+	uint64_t key = resourceKey(type, name);
+	untrack(key);
+
+	GPUAllocation& allocation = s_GPU[key];
+	allocation.type = type;
+	allocation.name = name;
+	allocation.bytes = bytes;
+	allocation.category = category;
+	allocation.owner = owner;
+
+	CategoryTotals& totals = s_Categories[category];
+	totals.bytes += bytes;
+	totals.count++;
+	totals.peakBytes = std::max(totals.peakBytes, totals.bytes);
+	s_GPUBytes += bytes;
+	s_GPUPeak = std::max(s_GPUPeak, s_GPUBytes);
+}
+
+void UntrackGPUMemory(GPUResource type, unsigned int name)
+{
+	std::lock_guard<std::mutex> lock(s_GPUMutex);
+	untrack(resourceKey(type, name));
+}
+
+static size_t texelBytes(GLenum internalFormat)
+{
+	switch (internalFormat) {
+	case GL_R8: case GL_R8I: case GL_R8UI: case GL_STENCIL_INDEX8:
+		return 1;
+	case GL_RG8: case GL_R16F: case GL_R16I: case GL_R16UI: case GL_DEPTH_COMPONENT16:
+		return 2;
+	case GL_RGBA16F: case GL_RG32F: case GL_RGBA16I: case GL_RGBA16UI: case GL_RG32I: case GL_RG32UI:
+	case GL_RGB16F: case GL_DEPTH32F_STENCIL8:	// RGB padded to RGBA like drivers do
+		return 8;
+	case GL_RGBA32F: case GL_RGBA32I: case GL_RGBA32UI: case GL_RGB32F: case GL_RGB32I: case GL_RGB32UI:
+		return 16;
+	default:	// RGBA8, RGB8 (padded), RGB10_A2, R11F_G11F_B10F, R32F, depth 24 and 32
+		return 4;
+	}
+}
+
+size_t TextureBytes(unsigned int internalFormat, int width, int height, int depth, bool mipmapped)
+{
+	size_t bytes = 0;
+	size_t texel = texelBytes(internalFormat);
+	for (;;) {
+		bytes += (size_t)std::max(width, 1) * std::max(height, 1) * texel * std::max(depth, 1);
+		if (!mipmapped || (width <= 1 && height <= 1))
+			return bytes;
+		width /= 2;
+		height /= 2;
+	}
+}
+
+MemorySnapshot GetMemorySnapshot()
+{
+	MemorySnapshot snapshot;
+	{
+		std::lock_guard<std::mutex> lock(s_GPUMutex);
+		for (const auto& category : s_Categories)
+			snapshot.gpu.push_back({ category.first, category.second.bytes, category.second.count, category.second.peakBytes });
+		snapshot.gpuBytes = s_GPUBytes;
+		snapshot.gpuPeakBytes = s_GPUPeak;
+		snapshot.gpuCount = s_GPU.size();
+	}
+	std::sort(snapshot.gpu.begin(), snapshot.gpu.end(), [](const MemoryCategory& a, const MemoryCategory& b) {
+		return a.bytes != b.bytes ? a.bytes > b.bytes : a.name < b.name;
+	});
+
+	snapshot.heapBytes = s_HeapBytes.load(std::memory_order_relaxed);
+	snapshot.heapPeakBytes = s_HeapPeak.load(std::memory_order_relaxed);
+	snapshot.heapLive = s_HeapLive.load(std::memory_order_relaxed);
+	snapshot.heapTotal = s_HeapTotal.load(std::memory_order_relaxed);
+	return snapshot;
+}
+
+static double megabytes(size_t bytes)
+{
+	return bytes / (1024.0 * 1024.0);
+}
+
+static void printResource(const GPUAllocation& allocation)
+{
+	std::cout << std::setw(10) << megabytes(allocation.bytes) << " MB  " << allocation.category << ", " << typeName(allocation.type)
+		<< " " << allocation.name;
+	if (!allocation.owner.empty())
+		std::cout << " (" << allocation.owner << ")";
+	std::cout << std::endl;
+}
+
+void PrintMemoryReport()
+{
+	MemorySnapshot snapshot = GetMemorySnapshot();
+	std::cout << std::fixed << std::setprecision(2);
+	std::cout << "Memory: GPU " << megabytes(snapshot.gpuBytes) << " MB in " << snapshot.gpuCount << " resources (peak "
+		<< megabytes(snapshot.gpuPeakBytes) << " MB), heap " << megabytes(snapshot.heapBytes) << " MB in " << snapshot.heapLive
+		<< " allocations (peak " << megabytes(snapshot.heapPeakBytes) << " MB, " << snapshot.heapTotal << " made)" << std::endl;
+
+	std::cout << "  " << std::left << std::setw(24) << "category" << std::right << std::setw(10) << "MB" << std::setw(8) << "count"
+		<< std::setw(10) << "peak MB" << std::endl;
+	for (const MemoryCategory& category : snapshot.gpu) {
+		std::cout << "  " << std::left << std::setw(24) << category.name << std::right << std::setw(10) << megabytes(category.bytes)
+			<< std::setw(8) << category.count << std::setw(10) << megabytes(category.peakBytes) << std::endl;
+	}
+
+	std::vector<GPUAllocation> largest;
+	{
+		std::lock_guard<std::mutex> lock(s_GPUMutex);
+		for (const auto& resource : s_GPU)
+			largest.push_back(resource.second);
+	}
+	std::sort(largest.begin(), largest.end(), [](const GPUAllocation& a, const GPUAllocation& b) { return a.bytes > b.bytes; });
+	largest.resize(std::min(largest.size(), LARGEST_LISTED));
+	std::cout << "  largest:" << std::endl;
+	for (const GPUAllocation& allocation : largest) {
+		std::cout << "  ";
+		printResource(allocation);
+	}
+	std::cout << std::defaultfloat << std::setprecision(6);
+}
+
+size_t ReportMemoryLeaks()
+{
+	std::vector<GPUAllocation> left;
+	{
+		std::lock_guard<std::mutex> lock(s_GPUMutex);
+		for (const auto& resource : s_GPU)
+			left.push_back(resource.second);
+	}
+	std::sort(left.begin(), left.end(), [](const GPUAllocation& a, const GPUAllocation& b) {
+		return a.owner != b.owner ? a.owner < b.owner : a.name < b.name;
+	});
+
+	size_t bytes = 0;
+	std::cout << std::fixed << std::setprecision(2);
+	for (const GPUAllocation& allocation : left) {
+		std::cout << "ERROR::MEMORY::GPU_LEAK ";
+		printResource(allocation);
+		bytes += allocation.bytes;
+	}
+	std::cout << "Memory at shutdown: " << left.size() << " GPU resources left (" << megabytes(bytes) << " MB), heap "
+		<< megabytes(s_HeapBytes.load(std::memory_order_relaxed)) << " MB in " << s_HeapLive.load(std::memory_order_relaxed)
+		<< " allocations" << std::endl;
+	std::cout << std::defaultfloat << std::setprecision(6);
+	return left.size();
+}
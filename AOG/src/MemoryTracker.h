@@ -0,0 +1,63 @@
+#pragma once
+
+// System library
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/*
+	Memory accounting: GPU buffers, textures, renderbuffers and programs as the code
+	creating them reports them, with a category and an owner tag, and the CPU heap
+	through the global operator new.
+
+	GPU sizes are what was asked for: width * height * bytes per texel (mip chain
+	included) or the buffer size, drivers add their own padding and alignment. Programs
+	are counted without a size, GL 3.3 has no way to ask for one. The heap is counted
+	with the size the allocator really handed out.
+
+	Tracking a name again replaces its entry, so buffers reallocated every frame are
+	fine. Any thread.
+*/
+
+enum class GPUResource
+{
+	Buffer,
+	Texture,
+	Renderbuffer,
+	Program
+};
+
+// category must be a literal (it is kept as is), owner is copied: a path, a pass, a class
+void TrackGPUMemory(GPUResource type, unsigned int name, size_t bytes, const char* category, const std::string& owner = std::string());
+void UntrackGPUMemory(GPUResource type, unsigned int name);
+
+// Bytes of a texture in internalFormat, with its mip chain down to 1x1 when mipmapped
+size_t TextureBytes(unsigned int internalFormat, int width, int height, int depth = 1, bool mipmapped = false);
+
+struct MemoryCategory
+{
+	std::string name;
+	size_t bytes;
+	size_t count;
+	size_t peakBytes;
+};
+
+struct MemorySnapshot
+{
+	std::vector<MemoryCategory> gpu;	// Largest first
+	size_t gpuBytes, gpuPeakBytes, gpuCount;
+	size_t heapBytes, heapPeakBytes;
+	size_t heapLive;		// Allocations not freed yet
+	size_t heapTotal;		// Allocations ever made
+};
+
+MemorySnapshot GetMemorySnapshot();
+
+// The snapshot by category, with the largest resources
+void PrintMemoryReport();
+
+// Every GPU resource still tracked, by owner. Call at shutdown with the context still current, returns how many
+size_t ReportMemoryLeaks();
+
+// Heap allocations made by the calling thread so far
+size_t GetThreadAllocationCount();
@@ -0,0 +1,179 @@
+#include "Mesh.h"
+#include "MemoryTracker.h"
+
+#include <cstddef>
+#include <cstring>
+#include <unordered_map>
+#include <string>
+
+Mesh::Mesh(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices)
+	: VAO(0), VBO(0), EBO(0), depthVAO(0), positionVBO(0), lightmapVBO(0), vertices(vertices), indices(indices), m_BoundingRadius(0.0f)
+{
+	lods.push_back({ 0, (uint32_t)indices.size(), 0.0f });
+
+	for (const Vertex& v : vertices)
+		m_BoundingRadius = glm::max(m_BoundingRadius, glm::length(v.position));
+}
+
+Mesh::~Mesh()
+{
+	if (VAO) {
+		UntrackGPUMemory(GPUResource::Buffer, VBO);
+		UntrackGPUMemory(GPUResource::Buffer, EBO);
+		UntrackGPUMemory(GPUResource::Buffer, positionVBO);
+		glDeleteVertexArrays(1, &VAO);
+		glDeleteBuffers(1, &VBO);
+		glDeleteBuffers(1, &EBO);
+		glDeleteVertexArrays(1, &depthVAO);
+		glDeleteBuffers(1, &positionVBO);
+	}
+	if (lightmapVBO) {
+		UntrackGPUMemory(GPUResource::Buffer, lightmapVBO);
+		glDeleteBuffers(1, &lightmapVBO);
+	}
+}
+
+std::vector<Vertex> Mesh::FromInterleaved(const float* data, size_t vertexCount, std::vector<uint32_t>& indices)
+{
+	std::vector<Vertex> vertices;
+	std::unordered_map<std::string, uint32_t> unique;
+	indices.clear();
+
+	for (size_t i = 0; i < vertexCount; i++) {
+		const float* v = data + i * 8;
+		std::string key((const char*)v, sizeof(float) * 8);
+
+		auto it = unique.find(key);
+		if (it == unique.end()) {
+			Vertex vertex;
+			vertex.position = glm::vec3(v[0], v[1], v[2]);
+			vertex.normal = glm::vec3(v[3], v[4], v[5]);
+			vertex.texCoords = glm::vec2(v[6], v[7]);
+
+			it = unique.emplace(key, (uint32_t)vertices.size()).first;
+			vertices.push_back(vertex);
+		}
+		indices.push_back(it->second);
+	}
+
+	return vertices;
+}
+
+void Mesh::GenerateLODs(int maxLevels, float ratio, float maxError)
+{
+	for (int level = 1; level < maxLevels; level++) {
+		const MeshLOD& previous = lods.back();
+		std::vector<uint32_t> source(indices.begin() + previous.indexOffset,
+			indices.begin() + previous.indexOffset + previous.indexCount);
+
+		size_t target = (size_t)(previous.indexCount * ratio) / 3 * 3;
+		float error = 0.0f;
+		std::vector<uint32_t> simplified = SimplifyMesh(vertices, source, target, maxError, error);
+
+		// Less than 10% saved, further levels would just waste memory
+		if (simplified.empty() || simplified.size() > previous.indexCount * 9 / 10)
+			break;
+
+		// Errors add up since each level is simplified from the one before
+		MeshLOD lod = { (uint32_t)indices.size(), (uint32_t)simplified.size(), previous.error + error };
+		indices.insert(indices.end(), simplified.begin(), simplified.end());
+		lods.push_back(lod);
+	}
+}
+
+void Mesh::Upload()
+{
+	glGenVertexArrays(1, &VAO);
+	glGenBuffers(1, &VBO);
+	glGenBuffers(1, &EBO);
+
+	glBindVertexArray(VAO);
+
+	glBindBuffer(GL_ARRAY_BUFFER, VBO);
+	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), vertices.data(), GL_STATIC_DRAW);
+	TrackGPUMemory(GPUResource::Buffer, VBO, vertices.size() * sizeof(Vertex), "mesh");
+
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(uint32_t), indices.data(), GL_STATIC_DRAW);
+	TrackGPUMemory(GPUResource::Buffer, EBO, indices.size() * sizeof(uint32_t), "mesh");
+
+	// position attribute
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, position));
+	glEnableVertexAttribArray(0);
+
+	// normal attribute
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, normal));
+	glEnableVertexAttribArray(1);
+
+	// texture attribute
+	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, texCoords));
+	glEnableVertexAttribArray(2);
+
+	// lightmap uv attribute, a buffer of its own so meshes without one keep the plain layout
+	if (!lightmapUVs.empty() && lightmapUVs.size() == vertices.size()) {
+		glGenBuffers(1, &lightmapVBO);
+		glBindBuffer(GL_ARRAY_BUFFER, lightmapVBO);
+		glBufferData(GL_ARRAY_BUFFER, lightmapUVs.size() * sizeof(glm::vec2), lightmapUVs.data(), GL_STATIC_DRAW);
+		TrackGPUMemory(GPUResource::Buffer, lightmapVBO, lightmapUVs.size() * sizeof(glm::vec2), "mesh", "lightmap uvs");
+		glVertexAttribPointer(4, 2, GL_FLOAT, GL_FALSE, sizeof(glm::vec2), (void*)0);
+		glEnableVertexAttribArray(4);
+	}
+
+	// Tightly packed positions for depth only passes, a third of the vertex fetch
+	std::vector<glm::vec3> positions(vertices.size());
+	for (size_t i = 0; i < vertices.size(); i++)
+		positions[i] = vertices[i].position;
+
+	glGenVertexArrays(1, &depthVAO);
+	glGenBuffers(1, &positionVBO);
+
+	glBindVertexArray(depthVAO);
+
+	glBindBuffer(GL_ARRAY_BUFFER, positionVBO);
+	glBufferData(GL_ARRAY_BUFFER, positions.size() * sizeof(glm::vec3), positions.data(), GL_STATIC_DRAW);
+	TrackGPUMemory(GPUResource::Buffer, positionVBO, positions.size() * sizeof(glm::vec3), "mesh", "depth positions");
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);
+	glEnableVertexAttribArray(0);
+
+	glBindVertexArray(0);
+}
+
+void Mesh::Draw(int lod) const
+{
+	const MeshLOD& level = lods[lod];
+
+	glBindVertexArray(VAO);
+	glDrawElements(GL_TRIANGLES, level.indexCount, GL_UNSIGNED_INT, (void*)(level.indexOffset * sizeof(uint32_t)));
+}
+
+void Mesh::DrawDepth(int lod) const
+{
+	const MeshLOD& level = lods[lod];
+
+	glBindVertexArray(depthVAO);
+	glDrawElements(GL_TRIANGLES, level.indexCount, GL_UNSIGNED_INT, (void*)(level.indexOffset * sizeof(uint32_t)));
+}
+
+int Mesh::SelectLOD(float distance, float projectionScale, float maxPixelError, int currentLOD, float hysteresis) const
+{
+	// Inside the bounds, always full detail
+	if (distance <= m_BoundingRadius)
+		return 0;
+
+	float pixelsPerUnit = projectionScale / distance;
+	int lodCount = (int)lods.size();
+	currentLOD = glm::clamp(currentLOD, 0, lodCount - 1);
+
+	// Refine straight away when the current level got too coarse
+	while (currentLOD > 0 && lods[currentLOD].error * pixelsPerUnit > maxPixelError)
+		currentLOD--;
+
+	// Coarsen only with some margin below the threshold
+	float coarsenThreshold = maxPixelError * (1.0f - hysteresis);
+	while (currentLOD + 1 < lodCount && lods[currentLOD + 1].error * pixelsPerUnit <= coarsenThreshold)
+		currentLOD++;
+
+	return currentLOD;
+}
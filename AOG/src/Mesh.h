@@ -0,0 +1,70 @@
+#pragma once
+
+#include "MeshSimplifier.h"
+
+// Third Party library
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+// System library
+#include <vector>
+#include <cstdint>
+
+/*
+	Index range of one level of detail inside the shared index buffer. Every level
+	uses the same vertex buffer, only the triangle list changes.
+*/
+struct MeshLOD
+{
+	uint32_t indexOffset;
+	uint32_t indexCount;
+	float error;			// Object space deviation from LOD 0
+};
+
+class Mesh
+{
+public:
+	unsigned int VAO, VBO, EBO;
+	unsigned int depthVAO, positionVBO;	// Positions only, for depth passes
+	unsigned int lightmapVBO;			// Attribute 4 when the mesh has lightmap uvs
+
+	std::vector<Vertex> vertices;
+	std::vector<uint32_t> indices;		// All LODs back to back
+	std::vector<MeshLOD> lods;
+	std::vector<glm::vec2> lightmapUVs;	// One per vertex (UnwrapLightmapUVs) or empty
+
+	Mesh(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices);
+	~Mesh();
+
+	Mesh(const Mesh&) = delete;
+	Mesh& operator=(const Mesh&) = delete;
+
+	// Interleaved position/normal/uv floats (like the sandbox cube), duplicates are merged
+	static std::vector<Vertex> FromInterleaved(const float* data, size_t vertexCount, std::vector<uint32_t>& indices);
+
+	// Append coarser levels, each with about 'ratio' of the previous triangle count.
+	// Stops early once a level no longer gets meaningfully smaller
+	void GenerateLODs(int maxLevels = 4, float ratio = 0.5f, float maxError = 1e30f);
+
+	// Create the GL buffers; call after GenerateLODs
+	void Upload();
+
+	void Draw(int lod = 0) const;
+	void DrawDepth(int lod = 0) const;
+
+	/*
+		Pick the coarsest level whose error projected on screen stays below maxPixelError.
+		projectionScale is pixels per world unit at distance 1 (see Camera::GetProjectionScale).
+		The current level is only given up for a coarser one once it is comfortably
+		under budget (hysteresis), so objects sitting on a threshold don't flicker
+	*/
+	int SelectLOD(float distance, float projectionScale, float maxPixelError, int currentLOD, float hysteresis = 0.25f) const;
+
+	// Getters
+	int GetLODCount() const { return (int)lods.size(); }
+	uint32_t GetTriangleCount(int lod) const { return lods[lod].indexCount / 3; }
+	float GetBoundingRadius() const { return m_BoundingRadius; }
+
+private:
+	float m_BoundingRadius;
+};
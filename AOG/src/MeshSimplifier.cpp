@@ -0,0 +1,308 @@
+#include "MeshSimplifier.h"
+
+#include <algorithm>
+#include <unordered_map>
+#include <cstring>
+#include <cmath>
+
+// Symmetric 4x4 matrix, upper triangle only
+struct Quadric
+{
+	double a00, a01, a02, a03, a11, a12, a13, a22, a23, a33;
+	double weight;		// Sum of plane weights, turns the cost back into a distance
+
+	Quadric() { memset(this, 0, sizeof(Quadric)); }
+
+	void AddPlane(double a, double b, double c, double d, double w)
+	{
+		a00 += w * a * a; a01 += w * a * b; a02 += w * a * c; a03 += w * a * d;
+		a11 += w * b * b; a12 += w * b * c; a13 += w * b * d;
+		a22 += w * c * c; a23 += w * c * d;
+		a33 += w * d * d;
+		weight += w;
+	}
+
+	void Add(const Quadric& q)
+	{
+		a00 += q.a00; a01 += q.a01; a02 += q.a02; a03 += q.a03;
+		a11 += q.a11; a12 += q.a12; a13 += q.a13;
+		a22 += q.a22; a23 += q.a23;
+		a33 += q.a33;
+		weight += q.weight;
+	}
+
+	// v^T Q v with v = (p, 1)
+	double Evaluate(const glm::vec3& p) const
+	{
+		double x = p.x, y = p.y, z = p.z;
+		return a00 * x * x + 2.0 * a01 * x * y + 2.0 * a02 * x * z + 2.0 * a03 * x
+			+ a11 * y * y + 2.0 * a12 * y * z + 2.0 * a13 * y
+			+ a22 * z * z + 2.0 * a23 * z
+			+ a33;
+	}
+
+	// Weighted mean squared distance to the accumulated planes
+	double Error(const glm::vec3& p) const
+	{
+		return weight > 0.0 ? glm::max(Evaluate(p), 0.0) / weight : 0.0;
+	}
+};
+
+struct Collapse
+{
+	uint32_t from, to;
+	double cost;
+};
+
+// Border edges get a plane through the edge perpendicular to the surface, weighted
+// heavily so open boundaries don't shrink away
+static const double BORDER_WEIGHT = 10.0;
+
+// Reject collapses that rotate a neighbouring triangle by more than ~78 degrees
+static const float FLIP_THRESHOLD = 0.2f;
+
+static uint64_t edgeKey(uint32_t a, uint32_t b)
+{
+	return a < b ? ((uint64_t)a << 32) | b : ((uint64_t)b << 32) | a;
+}
+
+struct PositionHash
+{
+	size_t operator()(const glm::vec3& p) const
+	{
+		uint32_t h[3];
+		memcpy(h, &p, sizeof(h));
+		return (h[0] * 73856093u) ^ (h[1] * 19349663u) ^ (h[2] * 83492791u);
+	}
+};
+
+std::vector<uint32_t> SimplifyMesh(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices,
+	size_t targetIndexCount, float maxError, float& error)
+{
+	error = 0.0f;
+	const size_t vertexCount = vertices.size();
+
+	// 1) Weld by position; w is the welded id, positions[w] its location
+	std::vector<uint32_t> weld(vertexCount);
+	std::vector<glm::vec3> positions;
+	{
+		std::unordered_map<glm::vec3, uint32_t, PositionHash> lookup;
+		for (size_t i = 0; i < vertexCount; i++) {
+			auto it = lookup.find(vertices[i].position);
+			if (it == lookup.end()) {
+				it = lookup.emplace(vertices[i].position, (uint32_t)positions.size()).first;
+				positions.push_back(vertices[i].position);
+			}
+			weld[i] = it->second;
+		}
+	}
+	const size_t weldedCount = positions.size();
+
+	// Triangles in both index spaces, kept side by side
+	std::vector<uint32_t> original(indices);
+	std::vector<uint32_t> welded(indices.size());
+	for (size_t i = 0; i < indices.size(); i++)
+		welded[i] = weld[indices[i]];
+
+	// 2) Quadrics from the area weighted triangle planes plus border constraints
+	std::vector<Quadric> quadrics(weldedCount);
+	std::unordered_map<uint64_t, int> edgeUse;
+	for (size_t t = 0; t + 2 < welded.size(); t += 3) {
+		const glm::vec3& p0 = positions[welded[t]];
+		const glm::vec3& p1 = positions[welded[t + 1]];
+		const glm::vec3& p2 = positions[welded[t + 2]];
+		glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+		float length = glm::length(n);
+		if (length <= 0.0f)
+			continue;
+
+		n /= length;
+		double area = 0.5 * length;
+		double d = -glm::dot(n, p0);
+		for (int k = 0; k < 3; k++) {
+			quadrics[welded[t + k]].AddPlane(n.x, n.y, n.z, d, area);
+			edgeUse[edgeKey(welded[t + k], welded[t + (k + 1) % 3])]++;
+		}
+	}
+
+	for (size_t t = 0; t + 2 < welded.size(); t += 3) {
+		const glm::vec3& p0 = positions[welded[t]];
+		const glm::vec3& p1 = positions[welded[t + 1]];
+		const glm::vec3& p2 = positions[welded[t + 2]];
+		glm::vec3 faceNormal = glm::cross(p1 - p0, p2 - p0);
+
+		for (int k = 0; k < 3; k++) {
+			uint32_t a = welded[t + k], b = welded[t + (k + 1) % 3];
+			if (edgeUse[edgeKey(a, b)] != 1)
+				continue;
+
+			glm::vec3 edge = positions[b] - positions[a];
+			glm::vec3 n = glm::cross(edge, faceNormal);
+			float length = glm::length(n);
+			if (length <= 0.0f)
+				continue;
+
+			n /= length;
+			double d = -glm::dot(n, positions[a]);
+			double weight = BORDER_WEIGHT * glm::dot(edge, edge);
+			quadrics[a].AddPlane(n.x, n.y, n.z, d, weight);
+			quadrics[b].AddPlane(n.x, n.y, n.z, d, weight);
+		}
+	}
+
+	// 3) Greedy passes: cheapest collapses first, each vertex touched at most once per pass
+	std::vector<uint32_t> collapseTo(weldedCount);
+	for (size_t w = 0; w < weldedCount; w++)
+		collapseTo[w] = (uint32_t)w;
+
+	const double maxCost = (double)maxError * maxError;
+	std::vector<Collapse> collapses;
+	std::vector<uint64_t> edges;
+	std::vector<uint8_t> locked(weldedCount);
+	std::vector<uint32_t> adjacencyOffsets(weldedCount + 1);
+	std::vector<uint32_t> adjacency;
+
+	while (welded.size() > targetIndexCount) {
+		// Vertex -> triangle adjacency of the current mesh
+		std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+		for (uint32_t w : welded)
+			adjacencyOffsets[w + 1]++;
+		for (size_t w = 0; w < weldedCount; w++)
+			adjacencyOffsets[w + 1] += adjacencyOffsets[w];
+		adjacency.resize(welded.size());
+		{
+			std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+			for (size_t i = 0; i < welded.size(); i++)
+				adjacency[fill[welded[i]]++] = (uint32_t)(i / 3);
+		}
+
+		// Unique edges of the current mesh
+		edges.clear();
+		for (size_t t = 0; t + 2 < welded.size(); t += 3) {
+			for (int k = 0; k < 3; k++)
+				edges.push_back(edgeKey(welded[t + k], welded[t + (k + 1) % 3]));
+		}
+		std::sort(edges.begin(), edges.end());
+		edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+		// Candidate collapses, each edge in its cheaper direction
+		collapses.clear();
+		for (uint64_t edge : edges) {
+			uint32_t a = (uint32_t)(edge >> 32), b = (uint32_t)edge;
+
+			Quadric q = quadrics[a];
+			q.Add(quadrics[b]);
+			double costAB = q.Error(positions[b]);
+			double costBA = q.Error(positions[a]);
+			if (costAB <= costBA)
+				collapses.push_back({ a, b, costAB });
+			else
+				collapses.push_back({ b, a, costBA });
+		}
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse& l, const Collapse& r) { return l.cost < r.cost; });
+
+		std::fill(locked.begin(), locked.end(), 0);
+		size_t remaining = welded.size();
+		size_t performed = 0;
+
+		for (const Collapse& c : collapses) {
+			if (remaining <= targetIndexCount || c.cost > maxCost)
+				break;
+			if (locked[c.from] || locked[c.to])
+				continue;
+
+			// Moving 'from' onto 'to' must not fold any of the surrounding triangles over
+			bool flips = false;
+			size_t removedTriangles = 0;
+			for (uint32_t a = adjacencyOffsets[c.from]; a < adjacencyOffsets[c.from + 1] && !flips; a++) {
+				const uint32_t* tri = &welded[adjacency[a] * 3];
+				if (tri[0] == c.to || tri[1] == c.to || tri[2] == c.to) {
+					removedTriangles++;
+					continue;
+				}
+
+				glm::vec3 p[3], q[3];
+				for (int k = 0; k < 3; k++) {
+					p[k] = positions[tri[k]];
+					q[k] = tri[k] == c.from ? positions[c.to] : p[k];
+				}
+				glm::vec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+				glm::vec3 after = glm::cross(q[1] - q[0], q[2] - q[0]);
+				float lengths = glm::length(before) * glm::length(after);
+				flips = lengths <= 0.0f || glm::dot(before, after) < FLIP_THRESHOLD * lengths;
+			}
+			if (flips)
+				continue;
+
+			// Lock the whole one-ring so later collapses this pass see valid adjacency
+			for (uint32_t a = adjacencyOffsets[c.from]; a < adjacencyOffsets[c.from + 1]; a++) {
+				const uint32_t* tri = &welded[adjacency[a] * 3];
+				locked[tri[0]] = locked[tri[1]] = locked[tri[2]] = 1;
+			}
+
+			collapseTo[c.from] = c.to;
+			quadrics[c.to].Add(quadrics[c.from]);
+			error = glm::max(error, (float)sqrt(c.cost));
+			remaining -= removedTriangles * 3;
+			performed++;
+		}
+
+		if (performed == 0)
+			break;
+
+		// Apply this pass' collapses and drop triangles that became degenerate
+		size_t write = 0;
+		for (size_t t = 0; t + 2 < welded.size(); t += 3) {
+			uint32_t w[3];
+			for (int k = 0; k < 3; k++)
+				w[k] = collapseTo[welded[t + k]];
+			if (w[0] == w[1] || w[1] == w[2] || w[2] == w[0])
+				continue;
+
+			for (int k = 0; k < 3; k++) {
+				welded[write + k] = w[k];
+				original[write + k] = original[t + k];
+			}
+			write += 3;
+		}
+		welded.resize(write);
+		original.resize(write);
+	}
+
+	// 4) Back to real vertices: keep the original where it still exists, otherwise pick
+	// the vertex at the new location whose normal matches best (keeps hard edges sharp)
+	std::vector<uint32_t> classOffsets(weldedCount + 1, 0);
+	std::vector<uint32_t> classMembers(vertexCount);
+	for (size_t i = 0; i < vertexCount; i++)
+		classOffsets[weld[i] + 1]++;
+	for (size_t w = 0; w < weldedCount; w++)
+		classOffsets[w + 1] += classOffsets[w];
+	{
+		std::vector<uint32_t> fill(classOffsets.begin(), classOffsets.end() - 1);
+		for (size_t i = 0; i < vertexCount; i++)
+			classMembers[fill[weld[i]]++] = (uint32_t)i;
+	}
+
+	std::vector<uint32_t> result(welded.size());
+	for (size_t i = 0; i < welded.size(); i++) {
+		uint32_t source = original[i];
+		uint32_t target = welded[i];
+		if (weld[source] == target) {
+			result[i] = source;
+			continue;
+		}
+
+		uint32_t best = classMembers[classOffsets[target]];
+		float bestDot = -2.0f;
+		for (uint32_t m = classOffsets[target]; m < classOffsets[target + 1]; m++) {
+			float d = glm::dot(vertices[classMembers[m]].normal, vertices[source].normal);
+			if (d > bestDot) {
+				bestDot = d;
+				best = classMembers[m];
+			}
+		}
+		result[i] = best;
+	}
+
+	return result;
+}
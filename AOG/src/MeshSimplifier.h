@@ -0,0 +1,28 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+// System library
+#include <vector>
+#include <cstdint>
+
+struct Vertex
+{
+	glm::vec3 position;
+	glm::vec3 normal;
+	glm::vec2 texCoords;
+};
+
+/*
+	Quadric error metric simplification (Garland & Heckbert) by edge collapse.
+
+	Vertices are never moved or created: every collapse snaps one end of an edge
+	onto the other, so the result is just a new index list over the same vertex
+	buffer and all LODs of a mesh can share one VBO. Vertices that only differ in
+	normal/uv (hard edges, uv seams) are welded by position while simplifying.
+
+	Returns the new indices; error receives the largest collapse error in object
+	space units (roughly the distance the surface moved).
+*/
+std::vector<uint32_t> SimplifyMesh(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices,
+	size_t targetIndexCount, float maxError, float& error);
@@ -0,0 +1,289 @@
+#include "MicroBenchmark.h"
+#include "MemoryTracker.h"
+#include "OffscreenContext.h"
+#include "Shader.h"
+#include "Texture.h"
+#include "Camera.h"
+#include "Scene.h"
+
+#include <glm/gtc/quaternion.hpp>
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <functional>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+static const int SAMPLES = 31;				// Batches timed per benchmark
+static const double BATCH_MS = 1.0;			// Calls are batched until a batch takes this long
+static const double MIN_CHANGE = 0.05;		// Smallest change a comparison reports
+
+struct MicroResult
+{
+	std::string name;
+	double medianNs, madNs, minNs;
+	double allocations;		// Per call
+	size_t batch;
+};
+
+// Keeps the compiler from dropping a result nothing reads
+static const void* volatile s_Escape = nullptr;
+
+template <typename T>
+static void keep(const T& value)
+{
+	s_Escape = &value;
+	std::atomic_signal_fence(std::memory_order_seq_cst);
+}
+
+static double median(std::vector<double> values)
+{
+	std::sort(values.begin(), values.end());
+	size_t n = values.size();
+	return n == 0 ? 0.0 : n % 2 ? values[n / 2] : 0.5 * (values[n / 2 - 1] + values[n / 2]);
+}
+
+// body(n) makes n calls
+static MicroResult measure(const char* name, const std::function<void(size_t)>& body)
+{
+	typedef std::chrono::steady_clock Clock;
+	auto timeBatch = [&](size_t n) {
+		auto start = Clock::now();
+		body(n);
+		return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+	};
+
+	// Grow the batch until it is long enough for the clock, the last one doubles as the warm up
+	size_t batch = 1;
+	for (double ns = timeBatch(batch); ns < BATCH_MS * 1.0e6 && batch < ((size_t)1 << 30); ns = timeBatch(batch)) {
+		double scale = ns > 0.0 ? BATCH_MS * 1.0e6 / ns * 1.2 : 10.0;
+		batch = (size_t)std::ceil(batch * std::min(std::max(scale, 1.5), 10.0));
+	}
+
+	std::vector<double> perCall;
+	perCall.reserve(SAMPLES);	// Its own allocations would be counted otherwise
+	size_t allocations = 0;
+	for (int s = 0; s < SAMPLES; s++) {
+		size_t before = GetThreadAllocationCount();
+		perCall.push_back(timeBatch(batch) / batch);
+		allocations += GetThreadAllocationCount() - before;
+	}
+
+	MicroResult result;
+	result.name = name;
+	result.medianNs = median(perCall);
+	std::vector<double> deviations;
+	for (double ns : perCall)
+		deviations.push_back(std::fabs(ns - result.medianNs));
+	result.madNs = median(deviations);
+	result.minNs = *std::min_element(perCall.begin(), perCall.end());
+	result.allocations = (double)allocations / ((double)SAMPLES * batch);
+	result.batch = batch;
+
+	std::cout << "  " << std::left << std::setw(44) << name << std::right << std::fixed << std::setprecision(1)
+		<< std::setw(12) << result.medianNs << " ns +- " << std::setw(8) << result.madNs << "  min " << std::setw(10) << result.minNs
+		<< std::setprecision(2) << "  allocs " << std::setw(6) << result.allocations << "  (" << batch << " per batch)" << std::endl;
+	std::cout << std::defaultfloat << std::setprecision(6);
+	return result;
+}
+
+static bool saveResults(const char* path, const std::vector<MicroResult>& results)
+{
+	std::ofstream file(path);
+	if (!file) {
+		std::cout << "ERROR::MICRO_BENCHMARK::CANNOT_WRITE " << path << std::endl;
+		return false;
+	}
+
+	file << "# name\tmedian ns\tmad ns\tallocations per call\n";
+	for (const MicroResult& r : results)
+		file << r.name << "\t" << r.medianNs << "\t" << r.madNs << "\t" << r.allocations << "\n";
+	return true;
+}
+
+static bool loadResults(const char* path, std::unordered_map<std::string, MicroResult>& results)
+{
+	std::ifstream file(path);
+	if (!file) {
+		std::cout << "ERROR::MICRO_BENCHMARK::CANNOT_READ " << path << std::endl;
+		return false;
+	}
+
+	std::string line;
+	while (std::getline(file, line)) {
+		if (line.empty() || line[0] == '#')
+			continue;
+
+		MicroResult r = {};
+		size_t tab = line.find('\t');
+		if (tab == std::string::npos)
+			continue;
+		r.name = line.substr(0, tab);
+		std::istringstream values(line.substr(tab + 1));
+		if (values >> r.medianNs >> r.madNs >> r.allocations)
+			results[r.name] = r;
+	}
+	return true;
+}
+
+// Returns the number of regressions
+static int compareResults(const std::unordered_map<std::string, MicroResult>& baseline, const std::vector<MicroResult>& results)
+{
+	int regressions = 0;
+	std::cout << std::endl << "Against the baseline (change, threshold):" << std::endl;
+	for (const MicroResult& r : results) {
+		auto found = baseline.find(r.name);
+		if (found == baseline.end()) {
+			std::cout << "  " << std::left << std::setw(44) << r.name << std::right << " not in the baseline" << std::endl;
+			continue;
+		}
+
+		// Relative noise of both runs, a change has to stand out of it
+		const MicroResult& b = found->second;
+		double noise = 3.0 * (b.madNs / std::max(b.medianNs, 1e-9) + r.madNs / std::max(r.medianNs, 1e-9));
+		double threshold = std::max(MIN_CHANGE, noise);
+		double change = r.medianNs / std::max(b.medianNs, 1e-9) - 1.0;
+
+		const char* verdict = "same";
+		if (change > threshold)
+			verdict = "SLOWER";
+		else if (change < -threshold)
+			verdict = "faster";
+		// The driver allocates now and then, one call in a hundred is left to it
+		bool moreAllocations = r.allocations > b.allocations + 0.01;
+		regressions += change > threshold || moreAllocations ? 1 : 0;
+
+		std::cout << "  " << std::left << std::setw(44) << r.name << std::right << std::fixed << std::setprecision(1)
+			<< std::setw(8) << change * 100.0 << "%  (+-" << threshold * 100.0 << "%)  " << verdict;
+		if (moreAllocations)
+			std::cout << ", ALLOCATES MORE " << std::setprecision(2) << b.allocations << " -> " << r.allocations;
+		std::cout << std::defaultfloat << std::setprecision(6) << std::endl;
+	}
+	std::cout << "  " << regressions << " regression(s)" << std::endl;
+	return regressions;
+}
+
+// Cube positions of the sandbox scene
+static const glm::vec3 CUBE_POSITIONS[] = {
+	glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(2.0f, 5.0f, -15.0f), glm::vec3(-1.5f, -2.2f, -2.5f), glm::vec3(-3.8f, -2.0f, -12.3f),
+	glm::vec3(2.4f, -0.4f, -3.5f), glm::vec3(-1.7f, 3.0f, -7.5f), glm::vec3(1.3f, -2.0f, -2.5f), glm::vec3(1.5f, 2.0f, -2.5f),
+	glm::vec3(1.5f, 0.2f, -1.5f), glm::vec3(-1.3f, 1.0f, -1.5f)
+};
+static const size_t CUBE_COUNT = sizeof(CUBE_POSITIONS) / sizeof(CUBE_POSITIONS[0]);
+
+int RunMicroBenchmarks(const char* filter, const char* savePath, const char* baselinePath)
+{
+	std::unordered_map<std::string, MicroResult> baseline;
+	if (baselinePath && !loadResults(baselinePath, baseline))
+		return -1;
+
+	std::vector<MicroResult> results;
+	auto run = [&](const char* name, const std::function<void(size_t)>& body) {
+		if (!filter || strstr(name, filter))
+			results.push_back(measure(name, body));
+	};
+
+	std::cout << "Micro benchmarks: median per call over " << SAMPLES << " batches +- median absolute deviation" << std::endl;
+
+	// Camera
+	Camera camera(glm::vec3(0.0f, 0.0f, 3.0f));
+	camera.SetPerspective(800.0f / 600.0f, 0.1f, 100.0f);
+
+	run("Camera::ProcessMouseMovement", [&](size_t n) {
+		for (size_t i = 0; i < n; i++)
+			camera.ProcessMouseMovement(i & 1 ? -1.0f : 1.0f, i & 1 ? -0.5f : 0.5f);
+		keep(camera.GetFront());
+	});
+	run("Camera::GetViewMatrix (cached)", [&](size_t n) {
+		for (size_t i = 0; i < n; i++)
+			keep(camera.GetViewMatrix());
+	});
+	run("Camera::GetViewMatrix (after a move)", [&](size_t n) {
+		for (size_t i = 0; i < n; i++) {
+			camera.ProcessKeyboard(i & 1 ? CameraMovement::BACKWARD : CameraMovement::FORWARD, 0.016f);
+			keep(camera.GetViewMatrix());
+		}
+	});
+
+	// The model matrices of the sandbox's cube loop, built the way it used to every frame
+	run("cube loop model matrices (10 cubes)", [&](size_t n) {
+		for (size_t i = 0; i < n; i++) {
+			for (size_t c = 0; c < CUBE_COUNT; c++) {
+				glm::mat4 model = glm::translate(glm::mat4(1.0f), CUBE_POSITIONS[c]);
+				model = glm::rotate(model, glm::radians(20.0f * c + (float)(i & 63)), glm::vec3(1.0f, 0.3f, 0.5f));
+				keep(model);
+			}
+		}
+	});
+
+	// And through the scene, which is what the sandbox does now
+	Scene scene;
+	for (size_t c = 0; c < CUBE_COUNT; c++)
+		scene.CreateEntity(CUBE_POSITIONS[c], glm::quat(1.0f, 0.0f, 0.0f, 0.0f), glm::vec3(1.0f), NULL_ENTITY);
+	scene.UpdateWorldMatrices();
+	run("Scene::UpdateWorldMatrices (10 cubes moved)", [&](size_t n) {
+		for (size_t i = 0; i < n; i++) {
+			for (size_t c = 0; c < CUBE_COUNT; c++)
+				scene.SetRotation((Entity)c, glm::angleAxis(glm::radians(20.0f * c + (float)(i & 63)), glm::normalize(glm::vec3(1.0f, 0.3f, 0.5f))));
+			scene.UpdateWorldMatrices();
+			keep(scene.GetWorldMatrix(0));
+		}
+	});
+
+	// Shader setters and texture loads need GL, the driver's side is part of what they cost
+	OffscreenContext offscreen;
+	if (offscreen.Create()) {
+		std::cout << "  on " << offscreen.GetBackendName() << std::endl;
+
+		Shader shader("./assets/shaders/lightingVShader.glsl", "./assets/shaders/lightingFShader.glsl");
+		shader.use();
+		const glm::mat4 model = glm::translate(glm::mat4(1.0f), CUBE_POSITIONS[1]);
+
+		run("Shader::setMat4f", [&](size_t n) {
+			for (size_t i = 0; i < n; i++)
+				shader.setMat4f("model", model);
+		});
+		run("Shader::setVec3f", [&](size_t n) {
+			for (size_t i = 0; i < n; i++)
+				shader.setVec3f("viewPos", 1.0f, 2.0f, (float)(i & 7));
+		});
+		// Past the small string buffer, every call allocates its std::string
+		run("Shader::setFloat (long name)", [&](size_t n) {
+			for (size_t i = 0; i < n; i++)
+				shader.setFloat("spotLight.outerCutOff", 0.9f);
+		});
+		run("Shader::setInt (unknown name)", [&](size_t n) {
+			for (size_t i = 0; i < n; i++)
+				shader.setInt("notInTheShader", 1);
+		});
+
+		run("Texture load (container.jpg)", [&](size_t n) {
+			for (size_t i = 0; i < n; i++) {
+				Texture texture("./assets/textures/container.jpg");
+			}
+		});
+		run("Texture load (container_mask.png)", [&](size_t n) {
+			for (size_t i = 0; i < n; i++) {
+				Texture texture("./assets/textures/container_mask.png");
+			}
+		});
+	}
+	else
+		std::cout << "  no GL context, Shader and Texture skipped" << std::endl;
+
+	if (savePath && saveResults(savePath, results))
+		std::cout << "Saved to " << savePath << std::endl;
+
+	if (baselinePath)
+		return compareResults(baseline, results) > 0 ? 1 : 0;
+	return 0;
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+// System library
+#include <cstddef>
+
+/*
+	Micro benchmarks of the per frame CPU paths: camera updates and matrices, the
+	model matrices of the cube loop, the scene transform update, the Shader uniform
+	setters and Texture loading (the last two on an offscreen GL context).
+
+	Each one runs in batches sized to take about a millisecond, after a warm up batch,
+	and reports the median time per call over SAMPLES batches with the median absolute
+	deviation as its noise, plus the heap allocations per call.
+
+	Results can be saved and later compared: a change counts once it is past both
+	MIN_CHANGE and three times the noise of the two runs, more allocations per call
+	always count. Returns 1 when a comparison found something slower.
+
+	Selected from the command line: "AOG.exe --bench-micro [name filter] [--save base.txt] [--compare base.txt]"
+*/
+int RunMicroBenchmarks(const char* filter, const char* savePath, const char* baselinePath);
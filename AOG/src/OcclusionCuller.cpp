@@ -0,0 +1,304 @@
+#include "OcclusionCuller.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#include <emmintrin.h>
+	#define OCCLUSION_SSE
+#endif
+
+// Clip space w below which a vertex counts as crossing the near plane
+static const float NEAR_W = 1e-4f;
+
+// Boxes tested per job when checking occludees
+static const size_t TEST_BATCH = 1024;
+
+static const glm::vec3 UNIT_CUBE_VERTICES[8] = {
+	glm::vec3(-0.5f, -0.5f, -0.5f), glm::vec3(0.5f, -0.5f, -0.5f),
+	glm::vec3(0.5f,  0.5f, -0.5f), glm::vec3(-0.5f,  0.5f, -0.5f),
+	glm::vec3(-0.5f, -0.5f,  0.5f), glm::vec3(0.5f, -0.5f,  0.5f),
+	glm::vec3(0.5f,  0.5f,  0.5f), glm::vec3(-0.5f,  0.5f,  0.5f)
+};
+
+// Counter-clockwise seen from outside
+static const uint32_t UNIT_CUBE_INDICES[36] = {
+	0, 2, 1,  0, 3, 2,		// back  (-z)
+	4, 5, 6,  4, 6, 7,		// front (+z)
+	0, 4, 7,  0, 7, 3,		// left  (-x)
+	1, 2, 6,  1, 6, 5,		// right (+x)
+	0, 1, 5,  0, 5, 4,		// bottom (-y)
+	3, 7, 6,  3, 6, 2		// top   (+y)
+};
+
+static double elapsedMs(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+OcclusionCuller::OcclusionCuller(ThreadPool& pool, int width, int height)
+	: m_Pool(pool), m_ViewProjection(1.0f)
+{
+	m_TilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+	m_TilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
+	m_Width = m_TilesX * TILE_SIZE;
+	m_Height = m_TilesY * TILE_SIZE;
+
+	m_Depth.assign((size_t)m_Width * m_Height, 1.0f);
+	m_HiZ.assign((size_t)m_TilesX * m_TilesY, 1.0f);
+}
+
+void OcclusionCuller::BeginFrame(const glm::mat4& viewProjection)
+{
+	m_ViewProjection = viewProjection;
+	m_Triangles.clear();
+	m_Stats = OcclusionStats();
+}
+
+void OcclusionCuller::AddOccluder(const glm::vec3* vertices, const uint32_t* indices, size_t indexCount, const glm::mat4& model)
+{
+	glm::mat4 mvp = m_ViewProjection * model;
+	m_Stats.occluders++;
+
+	for (size_t i = 0; i + 2 < indexCount; i += 3) {
+		glm::vec4 clip[3];
+		bool crossesNear = false;
+		for (int k = 0; k < 3; k++) {
+			clip[k] = mvp * glm::vec4(vertices[indices[i + k]], 1.0f);
+			crossesNear |= clip[k].w < NEAR_W;
+		}
+
+		// Not clipping against the near plane, dropping the triangle only loses occlusion
+		if (crossesNear)
+			continue;
+
+		ScreenTriangle tri;
+		for (int k = 0; k < 3; k++) {
+			glm::vec3 ndc = glm::vec3(clip[k]) / clip[k].w;
+			tri.v[k] = glm::vec3((ndc.x * 0.5f + 0.5f) * m_Width, (ndc.y * 0.5f + 0.5f) * m_Height, ndc.z * 0.5f + 0.5f);
+		}
+
+		// Backfaces and degenerate triangles
+		glm::vec2 e0 = glm::vec2(tri.v[1] - tri.v[0]);
+		glm::vec2 e1 = glm::vec2(tri.v[2] - tri.v[0]);
+		if (e0.x * e1.y - e0.y * e1.x <= 0.0f)
+			continue;
+
+		float minY = glm::min(glm::min(tri.v[0].y, tri.v[1].y), tri.v[2].y);
+		float maxY = glm::max(glm::max(tri.v[0].y, tri.v[1].y), tri.v[2].y);
+		float minX = glm::min(glm::min(tri.v[0].x, tri.v[1].x), tri.v[2].x);
+		float maxX = glm::max(glm::max(tri.v[0].x, tri.v[1].x), tri.v[2].x);
+		if (maxY < 0.0f || minY >= (float)m_Height || maxX < 0.0f || minX >= (float)m_Width)
+			continue;
+
+		tri.minY = glm::max(0, (int)floorf(minY));
+		tri.maxY = glm::min(m_Height - 1, (int)ceilf(maxY));
+		m_Triangles.push_back(tri);
+	}
+}
+
+void OcclusionCuller::AddBoxOccluder(const glm::mat4& model)
+{
+	AddOccluder(UNIT_CUBE_VERTICES, UNIT_CUBE_INDICES, 36, model);
+}
+
+void OcclusionCuller::RasterizeOccluders()
+{
+	auto start = std::chrono::steady_clock::now();
+	m_Stats.occluderTriangles = m_Triangles.size();
+
+	m_Pool.ParallelFor((uint32_t)m_TilesY, [this](uint32_t tileRow) {
+		rasterizeBand((int)tileRow);
+	});
+
+	m_Stats.rasterMs = elapsedMs(start);
+}
+
+void OcclusionCuller::rasterizeBand(int tileRow)
+{
+	const int y0 = tileRow * TILE_SIZE;
+	const int y1 = y0 + TILE_SIZE - 1;
+	float* depth = m_Depth.data();
+
+	std::fill(depth + (size_t)y0 * m_Width, depth + (size_t)(y1 + 1) * m_Width, 1.0f);
+
+	for (const ScreenTriangle& tri : m_Triangles) {
+		if (tri.maxY < y0 || tri.minY > y1)
+			continue;
+
+		const glm::vec3& v0 = tri.v[0];
+		const glm::vec3& v1 = tri.v[1];
+		const glm::vec3& v2 = tri.v[2];
+
+		// Edge functions w_i(x, y) = a_i * x + b_i * y + c_i, positive inside
+		float a0 = v1.y - v2.y, b0 = v2.x - v1.x, c0 = v1.x * v2.y - v1.y * v2.x;
+		float a1 = v2.y - v0.y, b1 = v0.x - v2.x, c1 = v2.x * v0.y - v2.y * v0.x;
+		float a2 = v0.y - v1.y, b2 = v1.x - v0.x, c2 = v0.x * v1.y - v0.y * v1.x;
+		float invArea = 1.0f / (c0 + c1 + c2);
+
+		// Depth is linear in screen space after the perspective divide
+		float za = (a0 * v0.z + a1 * v1.z + a2 * v2.z) * invArea;
+		float zb = (b0 * v0.z + b1 * v1.z + b2 * v2.z) * invArea;
+		float zc = (c0 * v0.z + c1 * v1.z + c2 * v2.z) * invArea;
+
+		int minX = glm::max(0, (int)floorf(glm::min(glm::min(v0.x, v1.x), v2.x)));
+		int maxX = glm::min(m_Width - 1, (int)ceilf(glm::max(glm::max(v0.x, v1.x), v2.x)));
+		int rowStart = glm::max(y0, tri.minY);
+		int rowEnd = glm::min(y1, tri.maxY);
+
+#if defined(OCCLUSION_SSE)
+		// Buffer width is a multiple of 8, so an aligned group of 4 never runs off the row
+		minX &= ~3;
+		const __m128 laneOffsets = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+		const __m128 stepW0 = _mm_set1_ps(a0 * 4.0f), stepW1 = _mm_set1_ps(a1 * 4.0f), stepW2 = _mm_set1_ps(a2 * 4.0f);
+		const __m128 stepZ = _mm_set1_ps(za * 4.0f);
+		const __m128 zero = _mm_setzero_ps();
+
+		for (int y = rowStart; y <= rowEnd; y++) {
+			float py = y + 0.5f;
+			__m128 px = _mm_add_ps(_mm_set1_ps((float)minX), laneOffsets);
+			__m128 w0 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(a0), px), _mm_set1_ps(b0 * py + c0));
+			__m128 w1 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(a1), px), _mm_set1_ps(b1 * py + c1));
+			__m128 w2 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(a2), px), _mm_set1_ps(b2 * py + c2));
+			__m128 z = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(za), px), _mm_set1_ps(zb * py + zc));
+			float* row = depth + (size_t)y * m_Width;
+
+			for (int x = minX; x <= maxX; x += 4) {
+				__m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(w0, zero), _mm_cmpge_ps(w1, zero)), _mm_cmpge_ps(w2, zero));
+				if (_mm_movemask_ps(inside)) {
+					__m128 current = _mm_loadu_ps(row + x);
+					__m128 nearest = _mm_min_ps(current, z);
+					_mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearest), _mm_andnot_ps(inside, current)));
+				}
+
+				w0 = _mm_add_ps(w0, stepW0);
+				w1 = _mm_add_ps(w1, stepW1);
+				w2 = _mm_add_ps(w2, stepW2);
+				z = _mm_add_ps(z, stepZ);
+			}
+		}
+#else
+		for (int y = rowStart; y <= rowEnd; y++) {
+			float py = y + 0.5f;
+			float* row = depth + (size_t)y * m_Width;
+
+			for (int x = minX; x <= maxX; x++) {
+				float px = x + 0.5f;
+				float w0 = a0 * px + (b0 * py + c0);
+				float w1 = a1 * px + (b1 * py + c1);
+				float w2 = a2 * px + (b2 * py + c2);
+				if (w0 >= 0.0f && w1 >= 0.0f && w2 >= 0.0f) {
+					float z = za * px + (zb * py + zc);
+					row[x] = glm::min(row[x], z);
+				}
+			}
+		}
+#endif
+	}
+
+	// Tile level: the farthest depth in each 8x8 block of this band
+	for (int tx = 0; tx < m_TilesX; tx++) {
+		float farthest = 0.0f;
+		for (int y = y0; y <= y1; y++) {
+			const float* row = depth + (size_t)y * m_Width + tx * TILE_SIZE;
+			for (int x = 0; x < TILE_SIZE; x++)
+				farthest = glm::max(farthest, row[x]);
+		}
+		m_HiZ[(size_t)tileRow * m_TilesX + tx] = farthest;
+	}
+}
+
+bool OcclusionCuller::IsVisible(const AABB& box) const
+{
+	glm::vec2 screenMin(FLT_MAX), screenMax(-FLT_MAX);
+	float nearestZ = FLT_MAX;
+
+	// Transform one corner and the three edge vectors, the other corners are just sums
+	glm::vec3 size = box.max - box.min;
+	glm::vec4 base = m_ViewProjection * glm::vec4(box.min, 1.0f);
+	glm::vec4 dx = m_ViewProjection[0] * size.x;
+	glm::vec4 dy = m_ViewProjection[1] * size.y;
+	glm::vec4 dz = m_ViewProjection[2] * size.z;
+
+	for (int corner = 0; corner < 8; corner++) {
+		glm::vec4 clip = base;
+		if (corner & 1) clip += dx;
+		if (corner & 2) clip += dy;
+		if (corner & 4) clip += dz;
+
+		// Touching the near plane, can't be behind anything
+		if (clip.w < NEAR_W)
+			return true;
+
+		float invW = 1.0f / clip.w;
+		glm::vec2 screen((clip.x * invW * 0.5f + 0.5f) * m_Width, (clip.y * invW * 0.5f + 0.5f) * m_Height);
+		screenMin = glm::min(screenMin, screen);
+		screenMax = glm::max(screenMax, screen);
+		nearestZ = glm::min(nearestZ, clip.z * invW * 0.5f + 0.5f);
+	}
+
+	int x0 = glm::max(0, (int)floorf(screenMin.x));
+	int y0 = glm::max(0, (int)floorf(screenMin.y));
+	int x1 = glm::min(m_Width - 1, (int)floorf(screenMax.x));
+	int y1 = glm::min(m_Height - 1, (int)floorf(screenMax.y));
+
+	// Off screen is the frustum culler's call, not ours
+	if (x0 > x1 || y0 > y1)
+		return true;
+
+	for (int ty = y0 / TILE_SIZE; ty <= y1 / TILE_SIZE; ty++) {
+		for (int tx = x0 / TILE_SIZE; tx <= x1 / TILE_SIZE; tx++) {
+			// Every pixel in the tile is nearer than the box
+			if (nearestZ > m_HiZ[(size_t)ty * m_TilesX + tx])
+				continue;
+
+			// Partially covered tile, look at the pixels the box actually overlaps
+			int px0 = glm::max(x0, tx * TILE_SIZE), px1 = glm::min(x1, tx * TILE_SIZE + TILE_SIZE - 1);
+			int py0 = glm::max(y0, ty * TILE_SIZE), py1 = glm::min(y1, ty * TILE_SIZE + TILE_SIZE - 1);
+			for (int y = py0; y <= py1; y++) {
+				const float* row = m_Depth.data() + (size_t)y * m_Width;
+				for (int x = px0; x <= px1; x++) {
+					if (nearestZ <= row[x])
+						return true;
+				}
+			}
+		}
+	}
+
+	return false;
+}
+
+size_t OcclusionCuller::TestBoxes(const AABB* boxes, size_t count, uint8_t* visible)
+{
+	auto start = std::chrono::steady_clock::now();
+	std::atomic<size_t> tested(0), occluded(0);
+
+	uint32_t batches = (uint32_t)((count + TEST_BATCH - 1) / TEST_BATCH);
+	m_Pool.ParallelFor(batches, [&](uint32_t batch) {
+		size_t begin = batch * TEST_BATCH;
+		size_t end = glm::min(count, begin + TEST_BATCH);
+		size_t batchTested = 0, batchOccluded = 0;
+
+		for (size_t i = begin; i < end; i++) {
+			if (!visible[i])
+				continue;
+
+			batchTested++;
+			if (!IsVisible(boxes[i])) {
+				visible[i] = 0;
+				batchOccluded++;
+			}
+		}
+
+		tested += batchTested;
+		occluded += batchOccluded;
+	});
+
+	m_Stats.tested += tested;
+	m_Stats.occluded += occluded;
+	m_Stats.testMs += elapsedMs(start);
+
+	return occluded;
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "BVH.h"
+#include "ThreadPool.h"
+
+#include <glm/glm.hpp>
+
+// System library
+#include <vector>
+#include <cstdint>
+
+struct OcclusionStats
+{
+	size_t occluders = 0;
+	size_t occluderTriangles = 0;	// Triangles that survived clipping and backface culling
+	size_t tested = 0;
+	size_t occluded = 0;
+	double rasterMs = 0.0;
+	double testMs = 0.0;
+};
+
+/*
+	Software occlusion culling.
+
+	Occluder triangles are rasterized into a small depth buffer (nearest depth wins),
+	4 pixels at a time with SSE, one 8 pixel high band per job so every pixel is only
+	ever written by one thread. The result does not depend on the thread count or
+	scheduling. A max-depth tile per 8x8 block (the hierarchical level) lets most
+	occludee boxes be accepted or rejected without touching individual pixels.
+
+	Occluders crossing the near plane are dropped and occludees crossing it are
+	always visible, so the culler only ever errs on the side of drawing.
+*/
+class OcclusionCuller
+{
+private:
+	struct ScreenTriangle {
+		glm::vec3 v[3];		// x, y in pixels (y up), z depth in [0, 1]
+		int minY, maxY;
+	};
+
+	ThreadPool& m_Pool;
+
+	int m_Width, m_Height;
+	int m_TilesX, m_TilesY;
+	std::vector<float> m_Depth;
+	std::vector<float> m_HiZ;		// Farthest depth of each 8x8 tile
+
+	glm::mat4 m_ViewProjection;
+	std::vector<ScreenTriangle> m_Triangles;
+	OcclusionStats m_Stats;
+
+public:
+	static const int TILE_SIZE = 8;
+
+	// Width and height are rounded up to a multiple of the tile size
+	OcclusionCuller(ThreadPool& pool, int width = 320, int height = 192);
+
+	// Starts a new frame and clears the occluder list
+	void BeginFrame(const glm::mat4& viewProjection);
+
+	// Queue occluder geometry (triangle list, counter-clockwise front faces)
+	void AddOccluder(const glm::vec3* vertices, const uint32_t* indices, size_t indexCount, const glm::mat4& model);
+	void AddBoxOccluder(const glm::mat4& model);	// Unit cube centred on the origin
+
+	// Rasterize everything queued so far and build the tile level
+	void RasterizeOccluders();
+
+	bool IsVisible(const AABB& box) const;
+
+	// Clears visible[i] for boxes that are hidden; entries already 0 are skipped
+	size_t TestBoxes(const AABB* boxes, size_t count, uint8_t* visible);
+
+	// Getters
+	int GetWidth() const { return m_Width; }
+	int GetHeight() const { return m_Height; }
+	const float* GetDepthBuffer() const { return m_Depth.data(); }
+	const OcclusionStats& GetStats() const { return m_Stats; }
+
+private:
+	void rasterizeBand(int tileRow);
+};
@@ -0,0 +1,118 @@
+#include "OffscreenContext.h"
+
+#include <iostream>
+
+#if defined(__linux__)
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+OffscreenContext::OffscreenContext()
+	: m_Window(nullptr), m_Display(nullptr), m_Context(nullptr), m_Loader(nullptr)
+{
+}
+
+OffscreenContext::~OffscreenContext()
+{
+#if defined(__linux__)
+	if (m_Context) {
+		eglMakeCurrent((EGLDisplay)m_Display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+		eglDestroyContext((EGLDisplay)m_Display, (EGLContext)m_Context);
+		eglTerminate((EGLDisplay)m_Display);
+	}
+#endif
+
+	if (m_Window) {
+		glfwDestroyWindow(m_Window);
+		glfwTerminate();
+	}
+}
+
+bool OffscreenContext::Create()
+{
+	if (!createEGL() && !createGLFW()) {
+		std::cout << "ERROR::OFFSCREEN_CONTEXT::CREATION_FAILED" << std::endl;
+		return false;
+	}
+
+	m_Backend += ", ";
+	m_Backend += (const char*)glGetString(GL_RENDERER);
+	return true;
+}
+
+bool OffscreenContext::createEGL()
+{
+#if defined(__linux__)
+	PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+	if (!getPlatformDisplay)
+		return false;
+
+	EGLDisplay display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+	if (display == EGL_NO_DISPLAY || !eglInitialize(display, nullptr, nullptr))
+		return false;
+
+	const EGLint contextAttributes[] = {
+		EGL_CONTEXT_MAJOR_VERSION, 3,
+		EGL_CONTEXT_MINOR_VERSION, 3,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+		EGL_NONE
+	};
+
+	// Configless and surfaceless: everything is drawn into framebuffer objects
+	eglBindAPI(EGL_OPENGL_API);
+	EGLContext context = eglCreateContext(display, (EGLConfig)0, EGL_NO_CONTEXT, contextAttributes);
+	if (context == EGL_NO_CONTEXT || !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+		eglTerminate(display);
+		return false;
+	}
+
+	m_Display = display;
+	m_Context = context;
+
+	m_Loader = (GLADloadproc)eglGetProcAddress;
+	if (!gladLoadGLLoader(m_Loader)) {
+		std::cout << "Failed to initialise GLAD" << std::endl;
+		return false;
+	}
+
+	m_Backend = "EGL surfaceless";
+	return true;
+#else
+	return false;
+#endif
+}
+
+bool OffscreenContext::createGLFW()
+{
+	if (!glfwInit())
+		return false;
+
+	const int contextApis[] = { GLFW_OSMESA_CONTEXT_API, GLFW_NATIVE_CONTEXT_API };
+	const char* contextNames[] = { "GLFW hidden window (OSMesa)", "GLFW hidden window" };
+
+	for (int i = 0; i < 2 && !m_Window; i++) {
+		glfwDefaultWindowHints();
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+		glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+		glfwWindowHint(GLFW_CONTEXT_CREATION_API, contextApis[i]);
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+		m_Window = glfwCreateWindow(64, 64, "AOG offscreen", nullptr, nullptr);
+		m_Backend = contextNames[i];
+	}
+
+	if (!m_Window) {
+		glfwTerminate();
+		return false;
+	}
+
+	glfwMakeContextCurrent(m_Window);
+	m_Loader = (GLADloadproc)glfwGetProcAddress;
+	if (!gladLoadGLLoader(m_Loader)) {
+		std::cout << "Failed to initialise GLAD" << std::endl;
+		return false;
+	}
+
+	return true;
+}
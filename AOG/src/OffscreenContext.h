@@ -0,0 +1,49 @@
+#pragma once
+
+// Third Party library
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+// System library
+#include <string>
+
+/*
+	GL 3.3 core context with nothing on screen, for benchmarks on machines without
+	a display or a GPU.
+
+	Linux: EGL on Mesa's surfaceless platform, no X server needed and llvmpipe takes
+	over when there is no GPU driver. Elsewhere: a hidden GLFW window, trying the
+	OSMesa context API first (software rendering, needs osmesa.dll next to the exe)
+	and the native one after that.
+
+	There is no usable default framebuffer either way, render into a Framebuffer.
+*/
+class OffscreenContext
+{
+private:
+	GLFWwindow* m_Window;
+	void* m_Display;
+	void* m_Context;
+	std::string m_Backend;
+	GLADloadproc m_Loader;
+
+public:
+	OffscreenContext();
+	~OffscreenContext();
+
+	OffscreenContext(const OffscreenContext&) = delete;
+	OffscreenContext& operator=(const OffscreenContext&) = delete;
+
+	// Creates the context, makes it current and loads the GL functions
+	bool Create();
+
+	// e.g. "EGL surfaceless, llvmpipe (LLVM 15.0.6, 256 bits)"
+	const std::string& GetBackendName() const { return m_Backend; }
+
+	// Proc address function that loaded glad, for entry points glad doesn't cover (GL43.h)
+	GLADloadproc GetLoader() const { return m_Loader; }
+
+private:
+	bool createEGL();
+	bool createGLFW();
+};
@@ -1,8 +1,35 @@
 #include "Shader.h"
 #include "Texture.h"
 #include "Camera.h"
+#include "Scene.h"
+#include "SceneFile.h"
+#include "Culling.h"
+#include "BVH.h"
+#include "OcclusionCuller.h"
+#include "ShadowCascades.h"
+#include "DynamicResolution.h"
+#include "GPUProfiler.h"
+#include "CPUProfiler.h"
+#include "LightClusters.h"
+#include "LightmapBaker.h"
+#include "ThreadPool.h"
+#include "Mesh.h"
+#include "StressScene.h"
+#include "Benchmark.h"
+#include "MicroBenchmark.h"
+#include "GLInterceptor.h"
+#include "GLCapture.h"
+#include "MemoryTracker.h"
+#include "StartupGraph.h"
+#include "StatsOverlay.h"
 
 #include <iostream>
+#include <vector>
+#include <cstring>
+#include <cstdlib>
+#include <string>
+#include <memory>
+#include <fstream>
 
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
@@ -22,6 +49,74 @@ glm::vec3 lightPos(1.2f, 1.0f, 2.0f);
 const unsigned int SCR_WIDTH = 800;
 const unsigned int SCR_HEIGHT = 600;
 
+// Largest on screen error allowed when picking a level of detail
+const float LOD_PIXEL_ERROR = 1.0f;
+
+// Directional light, shadows are cast along it
+const glm::vec3 SUN_DIRECTION(-0.2f, -1.0f, -0.3f);
+
+// Static lighting of the containers, written by --bake-lightmaps
+const char* LIGHTMAP_PATH = "./assets/scenes/sandbox.hdr";
+const int LIGHTMAP_RESOLUTION = 64;		// Texels along a container's square
+
+// GPU time per frame the render resolution is scaled to hold
+const float FRAME_BUDGET_MS = 16.0f;
+
+// Written by C with the GPU time of every pass over the last frames
+const char* GPU_PROFILE_PATH = "./gpu_profile.csv";
+
+// Written by T with the CPU trace (chrome://tracing or ui.perfetto.dev)
+const char* CPU_TRACE_PATH = "./trace.json";
+
+// Written by I with the GL calls of every frame it was on for (debug builds)
+const char* GL_CALLS_PATH = "./gl_calls.csv";
+
+// Cube shared by the containers and the lamps
+float vertices[] = {
+	// positions          // normals           // texture coords
+	-0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  0.0f, 0.0f,
+	 0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  1.0f, 0.0f,
+	 0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  1.0f, 1.0f,
+	 0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  1.0f, 1.0f,
+	-0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  0.0f, 1.0f,
+	-0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  0.0f, 0.0f,
+
+	-0.5f, -0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   0.0f, 0.0f,
+	 0.5f, -0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   1.0f, 0.0f,
+	 0.5f,  0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   1.0f, 1.0f,
+	 0.5f,  0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   1.0f, 1.0f,
+	-0.5f,  0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   0.0f, 1.0f,
+	-0.5f, -0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   0.0f, 0.0f,
+
+	-0.5f,  0.5f,  0.5f, -1.0f,  0.0f,  0.0f,  1.0f, 0.0f,
+	-0.5f,  0.5f, -0.5f, -1.0f,  0.0f,  0.0f,  1.0f, 1.0f,
+	-0.5f, -0.5f, -0.5f, -1.0f,  0.0f,  0.0f,  0.0f, 1.0f,
+	-0.5f, -0.5f, -0.5f, -1.0f,  0.0f,  0.0f,  0.0f, 1.0f,
+	-0.5f, -0.5f,  0.5f, -1.0f,  0.0f,  0.0f,  0.0f, 0.0f,
+	-0.5f,  0.5f,  0.5f, -1.0f,  0.0f,  0.0f,  1.0f, 0.0f,
+
+	 0.5f,  0.5f,  0.5f,  1.0f,  0.0f,  0.0f,  1.0f, 0.0f,
+	 0.5f,  0.5f, -0.5f,  1.0f,  0.0f,  0.0f,  1.0f, 1.0f,
+	 0.5f, -0.5f, -0.5f,  1.0f,  0.0f,  0.0f,  0.0f, 1.0f,
+	 0.5f, -0.5f, -0.5f,  1.0f,  0.0f,  0.0f,  0.0f, 1.0f,
+	 0.5f, -0.5f,  0.5f,  1.0f,  0.0f,  0.0f,  0.0f, 0.0f,
+	 0.5f,  0.5f,  0.5f,  1.0f,  0.0f,  0.0f,  1.0f, 0.0f,
+
+	-0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,  0.0f, 1.0f,
+	 0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,  1.0f, 1.0f,
+	 0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,  1.0f, 0.0f,
+	 0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,  1.0f, 0.0f,
+	-0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,  0.0f, 0.0f,
+	-0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,  0.0f, 1.0f,
+
+	-0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  0.0f, 1.0f,
+	 0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  1.0f, 1.0f,
+	 0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,  1.0f, 0.0f,
+	 0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,  1.0f, 0.0f,
+	-0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,  0.0f, 0.0f,
+	-0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  0.0f, 1.0f
+};
+
 float lastX = SCR_WIDTH / 2.0f;
 float lastY = SCR_HEIGHT / 2.0f;
 
@@ -39,11 +134,246 @@ void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
 void shaderCompilationCheck(unsigned int& id);
 void programLinkageCheck(unsigned int& id);
 void processInput(GLFWwindow* window);
+int bakeLightmaps(int samples);
 
-int main()
+int main(int argc, char** argv)
 {
+	CPU_PROFILE_THREAD("main");
+
+	// Headless benchmarks
+	if (argc > 1 && strcmp(argv[1], "--bench-scene") == 0) {
+		RunSceneBenchmark(argc > 2 ? strtoul(argv[2], nullptr, 10) : 1000000);
+		return 0;
+	}
+	if (argc > 1 && strcmp(argv[1], "--bench-culling") == 0) {
+		RunCullingBenchmark(argc > 2 ? strtoul(argv[2], nullptr, 10) : 1000000);
+		return 0;
+	}
+	if (argc > 1 && strcmp(argv[1], "--bench-bvh") == 0) {
+		RunBVHBenchmark(argc > 2 ? strtoul(argv[2], nullptr, 10) : 1000000);
+		return 0;
+	}
+	if (argc > 1 && strcmp(argv[1], "--bench-occlusion") == 0) {
+		RunOcclusionBenchmark(argc > 2 ? strtoul(argv[2], nullptr, 10) : 250000);
+		return 0;
+	}
+	if (argc > 1 && strcmp(argv[1], "--bench-lod") == 0) {
+		RunLODBenchmark(argc > 2 ? strtoul(argv[2], nullptr, 10) : 100000);
+		return 0;
+	}
+	if (argc > 1 && strcmp(argv[1], "--bench-scene-load") == 0) {
+		RunSceneLoadBenchmark(argc > 2 ? strtoul(argv[2], nullptr, 10) : 1000000);
+		return 0;
+	}
+	// Per call CPU cost, e.g. "--bench-micro Camera --compare base.txt"
+	if (argc > 1 && strcmp(argv[1], "--bench-micro") == 0) {
+		const char* filter = nullptr;
+		const char* savePath = nullptr;
+		const char* baselinePath = nullptr;
+		for (int i = 2; i < argc; i++) {
+			if (strcmp(argv[i], "--save") == 0 && i + 1 < argc)
+				savePath = argv[++i];
+			else if (strcmp(argv[i], "--compare") == 0 && i + 1 < argc)
+				baselinePath = argv[++i];
+			else
+				filter = argv[i];
+		}
+		return RunMicroBenchmarks(filter, savePath, baselinePath);
+	}
+
+	// Stress scene, e.g. "--stress 100000 --seed 7 --frames 600 --headless --gpu-culling"
+	if (argc > 1 && strcmp(argv[1], "--stress") == 0) {
+		StressSceneSettings settings;
+		if (argc > 2 && argv[2][0] != '-')
+			settings.objectCount = strtoul(argv[2], nullptr, 10);
+		for (int i = 2; i < argc; i++) {
+			if (strcmp(argv[i], "--headless") == 0)
+				settings.headless = true;
+			else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+				settings.seed = strtoul(argv[++i], nullptr, 10);
+			else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+				settings.frames = atoi(argv[++i]);
+			else if (strcmp(argv[i], "--gpu-culling") == 0)
+				settings.gpuCulling = true;
+			else if (strcmp(argv[i], "--depth-prepass") == 0)
+				settings.depthPrepass = true;
+			else if (strcmp(argv[i], "--sort") == 0)
+				settings.sortFrontToBack = true;
+			else if (strcmp(argv[i], "--overdraw") == 0)
+				settings.overdrawView = true;
+			else if (strcmp(argv[i], "--lights") == 0 && i + 1 < argc)
+				settings.lightCount = atoi(argv[++i]);
+			else if (strcmp(argv[i], "--clustered") == 0)
+				settings.clusteredLighting = true;
+			else if (strcmp(argv[i], "--deferred") == 0)
+				settings.deferred = true;
+			else if (strcmp(argv[i], "--shadows") == 0)
+				settings.shadows = true;
+			else if (strcmp(argv[i], "--no-shadow-cache") == 0)
+				settings.shadowCaching = false;
+			else if (strcmp(argv[i], "--dynamic-resolution") == 0 && i + 1 < argc)
+				settings.dynamicResolutionMs = (float)atof(argv[++i]);
+			else if (strcmp(argv[i], "--gpu-profile") == 0 && i + 1 < argc)
+				settings.gpuProfilePath = argv[++i];
+			else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+				settings.tracePath = argv[++i];
+			else if (strcmp(argv[i], "--gl-calls") == 0 && i + 1 < argc)
+				settings.glCallsPath = argv[++i];
+			else if (strcmp(argv[i], "--capture") == 0 && i + 1 < argc)
+				settings.capturePath = argv[++i];
+			else if (strcmp(argv[i], "--capture-frames") == 0 && i + 1 < argc)
+				settings.captureFrames = atoi(argv[++i]);
+			else if (strcmp(argv[i], "--overlay") == 0)
+				settings.statsOverlay = true;
+		}
+		return RunStressScene(settings);
+	}
+	if (argc > 1 && strcmp(argv[1], "--bench-gpu-culling") == 0)
+		return RunGPUCullingBenchmark(argc > 2 ? strtoul(argv[2], nullptr, 10) : 1000000);
+	if (argc > 1 && strcmp(argv[1], "--bench-lights") == 0)
+		return RunClusteredLightingBenchmark(argc > 2 ? strtoul(argv[2], nullptr, 10) : 10000);
+	if (argc > 1 && strcmp(argv[1], "--bench-shadows") == 0)
+		return RunShadowBenchmark(argc > 2 ? strtoul(argv[2], nullptr, 10) : 10000);
+	if (argc > 1 && strcmp(argv[1], "--bench-lighting-shader") == 0)
+		return RunLightingShaderBenchmark(argc > 2 ? atoi(argv[2]) : 20);
+	if (argc > 1 && strcmp(argv[1], "--benchmark") == 0)
+		return RunFrameBenchmark(argc > 2 ? argv[2] : "./benchmark.json", argc > 3 ? atoi(argv[3]) : 120,
+			argc > 4 ? strtoul(argv[4], nullptr, 10) : 10000);
+	// Golden images and budgets, e.g. "--regression ./regression" or "--regression ./regression --update"
+	if (argc > 1 && strcmp(argv[1], "--regression") == 0) {
+		const char* goldenDir = "./regression";
+		bool update = false;
+		for (int i = 2; i < argc; i++) {
+			if (strcmp(argv[i], "--update") == 0)
+				update = true;
+			else
+				goldenDir = argv[i];
+		}
+		return RunRegressionSuite(goldenDir, update);
+	}
+	if (argc > 1 && strcmp(argv[1], "--bench-lightmap") == 0) {
+		RunLightmapBenchmark(argc > 2 ? strtoul(argv[2], nullptr, 10) : 64);
+		return 0;
+	}
+
+	// Plays a GL capture back headless, e.g. "--replay frames.glcap 10"
+	if (argc > 1 && strcmp(argv[1], "--replay") == 0 && argc > 2)
+		return ReplayGLCapture(argv[2], argc > 3 ? atoi(argv[3]) : 1);
+
+	// Offline lightmap baking, e.g. "--bake-lightmaps 256"
+	if (argc > 1 && strcmp(argv[1], "--bake-lightmaps") == 0)
+		return bakeLightmaps(argc > 2 ? atoi(argv[2]) : 256);
+
+	// CPU trace from startup through the first frames, e.g. "--trace startup.json 300"
+	const char* tracePath = CPU_TRACE_PATH;
+	int traceFramesLeft = -1;
+	if (argc > 1 && strcmp(argv[1], "--trace") == 0) {
+		if (argc > 2)
+			tracePath = argv[2];
+		traceFramesLeft = argc > 3 ? atoi(argv[3]) : 300;
+#if !AOG_PROFILING
+		std::cout << "ERROR::SANDBOX::BUILT_WITHOUT_PROFILING no trace will be written" << std::endl;
+#endif
+		CPU_PROFILE_START();
+	}
+
+	// GL capture of every call from startup, the frames from first on timed by --replay, e.g. "--capture frames.glcap 60 120"
+	const char* capturePath = nullptr;
+	int captureFrames = 0, captureFirst = 0;
+	if (argc > 1 && strcmp(argv[1], "--capture") == 0) {
+		capturePath = argc > 2 ? argv[2] : "./frames.glcap";
+		captureFrames = argc > 3 ? atoi(argv[3]) : 60;
+		captureFirst = argc > 4 ? atoi(argv[4]) : 120;
+	}
+	CPU_SCOPE_BEGIN(startup, "startup");
+
+	// File reads, decodes and CPU side preparation run on the pool while the window and the context
+	// are created, the main thread only waits for each result right before it goes to the GPU
+	ThreadPool threadPool;
+	std::vector<ShaderSources> shaderSources(4);
+	SceneFile sceneFile;
+	Scene scene;
+	std::vector<Entity> cubes;
+	std::vector<Entity> pointLights;
+	int containerMaterial = -1, lampMaterial = -1;
+	bool sceneLoaded = false;
+	std::vector<uint32_t> cubeIndices;
+	std::vector<Vertex> cubeVertices;
+	std::unique_ptr<Mesh> cubeMesh;
+	TextureImage textureImages[3];
+	LightmapImage lightmapImage;
+
+	StartupGraph startupGraph(threadPool);
+	int readShaders = startupGraph.Add("shader sources", [&]() {
+		shaderSources[0] = Shader::ReadSources("./assets/shaders/lightingVShader.glsl", "./assets/shaders/lightingFShader.glsl");
+		shaderSources[0].Define("POINT_LIGHT_SLOTS", ForwardPointLightSlots(4));	// The scene is checked for 4 lamps
+		shaderSources[1] = Shader::ReadSources("./assets/shaders/lightCubeVShader.glsl", "./assets/shaders/lightCubeFShader.glsl");
+		shaderSources[2] = Shader::ReadSources("./assets/shaders/depthVShader.glsl", "./assets/shaders/depthFShader.glsl");
+		shaderSources[3] = Shader::ReadSources("./assets/shaders/lightmapVShader.glsl", "./assets/shaders/lightmapFShader.glsl");
+	});
+
+	// Scene objects come from the scene file, the text version is only parsed when it changed
+	int loadScene = startupGraph.Add("scene", [&]() {
+		if (!CompileSceneFile("./assets/scenes/sandbox.txt", "./assets/scenes/sandbox.aogs") || !sceneFile.Load("./assets/scenes/sandbox.aogs"))
+			return;
+		sceneFile.AssignTo(scene);
+
+		// Containers are lit, lamps are the point lights
+		containerMaterial = sceneFile.FindMaterial("container");
+		lampMaterial = sceneFile.FindMaterial("lamp");
+		const uint32_t* materialIds = sceneFile.GetMaterialIds();
+		for (Entity e = 0; e < scene.Size(); e++) {
+			if ((int)materialIds[e] == containerMaterial)
+				cubes.push_back(e);
+			else if ((int)materialIds[e] == lampMaterial)
+				pointLights.push_back(e);
+		}
+		sceneLoaded = true;
+	});
+
+	// Cube mesh shared by the containers and the lamps, unwrapped before the LODs so they share its vertices
+	int buildMesh = startupGraph.Add("cube mesh", [&]() {
+		cubeVertices = Mesh::FromInterleaved(vertices, 36, cubeIndices);
+		std::vector<glm::vec2> cubeLightmapUVs = UnwrapLightmapUVs(cubeVertices, cubeIndices, LIGHTMAP_RESOLUTION);
+		cubeMesh.reset(new Mesh(cubeVertices, cubeIndices));
+		cubeMesh->lightmapUVs = cubeLightmapUVs;
+		cubeMesh->GenerateLODs(4, 0.5f, 0.01f);
+	});
+
+	// Container diffuse and specular, lamp diffuse: one decode each, named by the scene's materials
+	int decodeTextures[3];
+	for (int i = 0; i < 3; i++) {
+		decodeTextures[i] = startupGraph.Add("decode texture", [&, i]() {
+			if (!sceneLoaded || containerMaterial < 0 || lampMaterial < 0)
+				return;
+			const SceneFileMaterial& container = sceneFile.GetMaterial(containerMaterial);
+			uint32_t path = i == 0 ? container.diffuse : i == 1 ? container.specular : sceneFile.GetMaterial(lampMaterial).diffuse;
+			textureImages[i] = Texture::Decode(sceneFile.GetString(path));
+		}, { loadScene });
+	}
+
+	// Baked lighting of the containers when there is a lightmap for this scene
+	int decodeLightmap = startupGraph.Add("decode lightmap", [&]() {
+		if (std::ifstream(LIGHTMAP_PATH).good())
+			lightmapImage = DecodeLightmapImage(LIGHTMAP_PATH);
+	});
+	startupGraph.Start();
+
 	// Initialise GLFW
+	CPU_SCOPE_BEGIN(window, "window and GL");
+	int windowPhase = startupGraph.BeginPhase("window and GL");
 	glfwInit();
+
+	// Terminates after the shaders, textures and meshes below freed their GL objects, what's left leaked
+	struct Shutdown
+	{
+		~Shutdown()
+		{
+			ReportMemoryLeaks();
+			glfwTerminate();
+		}
+	} shutdown;
+
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
 
@@ -55,7 +385,6 @@ int main()
 	GLFWwindow* window = glfwCreateWindow((float)SCR_WIDTH, (float)SCR_HEIGHT, "Learn OpenGL", nullptr, nullptr);
 	if (window == nullptr) {
 		std::cout << "Failed to create GLFW window" << std::endl;
-		glfwTerminate();
 		return -1;
 	}
 
@@ -75,6 +404,8 @@ int main()
 		std::cout << "Failed to initialise GLAD" << std::endl;
 		return -1;
 	}
+	if (capturePath)
+		StartGLCapture(capturePath, captureFirst, captureFrames);
 
 	// Before we can start rendering, set viewport
 	glViewport(0, 0, 800, 600);
@@ -82,123 +413,50 @@ int main()
 
 	// Callbaccak to resize window
 	glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+	startupGraph.EndPhase(windowPhase);
+	CPU_SCOPE_END(window);
 
 	// Shaders
-	Shader lightingShader("./assets/shaders/lightingVShader.glsl", "./assets/shaders/lightingFShader.glsl");
-	Shader lightCubeShader("./assets/shaders/lightCubeVShader.glsl", "./assets/shaders/lightCubeFShader.glsl");
-
-	// Lightning
-	float vertices[] = {
-		// positions          // normals           // texture coords
-		-0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  0.0f, 0.0f,
-		 0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  1.0f, 0.0f,
-		 0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  1.0f, 1.0f,
-		 0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  1.0f, 1.0f,
-		-0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  0.0f, 1.0f,
-		-0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,  0.0f, 0.0f,
-
-		-0.5f, -0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   0.0f, 0.0f,
-		 0.5f, -0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   1.0f, 0.0f,
-		 0.5f,  0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   1.0f, 1.0f,
-		 0.5f,  0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   1.0f, 1.0f,
-		-0.5f,  0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   0.0f, 1.0f,
-		-0.5f, -0.5f,  0.5f,  0.0f,  0.0f, 1.0f,   0.0f, 0.0f,
-
-		-0.5f,  0.5f,  0.5f, -1.0f,  0.0f,  0.0f,  1.0f, 0.0f,
-		-0.5f,  0.5f, -0.5f, -1.0f,  0.0f,  0.0f,  1.0f, 1.0f,
-		-0.5f, -0.5f, -0.5f, -1.0f,  0.0f,  0.0f,  0.0f, 1.0f,
-		-0.5f, -0.5f, -0.5f, -1.0f,  0.0f,  0.0f,  0.0f, 1.0f,
-		-0.5f, -0.5f,  0.5f, -1.0f,  0.0f,  0.0f,  0.0f, 0.0f,
-		-0.5f,  0.5f,  0.5f, -1.0f,  0.0f,  0.0f,  1.0f, 0.0f,
-
-		 0.5f,  0.5f,  0.5f,  1.0f,  0.0f,  0.0f,  1.0f, 0.0f,
-		 0.5f,  0.5f, -0.5f,  1.0f,  0.0f,  0.0f,  1.0f, 1.0f,
-		 0.5f, -0.5f, -0.5f,  1.0f,  0.0f,  0.0f,  0.0f, 1.0f,
-		 0.5f, -0.5f, -0.5f,  1.0f,  0.0f,  0.0f,  0.0f, 1.0f,
-		 0.5f, -0.5f,  0.5f,  1.0f,  0.0f,  0.0f,  0.0f, 0.0f,
-		 0.5f,  0.5f,  0.5f,  1.0f,  0.0f,  0.0f,  1.0f, 0.0f,
-
-		-0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,  0.0f, 1.0f,
-		 0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,  1.0f, 1.0f,
-		 0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,  1.0f, 0.0f,
-		 0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,  1.0f, 0.0f,
-		-0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,  0.0f, 0.0f,
-		-0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,  0.0f, 1.0f,
-
-		-0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  0.0f, 1.0f,
-		 0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  1.0f, 1.0f,
-		 0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,  1.0f, 0.0f,
-		 0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,  1.0f, 0.0f,
-		-0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,  0.0f, 0.0f,
-		-0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  0.0f, 1.0f
-	};
-
-	// positions all containers
-	glm::vec3 cubePositions[] = {
-		glm::vec3(0.0f,  0.0f,  0.0f),
-		glm::vec3(2.0f,  5.0f, -15.0f),
-		glm::vec3(-1.5f, -2.2f, -2.5f),
-		glm::vec3(-3.8f, -2.0f, -12.3f),
-		glm::vec3(2.4f, -0.4f, -3.5f),
-		glm::vec3(-1.7f,  3.0f, -7.5f),
-		glm::vec3(1.3f, -2.0f, -2.5f),
-		glm::vec3(1.5f,  2.0f, -2.5f),
-		glm::vec3(1.5f,  0.2f, -1.5f),
-		glm::vec3(-1.3f,  1.0f, -1.5f)
-	};
-
-	// positions of the point lights
-	glm::vec3 pointLightPositions[] = {
-		glm::vec3(0.7f,  0.2f,  2.0f),
-		glm::vec3(2.3f, -3.3f, -4.0f),
-		glm::vec3(-4.0f,  2.0f, -12.0f),
-		glm::vec3(0.0f,  0.0f, -3.0f)
-	};
-
-	// Generate vertex buffer
-	unsigned int VBO;
-
-	glGenBuffers(1, &VBO);
-	// Bind newly generate buffer
-	glBindBuffer(GL_ARRAY_BUFFER, VBO);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-
-	unsigned int cubeVAO;
-	glGenVertexArrays(1, &cubeVAO);
-	glBindVertexArray(cubeVAO);
-
-	// position attribute
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(0);
-
-	// normal attribute
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
-	glEnableVertexAttribArray(1);
-
-	// textire attribute
-	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
-	glEnableVertexAttribArray(2);
-
-	unsigned int lightCubeVAO;
-	glGenVertexArrays(1, &lightCubeVAO);
-	glBindVertexArray(lightCubeVAO);
-	
-	// Only need to bind to the VBO (to link it to vertexAttribPointer)
-	// no need to fill it; the VBO's data already contains all we need
-	glBindBuffer(GL_ARRAY_BUFFER, VBO);
-
-	// position attribute
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(0);
+	startupGraph.Wait(readShaders);
+	CPU_SCOPE_BEGIN(shaders, "shaders");
+	int shaderPhase = startupGraph.BeginPhase("compile shaders");
+	Shader lightingShader(shaderSources[0]);
+	Shader lightCubeShader(shaderSources[1]);
+	Shader depthShader(shaderSources[2]);
+	Shader lightmapShader(shaderSources[3]);
+	startupGraph.EndPhase(shaderPhase);
+	CPU_SCOPE_END(shaders);
+
+	startupGraph.Wait(loadScene);
+	if (!sceneLoaded)
+		return -1;
+	if (containerMaterial < 0 || lampMaterial < 0 || pointLights.size() != 4) {
+		std::cout << "ERROR::SANDBOX::SCENE_NEEDS_CONTAINERS_AND_4_LAMPS" << std::endl;
+		return -1;
+	}
+	const uint32_t* materialIds = sceneFile.GetMaterialIds();
 
-	// texture attribute
-	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
-	glEnableVertexAttribArray(1);
+	startupGraph.Wait(buildMesh);
+	CPU_SCOPE_BEGIN(mesh, "cube mesh");
+	int meshPhase = startupGraph.BeginPhase("upload cube mesh");
+	cubeMesh->Upload();
+	startupGraph.EndPhase(meshPhase);
+	CPU_SCOPE_END(mesh);
+	std::vector<int> entityLODs;
 
 	// Load Textures
-	Texture woodTexture("./assets/textures/container_steel.png");
-	Texture woodTextureMask("./assets/textures/container_mask.png");
-	Texture glowstoneTexture("./assets/textures/glowstone.png");
+	for (int task : decodeTextures)
+		startupGraph.Wait(task);
+	CPU_SCOPE_BEGIN(textures, "textures");
+	int texturePhase = startupGraph.BeginPhase("upload textures");
+	Texture woodTexture(textureImages[0]);
+	Texture woodTextureMask(textureImages[1]);
+	Texture glowstoneTexture(textureImages[2]);
+	for (TextureImage& image : textureImages)
+		image = TextureImage();
+	startupGraph.EndPhase(texturePhase);
+	CPU_SCOPE_END(textures);
+	const float containerShininess = sceneFile.GetMaterial(containerMaterial).shininess;
 
 	// Shader Configuration
 	lightCubeShader.use();
@@ -207,145 +465,470 @@ int main()
 	lightingShader.use();
 	lightingShader.setInt("material.diffuse", 1);
 	lightingShader.setInt("material.specular", 2);
+	lightingShader.setVec3f("pointAttenuation", 1.0f, 0.09f, 0.032f);
+
+	// The lamps as forward shader point lights, white and cut off where they fade below 1/256
+	std::vector<PointLight> lampLights(pointLights.size(), { glm::vec3(0.0f), PointLightRange(1.0f, 0.09f, 0.032f), glm::vec3(1.0f) });
+
+	lightmapShader.use();
+	lightmapShader.setInt("material.diffuse", 1);
+	lightmapShader.setInt("material.specular", 2);
+	lightmapShader.setInt("lightmap", 4);
+
+	// Baked lighting of the containers when there is a lightmap for this scene, L toggles it
+	LightmapAtlas lightmapAtlas(cubes.size(), LIGHTMAP_RESOLUTION);
+	unsigned int lightmapTexture = 0;
+	startupGraph.Wait(decodeLightmap);
+	if (!lightmapImage.texels.empty()) {
+		CPU_SCOPE("lightmap");
+		if (lightmapImage.width != lightmapAtlas.width || lightmapImage.height != lightmapAtlas.height)
+			std::cout << "ERROR::SANDBOX::LIGHTMAP_OUT_OF_DATE run --bake-lightmaps again" << std::endl;
+		else {
+			int lightmapPhase = startupGraph.BeginPhase("upload lightmap");
+			lightmapTexture = CreateLightmapTexture(lightmapImage);
+			startupGraph.EndPhase(lightmapPhase);
+		}
+		lightmapImage.texels = std::vector<float>();
+	}
+	int setupPhase = startupGraph.BeginPhase("renderer setup");
+	std::vector<int> lightmapInstances(scene.Size(), -1);
+	for (size_t k = 0; k < cubes.size(); k++)
+		lightmapInstances[cubes[k]] = (int)k;
+	bool bakedLighting = lightmapTexture != 0;
+	bool wasTogglingBaked = false;
+
+	camera.SetPerspective((float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
+
+	// The containers never move, so their hierarchy is built once and used for picking
+	scene.UpdateWorldMatrices();
+	std::vector<AABB> cubeBounds;
+	for (Entity cube : cubes)
+		cubeBounds.push_back(TransformAABB(AABB(glm::vec3(-0.5f), glm::vec3(0.5f)), scene.GetWorldMatrix(cube)));
+
+	BVH staticBVH;
+	{
+		CPU_SCOPE("static BVH");
+		staticBVH.Build(cubeBounds.data(), cubeBounds.size());
+	}
+	bool wasPicking = false;
+
+	// Depth pre-pass, P toggles it
+	bool depthPrepass = true;
+	bool wasTogglingPrepass = false;
+	std::vector<Entity> opaqueQueue;
+
+	// Culling results, one byte per scene entity
+	std::vector<uint8_t> visibility;
+	std::vector<AABB> entityBounds;
+	CullingStats cullingStats;
+
+	// The startup tasks are long done, this only gives the pool back
+	startupGraph.WaitAll();
+	OcclusionCuller occlusionCuller(threadPool);
+
+	// Draw calls of the frame, shadow passes included
+	size_t frameDraws = 0;
+
+	// Nothing moves, so past the first frame the far cascades come straight from the cache
+	ShadowCascades shadows(4, 2048, 40.0f, 30.0f);
+	std::vector<uint8_t> dynamicCasters(scene.Size(), 0);
+	auto drawShadowCasters = [&](const Shader& shader, const Entity* casters, size_t count) {
+		for (size_t i = 0; i < count; i++) {
+			if ((int)materialIds[casters[i]] != containerMaterial)
+				continue;	// Lamps give light, they don't block it
+			shader.setMat4f("model", scene.GetWorldMatrix(casters[i]));
+			cubeMesh->DrawDepth();
+			frameDraws++;
+		}
+	};
+	float lastStatsReport = 0.0f;
+
+	// The scene renders at the scale that holds the frame budget and is upscaled to the window, R toggles it
+	DynamicResolutionSettings scalingSettings;
+	scalingSettings.targetMs = FRAME_BUDGET_MS;
+	DynamicResolution dynamicResolution(SCR_WIDTH, SCR_HEIGHT, scalingSettings);
+	bool dynamicScaling = true;
+	bool wasTogglingScaling = false;
+	float reportedScale = dynamicResolution.GetScale();
+
+	// GPU time per pass, C prints it and writes the per frame CSV
+	GPUProfiler gpuProfiler;
+	GPUProfiler::SetActive(&gpuProfiler);
+	bool wasDumpingProfile = false;
+
+	// Frame time graphs, pass times, GL calls and memory on screen, O hides it
+	StatsOverlay statsOverlay(FRAME_BUDGET_MS);
+	bool wasTogglingOverlay = false;
+
+	// T starts and stops a CPU trace, --trace stops on its own after its frames
+	bool wasTracing = false;
+	auto finishTrace = [&]() {
+		CPU_PROFILE_STOP();
+		if (CPU_PROFILE_WRITE(tracePath))
+			std::cout << "CPU trace written to " << tracePath << std::endl;
+		traceFramesLeft = -1;
+	};
+
+	// I hooks every GL call, I again prints what the last frame called and writes the CSV
+	bool wasInterceptingGL = false;
+	bool wasReportingMemory = false;
+	startupGraph.EndPhase(setupPhase);
+	CPU_SCOPE_END(startup);
 	
 	// Render loop
 	while (!glfwWindowShouldClose(window))
 	{
+		if (traceFramesLeft >= 0 && traceFramesLeft-- == 0)
+			finishTrace();
+		CPU_SCOPE("frame");
+
 		/* Other computations */
 		float currentFrame = glfwGetTime();
 		deltaTime = currentFrame - lastFrame;
 		lastFrame = currentFrame;
 
 		/*Input commands*/
+		CPU_SCOPE_BEGIN(input, "input");
 		processInput(window);
 
+		// Left click picks the container in the middle of the screen
+		bool picking = glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS;
+		if (picking && !wasPicking) {
+			RayHit hit;
+			if (staticBVH.Raycast(camera.GetPosition(), camera.GetFront(), camera.GetFarPlane(), hit))
+				std::cout << "Picked container " << hit.index << " at distance " << hit.t << std::endl;
+		}
+		wasPicking = picking;
+
+		bool togglingPrepass = glfwGetKey(window, GLFW_KEY_P) == GLFW_PRESS;
+		if (togglingPrepass && !wasTogglingPrepass) {
+			depthPrepass = !depthPrepass;
+			std::cout << "Depth pre-pass " << (depthPrepass ? "on" : "off") << std::endl;
+		}
+		wasTogglingPrepass = togglingPrepass;
+
+		bool togglingBaked = glfwGetKey(window, GLFW_KEY_L) == GLFW_PRESS;
+		if (togglingBaked && !wasTogglingBaked && lightmapTexture) {
+			bakedLighting = !bakedLighting;
+			std::cout << "Lighting " << (bakedLighting ? "baked" : "realtime") << std::endl;
+		}
+		wasTogglingBaked = togglingBaked;
+
+		bool togglingScaling = glfwGetKey(window, GLFW_KEY_R) == GLFW_PRESS;
+		if (togglingScaling && !wasTogglingScaling) {
+			dynamicScaling = !dynamicScaling;
+			std::cout << "Dynamic resolution " << (dynamicScaling ? "on" : "off") << std::endl;
+		}
+		wasTogglingScaling = togglingScaling;
+
+		bool dumpingProfile = glfwGetKey(window, GLFW_KEY_C) == GLFW_PRESS;
+		if (dumpingProfile && !wasDumpingProfile) {
+			gpuProfiler.PrintReport();
+			if (gpuProfiler.WriteCSV(GPU_PROFILE_PATH))
+				std::cout << "GPU profile written to " << GPU_PROFILE_PATH << std::endl;
+		}
+		wasDumpingProfile = dumpingProfile;
+
+		bool tracing = glfwGetKey(window, GLFW_KEY_T) == GLFW_PRESS;
+		if (tracing && !wasTracing) {
+			if (CPU_PROFILE_RECORDING())
+				finishTrace();
+			else {
+				tracePath = CPU_TRACE_PATH;
+				CPU_PROFILE_START();
+				std::cout << "CPU trace started, T again to write it" << std::endl;
+			}
+		}
+		wasTracing = tracing;
+
+		bool interceptingGL = glfwGetKey(window, GLFW_KEY_I) == GLFW_PRESS;
+		if (interceptingGL && !wasInterceptingGL) {
+			if (IsGLInterceptorInstalled()) {
+				PrintGLCallReport();
+				if (WriteGLCallCSV(GL_CALLS_PATH))
+					std::cout << "GL calls written to " << GL_CALLS_PATH << std::endl;
+				RemoveGLInterceptor();
+			}
+			else if (InstallGLInterceptor())
+				std::cout << "GL calls counted, I again for the report" << std::endl;
+		}
+		wasInterceptingGL = interceptingGL;
+
+		bool reportingMemory = glfwGetKey(window, GLFW_KEY_M) == GLFW_PRESS;
+		if (reportingMemory && !wasReportingMemory)
+			PrintMemoryReport();
+		wasReportingMemory = reportingMemory;
+
+		bool togglingOverlay = glfwGetKey(window, GLFW_KEY_O) == GLFW_PRESS;
+		if (togglingOverlay && !wasTogglingOverlay)
+			statsOverlay.SetVisible(!statsOverlay.IsVisible());
+		wasTogglingOverlay = togglingOverlay;
+		CPU_SCOPE_END(input);
+
+		// Timed from here, so the shadow maps count towards the budget
+		int windowWidth, windowHeight;
+		glfwGetFramebufferSize(window, &windowWidth, &windowHeight);
+		gpuProfiler.BeginFrame();
+		if (dynamicScaling) {
+			dynamicResolution.SetOutputSize(windowWidth, windowHeight);
+			dynamicResolution.BeginFrame();
+
+			if (dynamicResolution.GetScale() != reportedScale) {
+				reportedScale = dynamicResolution.GetScale();
+				std::cout << "Resolution scale " << reportedScale << " (" << dynamicResolution.GetRenderWidth() << "x"
+					<< dynamicResolution.GetRenderHeight() << "), last frame " << dynamicResolution.GetLastFrame()->gpuMs << " ms" << std::endl;
+			}
+		}
+		const int renderHeight = dynamicScaling ? dynamicResolution.GetRenderHeight() : windowHeight;
+
+		// Only entities touched since last frame get their world matrix rebuilt
+		CPU_SCOPE_BEGIN(culling, "scene and culling");
+		scene.UpdateWorldMatrices();
+
+		// Frustum culling against the camera
+		const BoundingSpheres& bounds = scene.GetWorldBounds();
+		double cullStart = glfwGetTime();
+		visibility.resize(scene.Size());
+		cullingStats.tested = scene.Size();
+		cullingStats.visible = CullSpheres(camera.GetFrustum(), bounds.x.data(), bounds.y.data(), bounds.z.data(),
+			bounds.radius.data(), scene.Size(), visibility.data());
+		cullingStats.timeMs = (glfwGetTime() - cullStart) * 1000.0;
+
+		// Occlusion culling: the containers that survived are the occluders, then everything is tested against them
+		occlusionCuller.BeginFrame(camera.GetViewProjectionMatrix());
+		for (Entity cube : cubes) {
+			if (visibility[cube])
+				occlusionCuller.AddBoxOccluder(scene.GetWorldMatrix(cube));
+		}
+		occlusionCuller.RasterizeOccluders();
+
+		entityBounds.resize(scene.Size());
+		for (Entity e = 0; e < scene.Size(); e++)
+			entityBounds[e] = TransformAABB(AABB(glm::vec3(-0.5f), glm::vec3(0.5f)), scene.GetWorldMatrix(e));
+		occlusionCuller.TestBoxes(entityBounds.data(), scene.Size(), visibility.data());
+		CPU_SCOPE_END(culling);
+
+		// The lightmap already has the sun's shadows in it
+		frameDraws = 0;
+		if (!bakedLighting) {
+			CPU_SCOPE("shadows");
+			GPU_SCOPE("shadows");
+			shadows.Update(camera, SUN_DIRECTION);
+			shadows.Render(bounds, dynamicCasters.data(), scene.Size(), drawShadowCasters);
+		}
+		double shadowMs = 0.0;
+		for (int c = 0; c < shadows.GetCascadeCount() && !bakedLighting; c++)
+			shadowMs += shadows.GetStats(c).ms;
+
+		if (currentFrame - lastStatsReport > 1.0f) {
+			std::string title = "Learn OpenGL | visible " + std::to_string(cullingStats.visible) + "/" + std::to_string(cullingStats.tested)
+				+ " | culling " + std::to_string(cullingStats.timeMs) + " ms"
+				+ " | occluded " + std::to_string(occlusionCuller.GetStats().occluded)
+				+ " in " + std::to_string(occlusionCuller.GetStats().rasterMs + occlusionCuller.GetStats().testMs) + " ms"
+				+ " | shadows " + std::to_string(shadowMs) + " ms";
+			if (dynamicScaling && dynamicResolution.GetLastFrame())
+				title += " | scale " + std::to_string(dynamicResolution.GetScale()) + ", GPU "
+					+ std::to_string(dynamicResolution.GetLastFrame()->gpuMs) + " ms";
+			const GPUScopeStats frameStats = gpuProfiler.GetStats().front();
+			title += " | GPU frame avg " + std::to_string(frameStats.avgMs) + ", p99 " + std::to_string(frameStats.p99Ms) + " ms";
+			glfwSetWindowTitle(window, title.c_str());
+			lastStatsReport = currentFrame;
+		}
+
 		/* Rendering */
+		if (dynamicScaling)
+			dynamicResolution.Bind();
+		else {
+			glBindFramebuffer(GL_FRAMEBUFFER, 0);
+			glViewport(0, 0, windowWidth, windowHeight);
+		}
 		glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 		// change the light's position values over time (can be done anywhere in the render loop actually, but try to do it at least before using the light source positions)
 
 		// Activate the shader
+		CPU_SCOPE_BEGIN(uniforms, "uniforms");
 		lightingShader.use();
 		lightingShader.setVec3f("viewPos", camera.GetPosition());
 		// Material Properties
-		lightingShader.setFloat("material.shininess", 32.0f);
+		lightingShader.setFloat("material.shininess", containerShininess);
 
 
-		/*
-		   Here we set all the uniforms for the 5/6 types of lights we have. We have to set them manually and index
-		   the proper PointLight struct in the array to set each uniform variable. This can be done more code-friendly
-		   by defining light types as classes and set their values in there, or by using a more efficient uniform approach
-		   by using 'Uniform buffer objects', but that is something we'll discuss in the 'Advanced GLSL' tutorial.
-		*/
 		// directional light
-		lightingShader.setVec3f("dirLight.direction", -0.2f, -1.0f, -0.3f);
+		lightingShader.setVec3f("dirLight.direction", SUN_DIRECTION);
 		lightingShader.setVec3f("dirLight.ambient", 0.05f, 0.05f, 0.05f);
 		lightingShader.setVec3f("dirLight.diffuse", 0.4f, 0.4f, 0.4f);
 		lightingShader.setVec3f("dirLight.specular", 0.5f, 0.5f, 0.5f);
-		// point light 1	  
-		lightingShader.setVec3f("pointLights[0].position", pointLightPositions[0]);
-		lightingShader.setVec3f("pointLights[0].ambient", 0.05f, 0.05f, 0.05f);
-		lightingShader.setVec3f("pointLights[0].diffuse", 0.8f, 0.8f, 0.8f);
-		lightingShader.setVec3f("pointLights[0].specular", 1.0f, 1.0f, 1.0f);
-		lightingShader.setFloat("pointLights[0].constant", 1.0f);
-		lightingShader.setFloat("pointLights[0].linear", 0.09);
-		lightingShader.setFloat("pointLights[0].quadratic", 0.032);
-		// point light 2
-		lightingShader.setVec3f("pointLights[1].position", pointLightPositions[1]);
-		lightingShader.setVec3f("pointLights[1].ambient", 0.05f, 0.05f, 0.05f);
-		lightingShader.setVec3f("pointLights[1].diffuse", 0.8f, 0.8f, 0.8f);
-		lightingShader.setVec3f("pointLights[1].specular", 1.0f, 1.0f, 1.0f);
-		lightingShader.setFloat("pointLights[1].constant", 1.0f);
-		lightingShader.setFloat("pointLights[1].linear", 0.09);
-		lightingShader.setFloat("pointLights[1].quadratic", 0.032);
-		// point light 3
-		lightingShader.setVec3f("pointLights[2].position", pointLightPositions[2]);
-		lightingShader.setVec3f("pointLights[2].ambient", 0.05f, 0.05f, 0.05f);
-		lightingShader.setVec3f("pointLights[2].diffuse", 0.8f, 0.8f, 0.8f);
-		lightingShader.setVec3f("pointLights[2].specular", 1.0f, 1.0f, 1.0f);
-		lightingShader.setFloat("pointLights[2].constant", 1.0f);
-		lightingShader.setFloat("pointLights[2].linear", 0.09);
-		lightingShader.setFloat("pointLights[2].quadratic", 0.032);
-		// point light 4
-		lightingShader.setVec3f("pointLights[3].position", pointLightPositions[3]);
-		lightingShader.setVec3f("pointLights[3].ambient", 0.05f, 0.05f, 0.05f);
-		lightingShader.setVec3f("pointLights[3].diffuse", 0.8f, 0.8f, 0.8f);
-		lightingShader.setVec3f("pointLights[3].specular", 1.0f, 1.0f, 1.0f);
-		lightingShader.setFloat("pointLights[3].constant", 1.0f);
-		lightingShader.setFloat("pointLights[3].linear", 0.09);
-		lightingShader.setFloat("pointLights[3].quadratic", 0.032);
-		// spotLight
-		lightingShader.setVec3f("spotLight.position", camera.GetPosition());
-		lightingShader.setVec3f("spotLight.direction", camera.GetFront());
-		lightingShader.setVec3f("spotLight.ambient", 0.0f, 0.0f, 0.0f);
-		lightingShader.setVec3f("spotLight.diffuse", 1.0f, 1.0f, 1.0f);
-		lightingShader.setVec3f("spotLight.specular", 1.0f, 1.0f, 1.0f);
-		lightingShader.setFloat("spotLight.constant", 1.0f);
-		lightingShader.setFloat("spotLight.linear", 0.09);
-		lightingShader.setFloat("spotLight.quadratic", 0.032);
-		lightingShader.setFloat("spotLight.cutOff", glm::cos(glm::radians(12.5f)));
-		lightingShader.setFloat("spotLight.outerCutOff", glm::cos(glm::radians(15.0f)));
+		// point lights, packed with their range so the shader skips the ones too far away
+		for (size_t i = 0; i < pointLights.size(); i++)
+			lampLights[i].position = scene.GetPosition(pointLights[i]);
+		SetForwardPointLights(lightingShader, lampLights.data(), lampLights.size());
+		// spotLight, the baked lighting keeps it per pixel too
+		auto setSpotLight = [&](const Shader& shader) {
+			shader.setVec3f("spotLight.position", camera.GetPosition());
+			shader.setVec3f("spotLight.direction", camera.GetFront());
+			shader.setVec3f("spotLight.ambient", 0.0f, 0.0f, 0.0f);
+			shader.setVec3f("spotLight.diffuse", 1.0f, 1.0f, 1.0f);
+			shader.setVec3f("spotLight.specular", 1.0f, 1.0f, 1.0f);
+			shader.setFloat("spotLight.constant", 1.0f);
+			shader.setFloat("spotLight.linear", 0.09);
+			shader.setFloat("spotLight.quadratic", 0.032);
+			shader.setFloat("spotLight.cutOff", glm::cos(glm::radians(12.5f)));
+			shader.setFloat("spotLight.outerCutOff", glm::cos(glm::radians(15.0f)));
+		};
+		setSpotLight(lightingShader);
 							  
-		// Set projection
-		glm::mat4 projection = glm::perspective(glm::radians(camera.GetZoom()), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
+		// Set projection (cached by the camera, only rebuilt when it moved or zoomed)
+		const glm::mat4& projection = camera.GetProjectionMatrix();
 		// camera/view transformation
-		glm::mat4 view = camera.GetViewMatrix();
+		const glm::mat4& view = camera.GetViewMatrix();
 		
 		lightingShader.setMat4f("projection", projection);
 		lightingShader.setMat4f("view", view);
+		shadows.Bind(lightingShader, 3);
+
+		// Same inputs for the containers with baked lighting
+		if (bakedLighting) {
+			lightmapShader.use();
+			lightmapShader.setVec3f("viewPos", camera.GetPosition());
+			lightmapShader.setFloat("material.shininess", containerShininess);
+			setSpotLight(lightmapShader);
+			lightmapShader.setMat4f("projection", projection);
+			lightmapShader.setMat4f("view", view);
+
+			glActiveTexture(GL_TEXTURE4);
+			glBindTexture(GL_TEXTURE_2D, lightmapTexture);
+		}
+		Shader& surfaceShader = bakedLighting ? lightmapShader : lightingShader;
 
 		// Bind Textures
 		glowstoneTexture.Bind(GL_TEXTURE0);
 		woodTexture.Bind(GL_TEXTURE1);
 		woodTextureMask.Bind(GL_TEXTURE2);
+		CPU_SCOPE_END(uniforms);
+
+		// Level of detail from the projected error, the previous choice feeds the hysteresis
+		CPU_SCOPE_BEGIN(queue, "lod and sorting");
+		float projectionScale = camera.GetProjectionScale((float)renderHeight);
+		entityLODs.resize(scene.Size(), 0);
+		for (Entity e = 0; e < scene.Size(); e++) {
+			float distance = glm::length(glm::vec3(bounds.x[e], bounds.y[e], bounds.z[e]) - camera.GetPosition());
+			entityLODs[e] = cubeMesh->SelectLOD(distance, projectionScale, LOD_PIXEL_ERROR, entityLODs[e]);
+		}
+
+		// Visible containers nearest first, so early depth testing skips hidden fragments
+		opaqueQueue.clear();
+		for (Entity cube : cubes) {
+			if (visibility[cube])
+				opaqueQueue.push_back(cube);
+		}
+		SortFrontToBack(opaqueQueue.data(), opaqueQueue.size(), bounds.x.data(), bounds.y.data(), bounds.z.data(), camera.GetPosition());
+		CPU_SCOPE_END(queue);
+
+		// Depth only first, then the lighting runs once per pixel with GL_EQUAL
+		CPU_SCOPE_BEGIN(draws, "draw submission");
+		if (depthPrepass) {
+			GPU_SCOPE("depth prepass");
+			depthShader.use();
+			depthShader.setMat4f("projection", projection);
+			depthShader.setMat4f("view", view);
+
+			glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+			for (Entity cube : opaqueQueue) {
+				depthShader.setMat4f("model", scene.GetWorldMatrix(cube));
+				cubeMesh->DrawDepth(entityLODs[cube]);
+			}
+			frameDraws += opaqueQueue.size();
+			glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+
+			glDepthFunc(GL_EQUAL);
+			glDepthMask(GL_FALSE);
+			surfaceShader.use();
+		}
 
 		// Render the cube
-		glBindVertexArray(cubeVAO);
-		for (unsigned int i = 0; i < 10; i++) {
-			glm::mat4 model = glm::mat4(1.0f);
-			model = glm::translate(model, cubePositions[i]);
-			float angle = 20.0f * i;
-			model = glm::rotate(model, glm::radians(angle), glm::vec3(1.0f, 0.3f, 0.5f));
-			lightingShader.setMat4f("model", model);
-
-			glDrawArrays(GL_TRIANGLES, 0, 36);
+		{
+			GPU_SCOPE("containers");
+			for (Entity cube : opaqueQueue) {
+				surfaceShader.setMat4f("model", scene.GetWorldMatrix(cube));
+				if (bakedLighting)
+					surfaceShader.setVec4f("lightmapScaleOffset", lightmapAtlas.GetScaleOffset(lightmapInstances[cube]));
+
+				cubeMesh->Draw(entityLODs[cube]);
+			}
+			frameDraws += opaqueQueue.size();
 		}
 
+		glDepthFunc(GL_LESS);
+		glDepthMask(GL_TRUE);
+
 		// Also draw the lamp object
 		lightCubeShader.use();
 		lightCubeShader.setMat4f("projection", projection);
 		lightCubeShader.setMat4f("view", view);
 
 		// draw light bulbs as we have point lights
-		glBindVertexArray(lightCubeVAO);
-
-		for (unsigned int i = 0; i < 4; i++) {
-			glm::mat4 model = glm::mat4(1.0f);
-			model = glm::translate(model, pointLightPositions[i]);
-			model = glm::scale(model, glm::vec3(0.2f));
-			lightCubeShader.setMat4f("model", model);
-			
-			glDrawArrays(GL_TRIANGLES, 0, 36);
+		{
+			GPU_SCOPE("lamps");
+			for (Entity light : pointLights) {
+				if (!visibility[light])
+					continue;
+
+				lightCubeShader.setMat4f("model", scene.GetWorldMatrix(light));
+
+				cubeMesh->Draw(entityLODs[light]);
+				frameDraws++;
+			}
 		}
+		CPU_SCOPE_END(draws);
+
+		if (dynamicScaling) {
+			CPU_SCOPE("upscale");
+			GPU_SCOPE("upscale");
+			dynamicResolution.EndFrame(0, windowWidth, windowHeight);
+		}
+
+		// Over the upscaled frame, so it stays sharp and isn't counted in the scaling budget
+		statsOverlay.SetCounter("draw calls", (double)frameDraws);
+		statsOverlay.SetCounter("visible", (double)cullingStats.visible);
+		statsOverlay.SetCounter("occluded", (double)occlusionCuller.GetStats().occluded);
+		statsOverlay.SetCounter("resolution scale", dynamicScaling ? dynamicResolution.GetScale() : 1.0);
+		statsOverlay.Draw(windowWidth, windowHeight);
+		gpuProfiler.EndFrame();
+		if (IsGLInterceptorInstalled())
+			EndGLCallFrame();
+		EndGLCaptureFrame();
 
 		/* Check and call events and swap buffers */
+		CPU_SCOPE_BEGIN(swap, "swap");
 		glfwPollEvents();
 		glfwSwapBuffers(window);
+		startupGraph.FirstFrame();
+		CPU_SCOPE_END(swap);
 	}
 
-	// optional: de-allocate all resources once they've outlived their purpose:
-	glDeleteVertexArrays(1, &cubeVAO);
-	glDeleteVertexArrays(1, &lightCubeVAO);
-	glDeleteBuffers(1, &VBO);
+	// Closed before --trace had all its frames
+	if (CPU_PROFILE_RECORDING())
+		finishTrace();
+	StopGLCapture();
 
-	glfwTerminate();
+	// optional: de-allocate all resources once they've outlived their purpose:
+	cubeMesh.reset();
+	if (lightmapTexture) {
+		UntrackGPUMemory(GPUResource::Texture, lightmapTexture);
+		glDeleteTextures(1, &lightmapTexture);
+	}
 
 	return 0;
 }
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height) {
 	glViewport(0, 0, width, height);
+
+	// Minimised windows report a zero sized framebuffer
+	if (height > 0)
+		camera.SetAspectRatio((float)width / (float)height);
 }
 
 void processInput(GLFWwindow* window)
@@ -424,3 +1007,58 @@ void programLinkageCheck(unsigned int& id)
 		std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << std::endl;
 	}
 }
+
+
+int bakeLightmaps(int samples)
+{
+	if (!CompileSceneFile("./assets/scenes/sandbox.txt", "./assets/scenes/sandbox.aogs"))
+		return -1;
+
+	SceneFile sceneFile;
+	if (!sceneFile.Load("./assets/scenes/sandbox.aogs"))
+		return -1;
+
+	Scene scene;
+	sceneFile.AssignTo(scene);
+	scene.UpdateWorldMatrices();
+
+	// Same containers in the same order as the render loop, so their squares in the atlas match
+	const int containerMaterial = sceneFile.FindMaterial("container");
+	const int lampMaterial = sceneFile.FindMaterial("lamp");
+	const uint32_t* materialIds = sceneFile.GetMaterialIds();
+
+	std::vector<uint32_t> cubeIndices;
+	std::vector<Vertex> cubeVertices = Mesh::FromInterleaved(vertices, 36, cubeIndices);
+	std::vector<glm::vec2> lightmapUVs = UnwrapLightmapUVs(cubeVertices, cubeIndices, LIGHTMAP_RESOLUTION);
+
+	ThreadPool threadPool;
+	LightmapSettings settings;
+	settings.instanceResolution = LIGHTMAP_RESOLUTION;
+	settings.samples = samples;
+	LightmapBaker baker(threadPool, settings);
+
+	// The lamps light the scene but are not baked or in the way
+	std::vector<BakedPointLight> lamps;
+	for (Entity e = 0; e < scene.Size(); e++) {
+		if ((int)materialIds[e] == containerMaterial)
+			baker.AddInstance(cubeVertices, cubeIndices, lightmapUVs, scene.GetWorldMatrix(e));
+		else if ((int)materialIds[e] == lampMaterial)
+			lamps.push_back({ scene.GetPosition(e), glm::vec3(0.05f), glm::vec3(0.8f), 1.0f, 0.09f, 0.032f });
+	}
+
+	// Diffuse and ambient terms of the render loop's lights
+	BakedDirLight sun = { SUN_DIRECTION, glm::vec3(0.05f), glm::vec3(0.4f) };
+	baker.SetLights(sun, lamps.data(), lamps.size());
+	baker.Bake();
+
+	const LightmapStats& stats = baker.GetStats();
+	std::cout << "Lightmap " << baker.GetAtlas().width << "x" << baker.GetAtlas().height << ", " << stats.texels << " texels, "
+		<< samples << " samples on " << stats.threads << " threads" << std::endl;
+	std::cout << "  traced " << stats.rays << " rays in " << stats.traceMs << " ms (" << stats.RaysPerSecond() / 1e6 << " Mrays/s)"
+		<< ", denoised in " << stats.denoiseMs << " ms" << std::endl;
+
+	if (!baker.Write(LIGHTMAP_PATH))
+		return -1;
+	std::cout << "  written to " << LIGHTMAP_PATH << std::endl;
+	return 0;
+}
@@ -0,0 +1,204 @@
+#include "Scene.h"
+
+#include <cmath>
+
+// Build translate * rotate * scale without going through three full mat4 multiplies
+static inline glm::mat4 composeTRS(const glm::vec3& t, const glm::quat& q, const glm::vec3& s)
+{
+	glm::mat3 r = glm::mat3_cast(q);
+
+	return glm::mat4(
+		glm::vec4(r[0] * s.x, 0.0f),
+		glm::vec4(r[1] * s.y, 0.0f),
+		glm::vec4(r[2] * s.z, 0.0f),
+		glm::vec4(t, 1.0f));
+}
+
+Scene::Scene()
+	: m_FirstDirty(0), m_LastUpdateCount(0)
+{
+}
+
+void Scene::Reserve(size_t count)
+{
+	m_Positions.reserve(count);
+	m_Rotations.reserve(count);
+	m_Scales.reserve(count);
+	m_Parents.reserve(count);
+	m_LocalRadius.reserve(count);
+	m_LocalMatrices.reserve(count);
+	m_WorldMatrices.reserve(count);
+	m_WorldBounds.x.reserve(count);
+	m_WorldBounds.y.reserve(count);
+	m_WorldBounds.z.reserve(count);
+	m_WorldBounds.radius.reserve(count);
+	m_Dirty.reserve(count);
+	m_UpdateList.reserve(count);
+}
+
+void Scene::Clear()
+{
+	m_Positions.clear();
+	m_Rotations.clear();
+	m_Scales.clear();
+	m_Parents.clear();
+	m_LocalRadius.clear();
+	m_LocalMatrices.clear();
+	m_WorldMatrices.clear();
+	m_WorldBounds.x.clear();
+	m_WorldBounds.y.clear();
+	m_WorldBounds.z.clear();
+	m_WorldBounds.radius.clear();
+	m_Dirty.clear();
+	m_UpdateList.clear();
+
+	m_FirstDirty = 0;
+	m_LastUpdateCount = 0;
+}
+
+Entity Scene::CreateEntity(const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale, Entity parent)
+{
+	Entity e = (Entity)Size();
+
+	m_Positions.push_back(position);
+	m_Rotations.push_back(rotation);
+	m_Scales.push_back(scale);
+	// Parents must precede their children, anything else would break the single pass update
+	m_Parents.push_back(parent < e ? parent : NULL_ENTITY);
+	m_LocalRadius.push_back(0.0f);
+	m_LocalMatrices.push_back(glm::mat4(1.0f));
+	m_WorldMatrices.push_back(glm::mat4(1.0f));
+	m_WorldBounds.x.push_back(position.x);
+	m_WorldBounds.y.push_back(position.y);
+	m_WorldBounds.z.push_back(position.z);
+	m_WorldBounds.radius.push_back(0.0f);
+	m_Dirty.push_back(0);
+
+	markDirty(e);
+	return e;
+}
+
+void Scene::Assign(size_t count, const glm::vec3* positions, const glm::quat* rotations, const glm::vec3* scales,
+	const Entity* parents, const float* radii)
+{
+	m_Positions.assign(positions, positions + count);
+	m_Rotations.assign(rotations, rotations + count);
+	m_Scales.assign(scales, scales + count);
+	m_LocalRadius.assign(radii, radii + count);
+
+	m_Parents.resize(count);
+	Entity* ownParents = m_Parents.data();
+	for (size_t i = 0; i < count; i++)
+		ownParents[i] = parents[i] < i ? parents[i] : NULL_ENTITY;
+
+	// Derived data is overwritten by the next update
+	m_LocalMatrices.resize(count);
+	m_WorldMatrices.resize(count);
+	m_WorldBounds.x.resize(count);
+	m_WorldBounds.y.resize(count);
+	m_WorldBounds.z.resize(count);
+	m_WorldBounds.radius.resize(count);
+	m_Dirty.assign(count, 1);
+	m_UpdateList.clear();
+
+	m_FirstDirty = 0;
+	m_LastUpdateCount = 0;
+}
+
+void Scene::SetPosition(Entity e, const glm::vec3& position)
+{
+	m_Positions[e] = position;
+	markDirty(e);
+}
+
+void Scene::SetRotation(Entity e, const glm::quat& rotation)
+{
+	m_Rotations[e] = rotation;
+	markDirty(e);
+}
+
+void Scene::SetScale(Entity e, const glm::vec3& scale)
+{
+	m_Scales[e] = scale;
+	markDirty(e);
+}
+
+void Scene::SetBoundingRadius(Entity e, float radius)
+{
+	m_LocalRadius[e] = radius;
+	markDirty(e);
+}
+
+void Scene::UpdateWorldMatrices()
+{
+	const size_t count = Size();
+	m_LastUpdateCount = 0;
+	m_UpdateList.clear();
+
+	if (m_FirstDirty >= count)
+		return;
+
+	const Entity* parents = m_Parents.data();
+	const glm::vec3* positions = m_Positions.data();
+	const glm::quat* rotations = m_Rotations.data();
+	const glm::vec3* scales = m_Scales.data();
+	glm::mat4* local = m_LocalMatrices.data();
+	glm::mat4* world = m_WorldMatrices.data();
+	uint8_t* dirty = m_Dirty.data();
+
+	// 1) Push dirty flags down to the children and gather everything that needs work.
+	// Parents always sit at a lower index, so by the time we reach a child its parent's flag is final
+	for (size_t i = m_FirstDirty; i < count; i++) {
+		Entity parent = parents[i];
+		if (parent != NULL_ENTITY)
+			dirty[i] |= dirty[parent];
+		if (dirty[i])
+			m_UpdateList.push_back((Entity)i);
+	}
+
+	const Entity* list = m_UpdateList.data();
+	const size_t updated = m_UpdateList.size();
+
+	// 2) Local matrices only depend on the entity's own components
+	for (size_t n = 0; n < updated; n++) {
+		Entity i = list[n];
+		local[i] = composeTRS(positions[i], rotations[i], scales[i]);
+	}
+
+	// 3) Concatenate with the (already final) parent world matrix. The list is in
+	// ascending order, so parents are always resolved before their children
+	for (size_t n = 0; n < updated; n++) {
+		Entity i = list[n];
+		Entity parent = parents[i];
+		world[i] = (parent == NULL_ENTITY) ? local[i] : world[parent] * local[i];
+		dirty[i] = 0;
+	}
+
+	// 4) Move the bounding spheres along; the radius grows with the largest axis scale
+	float* bx = m_WorldBounds.x.data();
+	float* by = m_WorldBounds.y.data();
+	float* bz = m_WorldBounds.z.data();
+	float* br = m_WorldBounds.radius.data();
+	const float* localRadius = m_LocalRadius.data();
+	for (size_t n = 0; n < updated; n++) {
+		Entity i = list[n];
+		const glm::mat4& m = world[i];
+		float scale2 = glm::max(glm::max(glm::dot(glm::vec3(m[0]), glm::vec3(m[0])),
+			glm::dot(glm::vec3(m[1]), glm::vec3(m[1]))), glm::dot(glm::vec3(m[2]), glm::vec3(m[2])));
+
+		bx[i] = m[3].x;
+		by[i] = m[3].y;
+		bz[i] = m[3].z;
+		br[i] = localRadius[i] * sqrtf(scale2);
+	}
+
+	m_FirstDirty = count;
+	m_LastUpdateCount = updated;
+}
+
+void Scene::markDirty(Entity e)
+{
+	m_Dirty[e] = 1;
+	if (e < m_FirstDirty)
+		m_FirstDirty = e;
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+// System library
+#include <vector>
+#include <cstdint>
+
+typedef uint32_t Entity;
+const Entity NULL_ENTITY = 0xFFFFFFFF;
+
+// World space bounding spheres, SoA so culling can stream them 4/8 at a time
+struct BoundingSpheres
+{
+	std::vector<float> x, y, z, radius;
+};
+
+/*
+	Entities are plain indices into structure-of-arrays transform storage.
+	A parent is always created before its children, so the arrays are already
+	topologically sorted and one forward pass resolves the whole hierarchy.
+*/
+class Scene
+{
+private:
+	// Transform components (one slot per entity)
+	std::vector<glm::vec3> m_Positions;
+	std::vector<glm::quat> m_Rotations;
+	std::vector<glm::vec3> m_Scales;
+	std::vector<Entity> m_Parents;
+	std::vector<float> m_LocalRadius;	// Bounding sphere radius around the entity origin (0 = no geometry)
+
+	// Derived data
+	std::vector<glm::mat4> m_LocalMatrices;
+	std::vector<glm::mat4> m_WorldMatrices;
+	BoundingSpheres m_WorldBounds;
+	std::vector<uint8_t> m_Dirty;
+	std::vector<Entity> m_UpdateList;	// Scratch list of entities recomputed by an update
+
+	size_t m_FirstDirty;		// Lowest dirty index, everything before it is clean
+	size_t m_LastUpdateCount;	// Number of world matrices recomputed on the last update
+
+public:
+	Scene();
+
+	void Reserve(size_t count);
+	void Clear();
+
+	// Parent must already exist (or be NULL_ENTITY for a root)
+	Entity CreateEntity(const glm::vec3& position,
+		const glm::quat& rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f),
+		const glm::vec3& scale = glm::vec3(1.0f),
+		Entity parent = NULL_ENTITY);
+
+	// Replaces every entity with count new ones in one go (e.g. straight from a mapped scene file).
+	// Same rules as CreateEntity for the parents, everything starts dirty
+	void Assign(size_t count, const glm::vec3* positions, const glm::quat* rotations, const glm::vec3* scales,
+		const Entity* parents, const float* radii);
+
+	void SetPosition(Entity e, const glm::vec3& position);
+	void SetRotation(Entity e, const glm::quat& rotation);
+	void SetScale(Entity e, const glm::vec3& scale);
+	void SetBoundingRadius(Entity e, float radius);
+
+	// Recompute world matrices of dirty entities and their descendants
+	void UpdateWorldMatrices();
+
+	// Getters
+	size_t Size() const { return m_Positions.size(); }
+	size_t GetLastUpdateCount() const { return m_LastUpdateCount; }
+	const std::vector<Entity>& GetLastUpdateList() const { return m_UpdateList; }	// Ascending, e.g. for partial GPU uploads
+
+	const glm::vec3& GetPosition(Entity e) const { return m_Positions[e]; }
+	const glm::quat& GetRotation(Entity e) const { return m_Rotations[e]; }
+	const glm::vec3& GetScale(Entity e) const { return m_Scales[e]; }
+	Entity GetParent(Entity e) const { return m_Parents[e]; }
+	const glm::mat4& GetWorldMatrix(Entity e) const { return m_WorldMatrices[e]; }
+	const glm::mat4* GetWorldMatrices() const { return m_WorldMatrices.data(); }
+	const BoundingSpheres& GetWorldBounds() const { return m_WorldBounds; }
+
+private:
+	void markDirty(Entity e);
+};
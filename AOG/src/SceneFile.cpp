@@ -0,0 +1,345 @@
+#include "SceneFile.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstring>
+#include <cstdlib>
+
+#include <sys/stat.h>
+
+static_assert(sizeof(glm::vec3) == 12 && sizeof(glm::quat) == 16, "scene file sections are raw glm arrays");
+
+static const size_t SECTION_ALIGNMENT = 16;
+
+static size_t alignUp(size_t offset)
+{
+	return (offset + SECTION_ALIGNMENT - 1) & ~(SECTION_ALIGNMENT - 1);
+}
+
+Entity SceneDescription::AddEntity(const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale,
+	Entity parent, float radius, uint32_t material, uint32_t mesh)
+{
+	Entity e = (Entity)Size();
+
+	positions.push_back(position);
+	rotations.push_back(rotation);
+	scales.push_back(scale);
+	parents.push_back(parent < e ? parent : NULL_ENTITY);
+	radii.push_back(radius);
+	materialIds.push_back(material);
+	meshIds.push_back(mesh);
+	return e;
+}
+
+/*
+	Text format
+*/
+
+// "1,2,3" into up to count floats, returns how many were read
+static int parseFloats(const std::string& value, float* out, int count)
+{
+	const char* s = value.c_str();
+	int n = 0;
+	while (n < count && *s) {
+		char* end;
+		out[n] = strtof(s, &end);
+		if (end == s)
+			break;
+		n++;
+		s = (*end == ',') ? end + 1 : end;
+	}
+	return n;
+}
+
+template<typename T>
+static int findByName(const std::vector<T>& items, const std::string& name)
+{
+	for (size_t i = 0; i < items.size(); i++)
+		if (items[i].name == name)
+			return (int)i;
+	return -1;
+}
+
+bool ParseSceneText(const char* path, SceneDescription& scene)
+{
+	std::ifstream file(path);
+	if (!file.is_open()) {
+		std::cout << "ERROR::SCENE_FILE::TEXT_NOT_FOUND " << path << std::endl;
+		return false;
+	}
+
+	scene = SceneDescription();
+
+	std::string line;
+	int lineNumber = 0;
+	while (std::getline(file, line)) {
+		lineNumber++;
+		size_t comment = line.find('#');
+		if (comment != std::string::npos)
+			line.erase(comment);
+
+		std::istringstream tokens(line);
+		std::string kind;
+		if (!(tokens >> kind))
+			continue;
+
+		bool ok = true;
+		if (kind == "material") {
+			SceneDescription::Material material;
+			ok = (bool)(tokens >> material.name);
+
+			std::string token;
+			while (ok && tokens >> token) {
+				size_t eq = token.find('=');
+				std::string key = token.substr(0, eq), value = eq == std::string::npos ? "" : token.substr(eq + 1);
+				if (key == "diffuse")
+					material.diffuse = value;
+				else if (key == "specular")
+					material.specular = value;
+				else if (key == "shininess")
+					ok = parseFloats(value, &material.shininess, 1) == 1;
+				else
+					ok = false;
+			}
+			scene.materials.push_back(material);
+		}
+		else if (kind == "mesh") {
+			SceneDescription::MeshRef mesh;
+			ok = (bool)(tokens >> mesh.name >> mesh.path);
+			scene.meshes.push_back(mesh);
+		}
+		else if (kind == "entity") {
+			glm::vec3 position(0.0f), scale(1.0f);
+			glm::quat rotation(1.0f, 0.0f, 0.0f, 0.0f);
+			Entity parent = NULL_ENTITY;
+			float radius = 0.0f;
+			int material = scene.materials.empty() ? -1 : 0;
+			int mesh = scene.meshes.empty() ? -1 : 0;
+
+			std::string token;
+			while (ok && tokens >> token) {
+				size_t eq = token.find('=');
+				std::string key = token.substr(0, eq), value = eq == std::string::npos ? "" : token.substr(eq + 1);
+				float v[4];
+				if (key == "position") {
+					ok = parseFloats(value, v, 3) == 3;
+					position = glm::vec3(v[0], v[1], v[2]);
+				}
+				else if (key == "rotation") {
+					ok = parseFloats(value, v, 4) == 4 && (v[1] != 0.0f || v[2] != 0.0f || v[3] != 0.0f);
+					if (ok)
+						rotation = glm::angleAxis(glm::radians(v[0]), glm::normalize(glm::vec3(v[1], v[2], v[3])));
+				}
+				else if (key == "scale") {
+					int n = parseFloats(value, v, 3);
+					ok = n == 1 || n == 3;
+					scale = n == 3 ? glm::vec3(v[0], v[1], v[2]) : glm::vec3(v[0]);
+				}
+				else if (key == "radius")
+					ok = parseFloats(value, &radius, 1) == 1;
+				else if (key == "parent") {
+					long p = strtol(value.c_str(), nullptr, 10);
+					ok = p < (long)scene.Size();
+					parent = p < 0 ? NULL_ENTITY : (Entity)p;
+				}
+				else if (key == "material")
+					ok = (material = findByName(scene.materials, value)) >= 0;
+				else if (key == "mesh")
+					ok = (mesh = findByName(scene.meshes, value)) >= 0;
+				else
+					ok = false;
+			}
+
+			ok = ok && material >= 0 && mesh >= 0;
+			if (ok)
+				scene.AddEntity(position, rotation, scale, parent, radius, (uint32_t)material, (uint32_t)mesh);
+		}
+		else
+			ok = false;
+
+		if (!ok) {
+			std::cout << "ERROR::SCENE_FILE::PARSE_FAILED " << path << ":" << lineNumber << std::endl;
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/*
+	Binary format
+*/
+
+bool WriteSceneFile(const char* path, const SceneDescription& scene)
+{
+	const size_t count = scene.Size();
+
+	// Ids index the tables directly at load time, so this is the only place they get checked
+	for (size_t i = 0; i < count; i++) {
+		if (scene.materialIds[i] >= scene.materials.size() || scene.meshIds[i] >= scene.meshes.size()) {
+			std::cout << "ERROR::SCENE_FILE::INVALID_REFERENCE entity " << i << std::endl;
+			return false;
+		}
+	}
+
+	std::string strings;
+	auto addString = [&strings](const std::string& s) {
+		uint32_t offset = (uint32_t)strings.size();
+		strings.append(s.c_str(), s.size() + 1);
+		return offset;
+	};
+
+	std::vector<SceneFileMaterial> materials;
+	for (const SceneDescription::Material& m : scene.materials)
+		materials.push_back({ addString(m.name), addString(m.diffuse), addString(m.specular), m.shininess });
+
+	std::vector<SceneFileMesh> meshes;
+	for (const SceneDescription::MeshRef& m : scene.meshes)
+		meshes.push_back({ addString(m.name), addString(m.path) });
+
+	const void* data[SCENE_SECTION_COUNT] = {
+		scene.positions.data(), scene.rotations.data(), scene.scales.data(), scene.parents.data(), scene.radii.data(),
+		scene.materialIds.data(), scene.meshIds.data(), materials.data(), meshes.data(), strings.data()
+	};
+	const size_t sizes[SCENE_SECTION_COUNT] = {
+		count * sizeof(glm::vec3), count * sizeof(glm::quat), count * sizeof(glm::vec3), count * sizeof(Entity),
+		count * sizeof(float), count * sizeof(uint32_t), count * sizeof(uint32_t),
+		materials.size() * sizeof(SceneFileMaterial), meshes.size() * sizeof(SceneFileMesh), strings.size()
+	};
+
+	SceneFileHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, SCENE_FILE_MAGIC, sizeof(header.magic));
+	header.version = SCENE_FILE_VERSION;
+	header.entityCount = (uint32_t)count;
+	header.materialCount = (uint32_t)materials.size();
+	header.meshCount = (uint32_t)meshes.size();
+	header.stringBytes = (uint32_t)strings.size();
+
+	size_t offset = alignUp(sizeof(header));
+	for (int s = 0; s < SCENE_SECTION_COUNT; s++) {
+		header.offsets[s] = offset;
+		offset = alignUp(offset + sizes[s]);
+	}
+	header.fileSize = offset;
+
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file.is_open()) {
+		std::cout << "ERROR::SCENE_FILE::CANNOT_WRITE " << path << std::endl;
+		return false;
+	}
+
+	static const char padding[SECTION_ALIGNMENT] = {};
+	file.write((const char*)&header, sizeof(header));
+	size_t written = sizeof(header);
+	for (int s = 0; s < SCENE_SECTION_COUNT; s++) {
+		file.write(padding, header.offsets[s] - written);
+		file.write((const char*)data[s], sizes[s]);
+		written = header.offsets[s] + sizes[s];
+	}
+	file.write(padding, header.fileSize - written);
+
+	if (!file.good()) {
+		std::cout << "ERROR::SCENE_FILE::CANNOT_WRITE " << path << std::endl;
+		return false;
+	}
+	return true;
+}
+
+bool CompileSceneFile(const char* textPath, const char* binaryPath, bool force)
+{
+	struct stat text, binary;
+	if (stat(textPath, &text) != 0) {
+		std::cout << "ERROR::SCENE_FILE::TEXT_NOT_FOUND " << textPath << std::endl;
+		return false;
+	}
+	if (!force && stat(binaryPath, &binary) == 0 && binary.st_mtime >= text.st_mtime)
+		return true;
+
+	SceneDescription scene;
+	return ParseSceneText(textPath, scene) && WriteSceneFile(binaryPath, scene);
+}
+
+SceneFile::SceneFile()
+	: m_Header(nullptr)
+{
+}
+
+bool SceneFile::Load(const char* path)
+{
+	Close();
+
+	if (!m_File.Open(path)) {
+		std::cout << "ERROR::SCENE_FILE::NOT_FOUND " << path << std::endl;
+		return false;
+	}
+
+	const size_t fileSize = m_File.GetSize();
+	const SceneFileHeader* header = (const SceneFileHeader*)m_File.GetData();
+	if (fileSize < sizeof(SceneFileHeader) || memcmp(header->magic, SCENE_FILE_MAGIC, 4) != 0 ||
+		header->version != SCENE_FILE_VERSION || header->fileSize != fileSize) {
+		std::cout << "ERROR::SCENE_FILE::INVALID_HEADER " << path << std::endl;
+		m_File.Close();
+		return false;
+	}
+
+	// Bounds and alignment of every section; a truncated or foreign file stops here
+	const uint64_t n = header->entityCount;
+	const uint64_t sizes[SCENE_SECTION_COUNT] = {
+		n * sizeof(glm::vec3), n * sizeof(glm::quat), n * sizeof(glm::vec3), n * sizeof(Entity), n * sizeof(float),
+		n * sizeof(uint32_t), n * sizeof(uint32_t), header->materialCount * (uint64_t)sizeof(SceneFileMaterial),
+		header->meshCount * (uint64_t)sizeof(SceneFileMesh), header->stringBytes
+	};
+	bool valid = true;
+	for (int s = 0; s < SCENE_SECTION_COUNT; s++) {
+		uint64_t offset = header->offsets[s];
+		valid = valid && offset % SECTION_ALIGNMENT == 0 && offset <= fileSize && sizes[s] <= fileSize - offset;
+	}
+
+	// Table strings must land inside the string section, which must end with a terminator
+	const char* strings = (const char*)m_File.GetData() + (valid ? header->offsets[SCENE_SECTION_STRINGS] : 0);
+	valid = valid && (header->stringBytes == 0 || strings[header->stringBytes - 1] == '\0');
+	if (valid) {
+		const SceneFileMaterial* materials = (const SceneFileMaterial*)(m_File.GetData() + header->offsets[SCENE_SECTION_MATERIALS]);
+		const SceneFileMesh* meshes = (const SceneFileMesh*)(m_File.GetData() + header->offsets[SCENE_SECTION_MESHES]);
+		for (uint32_t i = 0; i < header->materialCount; i++)
+			valid = valid && materials[i].name < header->stringBytes && materials[i].diffuse < header->stringBytes &&
+				materials[i].specular < header->stringBytes;
+		for (uint32_t i = 0; i < header->meshCount; i++)
+			valid = valid && meshes[i].name < header->stringBytes && meshes[i].path < header->stringBytes;
+	}
+
+	if (!valid) {
+		std::cout << "ERROR::SCENE_FILE::CORRUPT " << path << std::endl;
+		m_File.Close();
+		return false;
+	}
+
+	m_Header = header;
+	return true;
+}
+
+void SceneFile::Close()
+{
+	m_File.Close();
+	m_Header = nullptr;
+}
+
+void SceneFile::AssignTo(Scene& scene) const
+{
+	if (!m_Header) {
+		scene.Clear();
+		return;
+	}
+
+	scene.Assign(Size(), GetPositions(), GetRotations(), GetScales(), GetParents(), GetRadii());
+}
+
+int SceneFile::FindMaterial(const char* name) const
+{
+	for (size_t i = 0; i < GetMaterialCount(); i++)
+		if (strcmp(GetString(GetMaterial(i).name), name) == 0)
+			return (int)i;
+	return -1;
+}
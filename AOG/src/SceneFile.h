@@ -0,0 +1,169 @@
+#pragma once
+
+#include "Scene.h"
+#include "MappedFile.h"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+// System library
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*
+	Binary scene format (".aogs"), laid out so a mapped file can be used as is:
+
+		SceneFileHeader
+		positions	vec3[entityCount]
+		rotations	quat[entityCount]	(glm's x, y, z, w order)
+		scales		vec3[entityCount]
+		parents		uint32[entityCount]	(NULL_ENTITY for roots, always a lower index otherwise)
+		radii		float[entityCount]
+		materials	uint32[entityCount]	(index into the material table)
+		meshes		uint32[entityCount]	(index into the mesh table)
+		SceneFileMaterial[materialCount]
+		SceneFileMesh[meshCount]
+		strings		null terminated, referenced by byte offset
+
+	Every section starts on a 16 byte boundary and its offset is in the header.
+	Little endian, as written by the machine that exports it.
+*/
+const char SCENE_FILE_MAGIC[4] = { 'A', 'O', 'G', 'S' };
+const uint32_t SCENE_FILE_VERSION = 1;
+
+enum SceneFileSection
+{
+	SCENE_SECTION_POSITIONS,
+	SCENE_SECTION_ROTATIONS,
+	SCENE_SECTION_SCALES,
+	SCENE_SECTION_PARENTS,
+	SCENE_SECTION_RADII,
+	SCENE_SECTION_MATERIAL_IDS,
+	SCENE_SECTION_MESH_IDS,
+	SCENE_SECTION_MATERIALS,
+	SCENE_SECTION_MESHES,
+	SCENE_SECTION_STRINGS,
+	SCENE_SECTION_COUNT
+};
+
+struct SceneFileHeader
+{
+	char magic[4];
+	uint32_t version;
+	uint32_t entityCount;
+	uint32_t materialCount;
+	uint32_t meshCount;
+	uint32_t stringBytes;
+	uint64_t offsets[SCENE_SECTION_COUNT];	// From the start of the file
+	uint64_t fileSize;
+};
+
+struct SceneFileMaterial
+{
+	uint32_t name;		// String offsets
+	uint32_t diffuse;
+	uint32_t specular;	// Empty string when there is none
+	float shininess;
+};
+
+struct SceneFileMesh
+{
+	uint32_t name;
+	uint32_t path;		// "builtin:cube" for the cube every demo uses
+};
+
+/*
+	Editable form of a scene: what the text format is parsed into and what the
+	binary writer takes. Only exporters and tools need this, loading goes through SceneFile.
+*/
+struct SceneDescription
+{
+	struct Material
+	{
+		std::string name, diffuse, specular;
+		float shininess = 32.0f;
+	};
+
+	struct MeshRef
+	{
+		std::string name, path;
+	};
+
+	std::vector<glm::vec3> positions;
+	std::vector<glm::quat> rotations;
+	std::vector<glm::vec3> scales;
+	std::vector<Entity> parents;
+	std::vector<float> radii;
+	std::vector<uint32_t> materialIds;
+	std::vector<uint32_t> meshIds;
+	std::vector<Material> materials;
+	std::vector<MeshRef> meshes;
+
+	size_t Size() const { return positions.size(); }
+	Entity AddEntity(const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale,
+		Entity parent, float radius, uint32_t material, uint32_t mesh);
+};
+
+/*
+	Text format, one item per line, '#' starts a comment:
+
+		material container diffuse=./assets/textures/a.png specular=./assets/textures/b.png shininess=32
+		mesh cube builtin:cube
+		entity mesh=cube material=container position=1,2,3 rotation=20,1,0.3,0.5 scale=0.2 radius=0.866 parent=0
+
+	rotation is an angle in degrees and an axis; scale is one value or x,y,z;
+	parent is the line index of an earlier entity (counting entities only), -1 or missing for a root.
+*/
+bool ParseSceneText(const char* path, SceneDescription& scene);
+bool WriteSceneFile(const char* path, const SceneDescription& scene);
+
+// Text to binary, skipped when the binary is newer than the text
+bool CompileSceneFile(const char* textPath, const char* binaryPath, bool force = false);
+
+/*
+	Read side: maps the file and validates the header and section bounds, nothing
+	else is touched until it is used. Entity data is read in place; material and
+	mesh ids are checked when the file is written, not when it is loaded.
+*/
+class SceneFile
+{
+private:
+	MappedFile m_File;
+	const SceneFileHeader* m_Header;
+
+public:
+	SceneFile();
+
+	bool Load(const char* path);
+	void Close();
+
+	// Copies the transform arrays into the scene (one memcpy each), everything ends up dirty
+	void AssignTo(Scene& scene) const;
+
+	// Getters
+	size_t Size() const { return m_Header ? m_Header->entityCount : 0; }
+	size_t GetMaterialCount() const { return m_Header ? m_Header->materialCount : 0; }
+	size_t GetMeshCount() const { return m_Header ? m_Header->meshCount : 0; }
+
+	const glm::vec3* GetPositions() const { return section<glm::vec3>(SCENE_SECTION_POSITIONS); }
+	const glm::quat* GetRotations() const { return section<glm::quat>(SCENE_SECTION_ROTATIONS); }
+	const glm::vec3* GetScales() const { return section<glm::vec3>(SCENE_SECTION_SCALES); }
+	const Entity* GetParents() const { return section<Entity>(SCENE_SECTION_PARENTS); }
+	const float* GetRadii() const { return section<float>(SCENE_SECTION_RADII); }
+	const uint32_t* GetMaterialIds() const { return section<uint32_t>(SCENE_SECTION_MATERIAL_IDS); }
+	const uint32_t* GetMeshIds() const { return section<uint32_t>(SCENE_SECTION_MESH_IDS); }
+	const SceneFileMaterial& GetMaterial(size_t i) const { return section<SceneFileMaterial>(SCENE_SECTION_MATERIALS)[i]; }
+	const SceneFileMesh& GetMesh(size_t i) const { return section<SceneFileMesh>(SCENE_SECTION_MESHES)[i]; }
+	const char* GetString(uint32_t offset) const { return section<char>(SCENE_SECTION_STRINGS) + offset; }
+
+	// Index in the material table, -1 when there is no such material
+	int FindMaterial(const char* name) const;
+
+private:
+	template<typename T>
+	const T* section(SceneFileSection s) const
+	{
+		return (const T*)(m_File.GetData() + m_Header->offsets[s]);
+	}
+};
@@ -1,10 +1,21 @@
 #include "Shader.h"
+#include "GL43.h"
+#include "CPUProfiler.h"
+#include "MemoryTracker.h"
 
 Shader::Shader(const char* vertexPath, const char* fragmentPath)
+	: Shader(ReadSources(vertexPath, fragmentPath))
 {
-	// 1) retrieve the vertex / fragment source code from filepath
-	std::string vertexCode;
-	std::string fragmentCode;
+}
+
+ShaderSources Shader::ReadSources(const char* vertexPath, const char* fragmentPath)
+{
+	CPU_SCOPE_DETAIL("read sources", fragmentPath);
+	ShaderSources sources;
+	sources.vertexPath = vertexPath;
+	sources.fragmentPath = fragmentPath;
+
+	// retrieve the vertex / fragment source code from filepath
 	std::ifstream vShaderFile;
 	std::ifstream fShaderFile;
 	// ensure ifstream objects can throw exceptions
@@ -26,23 +37,52 @@ Shader::Shader(const char* vertexPath, const char* fragmentPath)
 		fShaderFile.close();
 
 		// Convert stream into string
-		vertexCode = vShaderStream.str();
-		fragmentCode = fShaderStream.str();
+		sources.vertexCode = vShaderStream.str();
+		sources.fragmentCode = fShaderStream.str();
 	}
 	catch (std::ifstream::failure e)
 	{
 		std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ" << std::endl;
 	}
+	return sources;
+}
 
-	const char* vShaderCode = vertexCode.c_str();
-	const char* fShaderCode = fragmentCode.c_str();
+// After the #version line, which has to come first
+static void insertDefine(std::string& code, const std::string& line)
+{
+	size_t at = 0;
+	size_t version = code.find("#version");
+	if (version != std::string::npos) {
+		at = code.find('\n', version);
+		if (at == std::string::npos) {
+			code += '\n';
+			at = code.size() - 1;
+		}
+		at++;
+	}
+	code.insert(at, line);
+}
 
-	// 2) compile and link the shaders into a program
+void ShaderSources::Define(const char* name, int value)
+{
+	std::string line = std::string("#define ") + name + " " + std::to_string(value) + "\n";
+	insertDefine(vertexCode, line);
+	insertDefine(fragmentCode, line);
+}
+
+Shader::Shader(const ShaderSources& sources)
+{
+	CPU_SCOPE_DETAIL("Shader", sources.fragmentPath.c_str());
+	const char* vShaderCode = sources.vertexCode.c_str();
+	const char* fShaderCode = sources.fragmentCode.c_str();
+
+	// compile and link the shaders into a program
 	unsigned int vertex, fragment;
 	int success;
 	char infoLog[512];
 
 	// VERTEX SHADER
+	CPU_SCOPE_BEGIN(compile, "compile");
 	vertex = glCreateShader(GL_VERTEX_SHADER);
 	glShaderSource(vertex, 1, &vShaderCode, nullptr);
 	glCompileShader(vertex);
@@ -64,12 +104,15 @@ Shader::Shader(const char* vertexPath, const char* fragmentPath)
 		glGetShaderInfoLog(fragment, 512, NULL, infoLog);
 		std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << std::endl;
 	}
+	CPU_SCOPE_END(compile);
 
-	// Shader Program
+	// Shader Program, linking is where most drivers do the real work
+	CPU_SCOPE_BEGIN(link, "link");
 	id = glCreateProgram();
 	glAttachShader(id, vertex);
 	glAttachShader(id, fragment);
 	glLinkProgram(id);
+	TrackGPUMemory(GPUResource::Program, id, 0, "shader program", sources.fragmentPath);
 
 	// Print linking errors
 	glGetProgramiv(id, GL_LINK_STATUS, &success);
@@ -77,12 +120,69 @@ Shader::Shader(const char* vertexPath, const char* fragmentPath)
 		glGetProgramInfoLog(id, 512, nullptr, infoLog);
 		std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
 	}
+	CPU_SCOPE_END(link);
 
 	// delete the shaders as they're linked into our program now and no longer necessary
 	glDeleteShader(vertex);
 	glDeleteShader(fragment);
 }
 
+Shader::Shader(const char* computePath)
+{
+	CPU_SCOPE_DETAIL("Shader", computePath);
+
+	std::string computeCode;
+	std::ifstream cShaderFile;
+	cShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+
+	try {
+		cShaderFile.open(computePath);
+		std::stringstream cShaderStream;
+		cShaderStream << cShaderFile.rdbuf();
+		cShaderFile.close();
+		computeCode = cShaderStream.str();
+	}
+	catch (std::ifstream::failure e)
+	{
+		std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ" << std::endl;
+	}
+
+	const char* cShaderCode = computeCode.c_str();
+	int success;
+	char infoLog[512];
+
+	// COMPUTE SHADER
+	unsigned int compute = glCreateShader(GL_COMPUTE_SHADER);
+	glShaderSource(compute, 1, &cShaderCode, nullptr);
+	glCompileShader(compute);
+
+	glGetShaderiv(compute, GL_COMPILE_STATUS, &success);
+	if (!success) {
+		glGetShaderInfoLog(compute, 512, NULL, infoLog);
+		std::cout << "ERROR::SHADER::COMPUTE::COMPILATION_FAILED\n" << infoLog << std::endl;
+	}
+
+	// Shader Program
+	id = glCreateProgram();
+	glAttachShader(id, compute);
+	glLinkProgram(id);
+	TrackGPUMemory(GPUResource::Program, id, 0, "shader program", computePath);
+
+	glGetProgramiv(id, GL_LINK_STATUS, &success);
+	if (!success) {
+		glGetProgramInfoLog(id, 512, nullptr, infoLog);
+		std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
+	}
+
+	glDeleteShader(compute);
+}
+
+Shader::~Shader()
+{
+	UntrackGPUMemory(GPUResource::Program, id);
+	glDeleteProgram(id);
+}
+
 void Shader::use() {
 	glUseProgram(id);
 }
@@ -99,6 +199,11 @@ void Shader::setInt(const std::string& name, int value) const
 	glUniform1i(location, value);
 }
 
+void Shader::setUint(const std::string& name, unsigned int value) const
+{
+	unsigned int location = glGetUniformLocation(id, name.c_str());
+	glUniform1ui(location, value);
+}
 
 void Shader::setFloat(const std::string& name, float value) const
 {
@@ -106,6 +211,11 @@ void Shader::setFloat(const std::string& name, float value) const
 	glUniform1f(location, value);
 }
 
+void Shader::setVec2f(const std::string& name, float x, float y) const {
+	unsigned int location = glGetUniformLocation(id, name.c_str());
+	glUniform2f(location, x, y);
+}
+
 void Shader::setVec3f(const std::string& name, float x, float y, float z) const {
 	unsigned int location = glGetUniformLocation(id, name.c_str());
 	glUniform3f(location, x, y, z);
@@ -116,6 +226,16 @@ void Shader::setVec3f(const std::string& name, const glm::vec3& values) const {
 	glUniform3f(location, values.x, values.y, values.z);
 }
 
+void Shader::setVec4f(const std::string& name, const glm::vec4& values) const {
+	unsigned int location = glGetUniformLocation(id, name.c_str());
+	glUniform4f(location, values.x, values.y, values.z, values.w);
+}
+
+void Shader::setVec4fv(const std::string& name, const glm::vec4* values, int count) const {
+	unsigned int location = glGetUniformLocation(id, name.c_str());
+	glUniform4fv(location, count, glm::value_ptr(values[0]));
+}
+
 void Shader::setMat4f(const std::string& name, const glm::mat4& mat) const {
 	unsigned int location = glGetUniformLocation(id, name.c_str());
 	glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(mat));
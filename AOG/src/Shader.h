@@ -10,6 +10,16 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+// Source code of a vertex / fragment program, read from its files
+struct ShaderSources
+{
+	std::string vertexPath, fragmentPath;
+	std::string vertexCode, fragmentCode;
+
+	// Adds "#define name value" to both stages, after their #version line
+	void Define(const char* name, int value);
+};
+
 class Shader
 {
 public:
@@ -17,16 +27,31 @@ public:
 	
 	// constructor reads and builds the shader
 	Shader(const char* vertexPath, const char* fragmentPath);
+	// builds from sources read beforehand, e.g. on a worker during startup
+	explicit Shader(const ShaderSources& sources);
+	// compute only program (needs GL 4.3, see GL43.h)
+	explicit Shader(const char* computePath);
+	~Shader();
+
+	Shader(const Shader&) = delete;
+	Shader& operator=(const Shader&) = delete;
+
+	// File reads only, no GL: safe on any thread
+	static ShaderSources ReadSources(const char* vertexPath, const char* fragmentPath);
 
 	// use/activate the shader
 	void use();
 	// utility uniform functions
 	void setBool(const std::string& name, bool value) const;
 	void setInt(const std::string& name, int value) const;
+	void setUint(const std::string& name, unsigned int value) const;
 	void setFloat(const std::string& name, float value) const;
 	
+	void setVec2f(const std::string& name, float x, float y) const;
 	void setVec3f(const std::string& name, float x, float y, float z) const;
 	void setVec3f(const std::string& name, const glm::vec3& values) const;
+	void setVec4f(const std::string& name, const glm::vec4& values) const;
+	void setVec4fv(const std::string& name, const glm::vec4* values, int count) const;
 
 	void setMat4f(const std::string& name, const glm::mat4& mat) const;
 };
\ No newline at end of file
@@ -0,0 +1,247 @@
+#include "ShadowCascades.h"
+#include "Frustum.h"
+#include "Culling.h"
+#include "MemoryTracker.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <chrono>
+#include <cmath>
+#include <string>
+#include <algorithm>
+#include <iostream>
+
+static const float SPLIT_LAMBDA = 0.75f;	// 1 = logarithmic splits, 0 = uniform
+static const float CACHE_PADDING = 1.5f;	// Cached boxes are this much bigger than the slice they cover
+
+static unsigned int createDepthArray(int resolution, int layers)
+{
+	unsigned int texture;
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+	glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT24, resolution, resolution, std::max(layers, 1), 0,
+		GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+	TrackGPUMemory(GPUResource::Texture, texture, TextureBytes(GL_DEPTH_COMPONENT24, resolution, resolution, std::max(layers, 1)), "shadow map");
+
+	// Hardware compare with bilinear filtering: every tap is already a 2x2 PCF
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+	return texture;
+}
+
+ShadowCascades::ShadowCascades(int cascades, int resolution, float shadowDistance, float casterDistance, int firstCached)
+	: m_Count(glm::clamp(cascades, 1, MAX_CASCADES)), m_Resolution(resolution), m_FirstCached(glm::clamp(firstCached, 0, m_Count)),
+	  m_Distance(shadowDistance), m_CasterDistance(casterDistance), m_Lambda(SPLIT_LAMBDA), m_Caching(true),
+	  m_DepthShader("./assets/shaders/depthVShader.glsl", "./assets/shaders/depthFShader.glsl"),
+	  m_LightDirection(0.0f), m_LightView(1.0f), m_DepthPlane(0.0f)
+{
+	for (Cascade& cascade : m_Cascades)
+		cascade = Cascade();
+
+	m_ShadowMap = createDepthArray(m_Resolution, m_Count);
+	m_StaticMap = createDepthArray(m_Resolution, m_Count - m_FirstCached);
+
+	// Depth only, the layer is attached per cascade
+	unsigned int framebuffers[2];
+	glGenFramebuffers(2, framebuffers);
+	m_Framebuffer = framebuffers[0];
+	m_StaticFramebuffer = framebuffers[1];
+	for (unsigned int framebuffer : framebuffers) {
+		attachLayer(framebuffer, framebuffer == m_Framebuffer ? m_ShadowMap : m_StaticMap, 0);
+		glDrawBuffer(GL_NONE);
+		glReadBuffer(GL_NONE);
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+			std::cout << "ERROR::SHADOW_CASCADES::FRAMEBUFFER_INCOMPLETE" << std::endl;
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+ShadowCascades::~ShadowCascades()
+{
+	glDeleteFramebuffers(1, &m_Framebuffer);
+	glDeleteFramebuffers(1, &m_StaticFramebuffer);
+	UntrackGPUMemory(GPUResource::Texture, m_ShadowMap);
+	UntrackGPUMemory(GPUResource::Texture, m_StaticMap);
+	glDeleteTextures(1, &m_ShadowMap);
+	glDeleteTextures(1, &m_StaticMap);
+}
+
+void ShadowCascades::attachLayer(unsigned int framebuffer, unsigned int texture, int layer)
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, texture, 0, layer);
+}
+
+void ShadowCascades::InvalidateStatic()
+{
+	for (Cascade& cascade : m_Cascades)
+		cascade.staticValid = false;
+}
+
+void ShadowCascades::SetCaching(bool caching)
+{
+	m_Caching = caching;
+	for (Cascade& cascade : m_Cascades)
+		cascade.placed = cascade.staticValid = false;
+}
+
+void ShadowCascades::Update(const Camera& camera, const glm::vec3& lightDirection)
+{
+	// A turned light moves every box and every cached shadow
+	glm::vec3 direction = glm::normalize(lightDirection);
+	if (direction != m_LightDirection) {
+		m_LightDirection = direction;
+		glm::vec3 up = fabsf(direction.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+		m_LightView = glm::lookAt(glm::vec3(0.0f), direction, up);
+		for (Cascade& cascade : m_Cascades)
+			cascade.placed = cascade.staticValid = false;
+	}
+
+	const glm::mat4& view = camera.GetViewMatrix();
+	glm::mat4 inverseView = glm::inverse(view);
+	m_DepthPlane = -glm::vec4(view[0][2], view[1][2], view[2][2], view[3][2]);
+
+	const float nearPlane = camera.GetNearPlane();
+	const float farPlane = std::min(m_Distance, camera.GetFarPlane());
+	const float tanHalfFov = tan(glm::radians(camera.GetZoom()) * 0.5f);
+	const float k2 = tanHalfFov * tanHalfFov * (1.0f + camera.GetAspectRatio() * camera.GetAspectRatio());
+
+	float splitNear = nearPlane;
+	for (int c = 0; c < m_Count; c++) {
+		Cascade& cascade = m_Cascades[c];
+
+		// Practical split scheme
+		float s = (float)(c + 1) / m_Count;
+		float splitFar = m_Lambda * nearPlane * powf(farPlane / nearPlane, s) + (1.0f - m_Lambda) * (nearPlane + (farPlane - nearPlane) * s);
+		cascade.splitFar = splitFar;
+
+		// Smallest sphere through the slice corners, centred on the view axis. The corners sit at depth d,
+		// sqrt(k2) * d off the axis, so both ends are equally far from depth t = (n + f)(1 + k2) / 2
+		float t = std::min(0.5f * (splitNear + splitFar) * (1.0f + k2), splitFar);
+		float radius = sqrtf((splitFar - t) * (splitFar - t) + splitFar * splitFar * k2);
+		radius = ceilf(radius * 16.0f) / 16.0f;		// Same size every frame, no float jitter
+		glm::vec3 center = glm::vec3(m_LightView * inverseView * glm::vec4(0.0f, 0.0f, -t, 1.0f));
+		splitNear = splitFar;
+
+		bool cached = m_Caching && c >= m_FirstCached;
+		float boxRadius = cached ? radius * CACHE_PADDING : radius;
+		float texel = 2.0f * boxRadius / m_Resolution;
+
+		// Cached boxes stay put as long as the slice's sphere is still inside them
+		if (cached && cascade.placed) {
+			glm::vec3 offset = glm::abs(center - cascade.center);
+			if (std::max(offset.x, std::max(offset.y, offset.z)) + radius <= boxRadius)
+				continue;
+		}
+
+		// Whole texel steps in light space, so the rasterised casters land on the same texels
+		center.x = floorf(center.x / texel) * texel;
+		center.y = floorf(center.y / texel) * texel;
+		cascade.center = center;
+		cascade.radius = boxRadius;
+		cascade.placed = true;
+		cascade.staticValid = false;
+
+		// Light space looks down -z; near is pulled back towards the light for the casters in front of the box
+		cascade.projection = glm::ortho(center.x - boxRadius, center.x + boxRadius, center.y - boxRadius, center.y + boxRadius,
+			-center.z - boxRadius - m_CasterDistance, -center.z + boxRadius);
+		cascade.viewProjection = cascade.projection * m_LightView;
+	}
+}
+
+void ShadowCascades::Render(const BoundingSpheres& bounds, const uint8_t* dynamic, size_t count, const DrawCasters& draw, bool synchronous)
+{
+	GLint previousFramebuffer, viewport[4];
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousFramebuffer);
+	glGetIntegerv(GL_VIEWPORT, viewport);
+
+	glViewport(0, 0, m_Resolution, m_Resolution);
+	glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+	glEnable(GL_POLYGON_OFFSET_FILL);
+	glPolygonOffset(1.5f, 2.0f);	// Slope scaled, the receivers add a normal offset on top
+
+	m_DepthShader.use();
+	m_DepthShader.setMat4f("view", m_LightView);
+	m_Visibility.resize(count);
+
+	if (synchronous)
+		glFinish();
+
+	for (int c = 0; c < m_Count; c++) {
+		auto start = std::chrono::steady_clock::now();
+		Cascade& cascade = m_Cascades[c];
+		ShadowCascadeStats& stats = m_Stats[c];
+		stats = ShadowCascadeStats();
+
+		CullSpheres(Frustum::FromMatrix(cascade.viewProjection), bounds.x.data(), bounds.y.data(), bounds.z.data(),
+			bounds.radius.data(), count, m_Visibility.data());
+		m_DepthShader.setMat4f("projection", cascade.projection);
+
+		bool cached = m_Caching && c >= m_FirstCached;
+		if (cached && !cascade.staticValid) {
+			m_Casters.clear();
+			for (size_t e = 0; e < count; e++) {
+				if (m_Visibility[e] && !dynamic[e])
+					m_Casters.push_back((Entity)e);
+			}
+
+			attachLayer(m_StaticFramebuffer, m_StaticMap, c - m_FirstCached);
+			glClear(GL_DEPTH_BUFFER_BIT);
+			draw(m_DepthShader, m_Casters.data(), m_Casters.size());
+			cascade.staticValid = true;
+			stats.cacheRebuilt = true;
+			stats.casters += m_Casters.size();
+		}
+
+		attachLayer(m_Framebuffer, m_ShadowMap, c);
+		if (cached) {
+			// Static shadows from the cache, dynamic casters on top
+			glBindFramebuffer(GL_READ_FRAMEBUFFER, m_StaticFramebuffer);
+			glFramebufferTextureLayer(GL_READ_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, m_StaticMap, 0, c - m_FirstCached);
+			glBlitFramebuffer(0, 0, m_Resolution, m_Resolution, 0, 0, m_Resolution, m_Resolution, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+		}
+		else
+			glClear(GL_DEPTH_BUFFER_BIT);
+
+		m_Casters.clear();
+		for (size_t e = 0; e < count; e++) {
+			if (m_Visibility[e] && (!cached || dynamic[e]))
+				m_Casters.push_back((Entity)e);
+		}
+		draw(m_DepthShader, m_Casters.data(), m_Casters.size());
+		stats.casters += m_Casters.size();
+
+		if (synchronous)
+			glFinish();
+		stats.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	glDisable(GL_POLYGON_OFFSET_FILL);
+	glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+	glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+	glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+}
+
+void ShadowCascades::Bind(const Shader& shader, int unit) const
+{
+	glActiveTexture(GL_TEXTURE0 + unit);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, m_ShadowMap);
+	shader.setInt("shadowMap", unit);
+	shader.setInt("cascadeCount", m_Count);
+
+	// Unused cascades never get selected
+	glm::vec4 splits(1e30f), texels(0.0f);
+	for (int c = 0; c < m_Count; c++) {
+		splits[c] = m_Cascades[c].splitFar;
+		texels[c] = 2.0f * m_Cascades[c].radius / m_Resolution;
+		shader.setMat4f("cascadeMatrices[" + std::to_string(c) + "]", m_Cascades[c].viewProjection);
+	}
+	shader.setVec4f("cascadeSplits", splits);
+	shader.setVec4f("cascadeTexels", texels);
+	shader.setVec4f("cascadeDepthPlane", m_DepthPlane);
+}
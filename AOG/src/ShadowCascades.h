@@ -0,0 +1,110 @@
+#pragma once
+
+#include "Camera.h"
+#include "Shader.h"
+#include "Scene.h"
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+// System library
+#include <vector>
+#include <cstdint>
+#include <functional>
+
+struct ShadowCascadeStats
+{
+	size_t casters = 0;			// Drawn this frame, the static ones only count when the cache was rebuilt
+	bool cacheRebuilt = false;	// Static casters drawn again into the cache layer
+	double ms = 0.0;			// CPU submission, or until glFinish when rendered synchronously
+};
+
+/*
+	Cascaded shadow maps for the directional light.
+
+	The first shadowDistance units of the camera frustum are split into cascades
+	(practical split: a blend of logarithmic and uniform). Each cascade is an
+	orthographic box around the bounding sphere of its frustum slice; the sphere
+	only depends on the projection, so the box size never changes when the camera
+	turns, and its centre is snapped to whole shadow map texels so the edges don't
+	shimmer when it moves. The box is pulled back casterDistance towards the light
+	so casters outside the view still land in the map.
+
+	Casters are culled against every cascade's box with CullSpheres and drawn depth
+	only into one layer of a depth texture array, sampled as sampler2DArrayShadow.
+
+	The far cascades (firstCached on) are cached: their box is padded and only moves
+	when the view slice leaves it, and the static casters live in a separate layer
+	that is only drawn again when the box moved, the light turned or the static set
+	changed (InvalidateStatic). Each frame that layer is blitted in and only the
+	dynamic casters are drawn on top.
+*/
+class ShadowCascades
+{
+public:
+	static const int MAX_CASCADES = 4;	// Packed into vec4 uniforms
+
+	// Draws the given casters depth only: set "model" on the shader, then DrawDepth
+	typedef std::function<void(const Shader& depthShader, const Entity* casters, size_t count)> DrawCasters;
+
+private:
+	struct Cascade
+	{
+		float splitFar;			// View depth where the next cascade takes over
+		float radius;			// Half size of the ortho box
+		glm::vec3 center;		// Box centre in light space, texel snapped
+		glm::mat4 projection;
+		glm::mat4 viewProjection;
+		bool placed;			// Cached cascades: box valid from an earlier frame
+		bool staticValid;		// Cached cascades: static layer matches the box
+	};
+
+	int m_Count, m_Resolution, m_FirstCached;
+	float m_Distance, m_CasterDistance, m_Lambda;
+	bool m_Caching;
+
+	Shader m_DepthShader;
+	unsigned int m_ShadowMap;		// m_Count depth layers
+	unsigned int m_StaticMap;		// One layer per cached cascade
+	unsigned int m_Framebuffer, m_StaticFramebuffer;
+
+	Cascade m_Cascades[MAX_CASCADES];
+	ShadowCascadeStats m_Stats[MAX_CASCADES];
+	glm::vec3 m_LightDirection;
+	glm::mat4 m_LightView;			// Rotation only, the boxes carry the translation
+	glm::vec4 m_DepthPlane;			// View depth = dot(plane, (p, 1)) for the camera of the last Update
+
+	std::vector<uint8_t> m_Visibility;
+	std::vector<Entity> m_Casters;
+
+public:
+	ShadowCascades(int cascades = 4, int resolution = 2048, float shadowDistance = 60.0f, float casterDistance = 50.0f, int firstCached = 2);
+	~ShadowCascades();
+
+	ShadowCascades(const ShadowCascades&) = delete;
+	ShadowCascades& operator=(const ShadowCascades&) = delete;
+
+	// Fits the cascades to the camera, direction points from the light into the scene
+	void Update(const Camera& camera, const glm::vec3& lightDirection);
+
+	// Casters are the first count entities of bounds, dynamic[e] != 0 for the ones that move.
+	// Synchronous waits for every cascade to finish so its time includes the GPU work
+	void Render(const BoundingSpheres& bounds, const uint8_t* dynamic, size_t count, const DrawCasters& draw, bool synchronous = false);
+
+	// Static casters were added, removed or moved
+	void InvalidateStatic();
+
+	// Binds the shadow map to unit and sets the cascade uniforms of a program using them
+	void Bind(const Shader& shader, int unit) const;
+
+	void SetCaching(bool caching);
+
+	// Getters
+	int GetCascadeCount() const { return m_Count; }
+	int GetResolution() const { return m_Resolution; }
+	int GetFirstCached() const { return m_Caching ? m_FirstCached : m_Count; }
+	const ShadowCascadeStats& GetStats(int cascade) const { return m_Stats[cascade]; }
+
+private:
+	void attachLayer(unsigned int framebuffer, unsigned int texture, int layer);
+};
@@ -0,0 +1,146 @@
+#include "StartupGraph.h"
+#include "CPUProfiler.h"
+
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <utility>
+
+StartupGraph::StartupGraph(ThreadPool& pool)
+	: m_Pool(pool), m_Start(std::chrono::steady_clock::now()), m_WaitedMs(0.0), m_Reported(false)
+{
+}
+
+StartupGraph::~StartupGraph()
+{
+	if (m_Runner.joinable())
+		m_Runner.join();
+}
+
+double StartupGraph::GetElapsedMs() const
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_Start).count();
+}
+
+int StartupGraph::Add(const char* name, std::function<void()> work, std::vector<int> needs)
+{
+	m_Tasks.push_back({ name, std::move(work), std::move(needs), 0.0, 0.0, false });
+	return (int)m_Tasks.size() - 1;
+}
+
+void StartupGraph::Start()
+{
+	m_Done.assign(m_Tasks.size(), false);
+
+	// The pool hands the tasks out in order and each one only needs earlier ones, so whatever
+	// a task waits for is already running on another thread: no deadlock with any thread count
+	m_Runner = std::thread([this]() {
+		CPU_PROFILE_THREAD("startup");
+		m_Pool.ParallelFor((uint32_t)m_Tasks.size(), [this](uint32_t i) { run((int)i); });
+	});
+}
+
+void StartupGraph::run(int task)
+{
+	Task& t = m_Tasks[task];
+	{
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		m_Finished.wait(lock, [&] {
+			return std::all_of(t.needs.begin(), t.needs.end(), [&](int need) { return (bool)m_Done[need]; });
+		});
+	}
+
+	t.startMs = GetElapsedMs();
+	{
+		CPU_SCOPE(t.name);
+		t.work();
+	}
+	t.endMs = GetElapsedMs();
+
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Done[task] = true;
+	}
+	m_Finished.notify_all();
+}
+
+void StartupGraph::Wait(int task)
+{
+	CPU_SCOPE("wait for startup task");
+	double start = GetElapsedMs();
+	std::unique_lock<std::mutex> lock(m_Mutex);
+	m_Finished.wait(lock, [&] { return (bool)m_Done[task]; });
+	m_WaitedMs += GetElapsedMs() - start;
+}
+
+void StartupGraph::WaitAll()
+{
+	if (!m_Runner.joinable())
+		return;
+
+	double start = GetElapsedMs();
+	m_Runner.join();
+	m_WaitedMs += GetElapsedMs() - start;
+}
+
+int StartupGraph::BeginPhase(const char* name)
+{
+	double now = GetElapsedMs();
+	m_Phases.push_back({ name, nullptr, std::vector<int>(), now, now, true });
+	return (int)m_Phases.size() - 1;
+}
+
+void StartupGraph::EndPhase(int phase)
+{
+	m_Phases[phase].endMs = GetElapsedMs();
+}
+
+void StartupGraph::FirstFrame()
+{
+	if (m_Reported)
+		return;
+	m_Reported = true;
+	double firstFrameMs = GetElapsedMs();
+	WaitAll();
+
+	// Whatever the main thread did after its last phase, the frame itself mostly
+	double lastEndMs = 0.0;
+	for (const Task& t : m_Phases)
+		lastEndMs = std::max(lastEndMs, t.endMs);
+	m_Phases.push_back({ "first frame", nullptr, std::vector<int>(), lastEndMs, firstFrameMs, true });
+
+	// Work done on each side, the first frame is not startup work
+	std::vector<const Task*> timeline;
+	double mainMs = 0.0, workerMs = 0.0, slowestMs = 0.0;
+	const char* slowest = "";
+	for (const Task& t : m_Tasks) {
+		timeline.push_back(&t);
+		workerMs += t.endMs - t.startMs;
+	}
+	for (const Task& t : m_Phases) {
+		timeline.push_back(&t);
+		if (&t != &m_Phases.back())
+			mainMs += t.endMs - t.startMs;
+	}
+	for (const Task* task : timeline) {
+		const Task& t = *task;
+		double ms = t.endMs - t.startMs;
+		if (ms > slowestMs) {
+			slowestMs = ms;
+			slowest = t.name;
+		}
+	}
+	std::stable_sort(timeline.begin(), timeline.end(), [](const Task* a, const Task* b) { return a->startMs < b->startMs; });
+
+	std::cout << std::fixed << std::setprecision(1);
+	// The tasks run on the pool's workers and the runner thread, which works along with them
+	std::cout << "Startup: first frame after " << firstFrameMs << " ms, " << mainMs << " ms of main thread phases, "
+		<< workerMs << " ms of tasks on " << m_Pool.GetThreadCount() << " startup threads, main thread waited "
+		<< m_WaitedMs << " ms" << std::endl;
+	std::cout << "  slowest single step: " << slowest << ", " << slowestMs << " ms" << std::endl;
+	for (const Task* t : timeline) {
+		std::cout << "  " << std::setw(8) << t->startMs << " .. " << std::setw(8) << t->endMs << " ms  " << std::setw(8)
+			<< t->endMs - t->startMs << " ms  " << (t->onMainThread ? "main    " : "worker  ") << t->name << std::endl;
+	}
+	std::cout << std::defaultfloat << std::setprecision(6);
+}
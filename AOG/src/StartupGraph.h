@@ -0,0 +1,78 @@
+#pragma once
+
+#include "ThreadPool.h"
+
+// System library
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <chrono>
+
+/*
+	Startup as a small task graph: CPU work (file reads, image decodes, scene and
+	mesh preparation) is added as tasks with the tasks they need, and runs on the
+	pool from Start() on while the main thread creates the window and the GL
+	context. The main thread then waits for each result right before it uploads it,
+	so startup takes about as long as the slowest chain of work, not the sum.
+
+	Main thread work (anything touching GL) is only timed, between BeginPhase and
+	EndPhase. FirstFrame() closes the timeline and prints every task and phase with
+	when it ran, the time the main thread spent waiting and the time to first frame.
+
+	Tasks must not use GL or the pool, and a task only needs tasks added before it.
+	The pool is busy until every task finished, WaitAll() before using it elsewhere.
+*/
+class StartupGraph
+{
+private:
+	struct Task
+	{
+		const char* name;
+		std::function<void()> work;
+		std::vector<int> needs;
+		double startMs, endMs;
+		bool onMainThread;
+	};
+
+	ThreadPool& m_Pool;
+	std::chrono::steady_clock::time_point m_Start;
+	std::vector<Task> m_Tasks;		// Fixed once started, the workers hold on to them
+	std::vector<Task> m_Phases;
+	std::vector<bool> m_Done;
+	double m_WaitedMs;
+	std::thread m_Runner;
+	std::mutex m_Mutex;
+	std::condition_variable m_Finished;
+	bool m_Reported;
+
+public:
+	explicit StartupGraph(ThreadPool& pool);
+	~StartupGraph();
+
+	StartupGraph(const StartupGraph&) = delete;
+	StartupGraph& operator=(const StartupGraph&) = delete;
+
+	// Before Start(), returns the task's index for needs and Wait
+	int Add(const char* name, std::function<void()> work, std::vector<int> needs = std::vector<int>());
+	void Start();
+
+	// Blocks the main thread until the task finished
+	void Wait(int task);
+	void WaitAll();
+
+	// Main thread work, timed only
+	int BeginPhase(const char* name);
+	void EndPhase(int phase);
+
+	// Call once the first frame was presented, prints the report the first time. What the main
+	// thread did since its last phase is listed as the first frame
+	void FirstFrame();
+
+	// Since the graph was created
+	double GetElapsedMs() const;
+
+private:
+	void run(int task);
+};
@@ -0,0 +1,397 @@
+#include "StatsOverlay.h"
+#include "GPUProfiler.h"
+#include "CPUProfiler.h"
+#include "GLInterceptor.h"
+#include "MemoryTracker.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+
+static const double REFRESH_SECONDS = 0.25;
+
+// Font cells in the atlas, a glyph sits in the top left of its cell
+static const int GLYPH_WIDTH = 5, GLYPH_HEIGHT = 7;
+static const int FIRST_GLYPH = 32, GLYPH_COUNT = 95;	// Printable ASCII
+static const int ATLAS_COLUMNS = 16, CELL_WIDTH = 6, CELL_HEIGHT = 8;
+static const int ATLAS_WIDTH = ATLAS_COLUMNS * CELL_WIDTH, ATLAS_HEIGHT = 6 * CELL_HEIGHT;
+static const int SOLID_CELL = GLYPH_COUNT;		// Where DEL would go, all set
+
+// On screen, in pixels at scale 1
+static const int ADVANCE = 6, LINE_HEIGHT = 9, MARGIN = 8, PADDING = 4;
+static const int GRAPH_HEIGHT = 32;		// Twice the budget at the top
+
+static const int MEMORY_CATEGORIES = 3;	// Largest ones listed
+
+static const uint8_t TEXT_COLOR[4] = { 235, 235, 235, 255 };
+static const uint8_t DIM_COLOR[4] = { 160, 160, 160, 255 };
+static const uint8_t PANEL_COLOR[4] = { 0, 0, 0, 170 };
+static const uint8_t BUDGET_COLOR[4] = { 255, 255, 255, 110 };
+static const uint8_t FAST_COLOR[4] = { 90, 200, 90, 255 };
+static const uint8_t CLOSE_COLOR[4] = { 230, 200, 60, 255 };
+static const uint8_t SLOW_COLOR[4] = { 230, 70, 60, 255 };
+
+// 5x7 glyphs from ' ' to '~', 7 rows each, bit 4 is the leftmost column
+static const uint8_t FONT[GLYPH_COUNT * GLYPH_HEIGHT] = {
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x04, 0x04, 0x04, 0x04, 0x04, 0x00, 0x04, 0x0A, 0x0A, 0x0A, 0x00, 0x00, 0x00, 0x00, 0x0A, 0x0A, 0x1F, 0x0A, 0x1F, 0x0A, 0x0A,	//   ! " #
+	0x04, 0x0F, 0x14, 0x0E, 0x05, 0x1E, 0x04, 0x18, 0x19, 0x02, 0x04, 0x08, 0x13, 0x03, 0x0C, 0x12, 0x14, 0x08, 0x15, 0x12, 0x0D, 0x04, 0x04, 0x08, 0x00, 0x00, 0x00, 0x00,	// $ % & '
+	0x02, 0x04, 0x08, 0x08, 0x08, 0x04, 0x02, 0x08, 0x04, 0x02, 0x02, 0x02, 0x04, 0x08, 0x00, 0x04, 0x15, 0x0E, 0x15, 0x04, 0x00, 0x00, 0x04, 0x04, 0x1F, 0x04, 0x04, 0x00,	// ( ) * +
+	0x00, 0x00, 0x00, 0x00, 0x0C, 0x04, 0x08, 0x00, 0x00, 0x00, 0x1F, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C, 0x00, 0x01, 0x02, 0x04, 0x08, 0x10, 0x00,	// , - . /
+	0x0E, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0E, 0x04, 0x0C, 0x04, 0x04, 0x04, 0x04, 0x0E, 0x0E, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1F, 0x1F, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0E,	// 0 1 2 3
+	0x02, 0x06, 0x0A, 0x12, 0x1F, 0x02, 0x02, 0x1F, 0x10, 0x1E, 0x01, 0x01, 0x11, 0x0E, 0x06, 0x08, 0x10, 0x1E, 0x11, 0x11, 0x0E, 0x1F, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08,	// 4 5 6 7
+	0x0E, 0x11, 0x11, 0x0E, 0x11, 0x11, 0x0E, 0x0E, 0x11, 0x11, 0x0F, 0x01, 0x02, 0x0C, 0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x0C, 0x00, 0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x04, 0x08,	// 8 9 : ;
+	0x02, 0x04, 0x08, 0x10, 0x08, 0x04, 0x02, 0x00, 0x00, 0x1F, 0x00, 0x1F, 0x00, 0x00, 0x08, 0x04, 0x02, 0x01, 0x02, 0x04, 0x08, 0x0E, 0x11, 0x01, 0x02, 0x04, 0x00, 0x04,	// < = > ?
+	0x0E, 0x11, 0x01, 0x0D, 0x15, 0x15, 0x0E, 0x0E, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11, 0x1E, 0x11, 0x11, 0x1E, 0x11, 0x11, 0x1E, 0x0E, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0E,	// @ A B C
+	0x1C, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1C, 0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x1F, 0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x10, 0x0E, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0F,	// D E F G
+	0x11, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11, 0x0E, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0E, 0x07, 0x02, 0x02, 0x02, 0x02, 0x12, 0x0C, 0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11,	// H I J K
+	0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1F, 0x11, 0x1B, 0x15, 0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11, 0x0E, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E,	// L M N O
+	0x1E, 0x11, 0x11, 0x1E, 0x10, 0x10, 0x10, 0x0E, 0x11, 0x11, 0x11, 0x15, 0x12, 0x0D, 0x1E, 0x11, 0x11, 0x1E, 0x14, 0x12, 0x11, 0x0F, 0x10, 0x10, 0x0E, 0x01, 0x01, 0x1E,	// P Q R S
+	0x1F, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0A, 0x04, 0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0A,	// T U V W
+	0x11, 0x11, 0x0A, 0x04, 0x0A, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0A, 0x04, 0x04, 0x04, 0x1F, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1F, 0x0E, 0x08, 0x08, 0x08, 0x08, 0x08, 0x0E,	// X Y Z [
+	0x00, 0x10, 0x08, 0x04, 0x02, 0x01, 0x00, 0x0E, 0x02, 0x02, 0x02, 0x02, 0x02, 0x0E, 0x04, 0x0A, 0x11, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1F,	// \ ] ^ _
+	0x08, 0x04, 0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x0E, 0x01, 0x0F, 0x11, 0x0F, 0x10, 0x10, 0x16, 0x19, 0x11, 0x11, 0x1E, 0x00, 0x00, 0x0E, 0x10, 0x10, 0x11, 0x0E,	// ` a b c
+	0x01, 0x01, 0x0D, 0x13, 0x11, 0x11, 0x0F, 0x00, 0x00, 0x0E, 0x11, 0x1F, 0x10, 0x0E, 0x06, 0x09, 0x08, 0x1C, 0x08, 0x08, 0x08, 0x00, 0x0F, 0x11, 0x11, 0x0F, 0x01, 0x0E,	// d e f g
+	0x10, 0x10, 0x16, 0x19, 0x11, 0x11, 0x11, 0x04, 0x00, 0x0C, 0x04, 0x04, 0x04, 0x0E, 0x02, 0x00, 0x06, 0x02, 0x02, 0x12, 0x0C, 0x10, 0x10, 0x12, 0x14, 0x18, 0x14, 0x12,	// h i j k
+	0x0C, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0E, 0x00, 0x00, 0x1A, 0x15, 0x15, 0x11, 0x11, 0x00, 0x00, 0x16, 0x19, 0x11, 0x11, 0x11, 0x00, 0x00, 0x0E, 0x11, 0x11, 0x11, 0x0E,	// l m n o
+	0x00, 0x00, 0x1E, 0x11, 0x1E, 0x10, 0x10, 0x00, 0x00, 0x0D, 0x13, 0x0F, 0x01, 0x01, 0x00, 0x00, 0x16, 0x19, 0x10, 0x10, 0x10, 0x00, 0x00, 0x0E, 0x10, 0x0E, 0x01, 0x1E,	// p q r s
+	0x08, 0x08, 0x1C, 0x08, 0x08, 0x09, 0x06, 0x00, 0x00, 0x11, 0x11, 0x11, 0x13, 0x0D, 0x00, 0x00, 0x11, 0x11, 0x11, 0x0A, 0x04, 0x00, 0x00, 0x11, 0x11, 0x15, 0x15, 0x0A,	// t u v w
+	0x00, 0x00, 0x11, 0x0A, 0x04, 0x0A, 0x11, 0x00, 0x00, 0x11, 0x11, 0x0F, 0x01, 0x0E, 0x00, 0x00, 0x1F, 0x02, 0x04, 0x08, 0x1F, 0x02, 0x04, 0x04, 0x08, 0x04, 0x04, 0x02,	// x y z {
+	0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x08, 0x04, 0x04, 0x02, 0x04, 0x04, 0x08, 0x00, 0x00, 0x08, 0x15, 0x02, 0x00, 0x00,	// | } ~
+};
+
+StatsOverlay::StatsOverlay(float budgetMs)
+	: m_Shader("./assets/shaders/overlayVShader.glsl", "./assets/shaders/overlayFShader.glsl"),
+	m_FontTexture(0), m_VAO(0), m_VBO(0), m_EBO(0), m_BufferBytes(0), m_IndexedQuads(0), m_BudgetMs(std::max(budgetMs, 0.1f)), m_Visible(true), m_Scale(1),
+	m_LastGPUFrame(-1), m_FirstDraw(true), m_CostMs(0.0), m_CostTotalMs(0.0), m_CostFrames(0)
+{
+	for (Graph* graph : { &m_CPUGraph, &m_GPUGraph }) {
+		std::fill(graph->ms, graph->ms + GRAPH_FRAMES, 0.0f);
+		graph->next = 0;
+		graph->x = graph->y = 0.0f;
+		graph->shown = false;
+	}
+
+	// Bake the glyphs into an R8 atlas, coverage 0 or 255
+	std::vector<uint8_t> atlas(ATLAS_WIDTH * ATLAS_HEIGHT, 0);
+	for (int glyph = 0; glyph < GLYPH_COUNT; glyph++) {
+		int cellX = (glyph % ATLAS_COLUMNS) * CELL_WIDTH, cellY = (glyph / ATLAS_COLUMNS) * CELL_HEIGHT;
+		for (int y = 0; y < GLYPH_HEIGHT; y++) {
+			for (int x = 0; x < GLYPH_WIDTH; x++) {
+				if (FONT[glyph * GLYPH_HEIGHT + y] & (0x10 >> x))
+					atlas[(cellY + y) * ATLAS_WIDTH + cellX + x] = 255;
+			}
+		}
+	}
+	int solidX = (SOLID_CELL % ATLAS_COLUMNS) * CELL_WIDTH, solidY = (SOLID_CELL / ATLAS_COLUMNS) * CELL_HEIGHT;
+	for (int y = 0; y < CELL_HEIGHT; y++)
+		std::fill(&atlas[(solidY + y) * ATLAS_WIDTH + solidX], &atlas[(solidY + y) * ATLAS_WIDTH + solidX + CELL_WIDTH], (uint8_t)255);
+
+	glGenTextures(1, &m_FontTexture);
+	glBindTexture(GL_TEXTURE_2D, m_FontTexture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, ATLAS_WIDTH, ATLAS_HEIGHT, 0, GL_RED, GL_UNSIGNED_BYTE, atlas.data());
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	TrackGPUMemory(GPUResource::Texture, m_FontTexture, TextureBytes(GL_R8, ATLAS_WIDTH, ATLAS_HEIGHT), "overlay", "font");
+
+	// The buffers get their storage on the first draw
+	glGenVertexArrays(1, &m_VAO);
+	glGenBuffers(1, &m_VBO);
+	glGenBuffers(1, &m_EBO);
+	glBindVertexArray(m_VAO);
+	glBindBuffer(GL_ARRAY_BUFFER, m_VBO);
+	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, x));
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, u));
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex), (void*)offsetof(Vertex, color));
+	glEnableVertexAttribArray(2);
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	m_Shader.use();
+	m_Shader.setInt("font", 0);
+}
+
+StatsOverlay::~StatsOverlay()
+{
+	UntrackGPUMemory(GPUResource::Texture, m_FontTexture);
+	UntrackGPUMemory(GPUResource::Buffer, m_VBO);
+	UntrackGPUMemory(GPUResource::Buffer, m_EBO);
+	glDeleteTextures(1, &m_FontTexture);
+	glDeleteBuffers(1, &m_VBO);
+	glDeleteBuffers(1, &m_EBO);
+	glDeleteVertexArrays(1, &m_VAO);
+}
+
+void StatsOverlay::SetCounter(const char* name, double value)
+{
+	for (Counter& counter : m_Counters) {
+		if (counter.name == name || strcmp(counter.name, name) == 0) {
+			counter.value = value;
+			return;
+		}
+	}
+	m_Counters.push_back({ name, value });
+}
+
+static void pushTime(float* ms, int& next, float value)
+{
+	ms[next] = value;
+	next = (next + 1) % StatsOverlay::GRAPH_FRAMES;
+}
+
+void StatsOverlay::Draw(int width, int height)
+{
+	CPU_SCOPE("stats overlay");
+	auto start = std::chrono::steady_clock::now();
+
+	// Sampled while hidden too, so the graphs have no gap once shown
+	if (!m_FirstDraw)
+		pushTime(m_CPUGraph.ms, m_CPUGraph.next, std::chrono::duration<float, std::milli>(start - m_LastDraw).count());
+	m_LastDraw = start;
+
+	GPUProfiler* profiler = GPUProfiler::GetActive();
+	int gpuFrame;
+	double gpuMs;
+	if (profiler && profiler->GetLastFrame(gpuFrame, gpuMs) && gpuFrame != m_LastGPUFrame) {
+		pushTime(m_GPUGraph.ms, m_GPUGraph.next, (float)gpuMs);
+		m_LastGPUFrame = gpuFrame;
+	}
+
+	if (!m_Visible || width <= 0 || height <= 0)
+		return;
+	GPU_SCOPE("overlay");
+
+	// Twice as large from 1440 lines on
+	int scale = std::max(height / 720, 1);
+	if (m_FirstDraw || scale != m_Scale || std::chrono::duration<double>(start - m_LastRefresh).count() >= REFRESH_SECONDS) {
+		m_Scale = scale;
+		m_CostMs = m_CostFrames > 0 ? m_CostTotalMs / m_CostFrames : 0.0;
+		m_CostTotalMs = 0.0;
+		m_CostFrames = 0;
+		refreshText();
+		m_LastRefresh = start;
+	}
+	m_FirstDraw = false;
+
+	m_Vertices.assign(m_TextVertices.begin(), m_TextVertices.end());
+	if (m_CPUGraph.shown)
+		addGraph(m_CPUGraph);
+	if (m_GPUGraph.shown)
+		addGraph(m_GPUGraph);
+	upload();
+
+	GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+	GLboolean blend = glIsEnabled(GL_BLEND);
+	glDisable(GL_DEPTH_TEST);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+	m_Shader.use();
+	m_Shader.setVec2f("screenSize", (float)width, (float)height);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, m_FontTexture);
+	glBindVertexArray(m_VAO);
+	glDrawElements(GL_TRIANGLES, (GLsizei)(m_Vertices.size() / 4 * 6), GL_UNSIGNED_INT, nullptr);
+	glBindVertexArray(0);
+
+	if (!blend)
+		glDisable(GL_BLEND);
+	if (depthTest)
+		glEnable(GL_DEPTH_TEST);
+
+	m_CostTotalMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	m_CostFrames++;
+}
+
+static void graphStats(const float* ms, float& average, float& highest)
+{
+	average = highest = 0.0f;
+	int count = 0;
+	for (int i = 0; i < StatsOverlay::GRAPH_FRAMES; i++) {
+		if (ms[i] <= 0.0f)
+			continue;	// Not filled yet
+		average += ms[i];
+		highest = std::max(highest, ms[i]);
+		count++;
+	}
+	average /= std::max(count, 1);
+}
+
+static double megabytes(size_t bytes)
+{
+	return bytes / (1024.0 * 1024.0);
+}
+
+void StatsOverlay::refreshText()
+{
+	// A line with a graph gets it right under it
+	struct Line
+	{
+		std::string text;
+		const uint8_t* color;
+		Graph* graph;
+	};
+	std::vector<Line> lines;
+	char text[160];
+	float average, highest;
+
+	graphStats(m_CPUGraph.ms, average, highest);
+	snprintf(text, sizeof(text), "CPU frame %6.2f ms, max %6.2f, %4.0f fps", average, highest, average > 0.0f ? 1000.0f / average : 0.0f);
+	lines.push_back({ text, TEXT_COLOR, &m_CPUGraph });
+
+	GPUProfiler* profiler = GPUProfiler::GetActive();
+	m_GPUGraph.shown = false;
+	if (profiler) {
+		std::vector<GPUScopeStats> stats = profiler->GetStats();
+		graphStats(m_GPUGraph.ms, average, highest);
+		snprintf(text, sizeof(text), "GPU frame %6.2f ms, max %6.2f, p99 %6.2f", average, highest, stats.front().p99Ms);
+		lines.push_back({ text, TEXT_COLOR, &m_GPUGraph });
+
+		// Passes averaged over the profiler's history
+		for (size_t i = 1; i < stats.size(); i++) {
+			int indent = 2 * stats[i].depth;
+			snprintf(text, sizeof(text), "%*s%-*s %6.2f ms", indent, "", std::max(24 - indent, 1), stats[i].name.c_str(), stats[i].avgMs);
+			lines.push_back({ text, DIM_COLOR, nullptr });
+		}
+	}
+	else
+		lines.push_back({ "GPU frame: no profiler active", DIM_COLOR, nullptr });
+
+	if (IsGLInterceptorInstalled()) {
+		GLCallFrameTotals calls = GetLastGLCallFrame();
+		snprintf(text, sizeof(text), "GL %llu draws, %llu calls, %llu redundant, %.2f ms in the driver", (unsigned long long)calls.drawCalls,
+			(unsigned long long)calls.calls, (unsigned long long)calls.redundant, calls.driverMs);
+		lines.push_back({ text, TEXT_COLOR, nullptr });
+	}
+
+	MemorySnapshot memory = GetMemorySnapshot();
+	snprintf(text, sizeof(text), "GPU memory %7.1f MB in %u, heap %7.1f MB", megabytes(memory.gpuBytes), (unsigned)memory.gpuCount,
+		megabytes(memory.heapBytes));
+	lines.push_back({ text, TEXT_COLOR, nullptr });
+	for (size_t i = 0; i < memory.gpu.size() && i < (size_t)MEMORY_CATEGORIES; i++) {
+		snprintf(text, sizeof(text), "  %-22s %7.1f MB", memory.gpu[i].name.c_str(), megabytes(memory.gpu[i].bytes));
+		lines.push_back({ text, DIM_COLOR, nullptr });
+	}
+
+	for (const Counter& counter : m_Counters) {
+		if (counter.value == (double)(long long)counter.value)
+			snprintf(text, sizeof(text), "%-24s %9lld", counter.name, (long long)counter.value);
+		else
+			snprintf(text, sizeof(text), "%-24s %9.2f", counter.name, counter.value);
+		lines.push_back({ text, TEXT_COLOR, nullptr });
+	}
+
+	snprintf(text, sizeof(text), "overlay %.3f ms CPU, %u quads, 1 draw", m_CostMs, (unsigned)(m_Vertices.size() / 4));
+	lines.push_back({ text, DIM_COLOR, nullptr });
+
+	// Panel around everything, then the text on it
+	const float s = (float)m_Scale;
+	size_t longest = 0;
+	float panelHeight = 0.0f;
+	for (const Line& line : lines) {
+		longest = std::max(longest, line.text.size());
+		panelHeight += LINE_HEIGHT * s + (line.graph ? (GRAPH_HEIGHT + 2) * s : 0.0f);
+	}
+	float panelWidth = std::max(longest * ADVANCE * s, GRAPH_FRAMES * s);
+
+	m_TextVertices.clear();
+	float x = (MARGIN + PADDING) * s, y = (MARGIN + PADDING) * s;
+	addRect(m_TextVertices, MARGIN * s, MARGIN * s, x + panelWidth + PADDING * s, y + panelHeight + PADDING * s, PANEL_COLOR);
+	for (const Line& line : lines) {
+		addText(x, y, line.text.c_str(), line.color);
+		y += LINE_HEIGHT * s;
+		if (line.graph) {
+			line.graph->x = x;
+			line.graph->y = y;
+			line.graph->shown = true;
+			y += (GRAPH_HEIGHT + 2) * s;
+		}
+	}
+}
+
+void StatsOverlay::addQuad(std::vector<Vertex>& vertices, float x0, float y0, float x1, float y1, float u0, float v0, float u1, float v1, const uint8_t color[4])
+{
+	// Clockwise on screen, the index buffer makes the two triangles
+	vertices.push_back({ x0, y0, u0, v0, { color[0], color[1], color[2], color[3] } });
+	vertices.push_back({ x1, y0, u1, v0, { color[0], color[1], color[2], color[3] } });
+	vertices.push_back({ x1, y1, u1, v1, { color[0], color[1], color[2], color[3] } });
+	vertices.push_back({ x0, y1, u0, v1, { color[0], color[1], color[2], color[3] } });
+}
+
+void StatsOverlay::addRect(std::vector<Vertex>& vertices, float x0, float y0, float x1, float y1, const uint8_t color[4])
+{
+	// Middle of the solid cell, nearest filtering keeps it there
+	float u = ((SOLID_CELL % ATLAS_COLUMNS) * CELL_WIDTH + CELL_WIDTH * 0.5f) / ATLAS_WIDTH;
+	float v = ((SOLID_CELL / ATLAS_COLUMNS) * CELL_HEIGHT + CELL_HEIGHT * 0.5f) / ATLAS_HEIGHT;
+	addQuad(vertices, x0, y0, x1, y1, u, v, u, v, color);
+}
+
+void StatsOverlay::addText(float x, float y, const char* text, const uint8_t color[4])
+{
+	const float s = (float)m_Scale;
+	for (const char* c = text; *c; c++, x += ADVANCE * s) {
+		int glyph = (unsigned char)*c - FIRST_GLYPH;
+		if (glyph <= 0 || glyph >= GLYPH_COUNT)
+			continue;	// Spaces and what the font doesn't have
+
+		float u = (float)((glyph % ATLAS_COLUMNS) * CELL_WIDTH) / ATLAS_WIDTH;
+		float v = (float)((glyph / ATLAS_COLUMNS) * CELL_HEIGHT) / ATLAS_HEIGHT;
+		addQuad(m_TextVertices, x, y, x + GLYPH_WIDTH * s, y + GLYPH_HEIGHT * s, u, v,
+			u + (float)GLYPH_WIDTH / ATLAS_WIDTH, v + (float)GLYPH_HEIGHT / ATLAS_HEIGHT, color);
+	}
+}
+
+void StatsOverlay::addGraph(const Graph& graph)
+{
+	// Oldest on the left, the budget halfway up
+	const float s = (float)m_Scale;
+	const float bottom = graph.y + GRAPH_HEIGHT * s;
+	for (int i = 0; i < GRAPH_FRAMES; i++) {
+		float ms = graph.ms[(graph.next + i) % GRAPH_FRAMES];
+		if (ms <= 0.0f)
+			continue;
+
+		float bar = std::min(ms / (2.0f * m_BudgetMs), 1.0f) * GRAPH_HEIGHT * s;
+		const uint8_t* color = ms > m_BudgetMs ? SLOW_COLOR : ms > 0.8f * m_BudgetMs ? CLOSE_COLOR : FAST_COLOR;
+		addRect(m_Vertices, graph.x + i * s, bottom - std::max(bar, s), graph.x + (i + 1) * s, bottom, color);
+	}
+	float budget = bottom - 0.5f * GRAPH_HEIGHT * s;
+	addRect(m_Vertices, graph.x, budget, graph.x + GRAPH_FRAMES * s, budget + s, BUDGET_COLOR);
+}
+
+void StatsOverlay::upload()
+{
+	// Same two triangles for every quad, only written again when there are more quads than ever
+	size_t quads = m_Vertices.size() / 4;
+	if (quads > m_IndexedQuads) {
+		m_IndexedQuads = std::max(quads, 2 * m_IndexedQuads);
+		std::vector<uint32_t> indices(m_IndexedQuads * 6);
+		for (size_t q = 0; q < m_IndexedQuads; q++) {
+			const uint32_t corner = (uint32_t)q * 4;
+			const uint32_t quad[6] = { corner, corner + 1, corner + 2, corner, corner + 2, corner + 3 };
+			std::copy(quad, quad + 6, &indices[q * 6]);
+		}
+		glBindVertexArray(m_VAO);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_EBO);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(uint32_t), indices.data(), GL_STATIC_DRAW);
+		TrackGPUMemory(GPUResource::Buffer, m_EBO, indices.size() * sizeof(uint32_t), "overlay", "indices");
+		glBindVertexArray(0);
+	}
+
+	size_t bytes = m_Vertices.size() * sizeof(Vertex);
+	glBindBuffer(GL_ARRAY_BUFFER, m_VBO);
+	if (bytes > m_BufferBytes) {
+		m_BufferBytes = std::max(bytes, 2 * m_BufferBytes);
+		TrackGPUMemory(GPUResource::Buffer, m_VBO, m_BufferBytes, "overlay", "vertices");
+	}
+
+	// Orphan and refill, the previous frame may still be reading the old storage
+	glBufferData(GL_ARRAY_BUFFER, m_BufferBytes, nullptr, GL_STREAM_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, m_Vertices.data());
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
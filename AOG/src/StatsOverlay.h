@@ -0,0 +1,110 @@
+#pragma once
+
+#include "Shader.h"
+
+// Third Party library
+#include <glad/glad.h>
+
+// System library
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <chrono>
+
+/*
+	On-screen performance stats: CPU and GPU frame time graphs against the frame
+	budget, the GPU time of every pass, the GL calls of the last frame, memory by
+	category and whatever counters the caller sets, in the top left corner.
+
+	Everything is quads out of one small texture, a 5x7 bitmap font baked into the
+	code with a solid texel for the panel and the graph bars. The corners of a frame's
+	quads are written into one vertex buffer, orphaned and refilled every frame, and
+	drawn with a single indexed draw call; the index buffer only changes when it
+	grows. The text only changes a few times a second so it can
+	be read, its quads are kept in between; the graphs move every frame.
+
+	It reads the counters the engine already keeps: the active GPUProfiler, the GL
+	interceptor while installed and the memory tracker. Its own CPU cost is on the
+	last line, its GPU time is the "overlay" scope.
+*/
+class StatsOverlay
+{
+public:
+	static const int GRAPH_FRAMES = 120;	// One column per frame
+
+private:
+	struct Vertex
+	{
+		float x, y;			// Pixels from the top left corner
+		float u, v;
+		uint8_t color[4];
+	};
+
+	struct Counter
+	{
+		const char* name;
+		double value;
+	};
+
+	// Frame times in a ring, next is the oldest
+	struct Graph
+	{
+		float ms[GRAPH_FRAMES];
+		int next;
+		float x, y;			// Placed with the text, the top left corner
+		bool shown;
+	};
+
+	Shader m_Shader;
+	unsigned int m_FontTexture;
+	unsigned int m_VAO, m_VBO, m_EBO;
+	size_t m_BufferBytes;
+	size_t m_IndexedQuads;		// The index buffer has triangles for this many
+
+	float m_BudgetMs;
+	bool m_Visible;
+	int m_Scale;
+
+	Graph m_CPUGraph, m_GPUGraph;
+	int m_LastGPUFrame;
+	std::chrono::steady_clock::time_point m_LastDraw, m_LastRefresh;
+	bool m_FirstDraw;
+
+	std::vector<Counter> m_Counters;
+	std::vector<Vertex> m_TextVertices;	// Panel and text, rebuilt on refresh
+	std::vector<Vertex> m_Vertices;		// Of the frame, 4 per quad
+
+	double m_CostMs, m_CostTotalMs;		// Of Draw, averaged between refreshes
+	int m_CostFrames;
+
+public:
+	// budgetMs is the middle of the graphs, drawn as a line
+	explicit StatsOverlay(float budgetMs = 16.0f);
+	~StatsOverlay();
+
+	StatsOverlay(const StatsOverlay&) = delete;
+	StatsOverlay& operator=(const StatsOverlay&) = delete;
+
+	// Listed under the built in stats, set every frame before Draw. name must be a literal
+	void SetCounter(const char* name, double value);
+
+	// Over the bound framebuffer, whose viewport covers width x height. Once per frame, inside
+	// the profiler's frame; the frame time is measured from one call to the next
+	void Draw(int width, int height);
+
+	// Hidden, Draw keeps the graphs going and draws nothing
+	void SetVisible(bool visible) { m_Visible = visible; }
+	bool IsVisible() const { return m_Visible; }
+
+	// CPU cost of Draw averaged over the last refresh period
+	double GetCostMs() const { return m_CostMs; }
+	size_t GetQuadCount() const { return m_Vertices.size() / 4; }
+
+private:
+	void refreshText();
+	void addText(float x, float y, const char* text, const uint8_t color[4]);
+	void addQuad(std::vector<Vertex>& vertices, float x0, float y0, float x1, float y1, float u0, float v0, float u1, float v1, const uint8_t color[4]);
+	void addRect(std::vector<Vertex>& vertices, float x0, float y0, float x1, float y1, const uint8_t color[4]);
+	void addGraph(const Graph& graph);
+	void upload();
+};
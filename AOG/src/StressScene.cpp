@@ -0,0 +1,1537 @@
+#include "StressScene.h"
+#include "OffscreenContext.h"
+#include "Framebuffer.h"
+#include "GBuffer.h"
+#include "Shader.h"
+#include "Texture.h"
+#include "Camera.h"
+#include "Scene.h"
+#include "Culling.h"
+#include "Mesh.h"
+#include "GPUCuller.h"
+#include "LightClusters.h"
+#include "ShadowCascades.h"
+#include "DynamicResolution.h"
+#include "GPUProfiler.h"
+#include "CPUProfiler.h"
+#include "GLInterceptor.h"
+#include "GLCapture.h"
+#include "MemoryTracker.h"
+#include "ImageCompare.h"
+#include "StatsOverlay.h"
+#include "ThreadPool.h"
+
+#include <glm/gtc/quaternion.hpp>
+
+#if defined(_WIN32)
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <ctime>
+#include <random>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <utility>
+#include <cerrno>
+#include <cstdio>
+#include <sstream>
+#include <iomanip>
+#include <map>
+
+static const float SPACING = 2.5f;			// Grid cell size, objects are jittered inside their cell
+static const float SPIN_FRACTION = 0.25f;	// Share of objects animated every frame
+static const float FRAME_STEP = 1.0f / 60.0f;	// Fixed simulation step so every run sees the same frames
+static const int QUERY_LATENCY = 4;			// Frames between issuing a timer query and reading it back
+static const int LIGHT_COUNT = 4;			// Lights with a lamp cube and their full range
+static const int CLUSTER_UNIT = 3;			// Texture units of the light clusters (3 of them)
+static const int GBUFFER_UNIT = 6;			// and of the G-buffer (3 of them)
+static const int SHADOW_UNIT = 9;			// Cascaded shadow map array
+static const glm::vec3 SUN_DIRECTION(-0.2f, -1.0f, -0.3f);	// Directional light, also the shadows' light
+
+struct StressMaterial
+{
+	const char* diffusePath;
+	float shininess;
+};
+
+static const StressMaterial MATERIALS[] = {
+	{ "./assets/textures/container_steel.png", 32.0f },
+	{ "./assets/textures/wood.jpg", 8.0f },
+	{ "./assets/textures/container.jpg", 64.0f },
+	{ "./assets/textures/awesomeface.png", 128.0f },
+};
+static const int MATERIAL_COUNT = sizeof(MATERIALS) / sizeof(MATERIALS[0]);
+
+// Circle around the vertical axis for the extra lights of the clustered path
+struct LightOrbit
+{
+	float radius, height, speed, phase;
+};
+
+// Percentiles of the measured frames
+struct FrameTimes
+{
+	double p50 = 0.0, p90 = 0.0, p95 = 0.0, p99 = 0.0, max = 0.0, mean = 0.0;
+};
+
+// Summary of one run, for the benchmarks driving several of them
+struct StressRunResult
+{
+	double frameMs = 0.0;	// Wall clock per frame over the whole run, GPU included
+	double cpuMs = 0.0;		// Medians
+	double gpuMs = 0.0;
+	FrameTimes cpuTimes, gpuTimes;
+	int measuredFrames = 0;
+	bool gpuCulling = false;	// Falls back to the CPU without GL 4.3
+	double drawCalls = 0.0;		// Per frame, shadow passes included
+	double triangles = 0.0;
+	double visible = 0.0;
+	double shadedPerPixel = 0.0;
+	std::vector<GPUScopeStats> passes;
+	double assignMs = 0.0;
+	double lightsPerCluster = 0.0;	// Average over the non-empty clusters
+	double targetMB = 0.0;		// Color / G-buffer bytes written and read per frame
+	double shadowMs = 0.0;		// Medians of the whole shadow pass and of each cascade
+	double cascadeMs[ShadowCascades::MAX_CASCADES] = {};
+	double cascadeCasters[ShadowCascades::MAX_CASCADES] = {};	// Drawn per frame
+	int cascadeRebuilds[ShadowCascades::MAX_CASCADES] = {};		// Frames the static casters were drawn
+	Image lastFrame;			// With keepLastFrame
+};
+
+struct Spinner
+{
+	Entity entity;
+	glm::quat base;
+	glm::vec3 axis;
+	float speed;		// Radians per second
+};
+
+static double elapsedMs(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Nearest rank percentile, p in [0, 100]
+static double percentile(std::vector<double> values, double p)
+{
+	if (values.empty())
+		return 0.0;
+
+	std::sort(values.begin(), values.end());
+	size_t rank = (size_t)std::ceil(p / 100.0 * values.size());
+	return values[rank > 0 ? rank - 1 : 0];
+}
+
+static FrameTimes summarizeTimes(const std::vector<double>& times)
+{
+	FrameTimes t;
+	t.p50 = percentile(times, 50.0);
+	t.p90 = percentile(times, 90.0);
+	t.p95 = percentile(times, 95.0);
+	t.p99 = percentile(times, 99.0);
+	t.max = percentile(times, 100.0);
+	for (double ms : times)
+		t.mean += ms;
+	t.mean /= std::max(times.size(), (size_t)1);
+	return t;
+}
+
+static void reportTimes(const char* label, const std::vector<double>& times)
+{
+	std::cout << "  " << label << " ms: p50 " << percentile(times, 50.0) << ", p95 " << percentile(times, 95.0)
+		<< ", p99 " << percentile(times, 99.0) << ", max " << percentile(times, 100.0) << std::endl;
+}
+
+// Unit cube with per face normals and uvs, counter-clockwise faces
+static void buildCube(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+{
+	const glm::vec3 normals[6] = {
+		glm::vec3(1, 0, 0), glm::vec3(-1, 0, 0), glm::vec3(0, 1, 0),
+		glm::vec3(0, -1, 0), glm::vec3(0, 0, 1), glm::vec3(0, 0, -1)
+	};
+
+	for (const glm::vec3& n : normals) {
+		// Two axes spanning the face, u x v = n
+		glm::vec3 u = glm::vec3(n.y, n.z, n.x);
+		glm::vec3 v = glm::cross(n, u);
+
+		uint32_t base = (uint32_t)vertices.size();
+		const glm::vec2 corners[4] = { glm::vec2(0, 0), glm::vec2(1, 0), glm::vec2(1, 1), glm::vec2(0, 1) };
+		for (const glm::vec2& c : corners) {
+			Vertex vertex;
+			vertex.position = 0.5f * n + (c.x - 0.5f) * u + (c.y - 0.5f) * v;
+			vertex.normal = n;
+			vertex.texCoords = c;
+			vertices.push_back(vertex);
+		}
+		indices.insert(indices.end(), { base, base + 1, base + 2, base + 2, base + 3, base });
+	}
+}
+
+static void setStaticLighting(const Shader& shader)
+{
+	shader.setInt("material.diffuse", 1);
+	shader.setInt("material.specular", 2);
+
+	shader.setVec3f("dirLight.direction", SUN_DIRECTION);
+	shader.setVec3f("dirLight.ambient", 0.05f, 0.05f, 0.05f);
+	shader.setVec3f("dirLight.diffuse", 0.4f, 0.4f, 0.4f);
+	shader.setVec3f("dirLight.specular", 0.5f, 0.5f, 0.5f);
+
+	shader.setVec3f("spotLight.ambient", 0.0f, 0.0f, 0.0f);
+	shader.setVec3f("spotLight.diffuse", 1.0f, 1.0f, 1.0f);
+	shader.setVec3f("spotLight.specular", 1.0f, 1.0f, 1.0f);
+	shader.setFloat("spotLight.constant", 1.0f);
+	shader.setFloat("spotLight.linear", 0.09f);
+	shader.setFloat("spotLight.quadratic", 0.032f);
+	shader.setFloat("spotLight.cutOff", glm::cos(glm::radians(12.5f)));
+	shader.setFloat("spotLight.outerCutOff", glm::cos(glm::radians(15.0f)));
+
+	// The same falloff for every point light
+	shader.setVec3f("pointAttenuation", 1.0f, 0.09f, 0.032f);
+}
+
+static void setFrameLighting(const Shader& shader, const Camera& camera, const std::vector<PointLight>& lights)
+{
+	shader.setMat4f("projection", camera.GetProjectionMatrix());
+	shader.setMat4f("view", camera.GetViewMatrix());
+	shader.setVec3f("viewPos", camera.GetPosition());
+	shader.setVec3f("spotLight.position", camera.GetPosition());
+	shader.setVec3f("spotLight.direction", camera.GetFront());
+	SetForwardPointLights(shader, lights.data(), lights.size());
+}
+
+// Everything that owns GL objects lives in here so it is gone before the context
+static StressRunResult runFrames(const StressSceneSettings& settings, GLFWwindow* window, const std::string& backend, GLADloadproc loader)
+{
+	bool gpuCulling = settings.gpuCulling;
+	if (gpuCulling && !LoadGL43(loader)) {
+		std::cout << "ERROR::STRESS_SCENE::GPU_CULLING_NEEDS_GL43, culling on the CPU instead" << std::endl;
+		gpuCulling = false;
+	}
+	if (settings.glCallsPath)
+		InstallGLInterceptor();
+	if (settings.capturePath)
+		StartGLCapture(settings.capturePath, settings.warmupFrames, settings.captureFrames);
+
+	// G to switch between forward and deferred in a window
+	bool deferred = settings.deferred && !settings.overdrawView;
+	bool wasToggling = false;
+
+	int lightCount = std::max(settings.lightCount, 0);
+	if (!settings.clusteredLighting && !settings.deferred && lightCount > MAX_FORWARD_POINT_LIGHTS) {
+		std::cout << "ERROR::STRESS_SCENE::FORWARD_LIGHTING_HAS_16_LIGHTS, use --clustered for more" << std::endl;
+		lightCount = MAX_FORWARD_POINT_LIGHTS;
+	}
+
+	Shader lightCubeShader("./assets/shaders/lightCubeVShader.glsl", "./assets/shaders/lightCubeFShader.glsl");
+
+	std::vector<Vertex> cubeVertices;
+	std::vector<uint32_t> cubeIndices;
+	buildCube(cubeVertices, cubeIndices);
+	Mesh cube(cubeVertices, cubeIndices);
+	cube.Upload();
+
+	std::vector<std::unique_ptr<Texture>> diffuseTextures;
+	for (const StressMaterial& material : MATERIALS)
+		diffuseTextures.emplace_back(new Texture(material.diffusePath));
+	Texture specularTexture("./assets/textures/container_mask.png");
+	Texture glowstoneTexture("./assets/textures/glowstone.png");
+
+	Framebuffer target(settings.width, settings.height);
+
+	// Spawn everything from the seed: jittered grid, random orientation, size and material
+	std::mt19937 rng(settings.seed);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+	Scene scene;
+	std::vector<uint8_t> materials;
+	std::vector<Spinner> spinners;
+
+	size_t side = (size_t)std::ceil(std::cbrt((double)settings.objectCount));
+	float extent = side * SPACING;
+	glm::vec3 origin(-0.5f * extent);
+
+	for (size_t i = 0; i < settings.objectCount; i++) {
+		glm::vec3 cell((float)(i % side), (float)(i / side % side), (float)(i / (side * side)));
+		glm::vec3 jitter(unit(rng), unit(rng), unit(rng));
+		glm::vec3 position = origin + (cell + 0.25f + 0.5f * jitter) * SPACING;
+
+		glm::vec3 axis = glm::normalize(glm::vec3(unit(rng), unit(rng), unit(rng)) - 0.5f + glm::vec3(0.0f, 1e-3f, 0.0f));
+		glm::quat rotation = glm::angleAxis(unit(rng) * 6.2831853f, axis);
+		float scale = 0.5f + 0.7f * unit(rng);
+
+		Entity e = scene.CreateEntity(position, rotation, glm::vec3(scale));
+		scene.SetBoundingRadius(e, cube.GetBoundingRadius());
+		materials.push_back((uint8_t)(rng() % MATERIAL_COUNT));
+
+		if (unit(rng) < SPIN_FRACTION)
+			spinners.push_back({ e, rotation, axis, 0.5f + 1.5f * unit(rng) });
+	}
+
+	// The first lights keep their full range, crowds get shorter ones so a point only sees a handful.
+	// Own generator, so the objects don't depend on the light count
+	std::mt19937 lightRng(settings.seed + 1);
+	const float fullRange = PointLightRange(1.0f, 0.09f, 0.032f);
+	const float crowdRange = std::min(fullRange, 1.2f * extent / std::cbrt((float)std::max(lightCount, 1)));
+
+	std::vector<Entity> lights;
+	std::vector<LightOrbit> orbits;
+	std::vector<PointLight> pointLights;
+	for (int i = 0; i < lightCount; i++) {
+		Entity light = scene.CreateEntity(glm::vec3(0.0f), glm::quat(1.0f, 0.0f, 0.0f, 0.0f), glm::vec3(0.4f));
+		scene.SetBoundingRadius(light, i < LIGHT_COUNT ? cube.GetBoundingRadius() : 0.0f);
+		lights.push_back(light);
+
+		orbits.push_back({ std::sqrt(unit(lightRng)) * 0.6f * extent, (unit(lightRng) - 0.5f) * 0.8f * extent,
+			0.1f + 0.4f * unit(lightRng), unit(lightRng) * 6.2831853f });
+
+		glm::vec3 color = i < LIGHT_COUNT ? glm::vec3(1.0f) : glm::vec3(unit(lightRng), unit(lightRng), unit(lightRng));
+		color /= std::max(std::max(color.r, color.g), std::max(color.b, 1e-3f));
+		pointLights.push_back({ glm::vec3(0.0f), lightCount <= LIGHT_COUNT ? fullRange : crowdRange, color });
+	}
+
+	Camera camera;
+	camera.SetPerspective((float)settings.width / (float)settings.height, 0.1f, 2.0f * extent + 10.0f);
+
+	// The overdraw view swaps the lighting for a flat additive color
+	const char* opaqueFragment = settings.overdrawView ? "./assets/shaders/overdrawFShader.glsl" :
+		settings.clusteredLighting ? "./assets/shaders/lightingClusteredFShader.glsl" : "./assets/shaders/lightingFShader.glsl";
+	ShaderSources opaqueSources = Shader::ReadSources("./assets/shaders/lightingVShader.glsl", opaqueFragment);
+	opaqueSources.Define("POINT_LIGHT_SLOTS", ForwardPointLightSlots(lightCount));
+	Shader opaqueShader(opaqueSources);
+	Shader depthShader("./assets/shaders/depthVShader.glsl", "./assets/shaders/depthFShader.glsl");
+
+	opaqueShader.use();
+	setStaticLighting(opaqueShader);
+
+	// Deferred path: the same materials into the G-buffer, then one full screen pass with the clustered lights.
+	// Only built when it can be used, in a window G may switch to it
+	const bool deferredPath = !settings.overdrawView && (settings.deferred || window);
+	std::unique_ptr<Shader> gbufferShader, deferredShader;
+	std::unique_ptr<GBuffer> gbuffer;
+	if (deferredPath) {
+		gbufferShader.reset(new Shader("./assets/shaders/lightingVShader.glsl", "./assets/shaders/gbufferFShader.glsl"));
+		deferredShader.reset(new Shader("./assets/shaders/deferredVShader.glsl", "./assets/shaders/deferredFShader.glsl"));
+		gbuffer.reset(new GBuffer(settings.width, settings.height));
+
+		gbufferShader->use();
+		setStaticLighting(*gbufferShader);
+		deferredShader->use();
+		setStaticLighting(*deferredShader);
+		deferredShader->setInt("gAlbedoSpecular", GBUFFER_UNIT);
+		deferredShader->setInt("gNormalShininess", GBUFFER_UNIT + 1);
+		deferredShader->setInt("gDepth", GBUFFER_UNIT + 2);
+	}
+
+	lightCubeShader.use();
+	lightCubeShader.setInt("glowstoneTex", 0);
+
+	// GPU driven path: one indirect command per material, the instance transforms live on the GPU
+	std::unique_ptr<Shader> indirectShader, depthIndirectShader, gbufferIndirectShader;
+	std::unique_ptr<GPUCuller> gpuCuller;
+	if (gpuCulling) {
+		indirectShader.reset(new Shader("./assets/shaders/lightingIndirectVShader.glsl", opaqueFragment));
+		indirectShader->use();
+		setStaticLighting(*indirectShader);
+		if (deferredPath) {
+			gbufferIndirectShader.reset(new Shader("./assets/shaders/lightingIndirectVShader.glsl", "./assets/shaders/gbufferFShader.glsl"));
+			gbufferIndirectShader->use();
+			setStaticLighting(*gbufferIndirectShader);
+		}
+		depthIndirectShader.reset(new Shader("./assets/shaders/depthIndirectVShader.glsl", "./assets/shaders/depthFShader.glsl"));
+
+		gpuCuller.reset(new GPUCuller(settings.objectCount));
+		for (int m = 0; m < MATERIAL_COUNT; m++)
+			gpuCuller->AddGroup(cube.lods[0].indexCount, cube.lods[0].indexOffset);
+
+		std::vector<uint32_t> groups(materials.begin(), materials.end());
+		gpuCuller->SetInstanceGroups(groups.data(), groups.size());
+		gpuCuller->BindInstanceAttribute(cube.VAO);
+		gpuCuller->BindInstanceAttribute(cube.depthVAO);
+	}
+
+	// Used by clustered forward and by deferred, only updated when one of them is on
+	ThreadPool threadPool;
+	LightClusters clusters(threadPool, settings.clusterTilesX, settings.clusterTilesY, settings.clusterSlices);
+
+	// Shadows reach through the whole volume; the spinners are the only casters that move
+	std::unique_ptr<ShadowCascades> shadows;
+	std::vector<uint8_t> dynamicCasters(settings.objectCount, 0);
+	if (settings.shadows) {
+		shadows.reset(new ShadowCascades(4, 2048, extent, extent));
+		shadows->SetCaching(settings.shadowCaching);
+		for (const Spinner& s : spinners)
+			dynamicCasters[s.entity] = 1;
+	}
+
+	size_t shadowDraws = 0;
+	auto drawCasters = [&](const Shader& shader, const Entity* casters, size_t count) {
+		for (size_t i = 0; i < count; i++) {
+			shader.setMat4f("model", scene.GetWorldMatrix(casters[i]));
+			cube.DrawDepth();
+		}
+		shadowDraws += count;
+	};
+
+	// Scaled render size holding the GPU frame time, upscaled into the target. It times the frames itself
+	std::unique_ptr<DynamicResolution> dynamicResolution;
+	if (settings.dynamicResolutionMs > 0.0f) {
+		DynamicResolutionSettings scaling;
+		scaling.targetMs = settings.dynamicResolutionMs;
+		scaling.historyFrames = settings.warmupFrames + settings.frames;
+		dynamicResolution.reset(new DynamicResolution(settings.width, settings.height, scaling));
+	}
+
+	// Where the GPU time goes, per pass
+	GPUProfiler profiler(settings.frames);
+	GPUProfiler::SetActive(&profiler);
+
+	// Drawn over the finished frame, outside the frame's timer query
+	std::unique_ptr<StatsOverlay> overlay;
+	double overlayMs = 0.0;
+	if (settings.statsOverlay)
+		overlay.reset(new StatsOverlay(settings.dynamicResolutionMs > 0.0f ? settings.dynamicResolutionMs : 16.0f));
+
+	glEnable(GL_DEPTH_TEST);
+
+	// Timer queries for the whole frame, sample queries count the fragments the opaque shading pass lets through
+	unsigned int queries[QUERY_LATENCY], sampleQueries[QUERY_LATENCY];
+	glGenQueries(QUERY_LATENCY, queries);
+	glGenQueries(QUERY_LATENCY, sampleQueries);
+
+	const int totalFrames = settings.warmupFrames + settings.frames;
+	const double pixelCount = (double)settings.width * settings.height;
+	double renderPixels[QUERY_LATENCY] = {}, renderedPixels = 0.0;
+	std::vector<double> cpuTimes, gpuTimes, shadedPerPixel, assignTimes, shadowTimes;
+	std::vector<double> cascadeTimes[ShadowCascades::MAX_CASCADES];
+	size_t cascadeCasters[ShadowCascades::MAX_CASCADES] = {};
+	int cascadeRebuilds[ShadowCascades::MAX_CASCADES] = {};
+	double lightsPerCluster = 0.0;
+	size_t maxPerCluster = 0;
+	std::vector<uint8_t> visibility;
+	std::vector<Entity> buckets[MATERIAL_COUNT];
+	size_t drawCalls = 0, triangles = 0, visibleObjects = 0;
+	int framesRun = 0;
+	MemorySnapshot warmedUp = GetMemorySnapshot();
+
+	auto runStart = std::chrono::steady_clock::now();
+	for (int frame = 0; frame < totalFrames; frame++) {
+		if (window && glfwWindowShouldClose(window))
+			break;
+		if (frame == settings.warmupFrames)
+			warmedUp = GetMemorySnapshot();
+
+		CPU_SCOPE("frame");
+		auto frameStart = std::chrono::steady_clock::now();
+		float time = frame * FRAME_STEP;
+		bool measured = frame >= settings.warmupFrames;
+
+		// Animation
+		CPU_SCOPE_BEGIN(animation, "animation");
+		for (const Spinner& s : spinners)
+			scene.SetRotation(s.entity, glm::angleAxis(time * s.speed, s.axis) * s.base);
+		for (int i = 0; i < lightCount; i++) {
+			if (i < LIGHT_COUNT) {
+				float angle = time * 0.3f + i * 1.5707963f;
+				scene.SetPosition(lights[i], glm::vec3(cos(angle), 0.2f * sin(2.0f * angle), sin(angle)) * (0.3f * extent));
+			}
+			else {
+				const LightOrbit& o = orbits[i];
+				float angle = o.phase + time * o.speed;
+				scene.SetPosition(lights[i], glm::vec3(cos(angle) * o.radius, o.height, sin(angle) * o.radius));
+			}
+		}
+		scene.UpdateWorldMatrices();
+
+		// Scripted camera: one orbit through the outer part of the volume, bobbing up and down
+		float orbit = 6.2831853f * frame / totalFrames;
+		glm::vec3 eye = glm::vec3(cos(orbit), 0.3f * sin(2.0f * orbit), sin(orbit)) * (0.4f * extent + 2.0f);
+		camera.LookAt(eye, glm::vec3(0.0f));
+
+		for (int i = 0; i < lightCount; i++)
+			pointLights[i].position = scene.GetPosition(lights[i]);
+		CPU_SCOPE_END(animation);
+
+		const bool useClusters = settings.clusteredLighting || deferred;
+		if (useClusters) {
+			CPU_SCOPE("light clusters");
+			clusters.Update(camera, pointLights.data(), pointLights.size());
+
+			const LightClusterStats& stats = clusters.GetStats();
+			if (measured) {
+				assignTimes.push_back(stats.assignMs);
+				lightsPerCluster += stats.nonEmptyClusters ? (double)stats.references / stats.nonEmptyClusters : 0.0;
+				maxPerCluster = std::max(maxPerCluster, stats.maxPerCluster);
+			}
+		}
+
+		// Frustum culling, then bucket by material to keep texture binds down.
+		// With GPU culling only the lamps are done here
+		CPU_SCOPE_BEGIN(culling, "culling and buckets");
+		const BoundingSpheres& bounds = scene.GetWorldBounds();
+		size_t culledFirst = gpuCulling ? settings.objectCount : 0;
+		visibility.resize(scene.Size());
+		size_t visible = CullSpheres(camera.GetFrustum(), bounds.x.data() + culledFirst, bounds.y.data() + culledFirst,
+			bounds.z.data() + culledFirst, bounds.radius.data() + culledFirst, scene.Size() - culledFirst, visibility.data() + culledFirst);
+
+		for (std::vector<Entity>& bucket : buckets)
+			bucket.clear();
+		for (Entity e = (Entity)culledFirst; e < (Entity)settings.objectCount; e++) {
+			if (visibility[e])
+				buckets[materials[e]].push_back(e);
+		}
+		if (settings.sortFrontToBack) {
+			for (std::vector<Entity>& bucket : buckets)
+				SortFrontToBack(bucket.data(), bucket.size(), bounds.x.data(), bounds.y.data(), bounds.z.data(), camera.GetPosition());
+		}
+		CPU_SCOPE_END(culling);
+
+		// Only the range of matrices touched by this update goes to the GPU
+		const std::vector<Entity>& updated = scene.GetLastUpdateList();
+		if (gpuCulling && !updated.empty())
+			gpuCuller->UpdateInstances(scene.GetWorldMatrices(), bounds, updated.front(), updated.back() + 1 - updated.front());
+
+		// GPU time of the frame issued QUERY_LATENCY frames ago; it has long finished so this does not stall
+		int slot = frame % QUERY_LATENCY;
+		if (frame >= QUERY_LATENCY) {
+			GLuint64 elapsedNs = 0;
+			if (!dynamicResolution)
+				glGetQueryObjectui64v(queries[slot], GL_QUERY_RESULT, &elapsedNs);
+			if (frame - QUERY_LATENCY >= settings.warmupFrames && !dynamicResolution)
+				gpuTimes.push_back(elapsedNs / 1.0e6);
+
+			GLuint64 samples = 0;
+			glGetQueryObjectui64v(sampleQueries[slot], GL_QUERY_RESULT, &samples);
+			if (frame - QUERY_LATENCY >= settings.warmupFrames)
+				shadedPerPixel.push_back(samples / renderPixels[slot]);
+		}
+
+		// The scale may change here, so the render size is only known from now on
+		profiler.BeginFrame();
+		if (dynamicResolution)
+			dynamicResolution->BeginFrame();
+		else
+			glBeginQuery(GL_TIME_ELAPSED, queries[slot]);
+		const int renderWidth = dynamicResolution ? dynamicResolution->GetRenderWidth() : settings.width;
+		const int renderHeight = dynamicResolution ? dynamicResolution->GetRenderHeight() : settings.height;
+		renderPixels[slot] = (double)renderWidth * renderHeight;
+		if (measured)
+			renderedPixels += renderPixels[slot];
+
+		// Shadow maps first
+		shadowDraws = 0;
+		if (shadows) {
+			CPU_SCOPE("shadows");
+			GPU_SCOPE("shadows");
+			shadows->Update(camera, SUN_DIRECTION);
+			shadows->Render(bounds, dynamicCasters.data(), settings.objectCount, drawCasters, settings.synchronousShadows);
+
+			if (measured) {
+				double shadowMs = 0.0;
+				for (int c = 0; c < shadows->GetCascadeCount(); c++) {
+					const ShadowCascadeStats& stats = shadows->GetStats(c);
+					cascadeTimes[c].push_back(stats.ms);
+					cascadeCasters[c] += stats.casters;
+					cascadeRebuilds[c] += stats.cacheRebuilt ? 1 : 0;
+					shadowMs += stats.ms;
+				}
+				shadowTimes.push_back(shadowMs);
+			}
+		}
+
+		if (dynamicResolution)
+			dynamicResolution->Bind();
+		else
+			target.Bind();
+		if (settings.overdrawView)
+			glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+		else
+			glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+		// Deferred: the opaque passes fill the G-buffer instead
+		if (deferred) {
+			gbuffer->Resize(renderWidth, renderHeight);
+			gbuffer->Bind();
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		}
+
+		size_t frameDraws = shadowDraws, frameTriangles = shadowDraws * cube.GetTriangleCount(0);
+		specularTexture.Bind(GL_TEXTURE2);
+
+		if (gpuCulling) {
+			CPU_SCOPE("gpu culling");
+			GPU_SCOPE("gpu culling");
+			gpuCuller->Cull(camera.GetFrustum());
+			visible += gpuCuller->GetDelayedVisibleCount();
+		}
+
+		// Opaque cubes, drawn twice with the pre-pass: depth only, then shading
+		auto drawOpaque = [&](Shader& shader, Shader* indirect, bool depthOnly) {
+			if (gpuCulling) {
+				indirect->use();
+				setFrameLighting(*indirect, camera, pointLights);
+				if (useClusters && !deferred && !depthOnly)
+					clusters.Bind(*indirect, renderWidth, renderHeight, CLUSTER_UNIT);
+				if (shadows && !deferred && !depthOnly)
+					shadows->Bind(*indirect, SHADOW_UNIT);
+				glBindVertexArray(depthOnly ? cube.depthVAO : cube.VAO);
+				if (depthOnly) {
+					gpuCuller->Draw(0, MATERIAL_COUNT);
+				}
+				else {
+					for (int m = 0; m < MATERIAL_COUNT; m++) {
+						diffuseTextures[m]->Bind(GL_TEXTURE1);
+						indirect->setFloat("material.shininess", MATERIALS[m].shininess);
+						gpuCuller->Draw(m, 1);
+					}
+				}
+				frameDraws += depthOnly ? 1 : MATERIAL_COUNT;
+				frameTriangles += gpuCuller->GetDelayedVisibleCount() * cube.GetTriangleCount(0);
+			}
+
+			shader.use();
+			setFrameLighting(shader, camera, pointLights);
+			if (useClusters && !deferred && !depthOnly)
+				clusters.Bind(shader, renderWidth, renderHeight, CLUSTER_UNIT);
+			if (shadows && !deferred && !depthOnly)
+				shadows->Bind(shader, SHADOW_UNIT);
+			for (int m = 0; m < MATERIAL_COUNT; m++) {
+				if (buckets[m].empty())
+					continue;
+
+				if (!depthOnly) {
+					diffuseTextures[m]->Bind(GL_TEXTURE1);
+					shader.setFloat("material.shininess", MATERIALS[m].shininess);
+				}
+				for (Entity e : buckets[m]) {
+					shader.setMat4f("model", scene.GetWorldMatrix(e));
+					if (depthOnly)
+						cube.DrawDepth();
+					else
+						cube.Draw();
+				}
+				frameDraws += buckets[m].size();
+				frameTriangles += buckets[m].size() * cube.GetTriangleCount(0);
+			}
+		};
+
+		// Depth pre-pass: afterwards only the front-most fragment of each pixel passes GL_EQUAL
+		CPU_SCOPE_BEGIN(draws, "draw submission");
+		if (settings.depthPrepass) {
+			GPU_SCOPE("depth prepass");
+			glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+			drawOpaque(depthShader, depthIndirectShader.get(), true);
+			glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+			glDepthFunc(GL_EQUAL);
+			glDepthMask(GL_FALSE);
+		}
+		if (settings.overdrawView) {
+			glEnable(GL_BLEND);
+			glBlendFunc(GL_ONE, GL_ONE);
+		}
+
+		{
+			GPU_SCOPE(deferred ? "gbuffer" : "opaque");
+			glBeginQuery(GL_SAMPLES_PASSED, sampleQueries[slot]);
+			if (deferred)
+				drawOpaque(*gbufferShader, gbufferIndirectShader.get(), false);
+			else
+				drawOpaque(opaqueShader, indirectShader.get(), false);
+			glEndQuery(GL_SAMPLES_PASSED);
+		}
+
+		glDisable(GL_BLEND);
+		glDepthFunc(GL_LESS);
+		glDepthMask(GL_TRUE);
+
+		// Lighting pass, once per pixel. The depth goes along so the lamps still sort against the scene
+		if (deferred) {
+			GPU_SCOPE("deferred lighting");
+			gbuffer->BlitDepth(dynamicResolution ? dynamicResolution->GetFramebuffer() : target.id);
+			glDisable(GL_DEPTH_TEST);
+
+			deferredShader->use();
+			setFrameLighting(*deferredShader, camera, pointLights);
+			deferredShader->setMat4f("inverseViewProjection", glm::inverse(camera.GetViewProjectionMatrix()));
+			clusters.Bind(*deferredShader, renderWidth, renderHeight, CLUSTER_UNIT);
+			if (shadows)
+				shadows->Bind(*deferredShader, SHADOW_UNIT);
+			gbuffer->BindTextures(GBUFFER_UNIT);
+			gbuffer->DrawFullscreen();
+			frameDraws++;
+
+			glEnable(GL_DEPTH_TEST);
+		}
+
+		{
+			GPU_SCOPE("lamps");
+			lightCubeShader.use();
+			lightCubeShader.setMat4f("projection", camera.GetProjectionMatrix());
+			lightCubeShader.setMat4f("view", camera.GetViewMatrix());
+			glowstoneTexture.Bind(GL_TEXTURE0);
+			for (size_t i = 0; i < lights.size() && i < (size_t)LIGHT_COUNT; i++) {
+				Entity light = lights[i];
+				if (!visibility[light])
+					continue;
+
+				lightCubeShader.setMat4f("model", scene.GetWorldMatrix(light));
+				cube.Draw();
+				frameDraws++;
+				frameTriangles += cube.GetTriangleCount(0);
+			}
+		}
+		CPU_SCOPE_END(draws);
+
+		if (dynamicResolution) {
+			CPU_SCOPE("upscale");
+			GPU_SCOPE("upscale");
+			dynamicResolution->EndFrame(target.id, settings.width, settings.height);
+		}
+		else
+			glEndQuery(GL_TIME_ELAPSED);
+		if (overlay) {
+			auto overlayStart = std::chrono::steady_clock::now();
+			overlay->SetCounter("objects", (double)settings.objectCount);
+			overlay->SetCounter("visible", (double)visible);
+			overlay->SetCounter("draw calls", (double)frameDraws);
+			overlay->SetCounter("triangles", (double)frameTriangles);
+			target.Bind();
+			overlay->Draw(settings.width, settings.height);
+			if (measured)
+				overlayMs += elapsedMs(overlayStart);
+		}
+		profiler.EndFrame();
+		if (IsGLInterceptorInstalled())
+			EndGLCallFrame();
+		EndGLCaptureFrame();
+		double cpuMs = elapsedMs(frameStart);
+
+		if (window) {
+			CPU_SCOPE("present");
+			int screenWidth, screenHeight;
+			glfwGetFramebufferSize(window, &screenWidth, &screenHeight);
+			target.BlitToScreen(screenWidth, screenHeight);
+			glfwSwapBuffers(window);
+			glfwPollEvents();
+			if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
+				glfwSetWindowShouldClose(window, true);
+
+			bool toggling = glfwGetKey(window, GLFW_KEY_G) == GLFW_PRESS;
+			if (toggling && !wasToggling && !settings.overdrawView) {
+				deferred = !deferred;
+				std::cout << (deferred ? "Deferred shading" : "Forward shading") << std::endl;
+			}
+			wasToggling = toggling;
+		}
+
+		if (measured) {
+			cpuTimes.push_back(cpuMs);
+			drawCalls += frameDraws;
+			triangles += frameTriangles;
+			visibleObjects += visible;
+		}
+		framesRun = frame + 1;
+	}
+
+	// Collect the queries still in flight
+	for (int frame = std::max(framesRun - QUERY_LATENCY, 0); frame < framesRun; frame++) {
+		GLuint64 elapsedNs = 0;
+		if (!dynamicResolution)
+			glGetQueryObjectui64v(queries[frame % QUERY_LATENCY], GL_QUERY_RESULT, &elapsedNs);
+		GLuint64 samples = 0;
+		glGetQueryObjectui64v(sampleQueries[frame % QUERY_LATENCY], GL_QUERY_RESULT, &samples);
+		if (frame >= settings.warmupFrames) {
+			if (!dynamicResolution)
+				gpuTimes.push_back(elapsedNs / 1.0e6);
+			shadedPerPixel.push_back(samples / renderPixels[frame % QUERY_LATENCY]);
+		}
+	}
+	profiler.Flush();
+	GPUProfiler::SetActive(nullptr);
+	if (dynamicResolution) {
+		dynamicResolution->Flush();
+		for (const DynamicResolutionFrame& f : dynamicResolution->GetHistory()) {
+			if (f.frame >= settings.warmupFrames)
+				gpuTimes.push_back(f.gpuMs);
+		}
+	}
+	double runMs = elapsedMs(runStart);
+	MemorySnapshot finished = GetMemorySnapshot();
+
+	Image lastFrame;
+	if (settings.keepLastFrame) {
+		lastFrame.width = target.GetWidth();
+		lastFrame.height = target.GetHeight();
+		target.ReadPixels(lastFrame.pixels);
+	}
+	glDeleteQueries(QUERY_LATENCY, queries);
+	glDeleteQueries(QUERY_LATENCY, sampleQueries);
+
+	double shaded = 0.0;
+	for (double s : shadedPerPixel)
+		shaded += s;
+	shaded /= std::max(shadedPerPixel.size(), (size_t)1);
+
+	size_t measuredFrames = std::max(cpuTimes.size(), (size_t)1);
+	std::cout << "Stress scene: " << settings.objectCount << " objects, seed " << settings.seed << ", "
+		<< settings.width << "x" << settings.height << ", " << (gpuCulling ? "GPU" : "CPU") << " culling, " << backend << std::endl;
+	std::cout << "  frames: " << cpuTimes.size() << " measured after " << settings.warmupFrames << " warmup, "
+		<< framesRun * 1000.0 / runMs << " fps overall" << std::endl;
+	reportTimes("CPU frame", cpuTimes);
+	reportTimes("GPU frame", gpuTimes);
+	std::cout << "  per frame: " << visibleObjects / measuredFrames << " visible, " << drawCalls / measuredFrames << " draw calls, "
+		<< triangles / measuredFrames << " triangles" << std::endl;
+	std::cout << "  shaded fragments per pixel: " << shaded << " (depth pre-pass " << (settings.depthPrepass ? "on" : "off")
+		<< ", front to back " << (settings.sortFrontToBack ? "on" : "off") << ")" << std::endl;
+
+	// Render target traffic, depth testing left out as both paths pay it: forward writes 4 bytes per
+	// shaded fragment; deferred writes the G-buffer per fragment, then reads it and the depth and writes the color once per pixel
+	StressRunResult result;
+	double averagePixels = cpuTimes.empty() ? pixelCount : renderedPixels / cpuTimes.size();
+	result.targetMB = (deferred ? shaded * GBuffer::BYTES_PER_PIXEL + GBuffer::BYTES_PER_PIXEL + 4 + 4 : shaded * 4) * averagePixels / (1024.0 * 1024.0);
+	std::cout << "  " << (deferred ? "deferred" : "forward") << " shading, render target traffic " << result.targetMB << " MB/frame" << std::endl;
+
+	result.frameMs = runMs / std::max(framesRun, 1);
+	result.cpuMs = percentile(cpuTimes, 50.0);
+	result.gpuMs = percentile(gpuTimes, 50.0);
+	result.cpuTimes = summarizeTimes(cpuTimes);
+	result.gpuTimes = summarizeTimes(gpuTimes);
+	result.measuredFrames = (int)cpuTimes.size();
+	result.gpuCulling = gpuCulling;
+	result.drawCalls = (double)drawCalls / measuredFrames;
+	result.triangles = (double)triangles / measuredFrames;
+	result.visible = (double)visibleObjects / measuredFrames;
+	result.shadedPerPixel = shaded;
+	result.passes = profiler.GetStats();
+	result.lastFrame = std::move(lastFrame);
+	if (!assignTimes.empty()) {
+		result.assignMs = percentile(assignTimes, 50.0);
+		result.lightsPerCluster = lightsPerCluster / measuredFrames;
+		std::cout << "  lights: " << lightCount << ", clusters " << settings.clusterTilesX << "x" << settings.clusterTilesY << "x"
+			<< settings.clusterSlices << ", " << result.lightsPerCluster << " per non-empty cluster (max " << maxPerCluster
+			<< "), assignment p50 " << result.assignMs << " ms on " << threadPool.GetThreadCount() << " threads" << std::endl;
+	}
+	else
+		std::cout << "  lights: " << lightCount << ", fixed uniform array" << std::endl;
+
+	if (shadows) {
+		result.shadowMs = percentile(shadowTimes, 50.0);
+		std::cout << "  shadows: " << shadows->GetCascadeCount() << " cascades of " << shadows->GetResolution() << "^2, "
+			<< (settings.shadowCaching ? "static casters cached from cascade " + std::to_string(shadows->GetFirstCached()) : std::string("no caching"))
+			<< ", p50 " << result.shadowMs << " ms per frame" << (settings.synchronousShadows ? " (until glFinish)" : " (CPU submit)") << std::endl;
+		for (int c = 0; c < shadows->GetCascadeCount(); c++) {
+			result.cascadeMs[c] = percentile(cascadeTimes[c], 50.0);
+			result.cascadeCasters[c] = (double)cascadeCasters[c] / measuredFrames;
+			result.cascadeRebuilds[c] = cascadeRebuilds[c];
+			std::cout << "    cascade " << c << ": p50 " << result.cascadeMs[c] << " ms, " << result.cascadeCasters[c] << " casters drawn";
+			if (c >= shadows->GetFirstCached())
+				std::cout << ", static casters redrawn in " << cascadeRebuilds[c] << " of " << cpuTimes.size() << " frames";
+			std::cout << std::endl;
+		}
+	}
+
+	if (overlay) {
+		std::cout << "  stats overlay: " << overlayMs / measuredFrames << " ms CPU per frame, " << overlay->GetQuadCount()
+			<< " quads in one draw call" << std::endl;
+	}
+
+	// Anything still growing after the warmup is a leak or a cache without a bound
+	const double MB = 1024.0 * 1024.0;
+	std::cout << "  memory: GPU " << finished.gpuBytes / MB << " MB in " << finished.gpuCount << " resources ("
+		<< ((double)finished.gpuBytes - (double)warmedUp.gpuBytes) / MB << " MB since warmup), heap " << finished.heapBytes / MB
+		<< " MB (" << ((double)finished.heapBytes - (double)warmedUp.heapBytes) / MB << " MB since warmup)" << std::endl;
+
+	// Every frame with the scale it was rendered at, a * where the scale changed
+	if (dynamicResolution) {
+		const std::vector<DynamicResolutionFrame> frames = dynamicResolution->GetHistory();
+		std::vector<double> scales;
+		int changes = 0, overBudget = 0;
+		for (size_t i = 0; i < frames.size(); i++) {
+			const DynamicResolutionFrame& f = frames[i];
+			if (i > 0 && f.scale != frames[i - 1].scale)
+				changes++;
+			if (f.frame < settings.warmupFrames)
+				continue;
+			scales.push_back(f.scale);
+			overBudget += f.gpuMs > settings.dynamicResolutionMs ? 1 : 0;
+		}
+
+		std::cout << "  dynamic resolution: target " << settings.dynamicResolutionMs << " ms, scale p50 " << percentile(scales, 50.0)
+			<< ", min " << percentile(scales, 0.0) << ", max " << percentile(scales, 100.0) << ", " << changes << " changes, "
+			<< overBudget << " of " << scales.size() << " measured frames over budget" << std::endl;
+		for (size_t i = 0; i < frames.size(); i++) {
+			const DynamicResolutionFrame& f = frames[i];
+			std::cout << "    frame " << f.frame << (i > 0 && f.scale != frames[i - 1].scale ? "*" : "") << ": scale " << f.scale
+				<< " (" << f.width << "x" << f.height << "), " << f.gpuMs << " ms" << std::endl;
+		}
+	}
+
+	profiler.PrintReport();
+	PrintMemoryReport();
+	if (settings.gpuProfilePath)
+		profiler.WriteCSV(settings.gpuProfilePath);
+
+	// Before the destructors, their deletes belong to no frame
+	StopGLCapture();
+	if (IsGLInterceptorInstalled()) {
+		PrintGLCallReport();
+		if (WriteGLCallCSV(settings.glCallsPath))
+			std::cout << "GL calls written to " << settings.glCallsPath << std::endl;
+		RemoveGLInterceptor();
+	}
+	return result;
+}
+
+int RunStressScene(const StressSceneSettings& settings)
+{
+	OffscreenContext offscreen;
+	GLFWwindow* window = nullptr;
+	std::string backend;
+	GLADloadproc loader = (GLADloadproc)glfwGetProcAddress;
+
+	if (settings.headless) {
+		if (!offscreen.Create())
+			return -1;
+		backend = offscreen.GetBackendName();
+		loader = offscreen.GetLoader();
+	}
+	else {
+		glfwInit();
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+		glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+		window = glfwCreateWindow(settings.width, settings.height, "AOG stress scene", nullptr, nullptr);
+		if (window == nullptr) {
+			std::cout << "Failed to create GLFW window" << std::endl;
+			glfwTerminate();
+			return -1;
+		}
+
+		glfwMakeContextCurrent(window);
+		glfwSwapInterval(0);	// Measure the renderer, not the display refresh rate
+		if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+			std::cout << "Failed to initialise GLAD" << std::endl;
+			glfwTerminate();
+			return -1;
+		}
+		backend = std::string("GLFW window, ") + (const char*)glGetString(GL_RENDERER);
+	}
+
+	if (settings.tracePath)
+		CPU_PROFILE_START();
+	runFrames(settings, window, backend, loader);
+	ReportMemoryLeaks();
+	if (settings.tracePath) {
+		CPU_PROFILE_STOP();
+		if (CPU_PROFILE_WRITE(settings.tracePath))
+			std::cout << "CPU trace written to " << settings.tracePath << std::endl;
+	}
+
+	if (window)
+		glfwTerminate();
+
+	return 0;
+}
+
+int RunGPUCullingBenchmark(size_t objectCount)
+{
+	const int views = 32;
+
+	OffscreenContext offscreen;
+	if (!offscreen.Create())
+		return -1;
+	if (!LoadGL43(offscreen.GetLoader())) {
+		std::cout << "ERROR::GPU_CULLING::NEEDS_GL43" << std::endl;
+		return -1;
+	}
+
+	std::cout << "GPU culling benchmark: " << objectCount << " spheres, " << offscreen.GetBackendName() << std::endl;
+
+	// Random spheres in a cube, four groups like the stress scene's materials
+	std::mt19937 rng(11);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+	float extent = (float)std::cbrt((double)objectCount) * SPACING;
+
+	BoundingSpheres bounds;
+	std::vector<glm::mat4> matrices(objectCount);
+	std::vector<uint32_t> groups(objectCount);
+	for (size_t i = 0; i < objectCount; i++) {
+		glm::vec3 p = (glm::vec3(unit(rng), unit(rng), unit(rng)) - 0.5f) * extent;
+		bounds.x.push_back(p.x);
+		bounds.y.push_back(p.y);
+		bounds.z.push_back(p.z);
+		bounds.radius.push_back(0.3f + unit(rng));
+		matrices[i] = glm::translate(glm::mat4(1.0f), p);
+		groups[i] = (uint32_t)(rng() % MATERIAL_COUNT);
+	}
+
+	std::vector<Vertex> cubeVertices;
+	std::vector<uint32_t> cubeIndices;
+	buildCube(cubeVertices, cubeIndices);
+
+	size_t mismatches = 0, visibleTotal = 0;
+	double cpuMs = 0.0, gpuMs = 0.0;
+	{
+		GPUCuller culler(objectCount);
+		for (int g = 0; g < MATERIAL_COUNT; g++)
+			culler.AddGroup((uint32_t)cubeIndices.size());
+		culler.SetInstanceGroups(groups.data(), objectCount);
+		culler.UpdateInstances(matrices.data(), bounds, 0, objectCount);
+
+		Camera camera;
+		camera.SetPerspective(16.0f / 9.0f, 0.1f, 2.0f * extent);
+		std::vector<uint8_t> visibility(objectCount);
+		std::vector<uint32_t> cpuVisible, gpuVisible;
+		std::vector<Entity> buckets[MATERIAL_COUNT];
+
+		for (int view = 0; view < views; view++) {
+			float angle = 6.2831853f * view / views;
+			glm::vec3 eye = glm::vec3(cos(angle), 0.3f * sin(3.0f * angle), sin(angle)) * (0.4f * extent);
+			camera.LookAt(eye, glm::vec3(0.0f));
+
+			// CPU reference: cull plus the per material buckets the draw loop needs
+			auto start = std::chrono::steady_clock::now();
+			CullSpheres(camera.GetFrustum(), bounds.x.data(), bounds.y.data(), bounds.z.data(), bounds.radius.data(),
+				objectCount, visibility.data());
+			for (std::vector<Entity>& bucket : buckets)
+				bucket.clear();
+			for (size_t i = 0; i < objectCount; i++) {
+				if (visibility[i])
+					buckets[groups[i]].push_back((Entity)i);
+			}
+			cpuMs += elapsedMs(start);
+
+			// Wall clock up to glFinish: some drivers (llvmpipe) don't count compute work in timer queries
+			glFinish();
+			start = std::chrono::steady_clock::now();
+			culler.Cull(camera.GetFrustum());
+			glFinish();
+			gpuMs += elapsedMs(start);
+
+			// Same set, order inside a group depends on the atomics
+			cpuVisible.clear();
+			for (const std::vector<Entity>& bucket : buckets)
+				cpuVisible.insert(cpuVisible.end(), bucket.begin(), bucket.end());
+			culler.ReadVisible(gpuVisible);
+			std::sort(cpuVisible.begin(), cpuVisible.end());
+			std::sort(gpuVisible.begin(), gpuVisible.end());
+			mismatches += cpuVisible == gpuVisible ? 0 : 1;
+			visibleTotal += cpuVisible.size();
+		}
+	}
+
+	std::cout << "  " << visibleTotal / views << " visible per view" << std::endl;
+	std::cout << "  CPU cull + draw lists: " << cpuMs / views << " ms, GPU cull + compaction (until glFinish): " << gpuMs / views << " ms" << std::endl;
+	std::cout << "  views differing from CullSpheres: " << mismatches << " of " << views << std::endl;
+
+	return mismatches == 0 ? 0 : 1;
+}
+
+int RunClusteredLightingBenchmark(size_t maxLights)
+{
+	// A single cluster shades every light everywhere; past this it takes minutes per frame in software
+	const size_t bruteForceLimit = 256;
+	const size_t lightCounts[] = { 4, 16, 64, 256, 1024, 4096, 10000 };
+
+	OffscreenContext offscreen;
+	if (!offscreen.Create())
+		return -1;
+
+	StressSceneSettings settings;
+	settings.objectCount = 10000;
+	settings.frames = 40;
+	settings.warmupFrames = 5;
+	settings.width = 960;
+	settings.height = 540;
+	settings.headless = true;
+	settings.depthPrepass = true;	// Shading cost per pixel, not per overdrawn fragment
+	settings.clusteredLighting = true;
+
+	struct Row { size_t lights; StressRunResult clustered, deferred, bruteForce; bool hasBruteForce; };
+	std::vector<Row> rows;
+
+	for (size_t lights : lightCounts) {
+		if (lights > maxLights)
+			break;
+
+		Row row = {};
+		row.lights = lights;
+		settings.lightCount = (int)lights;
+		settings.clusterTilesX = 16;
+		settings.clusterTilesY = 9;
+		settings.clusterSlices = 24;
+		row.clustered = runFrames(settings, nullptr, offscreen.GetBackendName(), offscreen.GetLoader());
+		settings.deferred = true;
+		row.deferred = runFrames(settings, nullptr, offscreen.GetBackendName(), offscreen.GetLoader());
+		settings.deferred = false;
+
+		if (lights <= bruteForceLimit) {
+			settings.clusterTilesX = settings.clusterTilesY = settings.clusterSlices = 1;
+			row.bruteForce = runFrames(settings, nullptr, offscreen.GetBackendName(), offscreen.GetLoader());
+			row.hasBruteForce = true;
+		}
+		rows.push_back(row);
+	}
+
+	std::cout << std::endl << "Clustered lighting: " << settings.objectCount << " objects, " << settings.width << "x" << settings.height
+		<< ", depth pre-pass" << std::endl;
+	std::cout << "  lights | clustered forward: frame ms, GPU p50 ms, assign p50 ms, lights per cluster, target MB | deferred: frame ms, "
+		"GPU p50 ms, target MB | single cluster: frame ms, GPU p50 ms" << std::endl;
+	for (const Row& row : rows) {
+		std::cout << "  " << row.lights << " | " << row.clustered.frameMs << ", " << row.clustered.gpuMs << ", " << row.clustered.assignMs
+			<< ", " << row.clustered.lightsPerCluster << ", " << row.clustered.targetMB << " | " << row.deferred.frameMs << ", "
+			<< row.deferred.gpuMs << ", " << row.deferred.targetMB << " | ";
+		if (row.hasBruteForce)
+			std::cout << row.bruteForce.frameMs << ", " << row.bruteForce.gpuMs << std::endl;
+		else
+			std::cout << "skipped" << std::endl;
+	}
+
+	return 0;
+}
+
+int RunShadowBenchmark(size_t objectCount)
+{
+	OffscreenContext offscreen;
+	if (!offscreen.Create())
+		return -1;
+
+	// The camera does one orbit per run, enough frames keep it slow so the cached boxes get reused
+	StressSceneSettings settings;
+	settings.objectCount = objectCount;
+	settings.frames = 150;
+	settings.warmupFrames = 0;
+	settings.width = 960;
+	settings.height = 540;
+	settings.headless = true;
+	settings.depthPrepass = true;
+	settings.shadows = true;
+	settings.synchronousShadows = true;	// The per cascade times need the GPU work in them
+
+	settings.shadowCaching = true;
+	StressRunResult cached = runFrames(settings, nullptr, offscreen.GetBackendName(), offscreen.GetLoader());
+	settings.shadowCaching = false;
+	StressRunResult uncached = runFrames(settings, nullptr, offscreen.GetBackendName(), offscreen.GetLoader());
+	settings.shadows = false;
+	StressRunResult none = runFrames(settings, nullptr, offscreen.GetBackendName(), offscreen.GetLoader());
+
+	std::cout << std::endl << "Shadows: " << objectCount << " objects, " << SPIN_FRACTION * 100.0f << "% of them dynamic, "
+		<< settings.width << "x" << settings.height << ", " << settings.frames << " frames" << std::endl;
+	std::cout << "  cascade | cached: p50 ms, casters drawn, static redraws | uncached: p50 ms, casters drawn" << std::endl;
+	for (int c = 0; c < ShadowCascades::MAX_CASCADES; c++) {
+		std::cout << "  " << c << " | " << cached.cascadeMs[c] << ", " << cached.cascadeCasters[c] << ", " << cached.cascadeRebuilds[c]
+			<< " | " << uncached.cascadeMs[c] << ", " << uncached.cascadeCasters[c] << std::endl;
+	}
+	std::cout << "  shadow pass p50: " << cached.shadowMs << " ms cached, " << uncached.shadowMs << " ms uncached ("
+		<< 100.0 * (1.0 - cached.shadowMs / std::max(uncached.shadowMs, 1e-9)) << "% saved)" << std::endl;
+	std::cout << "  frame: " << cached.frameMs << " ms cached, " << uncached.frameMs << " ms uncached, " << none.frameMs
+		<< " ms without shadows" << std::endl;
+
+	return 0;
+}
+
+int RunLightingShaderBenchmark(int passes)
+{
+	const int width = 1280, height = 720;
+	passes = std::max(passes, 1);
+
+	OffscreenContext offscreen;
+	if (!offscreen.Create())
+		return -1;
+
+	Framebuffer target(width, height);
+	ShaderSources sources = Shader::ReadSources("./assets/shaders/lightingVShader.glsl", "./assets/shaders/lightingFShader.glsl");
+	Texture diffuseTexture(MATERIALS[0].diffusePath);
+	Texture specularTexture("./assets/textures/container_mask.png");
+
+	// A quad right over the screen: identity matrices, so world space is clip space and the quad sits at z = 0
+	std::vector<Vertex> vertices;
+	const glm::vec2 corners[4] = { glm::vec2(-1, -1), glm::vec2(1, -1), glm::vec2(1, 1), glm::vec2(-1, 1) };
+	for (const glm::vec2& c : corners)
+		vertices.push_back({ glm::vec3(c, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f), c * 0.5f + 0.5f });
+	Mesh quad(vertices, { 0, 1, 2, 2, 3, 0 });
+	quad.Upload();
+
+	diffuseTexture.Bind(GL_TEXTURE1);
+	specularTexture.Bind(GL_TEXTURE2);
+
+	target.Bind();
+	glDisable(GL_DEPTH_TEST);
+
+	// Lights hovering over the quad; the far ones are out of range and only cost the distance check
+	struct Case { const char* name; int nearLights, farLights; };
+	const Case cases[] = {
+		{ "sun + flashlight", 0, 0 },
+		{ "4 point lights", 4, 0 },
+		{ "8 point lights", 8, 0 },
+		{ "16 point lights", 16, 0 },
+		{ "4 point lights + 12 out of range", 4, 12 },
+	};
+
+	std::cout << "Lighting shader: full screen quad " << width << "x" << height << ", " << passes << " passes per case" << std::endl;
+	std::mt19937 rng(7);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	for (const Case& c : cases) {
+		std::vector<PointLight> lights;
+		for (int i = 0; i < c.nearLights + c.farLights; i++) {
+			bool far = i >= c.nearLights;
+			glm::vec3 position(unit(rng), unit(rng), 0.3f + 0.2f * unit(rng));
+			lights.push_back({ far ? position + glm::vec3(20.0f, 0.0f, 0.0f) : position, far ? 2.0f : PointLightRange(1.0f, 0.09f, 0.032f),
+				glm::vec3(1.0f) });
+		}
+
+		// Built for its light count, like the stress scene's
+		ShaderSources caseSources = sources;
+		caseSources.Define("POINT_LIGHT_SLOTS", ForwardPointLightSlots(lights.size()));
+		Shader shader(caseSources);
+		shader.use();
+		setStaticLighting(shader);
+		shader.setFloat("material.shininess", MATERIALS[0].shininess);
+		shader.setMat4f("model", glm::mat4(1.0f));
+		shader.setMat4f("view", glm::mat4(1.0f));
+		shader.setMat4f("projection", glm::mat4(1.0f));
+		shader.setVec3f("viewPos", 0.0f, 0.0f, 2.0f);
+		shader.setVec3f("spotLight.position", 0.0f, 0.0f, 2.0f);
+		shader.setVec3f("spotLight.direction", 0.0f, 0.0f, -1.0f);
+		SetForwardPointLights(shader, lights.data(), lights.size());
+
+		// One pass to warm up, then wall clock until glFinish
+		quad.Draw();
+		glFinish();
+		auto start = std::chrono::steady_clock::now();
+		for (int pass = 0; pass < passes; pass++)
+			quad.Draw();
+		glFinish();
+		double ms = elapsedMs(start) / passes;
+
+		std::cout << "  " << c.name << ": " << ms << " ms per pass, " << (double)width * height / (ms * 1000.0) << " Mpixels/s" << std::endl;
+	}
+
+	return 0;
+}
+
+static void writeFrameTimes(std::ofstream& file, const char* name, const FrameTimes& t)
+{
+	file << "\"" << name << "\": {\"p50\": " << t.p50 << ", \"p90\": " << t.p90 << ", \"p95\": " << t.p95
+		<< ", \"p99\": " << t.p99 << ", \"max\": " << t.max << ", \"mean\": " << t.mean << "}";
+}
+
+int RunFrameBenchmark(const char* jsonPath, int frames, size_t objectCount)
+{
+	OffscreenContext offscreen;
+	if (!offscreen.Create())
+		return -1;
+
+	// Same seed, resolution and camera orbit every time, so builds can be compared run for run
+	StressSceneSettings base;
+	base.objectCount = objectCount;
+	base.seed = 1;
+	base.frames = std::max(frames, 1);
+	base.warmupFrames = 10;
+	base.width = 960;
+	base.height = 540;
+	base.headless = true;
+
+	struct BenchmarkCase { const char* name; StressSceneSettings settings; };
+	std::vector<BenchmarkCase> cases;
+	cases.push_back({ "forward", base });
+
+	cases.push_back({ "forward prepass sorted", base });
+	cases.back().settings.depthPrepass = true;
+	cases.back().settings.sortFrontToBack = true;
+
+	cases.push_back({ "gpu culling", base });
+	cases.back().settings.gpuCulling = true;
+	cases.back().settings.depthPrepass = true;
+
+	cases.push_back({ "clustered 256 lights", base });
+	cases.back().settings.depthPrepass = true;
+	cases.back().settings.clusteredLighting = true;
+	cases.back().settings.lightCount = 256;
+
+	cases.push_back({ "deferred 256 lights", base });
+	cases.back().settings.deferred = true;
+	cases.back().settings.lightCount = 256;
+
+	cases.push_back({ "shadows", base });
+	cases.back().settings.depthPrepass = true;
+	cases.back().settings.shadows = true;
+
+	std::vector<StressRunResult> results;
+	for (const BenchmarkCase& c : cases) {
+		std::cout << std::endl << "Benchmark: " << c.name << std::endl;
+		results.push_back(runFrames(c.settings, nullptr, offscreen.GetBackendName(), offscreen.GetLoader()));
+	}
+
+	std::ofstream file(jsonPath);
+	if (!file) {
+		std::cout << "ERROR::STRESS_SCENE::CANNOT_WRITE " << jsonPath << std::endl;
+		return 1;
+	}
+
+	file << "{\n  \"schema\": 1,\n  \"unix_time\": " << (long long)std::time(nullptr) << ",\n";
+#if defined(_MSC_VER)
+	file << "  \"compiler\": \"msvc " << _MSC_VER << "\",\n";
+#elif defined(__clang__)
+	file << "  \"compiler\": \"clang " << __clang_major__ << "." << __clang_minor__ << "\",\n";
+#elif defined(__GNUC__)
+	file << "  \"compiler\": \"gcc " << __GNUC__ << "." << __GNUC_MINOR__ << "\",\n";
+#endif
+#if defined(NDEBUG)
+	file << "  \"build\": \"release\",\n";
+#else
+	file << "  \"build\": \"debug\",\n";
+#endif
+	// Renderer names have no quotes or backslashes in them
+	file << "  \"backend\": \"" << offscreen.GetBackendName() << "\",\n";
+	file << "  \"fixed_step_ms\": " << FRAME_STEP * 1000.0f << ",\n  \"runs\": [\n";
+
+	for (size_t i = 0; i < cases.size(); i++) {
+		const StressSceneSettings& s = cases[i].settings;
+		const StressRunResult& r = results[i];
+
+		file << "    {\n      \"name\": \"" << cases[i].name << "\",\n";
+		file << "      \"settings\": {\"objects\": " << s.objectCount << ", \"seed\": " << s.seed << ", \"frames\": " << s.frames
+			<< ", \"warmup_frames\": " << s.warmupFrames << ", \"width\": " << s.width << ", \"height\": " << s.height
+			<< ", \"lights\": " << s.lightCount << ", \"gpu_culling\": " << (r.gpuCulling ? "true" : "false")
+			<< ", \"depth_prepass\": " << (s.depthPrepass ? "true" : "false") << ", \"sort_front_to_back\": " << (s.sortFrontToBack ? "true" : "false")
+			<< ", \"clustered\": " << (s.clusteredLighting ? "true" : "false") << ", \"deferred\": " << (s.deferred ? "true" : "false")
+			<< ", \"shadows\": " << (s.shadows ? "true" : "false") << "},\n";
+		file << "      \"measured_frames\": " << r.measuredFrames << ",\n      \"wall_ms_per_frame\": " << r.frameMs << ",\n      ";
+		writeFrameTimes(file, "cpu_ms", r.cpuTimes);
+		file << ",\n      ";
+		writeFrameTimes(file, "gpu_ms", r.gpuTimes);
+		file << ",\n      \"draw_calls\": " << r.drawCalls << ",\n      \"triangles\": " << r.triangles << ",\n      \"visible\": " << r.visible
+			<< ",\n      \"shaded_per_pixel\": " << r.shadedPerPixel << ",\n      \"gpu_passes\": [";
+		for (size_t p = 0; p < r.passes.size(); p++) {
+			const GPUScopeStats& pass = r.passes[p];
+			file << (p ? ", " : "") << "\n        {\"name\": \"" << pass.name << "\", \"frames\": " << pass.samples << ", \"min_ms\": " << pass.minMs
+				<< ", \"avg_ms\": " << pass.avgMs << ", \"p99_ms\": " << pass.p99Ms << "}";
+		}
+		file << "\n      ]\n    }" << (i + 1 < cases.size() ? "," : "") << "\n";
+	}
+	file << "  ]\n}\n";
+
+	std::cout << std::endl << "Benchmark: " << cases.size() << " runs of " << base.frames << " frames written to " << jsonPath << std::endl;
+	for (size_t i = 0; i < cases.size(); i++) {
+		std::cout << "  " << cases[i].name << ": CPU p50 " << results[i].cpuTimes.p50 << " ms, GPU p50 " << results[i].gpuTimes.p50
+			<< " ms, " << results[i].drawCalls << " draw calls" << std::endl;
+	}
+	return 0;
+}
+
+// Per scene limits, frame times as medians
+struct RegressionBudget
+{
+	double cpuMs;
+	double gpuMs;
+	double drawCalls;
+};
+
+static const float GOLDEN_THRESHOLD = 0.1f;			// Per pixel, see CompareImages
+static const double GOLDEN_MAX_DIFFERING = 0.002;	// Fraction of the pixels allowed over it
+static const double BUDGET_HEADROOM = 2.0;			// Frame time budgets written by --update, shared machines are noisy
+static const double BUDGET_MIN_SLACK_MS = 2.0;		// So scenes of a fraction of a millisecond don't fail on noise
+
+static bool makeDirectory(const std::string& path)
+{
+#if defined(_WIN32)
+	return _mkdir(path.c_str()) == 0 || errno == EEXIST;
+#else
+	return mkdir(path.c_str(), 0755) == 0 || errno == EEXIST;
+#endif
+}
+
+static double frameBudget(double ms)
+{
+	return ceil(std::max(ms * BUDGET_HEADROOM, ms + BUDGET_MIN_SLACK_MS) * 100.0) / 100.0;
+}
+
+static std::string goldenFileName(const char* scene)
+{
+	std::string name = scene;
+	std::replace(name.begin(), name.end(), ' ', '_');
+	return name;
+}
+
+static bool loadBudgets(const std::string& path, std::map<std::string, RegressionBudget>& budgets)
+{
+	std::ifstream file(path);
+	if (!file)
+		return false;
+
+	std::string line;
+	while (std::getline(file, line)) {
+		if (line.empty() || line[0] == '#')
+			continue;
+
+		size_t tab = line.find('\t');
+		if (tab == std::string::npos)
+			continue;
+		RegressionBudget budget;
+		std::istringstream values(line.substr(tab + 1));
+		if (values >> budget.cpuMs >> budget.gpuMs >> budget.drawCalls)
+			budgets[line.substr(0, tab)] = budget;
+	}
+	return true;
+}
+
+static bool saveBudgets(const std::string& path, const std::map<std::string, RegressionBudget>& budgets)
+{
+	std::ofstream file(path);
+	if (!file) {
+		std::cout << "ERROR::REGRESSION::CANNOT_WRITE " << path << std::endl;
+		return false;
+	}
+
+	file << "# scene\tCPU frame p50 ms\tGPU frame p50 ms\tdraw calls per frame\n";
+	for (const auto& budget : budgets)
+		file << budget.first << "\t" << budget.second.cpuMs << "\t" << budget.second.gpuMs << "\t" << budget.second.drawCalls << "\n";
+	return true;
+}
+
+int RunRegressionSuite(const char* goldenDir, bool update)
+{
+	OffscreenContext offscreen;
+	if (!offscreen.Create())
+		return -1;
+
+	// Small enough for llvmpipe, fixed seed and time step so the last frame is always the same picture
+	StressSceneSettings base;
+	base.objectCount = 2000;
+	base.seed = 3;
+	base.frames = 30;
+	base.warmupFrames = 5;
+	base.width = 480;
+	base.height = 270;
+	base.headless = true;
+	base.keepLastFrame = true;
+
+	struct RegressionCase { const char* name; StressSceneSettings settings; };
+	std::vector<RegressionCase> cases;
+	cases.push_back({ "sandbox", base });
+	cases.back().settings.objectCount = 10;
+
+	cases.push_back({ "stress forward", base });
+
+	cases.push_back({ "stress prepass sorted", base });
+	cases.back().settings.depthPrepass = true;
+	cases.back().settings.sortFrontToBack = true;
+
+	cases.push_back({ "stress gpu culling", base });
+	cases.back().settings.gpuCulling = true;
+	cases.back().settings.depthPrepass = true;
+
+	cases.push_back({ "many lights clustered", base });
+	cases.back().settings.depthPrepass = true;
+	cases.back().settings.clusteredLighting = true;
+	cases.back().settings.lightCount = 256;
+
+	cases.push_back({ "many lights deferred", base });
+	cases.back().settings.deferred = true;
+	cases.back().settings.lightCount = 256;
+
+	cases.push_back({ "shadows", base });
+	cases.back().settings.depthPrepass = true;
+	cases.back().settings.shadows = true;
+
+	std::string directory = goldenDir;
+	std::string budgetsPath = directory + "/budgets.txt";
+	std::map<std::string, RegressionBudget> budgets;
+	if (update) {
+		if (!makeDirectory(directory)) {
+			std::cout << "ERROR::REGRESSION::CANNOT_CREATE " << directory << std::endl;
+			return 1;
+		}
+		loadBudgets(budgetsPath, budgets);		// Scenes not run keep theirs
+	}
+	else if (!loadBudgets(budgetsPath, budgets)) {
+		std::cout << "ERROR::REGRESSION::NO_BUDGETS " << budgetsPath << ", run with --update first" << std::endl;
+		return 1;
+	}
+
+	std::vector<StressRunResult> results;
+	for (const RegressionCase& c : cases) {
+		std::cout << std::endl << "Regression: " << c.name << std::endl;
+		results.push_back(runFrames(c.settings, nullptr, offscreen.GetBackendName(), offscreen.GetLoader()));
+	}
+
+	std::cout << std::endl << "Regression suite on " << offscreen.GetBackendName() << (update ? ", updating " : ", against ")
+		<< directory << std::endl;
+	int failures = 0;
+	for (size_t i = 0; i < cases.size(); i++) {
+		const StressRunResult& r = results[i];
+		std::string goldenPath = directory + "/" + goldenFileName(cases[i].name);
+		std::remove((goldenPath + ".actual.ppm").c_str());		// From an earlier failure
+		std::remove((goldenPath + ".diff.ppm").c_str());
+
+		if (update) {
+			budgets[cases[i].name] = { frameBudget(r.cpuTimes.p50), frameBudget(r.gpuTimes.p50), r.drawCalls };
+			bool written = WriteImagePPM(goldenPath + ".ppm", r.lastFrame);
+			failures += written ? 0 : 1;
+			std::cout << "  " << std::left << std::setw(24) << cases[i].name << std::right << (written ? "golden written" : "FAILED")
+				<< ", " << r.drawCalls << " draw calls, CPU p50 " << r.cpuTimes.p50 << " ms, GPU p50 " << r.gpuTimes.p50 << " ms" << std::endl;
+			continue;
+		}
+
+		std::vector<std::string> problems;
+		Image golden;
+		ImageDifference difference;
+		if (!ReadImage(goldenPath + ".ppm", golden))
+			problems.push_back("no golden image");
+		else {
+			Image diff;
+			difference = CompareImages(golden, r.lastFrame, GOLDEN_THRESHOLD, &diff);
+			if (!difference.sameSize)
+				problems.push_back("golden is " + std::to_string(golden.width) + "x" + std::to_string(golden.height));
+			else if (difference.differingFraction > GOLDEN_MAX_DIFFERING) {
+				std::ostringstream text;
+				text << "image differs, " << difference.differingFraction * 100.0 << "% of the pixels";
+				problems.push_back(text.str());
+				WriteImagePPM(goldenPath + ".diff.ppm", diff);
+			}
+		}
+
+		auto found = budgets.find(cases[i].name);
+		if (found == budgets.end())
+			problems.push_back("no budget");
+		else {
+			const RegressionBudget& budget = found->second;
+			std::ostringstream text;
+			if (r.cpuTimes.p50 > budget.cpuMs)
+				text << "CPU p50 " << r.cpuTimes.p50 << " ms over " << budget.cpuMs << " ms";
+			if (r.gpuTimes.p50 > budget.gpuMs)
+				text << (text.tellp() > 0 ? ", " : "") << "GPU p50 " << r.gpuTimes.p50 << " ms over " << budget.gpuMs << " ms";
+			if (r.drawCalls > budget.drawCalls + 0.5)
+				text << (text.tellp() > 0 ? ", " : "") << r.drawCalls << " draw calls over " << budget.drawCalls;
+			if (text.tellp() > 0)
+				problems.push_back(text.str());
+		}
+
+		if (!problems.empty()) {
+			failures++;
+			WriteImagePPM(goldenPath + ".actual.ppm", r.lastFrame);
+		}
+		std::cout << "  " << std::left << std::setw(24) << cases[i].name << std::right << (problems.empty() ? "pass" : "FAIL")
+			<< "  max delta " << difference.maxDelta << ", CPU p50 " << r.cpuTimes.p50 << " ms, GPU p50 " << r.gpuTimes.p50
+			<< " ms, " << r.drawCalls << " draw calls" << std::endl;
+		for (const std::string& problem : problems)
+			std::cout << "    " << problem << std::endl;
+	}
+
+	if (update)
+		saveBudgets(budgetsPath, budgets);
+	std::cout << "  " << failures << " of " << cases.size() << " scene(s) failed" << std::endl;
+	return failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+// System library
+#include <cstddef>
+#include <cstdint>
+
+struct StressSceneSettings
+{
+	size_t objectCount = 10000;
+	uint32_t seed = 1;			// Same seed, same scene and same camera path
+	int frames = 600;
+	int warmupFrames = 30;		// Not counted in the statistics
+	int width = 1280;
+	int height = 720;
+	bool headless = false;		// Offscreen context, no window or display needed
+	bool gpuCulling = false;	// Compute shader culling and multi draw indirect (GL 4.3)
+	bool depthPrepass = false;	// Depth only pass first, shading with GL_EQUAL
+	bool sortFrontToBack = false;	// Per material, nearest first (CPU culling only)
+	bool overdrawView = false;	// Additive flat color instead of lighting, brightness = times shaded
+	int lightCount = 4;			// More than 16 needs clustered lighting
+	bool clusteredLighting = false;
+	bool deferred = false;		// G-buffer pass, then one full screen pass with the clustered lights (G toggles)
+	int clusterTilesX = 16;		// Cluster grid, 1x1x1 loops over every light
+	int clusterTilesY = 9;
+	int clusterSlices = 24;
+	bool shadows = false;		// Cascaded shadow maps for the directional light, the spinning cubes are the dynamic casters
+	bool shadowCaching = true;	// Far cascades keep their static casters between frames
+	bool synchronousShadows = false;	// Waits for every cascade so its time includes the GPU work, drains the pipeline
+	float dynamicResolutionMs = 0.0f;	// GPU frame time to hold by scaling the render size, 0 renders at full size
+	const char* gpuProfilePath = nullptr;	// CSV of every pass's GPU time per frame
+	const char* tracePath = nullptr;		// Chrome trace of the CPU side of every frame (profiling builds)
+	const char* glCallsPath = nullptr;		// CSV of the GL calls of every frame, counted and timed (debug builds)
+	const char* capturePath = nullptr;		// GL capture for --replay, from the start to captureFrames after the warmup
+	int captureFrames = 60;
+	bool keepLastFrame = false;		// Reads the last frame back, for the regression suite
+	bool statsOverlay = false;		// Frame graphs, pass times and counters drawn over every frame
+};
+
+/*
+	Scalability test: spawns objectCount cubes with a handful of materials, some of
+	them spinning, four orbiting point lights and flies the camera along a fixed
+	path. Reports CPU and GPU frame time percentiles, draw calls, triangles and
+	shaded fragments per pixel (overdraw of the opaque shading pass).
+
+	With clustered lighting any number of extra point lights fly around the volume;
+	only the first four get a lamp cube. Deferred shading always uses the clustered lights.
+	With shadows the directional light gets cascaded shadow maps, the spinning cubes
+	being the dynamic casters. With dynamic resolution the scene is rendered smaller
+	and upscaled, and the scale picked for every frame is listed. The GPU time of
+	every pass is reported at the end, the CPU side can be written as a trace and
+	the GL calls of every frame, with the redundant ones, as a CSV. A GL capture
+	keeps everything from the start, --replay times the frames after the warmup.
+	The stats overlay can be drawn over the frames, its own cost is reported.
+
+	Selected from the command line: "AOG.exe --stress 100000 [--seed 7] [--frames 600] [--headless]
+	[--gpu-culling] [--depth-prepass] [--sort] [--overdraw] [--lights 1000 --clustered] [--deferred]
+	[--shadows [--no-shadow-cache]] [--dynamic-resolution 16] [--gpu-profile passes.csv] [--trace trace.json]
+	[--gl-calls calls.csv] [--capture frames.glcap [--capture-frames 60]] [--overlay]"
+*/
+int RunStressScene(const StressSceneSettings& settings);
+
+/*
+	Checks the compute culling pass against CullSpheres on random scenes from a set
+	of camera positions and times both. Always offscreen, needs GL 4.3.
+*/
+int RunGPUCullingBenchmark(size_t objectCount);
+
+/*
+	Frame times of the stress scene with 4 up to maxLights point lights: clustered
+	forward, deferred, and a single cluster holding every light (plain forward loop).
+	Always offscreen.
+*/
+int RunClusteredLightingBenchmark(size_t maxLights);
+
+/*
+	Shadow pass cost per cascade of the stress scene, with the far cascades cached
+	and with every cascade drawn from scratch each frame. Always offscreen.
+*/
+int RunShadowBenchmark(size_t objectCount);
+
+/*
+	Fragment throughput of the forward lighting shader on a full screen quad, with
+	more and more point lights and with lights out of range. Always offscreen.
+*/
+int RunLightingShaderBenchmark(int passes);
+
+/*
+	Fixed suite of stress scene runs for tracking performance across builds: forward,
+	pre-pass, GPU culling, clustered, deferred and shadows, all on the same seeded
+	scene and camera orbit with a fixed time step. Writes CPU and GPU frame time
+	percentiles, draw calls, triangles and the GPU time of every pass as JSON.
+	Always offscreen, runs on llvmpipe without a GPU or display.
+
+	"AOG.exe --benchmark results.json [frames] [objects]"
+*/
+int RunFrameBenchmark(const char* jsonPath, int frames, size_t objectCount);
+
+/*
+	Output and performance regression check: small seeded scenes (sandbox sized,
+	stress, many lights, shadows) rendered headless, the last frame of each compared
+	to its golden image and the frame times and draw calls to the scene's budget.
+	Fails when an image differs past the perceptual tolerance or a budget is exceeded.
+
+	The goldens (<scene>.ppm) and budgets.txt live in goldenDir and belong to one
+	backend. --update renders them again and sets the budgets from that run, time
+	with headroom and draw calls as they are; budgets.txt can be edited by hand.
+	Failing scenes leave <scene>.actual.ppm and <scene>.diff.ppm next to their golden.
+
+	"AOG.exe --regression [golden dir] [--update]"
+*/
+int RunRegressionSuite(const char* goldenDir, bool update);
@@ -1,14 +1,28 @@
 #include "Texture.h"
+#include "CPUProfiler.h"
+#include "MemoryTracker.h"
 
 #include <iostream>
 
 Texture::Texture(const std::string& path)
 {
+	CPU_SCOPE_DETAIL("Texture", path.c_str());
 	init();
-	loadImage(path);
+	upload(Decode(path));
 }
 
-Texture::~Texture() {}
+Texture::Texture(const TextureImage& image)
+{
+	CPU_SCOPE_DETAIL("Texture", image.path.c_str());
+	init();
+	upload(image);
+}
+
+Texture::~Texture()
+{
+	UntrackGPUMemory(GPUResource::Texture, id);
+	glDeleteTextures(1, &id);
+}
 
 void Texture::Bind(GLenum slot) const 
 {
@@ -25,23 +39,37 @@ void Texture::init()
 	// Set texture wrap attributes
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-	// Set texture filtering parameters
+	// Set texture filtering parameters, level 0 only so no mipmaps are made
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 }
 
-void Texture::loadImage(const std::string& path)
+TextureImage Texture::Decode(const std::string& path)
 {
-	int width, height, nrChannels;
+	CPU_SCOPE_DETAIL("decode", path.c_str());
+	TextureImage image;
+	image.path = path;
+
+	// flip loaded texture's on the y-axis, per thread as textures decode in parallel at startup
+	stbi_set_flip_vertically_on_load_thread(true);
+	unsigned char* data = stbi_load(path.c_str(), &image.width, &image.height, &image.nrChannels, 0);
+	if (!data)
+		return image;
+	image.pixels.reset(data, stbi_image_free);
+	return image;
+}
 
-	stbi_set_flip_vertically_on_load(true); // flip loaded texture's on the y-axis
-	unsigned char* data = stbi_load(path.c_str(), &width, &height, &nrChannels, 0);
+void Texture::upload(const TextureImage& image)
+{
+	int width = image.width, height = image.height, nrChannels = image.nrChannels;
+	const unsigned char* data = image.pixels.get();
 
 	storage.height = height;
 	storage.width = width;
 	storage.nrChannels = nrChannels;
 
 	if (data) {
+		CPU_SCOPE("upload");
 		GLenum internalFormat = 0, dataFormat = 0;
 		if (nrChannels == 4) {
 			internalFormat = GL_RGBA8;
@@ -51,10 +79,10 @@ void Texture::loadImage(const std::string& path)
 			internalFormat = GL_RGB8;
 			dataFormat = GL_RGB;
 		}
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);	// RGB rows aren't always 4 byte multiples
 		glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, dataFormat, GL_UNSIGNED_BYTE, data);
-		glGenerateMipmap(GL_TEXTURE_2D);
-		
-		stbi_image_free(data);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		TrackGPUMemory(GPUResource::Texture, id, TextureBytes(internalFormat, image.width, image.height), "texture", image.path);
 	}
 	else
 	{
@@ -6,6 +6,15 @@
 
 // System library
 #include <string>
+#include <memory>
+
+// Decoded pixels, rows flipped for GL, freed with the last copy
+struct TextureImage
+{
+	std::string path;
+	int width = 0, height = 0, nrChannels = 0;
+	std::shared_ptr<unsigned char> pixels;
+};
 
 class Texture
 {
@@ -19,11 +28,19 @@ public:
 	TextureStorage storage;
 
 	Texture(const std::string& path);
+	// Uploads an image decoded beforehand, e.g. on a worker during startup
+	explicit Texture(const TextureImage& image);
 	~Texture();
 
+	Texture(const Texture&) = delete;
+	Texture& operator=(const Texture&) = delete;
+
 	void Bind(GLenum slot = GL_TEXTURE0) const;
 
+	// File read and decode, no GL: safe on any thread
+	static TextureImage Decode(const std::string& path);
+
 private:
 	void init();
-	void loadImage(const std::string& path);
+	void upload(const TextureImage& image);
 };
\ No newline at end of file
@@ -0,0 +1,94 @@
+#include "ThreadPool.h"
+#include "CPUProfiler.h"
+
+#include <string>
+
+ThreadPool::ThreadPool(int workerCount)
+	: m_Job(nullptr), m_JobCount(0), m_Next(0), m_Busy(0), m_Generation(0), m_Quit(false)
+{
+	if (workerCount < 0) {
+		unsigned int cores = std::thread::hardware_concurrency();
+		workerCount = cores > 1 ? (int)cores - 1 : 0;
+	}
+
+	for (int i = 0; i < workerCount; i++)
+		m_Workers.emplace_back(&ThreadPool::workerLoop, this, i);
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Quit = true;
+	}
+	m_WorkReady.notify_all();
+
+	for (std::thread& worker : m_Workers)
+		worker.join();
+}
+
+void ThreadPool::ParallelFor(uint32_t count, const std::function<void(uint32_t)>& fn)
+{
+	if (count == 0)
+		return;
+
+	// Not worth waking anyone for a single item
+	if (m_Workers.empty() || count == 1) {
+		for (uint32_t i = 0; i < count; i++)
+			fn(i);
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Job = &fn;
+		m_JobCount = count;
+		m_Next = 0;
+		m_Busy = (uint32_t)m_Workers.size();
+		m_Generation++;
+	}
+	m_WorkReady.notify_all();
+
+	runJob(fn, count);
+
+	// Workers still hold a pointer to fn, wait until all of them let go
+	std::unique_lock<std::mutex> lock(m_Mutex);
+	m_WorkDone.wait(lock, [this] { return m_Busy == 0; });
+	m_Job = nullptr;
+}
+
+void ThreadPool::workerLoop(int index)
+{
+	uint64_t seen = 0;
+	CPU_PROFILE_THREAD(("worker " + std::to_string(index)).c_str());
+
+	while (true) {
+		const std::function<void(uint32_t)>* job;
+		uint32_t count;
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			m_WorkReady.wait(lock, [&] { return m_Quit || m_Generation != seen; });
+			if (m_Quit)
+				return;
+
+			seen = m_Generation;
+			job = m_Job;
+			count = m_JobCount;
+		}
+
+		runJob(*job, count);
+
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_Busy--;
+		}
+		m_WorkDone.notify_one();
+	}
+}
+
+void ThreadPool::runJob(const std::function<void(uint32_t)>& fn, uint32_t count)
+{
+	CPU_SCOPE("parallel for");
+	for (uint32_t i = m_Next++; i < count; i = m_Next++)
+		fn(i);
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+// System library
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <cstdint>
+
+/*
+	Fixed set of worker threads that stay alive for the lifetime of the pool.
+	ParallelFor hands out indices one at a time; the calling thread takes part too,
+	so a pool with 0 workers simply runs everything inline.
+*/
+class ThreadPool
+{
+private:
+	std::vector<std::thread> m_Workers;
+	std::mutex m_Mutex;
+	std::condition_variable m_WorkReady;
+	std::condition_variable m_WorkDone;
+
+	// Current job, protected by m_Mutex (m_Next is claimed lock free)
+	const std::function<void(uint32_t)>* m_Job;
+	uint32_t m_JobCount;
+	std::atomic<uint32_t> m_Next;
+	uint32_t m_Busy;
+	uint64_t m_Generation;
+	bool m_Quit;
+
+public:
+	// workerCount == -1 picks hardware_concurrency - 1 so the caller fills the last core
+	explicit ThreadPool(int workerCount = -1);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	// Runs fn(0 .. count-1) across the pool and blocks until every call returned
+	void ParallelFor(uint32_t count, const std::function<void(uint32_t)>& fn);
+
+	// Worker threads plus the calling thread
+	unsigned int GetThreadCount() const { return (unsigned int)m_Workers.size() + 1; }
+
+private:
+	void workerLoop(int index);
+	void runJob(const std::function<void(uint32_t)>& fn, uint32_t count);
+};